@@ -0,0 +1,1991 @@
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip> // For hex formatting
+#include <utility>
+#include "z80.h"
+#include "z80_btrace.h"
+#include "z80_flags.h"
+#include "z80_jit.h"
+#include "z80_opmeta.h"
+#include "z80_profile.h"
+#include "z80_trace.h"
+
+// Function to set flags for BIT operations. X and Y are copied from xy:
+// the tested register, or the high byte of the address for (IX+d).
+static void set_bit_flags(Z80Machine &m, uint8_t value, uint8_t bit, uint8_t xy)
+{
+    uint8_t f = flags_carry(m.cpu) | FLAG_H | (xy & (FLAG_Y | FLAG_X)); // Carry is preserved, Half carry set
+    if (!(value & (1 << bit)))
+        f |= FLAG_Z | FLAG_PV; // Set Zero (and P/V) flag if bit is 0
+    else if (bit == 7)
+        f |= FLAG_S; // Set Sign flag for bit 7
+    flags_set(m.cpu, f);
+}
+
+
+// Function to display CPU state
+void Z80Machine::display_state(std::ostream &out)
+{
+    out << "A: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.a) << std::endl;
+    out << "F: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(flags_get(cpu)) << std::endl;
+    out << "B: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.b) << std::endl;
+    out << "C: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.c) << std::endl;
+    out << "D: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.d) << std::endl;
+    out << "E: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.e) << std::endl;
+    out << "H: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.h) << std::endl;
+    out << "L: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.l) << std::endl;
+    out << "I: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.i) << std::endl;
+    out << "R: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.r) << std::endl;
+    out << "A': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.a_prime) << std::endl;
+    out << "F': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.f_prime) << std::endl;
+    out << "B': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.b_prime) << std::endl;
+    out << "C': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.c_prime) << std::endl;
+    out << "D': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.d_prime) << std::endl;
+    out << "E': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.e_prime) << std::endl;
+    out << "H': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.h_prime) << std::endl;
+    out << "L': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.l_prime) << std::endl;
+    out << "IFF1: " << static_cast<int>(cpu.interrupt_enable) << std::endl;
+    out << "IFF2: " << static_cast<int>(cpu.iff2) << std::endl;
+    out << "IM: " << static_cast<int>(cpu.im) << std::endl;
+    out << "Hidden 16-bit math register: 00" << std::endl;
+    out << "IX: " << std::hex << std::setw(4) << std::setfill('0') << cpu.ix << std::endl;
+    out << "IY: " << std::hex << std::setw(4) << std::setfill('0') << cpu.iy << std::endl;
+    out << "PC: " << std::hex << std::setw(4) << std::setfill('0') << cpu.pc << std::endl;
+    out << "SP: " << std::hex << std::setw(4) << std::setfill('0') << cpu.sp << std::endl;
+}
+
+// code_bits of a machine that has no copy of its own yet: nothing marked,
+// or every slot armed and nothing else
+struct Z80_CodeBits
+{
+    uint64_t word[65536 / 64];
+};
+
+static constexpr Z80_CodeBits make_code_bits(uint64_t fill)
+{
+    Z80_CodeBits bits{};
+    for (uint64_t &word : bits.word)
+        word = fill;
+    return bits;
+}
+
+static constexpr Z80_CodeBits no_code_bits = make_code_bits(0);
+static constexpr Z80_CodeBits all_code_bits = make_code_bits(~0ULL);
+
+// Memory of a machine that has not been given any yet
+static const std::shared_ptr<const Z80_Image> &zero_image()
+{
+    static const std::shared_ptr<const Z80_Image> image = std::make_shared<Z80_Image>(); // Zeroed
+    return image;
+}
+
+// Everything sized by the address space (memory, code_bits, block index
+// pages) lives on the heap, allocated when first used, so that thousands of
+// machines stay cheap; only per-slot tables and the block index grow with it
+static_assert(sizeof(Z80Machine) <= 3072 + 32 * Z80_PAGES, "Z80Machine should keep its large tables on the heap");
+
+Z80Machine::Z80Machine() : ram(nullptr), code_bits(no_code_bits.word), block_count(0), code_written(false),
+                           int_lines(0), int_data(0xFF), repeat_cycles(0), recorder(nullptr),
+                           debugging(false), resume_pc(-1), stop(), dirty_tracking(false), dirty(),
+                           shared()
+{
+#if Z80_BUS_CYCLES
+    bus_log = nullptr;
+#endif
+    map_image(zero_image()); // No 64KB of its own until init() asks for it
+    mark_traps();
+}
+
+Z80Machine::~Z80Machine()
+{
+}
+
+bool Z80Machine::enable_jit(bool on)
+{
+    flush_blocks(); // Blocks only carry translations from the current JIT
+    if (on && Z80_JIT_SUPPORTED)
+    {
+        if (!jit)
+            jit.reset(new Z80Jit());
+    }
+    else
+    {
+        jit.reset();
+    }
+    return jit != nullptr;
+}
+
+bool Z80Machine::enable_profile(bool on)
+{
+    if (on && Z80_PROFILE)
+        profile.reset(new Z80_Profile()); // Zeroed
+    else
+        profile.reset();
+    return profile != nullptr;
+}
+
+bool Z80Machine::set_recorder(Z80TraceWriter *writer)
+{
+    recorder = Z80_TRACE_LEVEL >= Z80_TRACE_INSN ? writer : nullptr;
+    return recorder == writer;
+}
+
+void Z80Machine::record_write(uint16_t addr)
+{
+    recorder->write(addr, mem_read(addr)); // What landed: ROM keeps its byte
+}
+
+uint8_t *Z80Machine::own_memory()
+{
+    if (!own_ram)
+        own_ram.reset(new uint8_t[65536]()); // Zeroed
+    return own_ram.get();
+}
+
+// Initialize the Z80
+void Z80Machine::init()
+{
+    if (ram == nullptr)
+        ram = own_memory();
+    std::memset(ram, 0, 65536);
+    unshare();
+    memory_map.map_flat(ram);
+    memory_map.drop_banks(); // No slot is on them any more
+    reset();
+}
+
+void Z80Machine::init(std::shared_ptr<const Z80_Image> shared_image)
+{
+    map_image(std::move(shared_image));
+    reset();
+}
+
+// Every slot onto the image, copy-on-write
+void Z80Machine::map_image(std::shared_ptr<const Z80_Image> shared_image)
+{
+    image = std::move(shared_image);
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+    {
+        shared[slot] = 1;
+        memory_map.map_shared(slot, image->bytes + slot * Z80_PAGE_SIZE);
+    }
+    memory_map.drop_banks();
+}
+
+int Z80Machine::private_pages() const
+{
+    int pages = 0;
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        pages += image && !shared[slot];
+    return pages;
+}
+
+void Z80Machine::unshare()
+{
+    image.reset();
+    std::memset(shared, 0, sizeof(shared));
+}
+
+// CPU and interrupt state of init(), with the memory already mapped
+void Z80Machine::reset()
+{
+    std::memset(&cpu, 0, sizeof(Z80_CPU));
+    flush_blocks();
+    int_lines = 0;
+    int_data = 0xFF;
+    cpu.pc = 0x0000; // Start execution at address 0x0001
+    cpu.sp = 0x0000; // Initialize stack pointer to 0x0000
+    cpu.ix = 0xFFFF; // Initialize IX register
+    cpu.iy = 0xFFFF; // Initialize IY register
+    cpu.r = 0x01;    // Initialize Refresh register
+    cpu.f = 0x40;    // Set Zero flag
+    Z80_LOG_SUMMARY("Z80 initialized. PC: %04x, SP: %x\n", cpu.pc, cpu.sp);
+}
+
+// Opcode table entry: handler plus what the decoder needs to know about
+// the instruction without running it
+struct Z80_OpInfo
+{
+    Z80_Handler handler;
+    uint8_t operand_bytes; // Immediate bytes after the opcode (0, 1 or 2)
+    uint8_t cycles;        // T-states (the longer case for conditional branches)
+    bool ends_block;       // Branches and HALT end a basic block
+};
+
+struct Z80_OpTable
+{
+    Z80_OpInfo op[256];
+};
+
+// ---------------------------------------------------------------------------
+// Unprefixed opcodes
+// ---------------------------------------------------------------------------
+
+static int op_nop(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("NOP (No Operation)\n");
+    return insn.cycles;
+}
+
+static int op_ld_bc_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t value = insn.operand;
+    m.cpu.bc = value;
+    Z80_LOG_INSN("LD BC, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_ind_bc_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t address = m.cpu.bc;
+    m.mem_write(address, m.cpu.a);
+    Z80_LOG_INSN("LD (BC), A (Address: %x)\n", address);
+    return insn.cycles;
+}
+
+static int op_ld_b_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.b = value;
+    Z80_LOG_INSN("LD B, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_c_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.c = value;
+    Z80_LOG_INSN("LD C, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_de_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t value = insn.operand;
+    m.cpu.de = value;
+    Z80_LOG_INSN("LD DE, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_d_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.d = value;
+    Z80_LOG_INSN("LD D, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_jr_e(Z80Machine &m, const Z80_Insn &insn)
+{
+    int8_t offset = static_cast<int8_t>(insn.operand); // Signed 8-bit offset
+    m.cpu.pc += offset;                                  // Apply the relative jump
+    Z80_LOG_INSN("JR (Jump Relative) by offset: %d\n", offset);
+    return insn.cycles;
+}
+
+static int op_ld_e_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.e = value;
+    Z80_LOG_INSN("LD E, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_hl_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t value = insn.operand;
+    m.cpu.hl = value;
+    Z80_LOG_INSN("LD HL, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_h_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.h = value;
+    Z80_LOG_INSN("LD H, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_ld_l_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.l = value;
+    Z80_LOG_INSN("LD L, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_scf(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t f = flags_get(m.cpu) & (FLAG_S | FLAG_Z | FLAG_PV); // H and N cleared
+    flags_set(m.cpu, f | FLAG_C | (m.cpu.a & (FLAG_Y | FLAG_X)));   // Set Carry flag
+    Z80_LOG_INSN("SCF (Set Carry Flag)\n");
+    return insn.cycles;
+}
+
+static int op_ld_a_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t value = static_cast<uint8_t>(insn.operand);
+    m.cpu.a = value;
+    Z80_LOG_INSN("LD A, %x\n", value);
+    return insn.cycles;
+}
+
+static int op_halt(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.cpu.pc--; // Stay on the HALT
+    m.cpu.halted = 1;
+    Z80_LOG_INSN("HLT (Halt Execution)\n");
+    return insn.cycles;
+}
+
+static int op_add_a_b(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t result = m.cpu.a + m.cpu.b;
+    flags_defer(m.cpu, FLAGS_ADD8, m.cpu.a, m.cpu.b, result);
+    m.cpu.a = static_cast<uint8_t>(result);
+    Z80_LOG_INSN("ADD A, B (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_sub_b(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t result = m.cpu.a - m.cpu.b; // Perform subtraction
+    flags_defer(m.cpu, FLAGS_SUB8, m.cpu.a, m.cpu.b, result);
+    m.cpu.a = static_cast<uint8_t>(result); // Store the result
+    Z80_LOG_INSN("SUB A, B (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_ret(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t low_byte = m.mem_read(m.cpu.sp++);
+    uint16_t high_byte = m.mem_read(m.cpu.sp++);
+    m.cpu.pc = (high_byte << 8) | low_byte; // Pop the return address
+    Z80_LOG_INSN("RET to address: %x\n", m.cpu.pc);
+    return insn.cycles;
+}
+
+static int op_jp_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t target_address = insn.operand;
+    Z80_LOG_INSN("JP to address: %x\n", target_address);
+    m.cpu.pc = target_address; // Update PC to the target address
+    return insn.cycles;
+}
+
+static int op_call_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t target_address = insn.operand; // Fetch 16-bit target address, PC now after CALL
+    m.mem_write(--m.cpu.sp, (m.cpu.pc >> 8) & 0xFF); // Push high byte of PC to stack
+    m.mem_write(--m.cpu.sp, m.cpu.pc & 0xFF);        // Push low byte of PC to stack
+    m.cpu.pc = target_address;                // Jump to target address
+    Z80_LOG_INSN("CALL to address: %x\n", target_address);
+    return insn.cycles;
+}
+
+// RST n: one-byte call to a fixed page-zero address
+template <uint8_t ADDR>
+static int op_rst(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.mem_write(--m.cpu.sp, (m.cpu.pc >> 8) & 0xFF);
+    m.mem_write(--m.cpu.sp, m.cpu.pc & 0xFF);
+    m.cpu.pc = ADDR;
+    Z80_LOG_INSN("RST %02xh\n", ADDR);
+    return insn.cycles;
+}
+
+static int op_di(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.cpu.interrupt_enable = 0;
+    m.cpu.iff2 = 0;
+    Z80_LOG_INSN("DI (Disable Interrupts)\n");
+    return insn.cycles;
+}
+
+// EI takes effect after the instruction that follows it, so that EI; RET
+// returns before the next interrupt. It ends the block, and execute()
+// holds a pending INT off until one more instruction has run.
+static int op_ei(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.cpu.interrupt_enable = 1;
+    m.cpu.iff2 = 1;
+    m.cpu.ei_delay = 1;
+    Z80_LOG_INSN("EI (Enable Interrupts)\n");
+    return insn.cycles;
+}
+
+// OUT (n), A and IN A, (n): A goes out on the high address lines
+static int op_out_n_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t port = m.cpu.a << 8 | (insn.operand & 0xFF);
+    m.port_out(port, m.cpu.a);
+    Z80_LOG_INSN("OUT (%x), A (Port: %04x)\n", insn.operand, port);
+    return insn.cycles;
+}
+
+static int op_in_a_n(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t port = m.cpu.a << 8 | (insn.operand & 0xFF);
+    m.cpu.a = m.port_in(port); // No flags affected
+    Z80_LOG_INSN("IN A, (%x) (Port: %04x, Value: %x)\n", insn.operand, port, m.cpu.a);
+    return insn.cycles;
+}
+
+// INC r / DEC r, templated on the register and its name for the trace
+template <uint8_t Z80_CPU::*REG, char NAME>
+static int op_inc_r(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu); // Carry is preserved
+    m.cpu.*REG = m.cpu.*REG + 1;
+    flags_defer(m.cpu, FLAGS_INC8, carry, 0, m.cpu.*REG);
+    Z80_LOG_INSN("INC %c (Result: %x)\n", NAME, m.cpu.*REG);
+    return insn.cycles;
+}
+
+template <uint8_t Z80_CPU::*REG, char NAME>
+static int op_dec_r(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu); // Carry is preserved
+    m.cpu.*REG = m.cpu.*REG - 1;
+    flags_defer(m.cpu, FLAGS_DEC8, carry, 0, m.cpu.*REG);
+    Z80_LOG_INSN("DEC %c (Result: %x)\n", NAME, m.cpu.*REG);
+    return insn.cycles;
+}
+
+// Branch conditions in opcode order: NZ, Z, NC, C, PO, PE, P, M
+static const char *const condition_names[8] = {"NZ", "Z", "NC", "C", "PO", "PE", "P", "M"};
+
+template <int CC>
+static inline bool condition(Z80Machine &m)
+{
+    if (CC == 2 || CC == 3)
+        return (flags_carry(m.cpu) != 0) == (CC == 3); // Carry alone is cheap
+    static const uint8_t masks[8] = {FLAG_Z, FLAG_Z, FLAG_C, FLAG_C, FLAG_PV, FLAG_PV, FLAG_S, FLAG_S};
+    return ((flags_get(m.cpu) & masks[CC]) != 0) == (CC & 1);
+}
+
+template <int CC>
+static int op_jr_cc_e(Z80Machine &m, const Z80_Insn &insn)
+{
+    int8_t offset = static_cast<int8_t>(insn.operand); // Signed 8-bit offset
+    bool taken = condition<CC>(m);
+    if (taken)
+        m.cpu.pc += offset;
+    Z80_LOG_INSN("JR %s by offset: %d (%s)\n", condition_names[CC], offset, taken ? "Taken" : "Not taken");
+    return taken ? insn.cycles : z80_base_meta[0x20 + 8 * CC].cycles_short;
+}
+
+template <int CC>
+static int op_jp_cc_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t target_address = insn.operand;
+    bool taken = condition<CC>(m);
+    if (taken)
+        m.cpu.pc = target_address;
+    Z80_LOG_INSN("JP %s to address: %x (%s)\n", condition_names[CC], target_address, taken ? "Taken" : "Not taken");
+    return insn.cycles;
+}
+
+static int op_pop_af(Z80Machine &m, const Z80_Insn &insn)
+{
+    flags_set(m.cpu, m.mem_read(m.cpu.sp++));
+    m.cpu.a = m.mem_read(m.cpu.sp++);
+    Z80_LOG_INSN("POP AF (Value: %x)\n", m.cpu.af);
+    return insn.cycles;
+}
+
+static int op_push_af(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.mem_write(--m.cpu.sp, m.cpu.a);           // Push high byte (A)
+    m.mem_write(--m.cpu.sp, flags_get(m.cpu)); // Push low byte (F)
+    Z80_LOG_INSN("PUSH AF (Value: %x)\n", m.cpu.af);
+    return insn.cycles;
+}
+
+// The exchanges swap whole pairs. F goes into the shadow set, so pending
+// lazy flags are made current first.
+static int op_ex_af_af(Z80Machine &m, const Z80_Insn &insn)
+{
+    flags_get(m.cpu);
+    std::swap(m.cpu.af, m.cpu.af_prime);
+    Z80_LOG_INSN("EX AF, AF' (AF: %x)\n", m.cpu.af);
+    return insn.cycles;
+}
+
+static int op_exx(Z80Machine &m, const Z80_Insn &insn)
+{
+    std::swap(m.cpu.bc, m.cpu.bc_prime);
+    std::swap(m.cpu.de, m.cpu.de_prime);
+    std::swap(m.cpu.hl, m.cpu.hl_prime);
+    Z80_LOG_INSN("EXX (BC: %x, DE: %x, HL: %x)\n", m.cpu.bc, m.cpu.de, m.cpu.hl);
+    return insn.cycles;
+}
+
+static int op_ex_de_hl(Z80Machine &m, const Z80_Insn &insn)
+{
+    std::swap(m.cpu.de, m.cpu.hl);
+    Z80_LOG_INSN("EX DE, HL (DE: %x, HL: %x)\n", m.cpu.de, m.cpu.hl);
+    return insn.cycles;
+}
+
+static int op_ex_ind_sp_hl(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t low = m.mem_read(m.cpu.sp);
+    uint8_t high = m.mem_read(m.cpu.sp + 1);
+    m.mem_write(m.cpu.sp, m.cpu.l);
+    m.mem_write(m.cpu.sp + 1, m.cpu.h);
+    m.cpu.l = low;
+    m.cpu.h = high;
+    Z80_LOG_INSN("EX (SP), HL (HL: %x)\n", m.cpu.hl);
+    return insn.cycles;
+}
+
+static int op_unknown(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("Unknown opcode: %x\n", insn.opcode);
+    return insn.cycles;
+}
+
+// ---------------------------------------------------------------------------
+// CB-prefixed opcodes
+// ---------------------------------------------------------------------------
+
+static int op_cb_rlc_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = (m.cpu.a & 0x80) >> 7;              // MSB as carry
+    m.cpu.a = (m.cpu.a << 1) | carry;                     // Rotate left
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.a);
+    Z80_LOG_INSN("RLC A (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_cb_rlc_b(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = (m.cpu.b & 0x80) >> 7;              // Extract MSB
+    m.cpu.b = (m.cpu.b << 1) | carry;                     // Rotate left circular
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.b);
+    Z80_LOG_INSN("RLC B (Result: %x)\n", m.cpu.b);
+    return insn.cycles;
+}
+
+static int op_cb_rrc_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = m.cpu.a & 0x01;                     // LSB as carry
+    m.cpu.a = (m.cpu.a >> 1) | (carry << 7);              // Rotate right
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.a);
+    Z80_LOG_INSN("RRC A (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_cb_rl_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu);                 // Carry flag
+    uint8_t new_carry = (m.cpu.a & 0x80) >> 7;          // MSB as new carry
+    m.cpu.a = (m.cpu.a << 1) | carry;                     // Rotate left through carry
+    flags_defer(m.cpu, FLAGS_SZP, new_carry, 0, m.cpu.a);
+    Z80_LOG_INSN("RL A (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_cb_rr_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu);                 // Carry flag
+    uint8_t new_carry = m.cpu.a & 0x01;                 // LSB as new carry
+    m.cpu.a = (m.cpu.a >> 1) | (carry << 7);              // Rotate right through carry
+    flags_defer(m.cpu, FLAGS_SZP, new_carry, 0, m.cpu.a);
+    Z80_LOG_INSN("RR A (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_cb_sra_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = m.cpu.a & 0x01;                     // LSB for carry
+    m.cpu.a = (m.cpu.a >> 1) | (m.cpu.a & 0x80);            // Preserve MSB
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.a);
+    Z80_LOG_INSN("SRA A (Result: %x)\n", m.cpu.a);
+    return insn.cycles;
+}
+
+static int op_cb_sra_b(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = m.cpu.b & 0x01;                     // LSB for carry
+    m.cpu.b = (m.cpu.b >> 1) | (m.cpu.b & 0x80);            // Preserve MSB
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.b);
+    Z80_LOG_INSN("SRA B (Result: %x)\n", m.cpu.b);
+    return insn.cycles;
+}
+
+static int op_cb_sra_d(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = m.cpu.d & 0x01;                     // LSB for carry
+    m.cpu.d = (m.cpu.d >> 1) | (m.cpu.d & 0x80);            // Preserve MSB
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.d);
+    Z80_LOG_INSN("SRA D (Result: %x)\n", m.cpu.d);
+    return insn.cycles;
+}
+
+static int op_cb_srl_c(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = m.cpu.c & 0x01;                     // LSB for carry
+    m.cpu.c >>= 1;
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.c);
+    Z80_LOG_INSN("SRL C (Result: %x)\n", m.cpu.c);
+    return insn.cycles;
+}
+
+static int op_cb_bit5_ind_hl(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t address = m.cpu.hl;
+    uint8_t value = m.mem_read(address);
+    set_bit_flags(m, value, 5, value);
+    Z80_LOG_INSN("BIT 5, (HL) at address: %x\n", address);
+    return insn.cycles;
+}
+
+static int op_cb_bit5_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    set_bit_flags(m, m.cpu.a, 5, m.cpu.a);
+    Z80_LOG_INSN("BIT 5, A (Value: %x, Result: %s)\n", m.cpu.a, (m.cpu.a & (1 << 5)) ? "Set" : "Unset");
+    return insn.cycles;
+}
+
+static int op_cb_unknown(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("Unknown CB-prefixed opcode: %x\n", insn.opcode);
+    return insn.cycles;
+}
+
+// ---------------------------------------------------------------------------
+// ED-prefixed opcodes
+// ---------------------------------------------------------------------------
+
+static int op_ed_sbc_hl_bc(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t hl = m.cpu.hl;
+    uint32_t result = static_cast<uint32_t>(hl) - m.cpu.bc - flags_carry(m.cpu);
+    flags_defer(m.cpu, FLAGS_SUB16, hl, m.cpu.bc, result);
+    m.cpu.hl = static_cast<uint16_t>(result);
+    Z80_LOG_INSN("SBC HL, BC (Result: %x)\n", m.cpu.hl);
+    return insn.cycles;
+}
+
+static int op_ed_ld_r_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.cpu.r = m.cpu.a;
+    Z80_LOG_INSN("LD R, A\n");
+    return insn.cycles;
+}
+
+static int op_ed_adc_hl_de(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t hl = m.cpu.hl;
+    uint32_t result = static_cast<uint32_t>(hl) + m.cpu.de + flags_carry(m.cpu);
+    flags_defer(m.cpu, FLAGS_ADD16, hl, m.cpu.de, result);
+    m.cpu.hl = static_cast<uint16_t>(result);
+    Z80_LOG_INSN("ADC HL, DE (Result: %x)\n", m.cpu.hl);
+    return insn.cycles;
+}
+
+// IN r, (C) / OUT (C), r, templated on the register like INC r. The port
+// is the whole of BC.
+template <uint8_t Z80_CPU::*REG, char NAME>
+static int op_ed_in_r_c(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu); // Carry is preserved
+    m.cpu.*REG = m.port_in(m.cpu.bc);
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, m.cpu.*REG);
+    Z80_LOG_INSN("IN %c, (C) (Value: %x)\n", NAME, m.cpu.*REG);
+    return insn.cycles;
+}
+
+// IN (C): sets the flags and drops the byte
+static int op_ed_in_c(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint8_t carry = flags_carry(m.cpu);
+    uint8_t value = m.port_in(m.cpu.bc);
+    flags_defer(m.cpu, FLAGS_SZP, carry, 0, value);
+    Z80_LOG_INSN("IN (C) (Value: %x)\n", value);
+    return insn.cycles;
+}
+
+template <uint8_t Z80_CPU::*REG, char NAME>
+static int op_ed_out_c_r(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.port_out(m.cpu.bc, m.cpu.*REG);
+    Z80_LOG_INSN("OUT (C), %c\n", NAME);
+    return insn.cycles;
+}
+
+static int op_ed_out_c_0(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.port_out(m.cpu.bc, 0);
+    Z80_LOG_INSN("OUT (C), 0\n");
+    return insn.cycles;
+}
+
+template <uint8_t MODE>
+static int op_ed_im(Z80Machine &m, const Z80_Insn &insn)
+{
+    m.cpu.im = MODE;
+    Z80_LOG_INSN("IM %d\n", MODE);
+    return insn.cycles;
+}
+
+// RETN and RETI: return and restore IFF1 from IFF2. RETI only differs on
+// the bus, where Z80 peripherals watch for it.
+template <bool RETI>
+static int op_ed_retn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t low_byte = m.mem_read(m.cpu.sp++);
+    uint16_t high_byte = m.mem_read(m.cpu.sp++);
+    m.cpu.pc = (high_byte << 8) | low_byte;
+    m.cpu.interrupt_enable = m.cpu.iff2;
+    Z80_LOG_INSN("%s to address: %x\n", RETI ? "RETI" : "RETN", m.cpu.pc);
+    return insn.cycles;
+}
+
+// Block instructions. One dispatch of a repeating form (LDIR, CPIR...) runs
+// every iteration left, or as many as start within execute()'s budget, and
+// ends with the registers, flags, R and T-states the same iterations would
+// have left one dispatch each: 21 T-states per repeat, 16 for the last.
+static constexpr int repeat_pass = z80_ed_meta[0xB0].cycles;
+static constexpr int repeat_last = z80_ed_meta[0xB0].cycles_short;
+
+// Iterations to run now out of `left`: all of them, or as many as start
+// within the budget, at least one
+static uint32_t repeat_count(const Z80Machine &m, uint32_t left)
+{
+    int budget = m.repeat_budget();
+    uint32_t fit = budget > 0 ? (static_cast<uint32_t>(budget) + repeat_pass - 1) / repeat_pass : 1;
+    return left < fit ? left : fit;
+}
+
+// T-states for `done` iterations, with R counted once per iteration. An
+// unfinished repeat moves PC back to run the instruction again.
+static int repeat_end(Z80Machine &m, uint32_t done, bool again)
+{
+    m.cpu.r = (m.cpu.r + done - 1) & 0x7F; // execute() counted the first
+    if (again)
+    {
+        m.cpu.pc -= 2;
+        return repeat_pass * done;
+    }
+    return repeat_pass * (done - 1) + repeat_last;
+}
+
+// Bytes from addr to the edge of its slot, going up (STEP 1) or down (-1)
+template <int STEP>
+static inline uint32_t slot_room(uint16_t addr)
+{
+    return STEP > 0 ? Z80_PAGE_SIZE - (addr & Z80_PAGE_MASK) : (addr & Z80_PAGE_MASK) + 1;
+}
+
+// Copy a run of k bytes the way k LDI (STEP 1) or LDD (-1) iterations
+// would; dst and src point at the lowest byte of each run. When the copy
+// reads bytes it has already written the pattern repeats, so that case
+// goes byte by byte, or is a memset for the fill idiom (DE = HL + 1).
+template <int STEP>
+static void block_copy(uint8_t *dst, const uint8_t *src, uint32_t k)
+{
+    uintptr_t d = reinterpret_cast<uintptr_t>(dst), s = reinterpret_cast<uintptr_t>(src);
+    if (STEP > 0 ? d > s && d < s + k : d < s && d + k > s)
+    {
+        if (STEP > 0 ? d == s + 1 : d + 1 == s)
+            std::memset(dst, STEP > 0 ? src[0] : src[k - 1], k);
+        else if (STEP > 0)
+            for (uint32_t i = 0; i < k; i++)
+                dst[i] = src[i];
+        else
+            for (uint32_t i = k; i-- > 0;)
+                dst[i] = src[i];
+    }
+    else
+    {
+        std::memmove(dst, src, k);
+    }
+}
+
+// LDI, LDD, LDIR, LDDR. Runs that stay inside one slot on both sides are
+// copied at once; a destination holding cached code (or any write while
+// recording) takes one iteration through mem_write and ends the dispatch,
+// since it may have rewritten this very instruction. So does a watched
+// source or destination.
+template <int STEP, bool REPEAT>
+static int op_ed_ld_block(Z80Machine &m, const Z80_Insn &)
+{
+    Z80_CPU &cpu = m.cpu;
+    uint32_t n = REPEAT ? repeat_count(m, cpu.bc != 0 ? cpu.bc : 0x10000) : 1;
+    uint32_t done = 0;
+    uint8_t value = 0;
+    while (done < n)
+    {
+        uint32_t k = std::min({n - done, slot_room<STEP>(cpu.hl), slot_room<STEP>(cpu.de)});
+        uint16_t low = STEP > 0 ? 0 : k - 1; // Run starts this far below HL and DE
+        uint8_t *dst = m.direct_span(static_cast<uint16_t>(cpu.de - low), k, true);
+        const uint8_t *src = m.direct_span(static_cast<uint16_t>(cpu.hl - low), k, false);
+        if (dst == nullptr || src == nullptr)
+        {
+            value = m.mem_read(cpu.hl);
+            m.mem_write(cpu.de, value);
+            cpu.hl += STEP;
+            cpu.de += STEP;
+            cpu.bc--;
+            done++;
+            break;
+        }
+        block_copy<STEP>(dst, src, k);
+        value = STEP > 0 ? dst[k - 1] : dst[0];
+        cpu.hl += STEP * static_cast<int>(k);
+        cpu.de += STEP * static_cast<int>(k);
+        cpu.bc -= k;
+        done += k;
+    }
+
+    // Bits 5 and 3 of F are bits 1 and 3 of A plus the last byte copied
+    uint8_t xy = cpu.a + value;
+    flags_set(cpu, (flags_get(cpu) & (FLAG_S | FLAG_Z | FLAG_C)) | (cpu.bc != 0 ? FLAG_PV : 0) | (xy & FLAG_X) |
+                       ((xy << 4) & FLAG_Y));
+    Z80_LOG_INSN("LD%c%s (%u bytes, BC: %x)\n", STEP > 0 ? 'I' : 'D', REPEAT ? "R" : "", done, cpu.bc);
+    return repeat_end(m, done, REPEAT && cpu.bc != 0);
+}
+
+// CPI, CPD, CPIR, CPDR. A run inside one slot is searched with memchr (a
+// byte loop going down); a watched run takes one iteration through
+// mem_read.
+template <int STEP, bool REPEAT>
+static int op_ed_cp_block(Z80Machine &m, const Z80_Insn &)
+{
+    Z80_CPU &cpu = m.cpu;
+    uint32_t n = REPEAT ? repeat_count(m, cpu.bc != 0 ? cpu.bc : 0x10000) : 1;
+    uint32_t done = 0;
+    uint8_t value = 0;
+    while (done < n)
+    {
+        uint32_t k = std::min(n - done, slot_room<STEP>(cpu.hl));
+        const uint8_t *run = m.direct_span(static_cast<uint16_t>(STEP > 0 ? cpu.hl : cpu.hl - (k - 1)), k, false);
+        const uint8_t *hit;
+        if (run == nullptr)
+        {
+            value = m.mem_read(cpu.hl);
+            cpu.hl += STEP;
+            cpu.bc--;
+            done++;
+            break;
+        }
+        if (STEP > 0)
+        {
+            hit = static_cast<const uint8_t *>(std::memchr(run, cpu.a, k));
+            if (hit != nullptr)
+                k = static_cast<uint32_t>(hit - run) + 1;
+        }
+        else
+        {
+            hit = nullptr;
+            for (const uint8_t *p = run + k; p != run;)
+            {
+                if (*--p == cpu.a)
+                {
+                    hit = p;
+                    k = static_cast<uint32_t>(run + k - p);
+                    break;
+                }
+            }
+        }
+        value = m.mem_read(static_cast<uint16_t>(cpu.hl + STEP * static_cast<int>(k - 1))); // Last byte compared
+        cpu.hl += STEP * static_cast<int>(k);
+        cpu.bc -= k;
+        done += k;
+        if (hit != nullptr)
+            break;
+    }
+
+    // As CP (HL) with the carry kept; bits 5 and 3 from A - (HL) - H
+    uint8_t result = cpu.a - value;
+    uint8_t half = (cpu.a ^ value ^ result) & FLAG_H;
+    uint8_t xy = result - (half ? 1 : 0);
+    flags_set(cpu, flags_carry(cpu) | (result & FLAG_S) | (result == 0 ? FLAG_Z : 0) | half | FLAG_N |
+                       (cpu.bc != 0 ? FLAG_PV : 0) | (xy & FLAG_X) | ((xy << 4) & FLAG_Y));
+    Z80_LOG_INSN("CP%c%s (%u bytes, BC: %x)\n", STEP > 0 ? 'I' : 'D', REPEAT ? "R" : "", done, cpu.bc);
+    return repeat_end(m, done, REPEAT && cpu.bc != 0 && result != 0);
+}
+
+// Flags after INI/OUTI and friends: S, Z, 5 and 3 from B, N from bit 7 of
+// the byte, H and C from the carry out of k (the byte plus C +/- 1 for IN,
+// plus L for OUT) and P/V from the parity of its low 3 bits XOR B
+static inline uint8_t io_block_flags(uint8_t b, uint8_t value, unsigned k)
+{
+    return sz_table.f[b] | (value & 0x80 ? FLAG_N : 0) | (k > 0xFF ? FLAG_H | FLAG_C : 0) |
+           (szp_table.f[(k & 7) ^ b] & FLAG_PV);
+}
+
+// INI, IND, INIR, INDR. Every byte is a port access, so the repeating forms
+// loop here without the bulk step, saving the dispatch per byte. They stop
+// once a device raises an interrupt or a write lands on cached code.
+template <int STEP, bool REPEAT>
+static int op_ed_in_block(Z80Machine &m, const Z80_Insn &)
+{
+    Z80_CPU &cpu = m.cpu;
+    uint32_t n = REPEAT ? repeat_count(m, cpu.b != 0 ? cpu.b : 0x100) : 1;
+    uint32_t done = 0;
+    uint8_t value;
+    bool direct;
+    do
+    {
+        value = m.port_in(cpu.bc);
+        direct = m.direct_span(cpu.hl, 1, true) != nullptr;
+        m.mem_write(cpu.hl, value);
+        cpu.b--;
+        cpu.hl += STEP;
+        done++;
+    } while (done < n && direct && !m.interrupt_pending());
+
+    flags_set(cpu, io_block_flags(cpu.b, value, value + ((cpu.c + STEP) & 0xFF)));
+    Z80_LOG_INSN("IN%c%s (%u bytes, B: %x)\n", STEP > 0 ? 'I' : 'D', REPEAT ? "R" : "", done, cpu.b);
+    return repeat_end(m, done, REPEAT && cpu.b != 0);
+}
+
+// OUTI, OUTD, OTIR, OTDR. B is decremented before it goes out on the port's
+// high byte.
+template <int STEP, bool REPEAT>
+static int op_ed_out_block(Z80Machine &m, const Z80_Insn &)
+{
+    Z80_CPU &cpu = m.cpu;
+    uint32_t n = REPEAT ? repeat_count(m, cpu.b != 0 ? cpu.b : 0x100) : 1;
+    uint32_t done = 0;
+    uint8_t value;
+    do
+    {
+        value = m.mem_read(cpu.hl);
+        cpu.b--;
+        m.port_out(cpu.bc, value);
+        cpu.hl += STEP;
+        done++;
+    } while (done < n && !m.interrupt_pending());
+
+    flags_set(cpu, io_block_flags(cpu.b, value, value + cpu.l));
+    Z80_LOG_INSN("%s (%u bytes, B: %x)\n", REPEAT ? (STEP > 0 ? "OTIR" : "OTDR") : (STEP > 0 ? "OUTI" : "OUTD"), done,
+                 cpu.b);
+    return repeat_end(m, done, REPEAT && cpu.b != 0);
+}
+
+static int op_ed_unknown(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("Unknown ED-prefixed opcode: %x\n", insn.opcode);
+    return insn.cycles;
+}
+
+// ---------------------------------------------------------------------------
+// DD/FD-prefixed opcodes, templated on the prefix byte to pick IX or IY
+// ---------------------------------------------------------------------------
+
+template <uint8_t PREFIX>
+static inline uint16_t &index_reg(Z80Machine &m)
+{
+    return PREFIX == 0xDD ? m.cpu.ix : m.cpu.iy;
+}
+
+template <uint8_t PREFIX>
+static inline const char *index_name()
+{
+    return PREFIX == 0xDD ? "IX" : "IY";
+}
+
+template <uint8_t PREFIX>
+static int op_idx_ld_idx_nn(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t value = insn.operand;
+    index_reg<PREFIX>(m) = value;
+    Z80_LOG_INSN("LD %s, %x\n", index_name<PREFIX>(), value);
+    return insn.cycles;
+}
+
+template <uint8_t PREFIX>
+static int op_idx_ld_ind_idx_a(Z80Machine &m, const Z80_Insn &insn)
+{
+    int8_t offset = static_cast<int8_t>(insn.operand);
+    uint16_t address = index_reg<PREFIX>(m) + offset;
+    m.mem_write(address, m.cpu.a);
+    Z80_LOG_INSN("LD (%s+%x), A (Address: %x)\n", index_name<PREFIX>(), offset, address);
+    return insn.cycles;
+}
+
+template <uint8_t PREFIX>
+static int op_idx_sub_ind_idx(Z80Machine &m, const Z80_Insn &insn)
+{
+    int8_t offset = static_cast<int8_t>(insn.operand);
+    uint16_t address = index_reg<PREFIX>(m) + offset;
+    uint8_t value = m.mem_read(address);
+    uint16_t result = m.cpu.a - value;
+    flags_defer(m.cpu, FLAGS_SUB8, m.cpu.a, value, result);
+    m.cpu.a = static_cast<uint8_t>(result);
+    Z80_LOG_INSN("SUB (%s+%x) (Address: %x)\n", index_name<PREFIX>(), offset, address);
+    return insn.cycles;
+}
+
+static int op_idx_unknown(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("Unknown opcode after prefix: %x\n", insn.opcode);
+    return insn.cycles;
+}
+
+// DDCB/FDCB handlers: the displacement is the operand, the final opcode
+// byte comes after it
+
+template <uint8_t PREFIX>
+static int op_idxcb_bit5(Z80Machine &m, const Z80_Insn &insn)
+{
+    int8_t offset = static_cast<int8_t>(insn.operand);
+    uint16_t address = index_reg<PREFIX>(m) + offset;
+    uint8_t value = m.mem_read(address);          // Read from memory
+    set_bit_flags(m, value, 5, address >> 8); // Test bit 5
+    Z80_LOG_INSN("BIT 5, (%s+%x) (Address: %x)\n", index_name<PREFIX>(), offset, address);
+    return insn.cycles;
+}
+
+template <uint8_t PREFIX>
+static int op_idxcb_unknown(Z80Machine &, const Z80_Insn &insn)
+{
+    Z80_LOG_INSN("Unknown CB-prefixed opcode after %s: %x\n", PREFIX == 0xDD ? "DD" : "FD", insn.opcode);
+    return insn.cycles;
+}
+
+// ---------------------------------------------------------------------------
+// Opcode tables. This is the one place new instructions get wired in:
+// write the handler above and add an X(opcode, handler) line below; operand
+// bytes and T-states come from the metadata in z80_opmeta.h. Branches, and
+// anything after which a pending interrupt must be looked at, go in the
+// *_BRANCHES lists so they end a block.
+// ---------------------------------------------------------------------------
+
+#define Z80_CB_OPS(X)          \
+    X(0x07, op_cb_rlc_a)       \
+    X(0x08, op_cb_rlc_b)       \
+    X(0x0F, op_cb_rrc_a)       \
+    X(0x17, op_cb_rl_a)        \
+    X(0x1F, op_cb_rr_a)        \
+    X(0x27, op_cb_sra_a)       \
+    X(0x28, op_cb_sra_b)       \
+    X(0x2F, op_cb_bit5_ind_hl) \
+    X(0x31, op_cb_srl_c)       \
+    X(0x3A, op_cb_sra_d)       \
+    X(0x6F, op_cb_bit5_a)
+
+#define Z80_ED_OPS(X)                          \
+    X(0x40, (op_ed_in_r_c<&Z80_CPU::b, 'B'>))  \
+    X(0x41, (op_ed_out_c_r<&Z80_CPU::b, 'B'>)) \
+    X(0x42, op_ed_sbc_hl_bc)                   \
+    X(0x46, op_ed_im<0>)                       \
+    X(0x48, (op_ed_in_r_c<&Z80_CPU::c, 'C'>))  \
+    X(0x49, (op_ed_out_c_r<&Z80_CPU::c, 'C'>)) \
+    X(0x4F, op_ed_ld_r_a)                      \
+    X(0x50, (op_ed_in_r_c<&Z80_CPU::d, 'D'>))  \
+    X(0x51, (op_ed_out_c_r<&Z80_CPU::d, 'D'>)) \
+    X(0x56, op_ed_im<1>)                       \
+    X(0x58, (op_ed_in_r_c<&Z80_CPU::e, 'E'>))  \
+    X(0x59, (op_ed_out_c_r<&Z80_CPU::e, 'E'>)) \
+    X(0x5A, op_ed_adc_hl_de)                   \
+    X(0x5E, op_ed_im<2>)                       \
+    X(0x60, (op_ed_in_r_c<&Z80_CPU::h, 'H'>))  \
+    X(0x61, (op_ed_out_c_r<&Z80_CPU::h, 'H'>)) \
+    X(0x68, (op_ed_in_r_c<&Z80_CPU::l, 'L'>))  \
+    X(0x69, (op_ed_out_c_r<&Z80_CPU::l, 'L'>)) \
+    X(0x70, op_ed_in_c)                        \
+    X(0x71, op_ed_out_c_0)                     \
+    X(0x78, (op_ed_in_r_c<&Z80_CPU::a, 'A'>))  \
+    X(0x79, (op_ed_out_c_r<&Z80_CPU::a, 'A'>)) \
+    X(0xA0, (op_ed_ld_block<1, false>))        \
+    X(0xA1, (op_ed_cp_block<1, false>))        \
+    X(0xA2, (op_ed_in_block<1, false>))        \
+    X(0xA3, (op_ed_out_block<1, false>))       \
+    X(0xA8, (op_ed_ld_block<-1, false>))       \
+    X(0xA9, (op_ed_cp_block<-1, false>))       \
+    X(0xAA, (op_ed_in_block<-1, false>))       \
+    X(0xAB, (op_ed_out_block<-1, false>))
+
+#define Z80_ED_BRANCHES(X)              \
+    X(0x45, op_ed_retn<false>)          \
+    X(0x4D, op_ed_retn<true>)           \
+    X(0xB0, (op_ed_ld_block<1, true>))  \
+    X(0xB1, (op_ed_cp_block<1, true>))  \
+    X(0xB2, (op_ed_in_block<1, true>))  \
+    X(0xB3, (op_ed_out_block<1, true>)) \
+    X(0xB8, (op_ed_ld_block<-1, true>)) \
+    X(0xB9, (op_ed_cp_block<-1, true>)) \
+    X(0xBA, (op_ed_in_block<-1, true>)) \
+    X(0xBB, (op_ed_out_block<-1, true>))
+
+#define Z80_INDEX_OPS(X, P)         \
+    X(0x21, op_idx_ld_idx_nn<P>)    \
+    X(0x77, op_idx_ld_ind_idx_a<P>) \
+    X(0x96, op_idx_sub_ind_idx<P>)
+
+#define Z80_INDEX_CB_OPS(X, P) \
+    X(0x6E, op_idxcb_bit5<P>)
+
+#define Z80_TABLE_ENTRY(code, handler) table.op[code] = op_info(handler, meta[code], false);
+#define Z80_BRANCH_ENTRY(code, handler) table.op[code] = op_info(handler, meta[code], true);
+
+static constexpr Z80_OpInfo op_info(Z80_Handler handler, const Z80_OpMeta &meta, bool ends_block)
+{
+    return {handler, static_cast<uint8_t>(z80_operand_bytes(meta.operands)), meta.cycles, ends_block};
+}
+
+static constexpr Z80_OpTable make_table(Z80_Handler fallback)
+{
+    Z80_OpTable table{};
+    for (int i = 0; i < 256; i++)
+        table.op[i] = {fallback, 0, 4, false};
+    return table;
+}
+
+static constexpr Z80_OpTable make_cb_table()
+{
+    Z80_OpTable table = make_table(op_cb_unknown);
+    const Z80_OpMeta *meta = z80_cb_meta;
+    Z80_CB_OPS(Z80_TABLE_ENTRY)
+    table.op[0x2F].cycles = z80_cb_meta[0x6E].cycles; // Runs BIT 5,(HL), not SRA A
+    return table;
+}
+
+static constexpr Z80_OpTable make_ed_table()
+{
+    Z80_OpTable table = make_table(op_ed_unknown);
+    const Z80_OpMeta *meta = z80_ed_meta;
+    Z80_ED_OPS(Z80_TABLE_ENTRY)
+    Z80_ED_BRANCHES(Z80_BRANCH_ENTRY)
+    return table;
+}
+
+template <uint8_t PREFIX>
+static constexpr Z80_OpTable make_index_table()
+{
+    Z80_OpTable table = make_table(op_idx_unknown);
+    const Z80_OpMeta *meta = z80_index_meta;
+    Z80_INDEX_OPS(Z80_TABLE_ENTRY, PREFIX)
+    return table;
+}
+
+template <uint8_t PREFIX>
+static constexpr Z80_OpTable make_index_cb_table()
+{
+    Z80_OpTable table = make_table(op_idxcb_unknown<PREFIX>);
+    const Z80_OpMeta *meta = z80_index_cb_meta;
+    Z80_INDEX_CB_OPS(Z80_TABLE_ENTRY, PREFIX)
+    return table;
+}
+
+static constexpr Z80_OpTable cb_table = make_cb_table();
+static constexpr Z80_OpTable ed_table = make_ed_table();
+static constexpr Z80_OpTable dd_table = make_index_table<0xDD>();
+static constexpr Z80_OpTable fd_table = make_index_table<0xFD>();
+static constexpr Z80_OpTable ddcb_table = make_index_cb_table<0xDD>();
+static constexpr Z80_OpTable fdcb_table = make_index_cb_table<0xFD>();
+
+#define Z80_BASE_OPS(X)                   \
+    X(0x00, op_nop)                       \
+    X(0x01, op_ld_bc_nn)                  \
+    X(0x02, op_ld_ind_bc_a)               \
+    X(0x04, (op_inc_r<&Z80_CPU::b, 'B'>)) \
+    X(0x05, (op_dec_r<&Z80_CPU::b, 'B'>)) \
+    X(0x06, op_ld_b_n)                    \
+    X(0x08, op_ex_af_af)                  \
+    X(0x0C, (op_inc_r<&Z80_CPU::c, 'C'>)) \
+    X(0x0D, (op_dec_r<&Z80_CPU::c, 'C'>)) \
+    X(0x0E, op_ld_c_n)                    \
+    X(0x11, op_ld_de_nn)                  \
+    X(0x14, (op_inc_r<&Z80_CPU::d, 'D'>)) \
+    X(0x15, (op_dec_r<&Z80_CPU::d, 'D'>)) \
+    X(0x16, op_ld_d_n)                    \
+    X(0x1C, (op_inc_r<&Z80_CPU::e, 'E'>)) \
+    X(0x1D, (op_dec_r<&Z80_CPU::e, 'E'>)) \
+    X(0x1E, op_ld_e_n)                    \
+    X(0x21, op_ld_hl_nn)                  \
+    X(0x24, (op_inc_r<&Z80_CPU::h, 'H'>)) \
+    X(0x25, (op_dec_r<&Z80_CPU::h, 'H'>)) \
+    X(0x26, op_ld_h_n)                    \
+    X(0x2C, (op_inc_r<&Z80_CPU::l, 'L'>)) \
+    X(0x2D, (op_dec_r<&Z80_CPU::l, 'L'>)) \
+    X(0x2E, op_ld_l_n)                    \
+    X(0x37, op_scf)                       \
+    X(0x3C, (op_inc_r<&Z80_CPU::a, 'A'>)) \
+    X(0x3D, (op_dec_r<&Z80_CPU::a, 'A'>)) \
+    X(0x3E, op_ld_a_n)                    \
+    X(0x80, op_add_a_b)                   \
+    X(0x90, op_sub_b)                     \
+    X(0xD3, op_out_n_a)                   \
+    X(0xD9, op_exx)                       \
+    X(0xDB, op_in_a_n)                    \
+    X(0xE3, op_ex_ind_sp_hl)              \
+    X(0xEB, op_ex_de_hl)                  \
+    X(0xF1, op_pop_af)                    \
+    X(0xF3, op_di)                        \
+    X(0xF5, op_push_af)
+
+#define Z80_BASE_BRANCHES(X) \
+    X(0x18, op_jr_e)         \
+    X(0x20, op_jr_cc_e<0>)   \
+    X(0x28, op_jr_cc_e<1>)   \
+    X(0x30, op_jr_cc_e<2>)   \
+    X(0x38, op_jr_cc_e<3>)   \
+    X(0x76, op_halt)         \
+    X(0xC2, op_jp_cc_nn<0>)  \
+    X(0xC3, op_jp_nn)        \
+    X(0xC7, op_rst<0x00>)    \
+    X(0xC9, op_ret)          \
+    X(0xCA, op_jp_cc_nn<1>)  \
+    X(0xCD, op_call_nn)      \
+    X(0xCF, op_rst<0x08>)    \
+    X(0xD2, op_jp_cc_nn<2>)  \
+    X(0xD7, op_rst<0x10>)    \
+    X(0xDA, op_jp_cc_nn<3>)  \
+    X(0xDF, op_rst<0x18>)    \
+    X(0xE2, op_jp_cc_nn<4>)  \
+    X(0xE7, op_rst<0x20>)    \
+    X(0xEA, op_jp_cc_nn<5>)  \
+    X(0xEF, op_rst<0x28>)    \
+    X(0xF2, op_jp_cc_nn<6>)  \
+    X(0xF7, op_rst<0x30>)    \
+    X(0xFA, op_jp_cc_nn<7>)  \
+    X(0xFB, op_ei)           \
+    X(0xFF, op_rst<0x38>)
+
+// The CB, ED, DD and FD prefix bytes are resolved by decode() and never
+// looked up here
+static constexpr Z80_OpTable make_base_table()
+{
+    Z80_OpTable table = make_table(op_unknown);
+    const Z80_OpMeta *meta = z80_base_meta;
+    Z80_BASE_OPS(Z80_TABLE_ENTRY)
+    Z80_BASE_BRANCHES(Z80_BRANCH_ENTRY)
+    return table;
+}
+
+static constexpr Z80_OpTable base_table = make_base_table();
+
+// Decode the instruction at pc. Prefixes are resolved here, so running it
+// is a single handler call. Returns true if it ends a basic block.
+static bool decode(const Z80Memory &mem, uint16_t pc, Z80_Insn &insn)
+{
+    uint8_t opcode = mem.read(pc);
+    uint16_t prefix = 0;
+    uint8_t length = 1;
+    uint8_t table = Z80_TABLE_BASE;
+    uint16_t operand = 0;
+    const Z80_OpInfo *info;
+
+    switch (opcode)
+    {
+    case 0xCB:
+        prefix = opcode;
+        opcode = mem.read(pc + 1);
+        info = &cb_table.op[opcode];
+        table = Z80_TABLE_CB;
+        length = 2;
+        break;
+    case 0xED:
+        prefix = opcode;
+        opcode = mem.read(pc + 1);
+        info = &ed_table.op[opcode];
+        table = Z80_TABLE_ED;
+        length = 2;
+        break;
+    case 0xDD:
+    case 0xFD:
+        prefix = opcode;
+        opcode = mem.read(pc + 1);
+        length = 2;
+        if (opcode != 0xCB)
+        {
+            info = &(prefix == 0xDD ? dd_table : fd_table).op[opcode];
+            table = prefix == 0xDD ? Z80_TABLE_DD : Z80_TABLE_FD;
+            break;
+        }
+
+        // DD CB d op: displacement comes before the final opcode byte
+        prefix = prefix << 8 | 0xCB;
+        operand = mem.read(pc + 2);
+        opcode = mem.read(pc + 3);
+        info = &(prefix == 0xDDCB ? ddcb_table : fdcb_table).op[opcode];
+        table = prefix == 0xDDCB ? Z80_TABLE_DDCB : Z80_TABLE_FDCB;
+        length = 4;
+        break;
+    default:
+        info = &base_table.op[opcode];
+        break;
+    }
+
+    if (info->operand_bytes == 1)
+        operand = mem.read(pc + length);
+    else if (info->operand_bytes == 2)
+        operand = mem.read(pc + length) | (mem.read(pc + length + 1) << 8);
+
+    insn.handler = info->handler;
+    insn.operand = operand;
+    insn.prefix = prefix;
+    insn.opcode = opcode;
+    insn.length = length + info->operand_bytes;
+    insn.cycles = info->cycles;
+    insn.table = table;
+    return info->ends_block;
+}
+
+bool z80_opcode_info(uint16_t prefix, uint8_t opcode, int &operand_bytes)
+{
+    const Z80_OpInfo *info;
+    Z80_Handler fallback;
+    switch (prefix)
+    {
+    case 0x00: info = &base_table.op[opcode], fallback = op_unknown; break;
+    case 0xCB: info = &cb_table.op[opcode], fallback = op_cb_unknown; break;
+    case 0xED: info = &ed_table.op[opcode], fallback = op_ed_unknown; break;
+    case 0xDD: info = &dd_table.op[opcode], fallback = op_idx_unknown; break;
+    case 0xFD: info = &fd_table.op[opcode], fallback = op_idx_unknown; break;
+    case 0xDDCB: info = &ddcb_table.op[opcode], fallback = op_idxcb_unknown<0xDD>; break;
+    case 0xFDCB: info = &fdcb_table.op[opcode], fallback = op_idxcb_unknown<0xFD>; break;
+    default: return false;
+    }
+    // The prefix bytes themselves are resolved by decode(), not the table
+    if (info->handler == fallback || (prefix == 0x00 && (opcode == 0xCB || opcode == 0xED || opcode == 0xDD || opcode == 0xFD)))
+        return false;
+    operand_bytes = info->operand_bytes;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Block cache
+// ---------------------------------------------------------------------------
+
+// code_bits a machine can change, copied from the constant table it
+// starts on the first time
+uint64_t *Z80Machine::writable_code_bits()
+{
+    if (!own_code_bits)
+    {
+        own_code_bits.reset(new uint64_t[65536 / 64]);
+        std::memcpy(own_code_bits.get(), code_bits, 65536 / 8);
+        code_bits = own_code_bits.get();
+    }
+    return own_code_bits.get();
+}
+
+// Set or clear the code bit of every byte a block was decoded from
+void Z80Machine::mark_code(const Z80_Block &block, bool set)
+{
+    uint64_t *bits = writable_code_bits();
+    for (uint16_t i = 0; i < block.length; i++)
+    {
+        uint16_t addr = block.start + i;
+        if (set)
+            bits[addr >> 6] |= 1ULL << (addr & 63);
+        else
+            bits[addr >> 6] &= ~(1ULL << (addr & 63));
+    }
+}
+
+void Z80Machine::flush_blocks()
+{
+    if (jit)
+        jit->reset();
+    for (uint16_t pc : block_starts)
+        block_entry(pc)->reset(); // Only where blocks were made, not all 64K entries
+    block_starts.clear();
+    block_count = 0;
+    if (own_code_bits)
+        std::memset(own_code_bits.get(), 0, 65536 / 8);
+    else
+        code_bits = no_code_bits.word;
+    mark_traps();
+}
+
+// A write (or a bank switch) hit bytes that cached code was decoded from.
+// Drop every block covering [addr, addr + size), then re-mark bytes that
+// other blocks still cover.
+void Z80Machine::invalidate_code(uint16_t addr, size_t size)
+{
+    for (int offset = 1 - Z80_BLOCK_MAX_BYTES; offset < static_cast<int>(size); offset++)
+    {
+        std::unique_ptr<Z80_Block> *block = block_entry(static_cast<uint16_t>(addr + offset));
+        if (block != nullptr && *block && offset + (*block)->length > 0)
+        {
+            mark_code(**block, false);
+            retired.push_back(std::move(*block)); // May be the block that is running
+            block_count--;
+        }
+    }
+
+    // Cleared bytes lie within Z80_BLOCK_MAX_BYTES of the range, so only
+    // blocks starting within twice that can overlap them
+    for (int offset = 1 - 2 * Z80_BLOCK_MAX_BYTES; offset < static_cast<int>(size) + Z80_BLOCK_MAX_BYTES; offset++)
+    {
+        const std::unique_ptr<Z80_Block> *block = block_entry(static_cast<uint16_t>(addr + offset));
+        if (block != nullptr && *block)
+            mark_code(**block, true);
+    }
+    mark_traps();
+    code_written = true;
+}
+
+bool Z80Machine::map_page(int slot, int bank, size_t page)
+{
+    if (!memory_map.map(slot, bank, page))
+        return false;
+    shared[slot] = 0;
+
+    // Only blocks decoded from this slot can be stale
+    uint16_t start = static_cast<uint16_t>(slot << Z80_PAGE_BITS);
+    bool has_code = false;
+    for (int word = start >> 6; word < (start + Z80_PAGE_SIZE) >> 6; word++)
+        has_code |= code_bits[word] != 0;
+    if (has_code && block_count != 0)
+        invalidate_code(start, Z80_PAGE_SIZE);
+    else if (has_code)
+        remark_code(start, Z80_PAGE_SIZE); // Only traps there
+    return true;
+}
+
+// Cached block starting at pc, decoding it on first use
+inline Z80_Block *Z80Machine::find_block(uint16_t pc)
+{
+    Z80_BlockPage *page = blocks[pc >> Z80_BLOCK_PAGE_BITS].get();
+    if (page != nullptr && page->at[pc & Z80_BLOCK_PAGE_MASK])
+        return page->at[pc & Z80_BLOCK_PAGE_MASK].get();
+    return decode_block(pc);
+}
+
+// Instructions an idle loop may contain: nothing that writes memory or a
+// device, or changes interrupt state. IN A,(n) is allowed here and checked
+// against the port bus when the loop is skipped.
+static bool spin_safe(const Z80_Insn &insn)
+{
+    uint8_t op = insn.opcode;
+    switch (insn.table)
+    {
+    case Z80_TABLE_BASE:
+        if (op >= 0x40 && op <= 0xBF)
+            return (op & 0xF8) != 0x70; // LD r,r' and ALU A,r; not LD (HL),r or HALT
+        if (op < 0x40)
+            return (op & 0xCF) != 0x02 && (op < 0x34 || op > 0x36); // Not LD (BC)/(DE)/(nn),A or HL, nor INC/DEC/LD (HL)
+        switch (op)
+        {
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA: // JP (cc,) nn
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:             // ALU A,n
+        case 0xDB:                                                                                           // IN A,(n)
+            return true;
+        default:
+            return false;
+        }
+    case Z80_TABLE_CB:
+    case Z80_TABLE_DDCB:
+    case Z80_TABLE_FDCB:
+        return op >= 0x40 && op <= 0x7F; // BIT n
+    case Z80_TABLE_DD:
+    case Z80_TABLE_FD:
+        return op == 0x21 || op == 0x2A || (op >= 0x80 && op <= 0xBF && (op & 0x07) == 0x06); // LD IX,nn/(nn), ALU A,(IX+d)
+    default:
+        return false;
+    }
+}
+
+// A block that jumps back to its own start and only contains spin_safe
+// instructions is a candidate for skip_spin()
+static bool is_spin_loop(const Z80_Block &block)
+{
+    const Z80_Insn &last = block.insn[block.count - 1];
+    uint16_t next = static_cast<uint16_t>(block.start + block.length);
+    uint16_t target;
+    if (last.table != Z80_TABLE_BASE)
+        return false;
+    switch (last.opcode)
+    {
+    case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR (cc)
+        target = static_cast<uint16_t>(next + static_cast<int8_t>(last.operand));
+        break;
+    case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA: // JP (cc)
+        target = last.operand;
+        break;
+    default:
+        return false;
+    }
+    if (target != block.start)
+        return false;
+    for (int n = 0; n < block.count; n++)
+        if (!spin_safe(block.insn[n]))
+            return false;
+    return true;
+}
+
+Z80_Block *Z80Machine::decode_block(uint16_t pc)
+{
+    std::unique_ptr<Z80_BlockPage> &page = blocks[pc >> Z80_BLOCK_PAGE_BITS];
+    if (!page)
+        page.reset(new Z80_BlockPage());
+
+    Z80_Block *block = new Z80_Block;
+    block->start = pc;
+    block->length = 0;
+    block->cycles = 0;
+    block->count = 0;
+    block->hits = 0;
+    block->native = nullptr;
+    bool ends_block = false;
+    while (!ends_block && block->count < Z80_BLOCK_MAX_INSNS)
+    {
+        Z80_Insn &insn = block->insn[block->count++];
+        uint16_t addr = pc + block->length;
+        ends_block = decode(memory_map, addr, insn);
+        if (watch && (watch->breaks[addr >> 6] & (1ULL << (addr & 63))))
+            insn.handler = breakpoint;
+        block->length += insn.length;
+        block->cycles += insn.cycles;
+    }
+
+    block->spin = is_spin_loop(*block);
+    page->at[pc & Z80_BLOCK_PAGE_MASK].reset(block);
+    block_count++;
+    if (block_starts.size() >= 2 * block_count + 4096)
+    {
+        // Mostly invalidated blocks: keep the live starts, once each
+        std::sort(block_starts.begin(), block_starts.end());
+        block_starts.erase(std::unique(block_starts.begin(), block_starts.end()), block_starts.end());
+        block_starts.erase(std::remove_if(block_starts.begin(), block_starts.end(),
+                                          [this](uint16_t start) { return !*block_entry(start); }),
+                           block_starts.end());
+    }
+    block_starts.push_back(pc);
+    mark_code(*block, true);
+    return block;
+}
+
+// Take a pending NMI, or INT if IFF1 allows it: push PC and jump to the
+// handler. Returns the T-states the acknowledge took, 0 if none was taken.
+int Z80Machine::accept_interrupt()
+{
+    uint16_t vector;
+    int cycles;
+    if (int_lines & Z80_LINE_NMI)
+    {
+        int_lines &= ~Z80_LINE_NMI;
+        cpu.iff2 = cpu.interrupt_enable;
+        cpu.interrupt_enable = 0;
+        vector = 0x0066;
+        cycles = 11;
+    }
+    else if (cpu.interrupt_enable)
+    {
+        int_lines &= ~Z80_LINE_INT; // Acknowledged: the device drops its request
+        cpu.interrupt_enable = 0;
+        cpu.iff2 = 0;
+        switch (cpu.im)
+        {
+        case 0: // The device's byte runs as an instruction; RST n is the only one supported
+            vector = (int_data & 0xC7) == 0xC7 ? int_data & 0x38 : 0x38;
+            cycles = 13;
+            break;
+        case 1:
+            vector = 0x0038;
+            cycles = 13;
+            break;
+        default: // IM 2: the handler address comes from the table at I:data
+        {
+            uint16_t entry = cpu.i << 8 | int_data;
+            vector = mem_read(entry) | mem_read(static_cast<uint16_t>(entry + 1)) << 8;
+            cycles = 19;
+            break;
+        }
+        }
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (cpu.halted)
+    {
+        cpu.halted = 0;
+        cpu.pc++; // Return past the HALT
+    }
+    resume_pc = -1; // A breakpoint reached after the handler stops
+    cpu.r = (cpu.r + 1) & 0x7F;
+    mem_write(--cpu.sp, (cpu.pc >> 8) & 0xFF);
+    mem_write(--cpu.sp, cpu.pc & 0xFF);
+    cpu.pc = vector;
+    Z80_LOG_INSN("Interrupt accepted, jumping to %04x\n", vector);
+    Z80_RECORD_INT(recorder, *this, cycles);
+    return cycles;
+}
+
+// An idle loop candidate (Z80_Block::spin) has just made one pass and is
+// back at its start. If the pass left every register as it found it (R
+// aside), nothing it reads can have changed: it wrote nothing, and an
+// IN A,(n) is only allowed on the open bus or a port whose handler is
+// stable (Z80_PortHandler::stable). Every further pass would do the
+// same until an interrupt, so the passes that start within the budget but
+// the last are skipped, with their T-states and R increments counted; the
+// last runs normally to stop on the exact instruction. Returns the
+// T-states skipped.
+int Z80Machine::skip_spin(const Z80_Block &block, const Z80_CPU &entry, int budget)
+{
+    if (cpu.pc != block.start || budget <= block.cycles)
+        return 0;
+    if ((int_lines & Z80_LINE_NMI) || ((int_lines & Z80_LINE_INT) && cpu.interrupt_enable))
+        return 0; // Taken before the next pass
+    for (int n = 0; n < block.count; n++)
+        if (block.insn[n].table == Z80_TABLE_BASE && block.insn[n].opcode == 0xDB && !ports.reads_stable(block.insn[n].operand & 0xFF))
+            return 0; // A device may answer differently next time
+
+    Z80_CPU now;
+    std::memcpy(&now, &cpu, sizeof(now));
+    now.r = entry.r;
+    if (std::memcmp(&now, &entry, sizeof(now)) != 0)
+        return 0;
+
+    int passes = (budget - 1) / block.cycles;
+    cpu.r = (cpu.r + (passes % 128) * block.count) & 0x7F;
+    return passes * block.cycles;
+}
+
+int Z80Machine::idle(int cycles)
+{
+    if (!cpu.halted || cycles <= 0)
+        return 0;
+    int nops = (cycles - 1) / 4 + 1;
+    cpu.r = (cpu.r + nops % 128) & 0x7F;
+    return nops * 4;
+}
+
+// Execute Z80 instructions for the given number of cycles. Code runs a
+// basic block at a time from the block cache; the cycle budget is only
+// checked per instruction in a block that could overrun it. With the JIT
+// on, hot blocks that fit in the remaining budget run as native code. Idle
+// loops are skipped once they are seen to change nothing (skip_spin).
+// Interrupt lines are looked at between blocks; EI, RETN and RETI end a
+// block so a newly enabled interrupt is seen straight away. Breakpoints and
+// watches stop the run through Z80_LINE_STOP, so they are noticed there too.
+// The count is 64-bit so a budget near INT_MAX cannot wrap it.
+int Z80Machine::execute(int cycles)
+{
+    int64_t executed_cycles = 0;
+    cycles = std::min(cycles, Z80_EXECUTE_MAX);
+    bool observed = z80_trace_level >= Z80_TRACE_INSN || profile || recorder || debugging; // Every instruction has to be seen
+    Z80Jit *native = jit && !observed ? jit.get() : nullptr; // Traced, profiled and recorded code stays interpreted
+    int_lines &= ~Z80_LINE_STOP;
+    stop = Z80_Stop();
+    resume_pc = cpu.pc; // A breakpoint here was where the last run stopped
+
+    while (executed_cycles < cycles)
+    {
+        if (int_lines != 0)
+        {
+            if (int_lines & Z80_LINE_STOP)
+                break;
+            bool delayed = cpu.ei_delay != 0;
+            cpu.ei_delay = 0;
+            int taken = delayed ? step() : accept_interrupt(); // The instruction after EI runs first
+            if (taken != 0)
+            {
+                executed_cycles += taken;
+                continue;
+            }
+        }
+        if (cpu.halted)
+            break;
+        cpu.ei_delay = 0;
+
+        Z80_Block *block = find_block(cpu.pc);
+        code_written = false;
+        bool spin = block->spin && !observed;
+        Z80_CPU entry;
+        if (spin)
+            std::memcpy(&entry, &cpu, sizeof(entry)); // For skip_spin
+
+        if (native != nullptr)
+        {
+            if (block->native == nullptr && ++block->hits == Z80_JIT_THRESHOLD && !native->translate(*block))
+            {
+                flush_blocks(); // Native code buffer is full: start over
+                block = find_block(cpu.pc);
+            }
+            if (block->native != nullptr && executed_cycles + block->cycles <= cycles)
+            {
+                executed_cycles += block->native(&cpu, memory_map.read_page, this);
+                if (code_written)
+                    retired.clear();
+                else if (spin)
+                    executed_cycles += skip_spin(*block, entry, static_cast<int>(cycles - executed_cycles));
+                continue;
+            }
+        }
+
+        const Z80_Insn *insn = block->insn;
+        const Z80_Insn *end = insn + block->count;
+        int64_t limit = executed_cycles + block->cycles > cycles ? cycles : INT64_MAX; // Budget may run out inside this block
+        repeat_cycles = static_cast<int>(cycles - executed_cycles - (block->cycles - end[-1].cycles)); // Left when the last instruction starts
+
+        do
+        {
+            cpu.r = (cpu.r + 1) & 0x7F; // Increment refresh register
+            Z80_LOG_INSN("Executing opcode: %02x at PC: %04x\n", peek(cpu.pc), cpu.pc);
+            uint16_t pc = cpu.pc;
+            cpu.pc += insn->length;
+            int insn_cycles = insn->handler(*this, *insn);
+            executed_cycles += insn_cycles;
+            if (stop.reason != Z80_STOP_BREAK) // A breakpoint left it unrun; a watch stops after it ran
+            {
+                Z80_PROFILE_INSN(profile, pc, *insn, insn_cycles);
+                Z80_RECORD_INSN(recorder, *this, *insn, insn_cycles);
+            }
+        } while (++insn != end && executed_cycles < limit && !code_written); // After a write to cached code the rest may be stale
+
+        if (code_written)
+            retired.clear(); // The blocks it dropped are no longer running
+        else if (spin)
+            executed_cycles += skip_spin(*block, entry, static_cast<int>(cycles - executed_cycles));
+    }
+
+    Z80_LOG_SUMMARY("Ran %lld cycles\n", static_cast<long long>(executed_cycles));
+    return static_cast<int>(executed_cycles);
+}
+
+// Decode and run one instruction without going through the block cache
+int Z80Machine::step()
+{
+    Z80_Insn insn;
+    decode(memory_map, cpu.pc, insn);
+    int_lines &= ~Z80_LINE_STOP;
+    stop = Z80_Stop();
+    repeat_cycles = 0; // Block instructions run one iteration
+    cpu.r = (cpu.r + 1) & 0x7F; // Increment refresh register
+    Z80_LOG_INSN("Executing opcode: %02x at PC: %04x\n", peek(cpu.pc), cpu.pc);
+    uint16_t pc = cpu.pc;
+    cpu.pc += insn.length;
+    int insn_cycles = insn.handler(*this, insn);
+    Z80_PROFILE_INSN(profile, pc, insn, insn_cycles);
+    Z80_RECORD_INSN(recorder, *this, insn, insn_cycles);
+    return insn_cycles;
+}
+
+// ---------------------------------------------------------------------------
+// Breakpoints and watches
+// ---------------------------------------------------------------------------
+
+// Handler patched over the decoded instruction at a breakpoint. Stops with
+// the instruction not yet run, or runs it when execute() starts there.
+int Z80Machine::breakpoint(Z80Machine &m, const Z80_Insn &insn)
+{
+    uint16_t pc = m.cpu.pc - insn.length;
+    if (pc == m.resume_pc)
+    {
+        m.resume_pc = -1;
+        Z80_Insn original;
+        decode(m.memory_map, pc, original);
+        return original.handler(m, insn);
+    }
+    m.cpu.pc = pc;
+    m.cpu.r = (m.cpu.r - 1) & 0x7F; // Not fetched after all
+    m.stop = {Z80_STOP_BREAK, pc, 0};
+    m.int_lines |= Z80_LINE_STOP;
+    m.code_written = true; // Leave the block here
+    return 0;
+}
+
+// A write hit a byte marked in code_bits. The first write to an armed page
+// copies it off a shared image (the byte went to scratch, so it is written
+// again on the copy) and marks it dirty. Then drop any code decoded from the
+// byte and stop if a watch covers it; code_written ends the block for those.
+void Z80Machine::write_trap(uint16_t addr, uint8_t value)
+{
+    int slot = addr >> Z80_PAGE_BITS;
+    if (shared[slot] || (dirty_tracking && !dirty[slot]))
+    {
+        if (shared[slot])
+        {
+            if (!copies[slot])
+                copies[slot].reset(new uint8_t[Z80_PAGE_SIZE]);
+            std::memcpy(copies[slot].get(), memory_map.read_page[slot], Z80_PAGE_SIZE);
+            copies[slot][addr & Z80_PAGE_MASK] = value;
+            memory_map.map_private(slot, copies[slot].get());
+            shared[slot] = 0;
+        }
+        dirty[slot] = 1;
+        remark_code(static_cast<uint16_t>(slot << Z80_PAGE_BITS), Z80_PAGE_SIZE);
+        if (!(code_bits[addr >> 6] & (1ULL << (addr & 63))))
+            return; // Only the page was armed
+    }
+    if (watch && (watch->writes[addr >> 6] & (1ULL << (addr & 63))) && stop.reason == Z80_STOP_NONE)
+    {
+        stop = {Z80_STOP_WRITE, addr, value};
+        int_lines |= Z80_LINE_STOP;
+    }
+    if (block_count != 0)
+        invalidate_code(addr);
+    else
+        code_written = true;
+}
+
+void Z80Machine::read_trap(uint16_t addr, uint8_t value)
+{
+    if (stop.reason == Z80_STOP_NONE)
+    {
+        stop = {Z80_STOP_READ, addr, value};
+        int_lines |= Z80_LINE_STOP;
+    }
+    code_written = true;
+}
+
+// Put the write watches and the armed pages (shared, or clean under dirty
+// tracking) back into code_bits after cached code was dropped. Arming
+// every slot or none keeps a machine on the constant tables.
+void Z80Machine::mark_traps()
+{
+    int armed = 0;
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        armed += shared[slot] || (dirty_tracking && !dirty[slot]);
+    if (!own_code_bits && !watch && (armed == 0 || armed == Z80_PAGES))
+    {
+        if (armed != 0)
+            code_bits = all_code_bits.word;
+        return;
+    }
+
+    uint64_t *bits = writable_code_bits();
+    if (watch)
+        for (int word = 0; word < 65536 / 64; word++)
+            bits[word] |= watch->writes[word];
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        if (shared[slot] || (dirty_tracking && !dirty[slot]))
+            std::memset(bits + (slot << Z80_PAGE_BITS >> 6), 0xFF, Z80_PAGE_SIZE / 8);
+}
+
+// Blocks are decoded again to pick breakpoints up or drop them, and
+// code_bits is rebuilt with the write watches
+void Z80Machine::watches_changed()
+{
+    flush_blocks();
+    debugging = false;
+    for (int word = 0; word < 65536 / 64; word++)
+        debugging |= (watch->breaks[word] | watch->writes[word] | watch->reads[word]) != 0;
+}
+
+void Z80Machine::set_breakpoint(uint16_t addr, bool on)
+{
+    if (!watch)
+        watch.reset(new Z80_Watch());
+    if (on)
+        watch->breaks[addr >> 6] |= 1ULL << (addr & 63);
+    else
+        watch->breaks[addr >> 6] &= ~(1ULL << (addr & 63));
+    watches_changed();
+}
+
+bool Z80Machine::set_watch(uint16_t addr, size_t size, int kinds, bool on)
+{
+    if ((kinds & Z80_WATCH_READ) && !Z80_WATCH_READS)
+        return false;
+    if (!watch)
+        watch.reset(new Z80_Watch());
+    for (size_t i = 0; i < size && addr + i < 65536; i++)
+    {
+        uint16_t a = static_cast<uint16_t>(addr + i);
+        uint64_t bit = 1ULL << (a & 63);
+        if (kinds & Z80_WATCH_WRITE)
+            watch->writes[a >> 6] = on ? watch->writes[a >> 6] | bit : watch->writes[a >> 6] & ~bit;
+        if (kinds & Z80_WATCH_READ)
+            watch->reads[a >> 6] = on ? watch->reads[a >> 6] | bit : watch->reads[a >> 6] & ~bit;
+    }
+    watches_changed();
+    return true;
+}
+
+void Z80Machine::clear_breakpoints()
+{
+    watch.reset();
+    debugging = false;
+    flush_blocks();
+}
+
+// ---------------------------------------------------------------------------
+// Dirty pages
+// ---------------------------------------------------------------------------
+
+// Rebuild code_bits over [start, start + size) from the cached blocks and
+// the traps
+void Z80Machine::remark_code(uint16_t start, size_t size)
+{
+    uint64_t *bits = writable_code_bits();
+    for (size_t word = start >> 6; word < (start + size) >> 6; word++)
+        bits[word] = 0;
+    if (block_count != 0)
+    {
+        for (int offset = 1 - Z80_BLOCK_MAX_BYTES; offset < static_cast<int>(size); offset++)
+        {
+            const std::unique_ptr<Z80_Block> *block = block_entry(static_cast<uint16_t>(start + offset));
+            if (block != nullptr && *block)
+                mark_code(**block, true);
+        }
+    }
+    mark_traps();
+}
+
+void Z80Machine::track_dirty(bool on)
+{
+    dirty_tracking = on;
+    std::memset(dirty, 0, sizeof(dirty));
+    remark_code(0, 65536);
+}
+
+void Z80Machine::clear_dirty()
+{
+    std::memset(dirty, 0, sizeof(dirty));
+    mark_traps();
+}
+
+bool Z80Machine::load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    if (size > 65536)
+    {
+        // Too big to copy in: map it from disk as a ROM bank instead
+        file.close();
+        int bank = add_rom_bank(filename);
+        if (bank < 0)
+        {
+            std::cerr << "Error: Cannot map file " << filename << std::endl;
+            return false;
+        }
+        int rom_slots = 0x4000 >> Z80_PAGE_BITS; // 16KB, or one slot if pages are bigger
+        for (int slot = 0; slot < rom_slots || slot == 0; slot++)
+            map_page(slot, bank, slot);
+        Z80_LOG_SUMMARY("Mapped ROM file: %s (Size: %ld bytes)\n", filename.c_str(), static_cast<long>(size));
+        return true;
+    }
+
+    if (ram == nullptr)
+        attach_memory(nullptr); // Never given its own 64KB: start on it now
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(ram), size);
+    flush_blocks(); // Written behind the block cache's back
+    bool ok = static_cast<bool>(file);
+    if (!ok)
+    {
+        std::cerr << "Error: Failed to read file " << filename << std::endl;
+    }
+    else
+    {
+        Z80_LOG_SUMMARY("Loaded binary file: %s (Size: %ld bytes)\n", filename.c_str(), static_cast<long>(size));
+    }
+
+    file.close();
+    return ok;
+}
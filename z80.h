@@ -0,0 +1,553 @@
+#ifndef Z80_H
+#define Z80_H
+
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "z80_io.h"
+#include "z80_memory.h"
+#include "z80_trace.h"
+
+#define Z80_INSN_MAX_BYTES 4                                       // DD CB d op
+#define Z80_BLOCK_MAX_INSNS 32                                     // Longest basic block decoded at once
+#define Z80_BLOCK_MAX_BYTES (Z80_BLOCK_MAX_INSNS * Z80_INSN_MAX_BYTES)
+#define Z80_BLOCK_PAGE_BITS 8                                      // Block index pages cover 256 start addresses
+#define Z80_BLOCK_PAGE_MASK ((1 << Z80_BLOCK_PAGE_BITS) - 1)
+#define Z80_EXECUTE_MAX (INT_MAX - 256)                            // Largest execute() budget; room for the last instruction's overrun
+
+// Opcode tables, as Z80_Insn::table
+#define Z80_TABLE_BASE 0
+#define Z80_TABLE_CB 1
+#define Z80_TABLE_ED 2
+#define Z80_TABLE_DD 3
+#define Z80_TABLE_FD 4
+#define Z80_TABLE_DDCB 5
+#define Z80_TABLE_FDCB 6
+#define Z80_TABLE_COUNT 7
+
+// Interrupt lines (Z80Machine::set_int / nmi)
+#define Z80_LINE_INT 0x01
+#define Z80_LINE_NMI 0x02
+#define Z80_LINE_STOP 0x04 // Not a pin: a breakpoint or watch stopped the run
+
+// Build with -DZ80_WATCH_READS=1 to compile read watches into mem_read().
+// Without it only breakpoints and write watches are available, and reads
+// are unchanged.
+#ifndef Z80_WATCH_READS
+#define Z80_WATCH_READS 0
+#endif
+
+// Build with -DZ80_BUS_CYCLES=1 to have mem_read(), mem_write() and the
+// port accesses report to a bus log, for the M-cycle stepping in z80_bus.h.
+// Without it they are unchanged.
+#ifndef Z80_BUS_CYCLES
+#define Z80_BUS_CYCLES 0
+#endif
+
+// Bus cycle kinds (Z80_BusCycle::kind, Z80_BusLog)
+#define Z80_BUS_FETCH 0    // M1 opcode fetch
+#define Z80_BUS_READ 1     // Memory read
+#define Z80_BUS_WRITE 2    // Memory write
+#define Z80_BUS_IN 3       // Port read
+#define Z80_BUS_OUT 4      // Port write
+#define Z80_BUS_INT_ACK 5  // Interrupt acknowledge (M1 with IORQ)
+#define Z80_BUS_INTERNAL 6 // No bus access
+#define Z80_BUS_LOG_MAX 8  // Accesses one instruction or acknowledge can make
+
+// Watch kinds (Z80Machine::set_watch)
+#define Z80_WATCH_READ 0x01
+#define Z80_WATCH_WRITE 0x02
+
+// Why execute() or step() stopped early (Z80_Stop::reason)
+#define Z80_STOP_NONE 0
+#define Z80_STOP_BREAK 1 // Before the instruction at a breakpoint
+#define Z80_STOP_READ 2  // After an instruction read a watched byte
+#define Z80_STOP_WRITE 3 // After an instruction wrote a watched byte
+
+// A register pair: a 16-bit word whose two bytes can also be used as the
+// 8-bit registers, laid out for the host's byte order so both views alias.
+// Z80_PAIR(b, c, bc) gives the members b, c and bc.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define Z80_PAIR(high, low, pair) \
+    union                         \
+    {                             \
+        uint16_t pair;            \
+        struct                    \
+        {                         \
+            uint8_t high, low;    \
+        };                        \
+    }
+#else
+#define Z80_PAIR(high, low, pair) \
+    union                         \
+    {                             \
+        uint16_t pair;            \
+        struct                    \
+        {                         \
+            uint8_t low, high;    \
+        };                        \
+    }
+#endif
+
+// Z80 CPU Structure
+struct Z80_CPU
+{
+    uint16_t pc;              // Program Counter
+    uint16_t sp;              // Stack Pointer
+    Z80_PAIR(a, f, af);       // Accumulator and Flags (f and af only hold F when flag_op is FLAGS_NONE)
+    Z80_PAIR(b, c, bc);       // BC register pair
+    Z80_PAIR(d, e, de);       // DE register pair
+    Z80_PAIR(h, l, hl);       // HL register pair
+    uint8_t interrupt_enable; // IFF1: maskable interrupts accepted
+    uint8_t iff2;             // IFF2: IFF1 saved while an NMI runs
+    uint8_t im;               // Interrupt mode (0, 1 or 2)
+    uint8_t ei_delay;         // Set by EI: no interrupt before the next instruction
+    Z80_PAIR(ixh, ixl, ix);   // Index registers
+    Z80_PAIR(iyh, iyl, iy);
+    uint8_t r;                // Refresh register
+    uint8_t i;                // Interrupt register
+    uint8_t halted;           // Set by HALT, stops z80_execute
+
+    // Shadow registers, swapped in by EX AF,AF' and EXX
+    Z80_PAIR(a_prime, f_prime, af_prime);
+    Z80_PAIR(b_prime, c_prime, bc_prime);
+    Z80_PAIR(d_prime, e_prime, de_prime);
+    Z80_PAIR(h_prime, l_prime, hl_prime);
+
+    // Lazy flag state: F is rebuilt from these when read (see z80_flags.h)
+    uint8_t flag_op;   // Last flag-setting operation, FLAGS_NONE when f is current
+    uint16_t flag_x;   // First operand
+    uint16_t flag_y;   // Second operand
+    uint32_t flag_res; // Unmasked result
+};
+
+class Z80Machine;
+class Z80Jit;
+struct Z80_Insn;
+struct Z80_Profile;
+class Z80TraceWriter;
+struct Z80_StateDevice;
+
+// Look up an opcode in the decoder's tables. prefix is 0, 0xCB, 0xED, 0xDD,
+// 0xFD, 0xDDCB or 0xFDCB. Returns false if the opcode is not implemented;
+// otherwise sets the immediate bytes that follow it (the DD/FD
+// displacement counts as one, the DDCB/FDCB one does not).
+bool z80_opcode_info(uint16_t prefix, uint8_t opcode, int &operand_bytes);
+
+// Opcode handler. Runs with PC already past the whole instruction and
+// returns the T-states it took.
+typedef int (*Z80_Handler)(Z80Machine &m, const Z80_Insn &insn);
+
+// One pre-decoded instruction: prefixes resolved to the final handler,
+// immediates already assembled
+struct Z80_Insn
+{
+    Z80_Handler handler;
+    uint16_t operand; // n, nn or (IX+d) displacement
+    uint16_t prefix;  // 0, 0xCB, 0xED, 0xDD, 0xFD, 0xDDCB or 0xFDCB
+    uint8_t opcode;   // Final opcode byte, after any prefixes
+    uint8_t length;   // Bytes, prefixes and operands included
+    uint8_t cycles;   // T-states (the longer case for conditional branches)
+    uint8_t table;    // Z80_TABLE_* the opcode was looked up in
+};
+
+// Translated block: runs the whole block on the host and returns its T-states
+typedef int (*Z80_Native)(Z80_CPU *cpu, uint8_t *const *read_page, Z80Machine *m);
+
+// Straight-line run of instructions starting at one PC, ending at the
+// first branch or HALT
+struct Z80_Block
+{
+    uint16_t start;    // Address of the first instruction
+    uint16_t length;   // Bytes covered, from start
+    int cycles;        // T-states of the whole block, taking every branch
+    int count;         // Instructions in insn[]
+    uint32_t hits;     // Times run by the interpreter while the JIT is on
+    bool spin;         // Idle loop candidate: branches back to start, writes nothing
+    Z80_Native native; // JIT translation, nullptr until the block is hot
+    Z80_Insn insn[Z80_BLOCK_MAX_INSNS];
+};
+
+// Cached blocks for the start addresses of one block index page
+struct Z80_BlockPage
+{
+    std::unique_ptr<Z80_Block> at[1 << Z80_BLOCK_PAGE_BITS];
+};
+
+struct Z80_Stop
+{
+    uint8_t reason; // Z80_STOP_*
+    uint16_t addr;  // Breakpoint PC, or the watched address
+    uint8_t value;  // Byte read or written
+};
+
+// Memory and port accesses made by one instruction, in order, with the
+// byte that went over the bus
+struct Z80_BusLog
+{
+    struct Access
+    {
+        uint8_t kind; // Z80_BUS_READ, WRITE, IN or OUT
+        uint8_t data;
+        uint16_t addr;
+    };
+    Access access[Z80_BUS_LOG_MAX];
+    int count;
+
+    void add(uint8_t kind, uint16_t addr, uint8_t data)
+    {
+        if (count < Z80_BUS_LOG_MAX)
+            access[count++] = {kind, data, addr};
+    }
+};
+
+// Breakpoint and watch bits, one per address; allocated on first use
+struct Z80_Watch
+{
+    uint64_t breaks[65536 / 64];
+    uint64_t writes[65536 / 64];
+    uint64_t reads[65536 / 64];
+};
+
+// A complete Z80 machine: registers, a paged memory map over its own
+// 64KB and any extra RAM/ROM banks, and an I/O port bus. Machines share nothing, so any number
+// of them can run side by side on different threads.
+class Z80Machine
+{
+public:
+    Z80_CPU cpu;
+    uint8_t *ram; // Base 64KB of memory, own_ram unless attach_memory() was called; nullptr until init()
+    Z80PortBus ports; // Devices behind IN and OUT; kept across init()
+
+    // A new machine runs on 64KB of zeros shared with every other one,
+    // copy-on-write as after init(image); init() gives it its own 64KB
+    Z80Machine();
+    ~Z80Machine();
+    Z80Machine(const Z80Machine &) = delete;
+    Z80Machine &operator=(const Z80Machine &) = delete;
+
+    // Run against an external 64KB buffer instead of own_ram (nullptr
+    // switches back). Every slot is mapped back onto it.
+    void attach_memory(uint8_t *memory)
+    {
+        ram = memory != nullptr ? memory : own_memory();
+        unshare();
+        memory_map.map_flat(ram);
+        flush_blocks();
+    }
+
+    // Initialize the Z80. Clears ram and maps every slot back onto it; extra
+    // banks are freed, so their numbers start from 0 again.
+    void init();
+
+    // Initialize the Z80 on a shared image instead of ram: every slot reads
+    // the image until the first mem_write to it, which copies that one page
+    // (Z80_PAGE_SIZE bytes) for this machine. The private pages are kept
+    // for reuse by the next init(image); extra banks are freed as by init().
+    // Writes straight to ram[] do not reach memory on the image; init(),
+    // attach_memory() and map_page() leave it.
+    void init(std::shared_ptr<const Z80_Image> shared_image);
+
+    // Slots this machine has its own copy of since init(image)
+    int private_pages() const;
+
+    // Load a binary image at address 0. Images up to 64KB are copied into
+    // ram; larger ones become a ROM bank (see add_rom_bank) with its first
+    // 16KB mapped at 0000h. Returns false if it could not be read.
+    bool load(const std::string &filename);
+
+    // Banked memory (z80_memory.h). Bank numbers are per machine; slot is
+    // addr >> Z80_PAGE_BITS. map_page() drops cached code decoded from the
+    // slot, so switching banks under running code is safe.
+    int add_ram_bank(size_t pages)
+    {
+        return memory_map.add_ram(pages);
+    }
+
+    int add_rom_bank(const std::string &filename)
+    {
+        return memory_map.add_rom(filename);
+    }
+
+    size_t bank_pages(int bank) const
+    {
+        return memory_map.bank_pages(bank);
+    }
+
+    bool map_page(int slot, int bank, size_t page);
+
+    // Execute Z80 instructions for the given number of cycles, at most
+    // Z80_EXECUTE_MAX at a time
+    int execute(int cycles);
+
+    // Execute exactly one instruction and return its cycles
+    int step();
+
+    // Let a halted CPU wait `cycles` T-states. It runs NOPs meanwhile, one
+    // R increment per 4 T-states, so the time is rounded up to whole NOPs.
+    // Returns the T-states that passed (0 if the CPU is not halted).
+    int idle(int cycles);
+
+    // Function to display CPU state
+    void display_state(std::ostream &out);
+
+    // Memory functions
+    uint8_t mem_read(uint16_t addr) const
+    {
+#if Z80_WATCH_READS || Z80_BUS_CYCLES
+        uint8_t value = memory_map.read(addr);
+#if Z80_WATCH_READS
+        if (watch && (watch->reads[addr >> 6] & (1ULL << (addr & 63))))
+            const_cast<Z80Machine *>(this)->read_trap(addr, value);
+#endif
+#if Z80_BUS_CYCLES
+        if (bus_log != nullptr)
+            bus_log->add(Z80_BUS_READ, addr, value);
+#endif
+        return value;
+#else
+        return memory_map.read(addr);
+#endif
+    }
+
+    // Read without tripping a watch, for tools looking at memory from outside
+    uint8_t peek(uint16_t addr) const
+    {
+        return memory_map.read(addr);
+    }
+
+    void mem_write(uint16_t addr, uint8_t value)
+    {
+        memory_map.write(addr, value);
+        if (code_bits[addr >> 6] & (1ULL << (addr & 63)))
+            write_trap(addr, value); // Self-modifying code or a watched byte
+#if Z80_TRACE_LEVEL >= Z80_TRACE_INSN
+        if (recorder != nullptr)
+            record_write(addr);
+#endif
+#if Z80_BUS_CYCLES
+        if (bus_log != nullptr)
+            bus_log->add(Z80_BUS_WRITE, addr, value);
+#endif
+    }
+
+    // IN and OUT go through these, so the bus log sees them
+    uint8_t port_in(uint16_t port)
+    {
+#if Z80_BUS_CYCLES
+        uint8_t value = ports.read(port);
+        if (bus_log != nullptr)
+            bus_log->add(Z80_BUS_IN, port, value);
+        return value;
+#else
+        return ports.read(port);
+#endif
+    }
+
+    void port_out(uint16_t port, uint8_t value)
+    {
+        ports.write(port, value);
+#if Z80_BUS_CYCLES
+        if (bus_log != nullptr)
+            bus_log->add(Z80_BUS_OUT, port, value);
+#endif
+    }
+
+    // Host address of [addr, addr + size) for a handler that works on a
+    // run of memory at once, or nullptr if it has to go byte by byte through
+    // mem_read/mem_write: the run crosses a slot or the end of memory, a
+    // watch covers it or a bus log wants every access, or (for writes)
+    // cached code lives there or a recorder wants every write. ROM slots
+    // give their scratch page for writes.
+    uint8_t *direct_span(uint16_t addr, size_t size, bool write)
+    {
+        int slot = addr >> Z80_PAGE_BITS;
+        if (size == 0 || (addr & Z80_PAGE_MASK) + size > Z80_PAGE_SIZE)
+            return nullptr;
+#if Z80_BUS_CYCLES
+        if (bus_log != nullptr)
+            return nullptr;
+#endif
+        if (!write)
+        {
+#if Z80_WATCH_READS
+            if (watch)
+                for (size_t word = addr >> 6; word <= (addr + size - 1) >> 6; word++)
+                    if (watch->reads[word] != 0)
+                        return nullptr;
+#endif
+            return memory_map.read_page[slot] + (addr & Z80_PAGE_MASK);
+        }
+        if (recorder != nullptr)
+            return nullptr;
+        for (size_t word = addr >> 6; word <= (addr + size - 1) >> 6; word++)
+            if (code_bits[word] != 0)
+                return nullptr;
+        return memory_map.write_page[slot] + (addr & Z80_PAGE_MASK);
+    }
+
+    // T-states execute() has left for the instruction now running when it is
+    // the last of its block, as block instructions (LDIR, CPIR...) are. They
+    // repeat in bulk up to this budget instead of once per dispatch; 0 (one
+    // iteration) under step().
+    int repeat_budget() const
+    {
+        return repeat_cycles;
+    }
+
+    // An interrupt is waiting, or a breakpoint or watch has stopped the run:
+    // a handler looping in bulk should return
+    bool interrupt_pending() const
+    {
+        return int_lines != 0;
+    }
+
+    // Request a maskable interrupt. It stays pending until the CPU accepts
+    // it (IFF1 set) or it is withdrawn with set_int(false). data is the byte
+    // the device puts on the bus: the RST opcode in IM 0, the vector table
+    // offset in IM 2.
+    void set_int(bool asserted, uint8_t data = 0xFF)
+    {
+        int_data = data;
+        int_lines = asserted ? (int_lines | Z80_LINE_INT) : (int_lines & ~Z80_LINE_INT);
+    }
+
+    // Request a non-maskable interrupt (edge-triggered: one call, one NMI)
+    void nmi()
+    {
+        int_lines |= Z80_LINE_NMI;
+    }
+
+    // Drop every cached block. Needed after writing to ram or a bank
+    // directly instead of through mem_write().
+    void flush_blocks();
+
+    // Translate hot blocks to native code. Returns false if this build or
+    // host has no JIT.
+    bool enable_jit(bool on);
+
+    // Count executions and T-states per opcode and per PC (z80_profile.h).
+    // Turning it on clears the counts; profiled code stays on the
+    // interpreter. Returns false if the profiler is not compiled in.
+    bool enable_profile(bool on);
+
+    const Z80_Profile *profile_data() const
+    {
+        return profile.get();
+    }
+
+    // Send every instruction, interrupt and memory write to a binary trace
+    // (z80_btrace.h), or stop with nullptr. Recorded code stays on the
+    // interpreter. Returns false if this build has instruction tracing
+    // compiled out (Z80_TRACE_LEVEL below 2).
+    bool set_recorder(Z80TraceWriter *writer);
+
+    // Breakpoints and watches. A breakpoint stops execute() before the
+    // instruction at addr runs; calling execute() again runs it and goes on.
+    // A watch stops execute() after the instruction that reads or writes
+    // (Z80_WATCH_*) a byte in [addr, addr + size). stop_info() says which
+    // stopped the last execute() or step(). step() ignores breakpoints.
+    // None of it costs anything while unused: breakpoints are patched into
+    // the decoded block, write watches share mem_write's cached-code check,
+    // and read watches need Z80_WATCH_READS. While any is set the machine
+    // stays on the interpreter. set_watch() returns false for reads in a
+    // build without them. Set them between runs, not from a device callback.
+    void set_breakpoint(uint16_t addr, bool on);
+    bool set_watch(uint16_t addr, size_t size, int kinds, bool on);
+    void clear_breakpoints(); // And watches
+
+    const Z80_Stop &stop_info() const
+    {
+        return stop;
+    }
+
+    // Dirty page tracking, for checkpoints (z80_snap.h). While it is on, the
+    // first write to each slot after clear_dirty() marks it dirty. That write
+    // takes mem_write's slow path once (the slot's bytes are armed in
+    // code_bits); later writes to the slot cost nothing extra. Writes made
+    // behind mem_write's back (load(), ram[]) are not seen.
+    void track_dirty(bool on);
+    void clear_dirty();
+
+    bool page_dirty(int slot) const
+    {
+        return dirty[slot] != 0;
+    }
+
+private:
+    friend class Z80Jit;
+    friend class Z80Snapshots;
+    friend class Z80SavedState;
+    friend class Z80BusCycles;
+    friend bool z80_save_state(const std::string &filename, const Z80Machine &m,
+                               const std::vector<Z80_StateDevice> &devices);
+
+    Z80_Block *find_block(uint16_t pc);
+    Z80_Block *decode_block(uint16_t pc);
+    void invalidate_code(uint16_t addr, size_t size = 1);
+    void mark_code(const Z80_Block &block, bool set);
+    int accept_interrupt();
+    int skip_spin(const Z80_Block &block, const Z80_CPU &entry, int budget);
+    void record_write(uint16_t addr);
+    void write_trap(uint16_t addr, uint8_t value);
+    void read_trap(uint16_t addr, uint8_t value);
+    void mark_traps();
+    void unshare();
+    void map_image(std::shared_ptr<const Z80_Image> shared_image);
+    void reset();
+    void remark_code(uint16_t start, size_t size);
+    uint64_t *writable_code_bits();
+    void watches_changed();
+    uint8_t *own_memory();
+    static int breakpoint(Z80Machine &m, const Z80_Insn &insn);
+
+    // Cache entry for a block starting at pc; nullptr if nothing was ever
+    // decoded in its index page
+    std::unique_ptr<Z80_Block> *block_entry(uint16_t pc)
+    {
+        Z80_BlockPage *page = blocks[pc >> Z80_BLOCK_PAGE_BITS].get();
+        return page != nullptr ? &page->at[pc & Z80_BLOCK_PAGE_MASK] : nullptr;
+    }
+
+    std::unique_ptr<uint8_t[]> own_ram; // Allocated by the first init() or attach_memory(nullptr)
+    Z80Memory memory_map;
+
+    // Block cache: blocks by start address, in index pages allocated where
+    // code is decoded, plus one bit per byte of memory that some cached
+    // block was decoded from, a write watch covers, or that dirty tracking
+    // or a shared image has armed; mem_write takes the slow path for any of
+    // them. Until they first differ from all clear or all set, code_bits
+    // points at a constant table and the machine has no copy of its own.
+    std::unique_ptr<Z80_BlockPage> blocks[65536 >> Z80_BLOCK_PAGE_BITS];
+    std::vector<std::unique_ptr<Z80_Block>> retired; // Invalidated, freed once the running block is left
+    const uint64_t *code_bits;
+    std::unique_ptr<uint64_t[]> own_code_bits; // Allocated by the first writable_code_bits()
+    std::vector<uint16_t> block_starts; // Every decode_block() since the flush, for flush_blocks()
+    size_t block_count;
+    bool code_written; // A cached block was invalidated since the last check
+    uint8_t int_lines; // Z80_LINE_* requests not yet accepted
+    uint8_t int_data;  // Bus byte for the pending INT
+    int repeat_cycles; // See repeat_budget()
+    std::unique_ptr<Z80Jit> jit; // nullptr unless enable_jit(true)
+    std::unique_ptr<Z80_Profile> profile; // nullptr unless enable_profile(true)
+    Z80TraceWriter *recorder;              // Binary trace being written, not owned
+    std::unique_ptr<Z80_Watch> watch;      // nullptr until a breakpoint or watch is set
+    bool debugging;                        // Some breakpoint or watch is set
+    int resume_pc;                         // Breakpoint execute() started on, -1 if none
+    Z80_Stop stop;
+    bool dirty_tracking;
+    uint8_t dirty[Z80_PAGES]; // Slots written since clear_dirty()
+
+    // Copy-on-write memory of init(image)
+    std::shared_ptr<const Z80_Image> image;
+    uint8_t shared[Z80_PAGES];                  // Slot still reads the image
+    std::unique_ptr<uint8_t[]> copies[Z80_PAGES]; // Private pages, allocated on first use
+#if Z80_BUS_CYCLES
+    Z80_BusLog *bus_log; // Set by Z80BusCycles around the instruction it runs
+#endif
+};
+
+#endif // Z80_H
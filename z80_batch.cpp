@@ -0,0 +1,661 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "z80_batch.h"
+#include "z80_flags.h"
+#include "z80_opmeta.h"
+#include "z80_trace.h"
+
+// ---------------------------------------------------------------------------
+// Byte-lane vector helpers. The kernels below are written once against these
+// and compiled for AVX2 (-mavx2), SSE2 (any x86-64) or plain bytes.
+// ---------------------------------------------------------------------------
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define Z80_VEC_WIDTH 32
+#define Z80_VEC_NAME "avx2"
+typedef __m256i vec;
+static inline vec v_load(const uint8_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+static inline void v_store(uint8_t *p, vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+static inline vec v_set1(uint8_t x) { return _mm256_set1_epi8(static_cast<char>(x)); }
+static inline vec v_add(vec x, vec y) { return _mm256_add_epi8(x, y); }
+static inline vec v_sub(vec x, vec y) { return _mm256_sub_epi8(x, y); }
+static inline vec v_adds(vec x, vec y) { return _mm256_adds_epu8(x, y); }
+static inline vec v_subs(vec x, vec y) { return _mm256_subs_epu8(x, y); }
+static inline vec v_and(vec x, vec y) { return _mm256_and_si256(x, y); }
+static inline vec v_or(vec x, vec y) { return _mm256_or_si256(x, y); }
+static inline vec v_xor(vec x, vec y) { return _mm256_xor_si256(x, y); }
+static inline vec v_andnot(vec x, vec y) { return _mm256_andnot_si256(x, y); } // ~x & y
+static inline vec v_cmpeq(vec x, vec y) { return _mm256_cmpeq_epi8(x, y); }
+static inline vec v_srl16(vec x, int n) { return _mm256_srli_epi16(x, n); }
+static inline vec v_sll16(vec x, int n) { return _mm256_slli_epi16(x, n); }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define Z80_VEC_WIDTH 16
+#define Z80_VEC_NAME "sse2"
+typedef __m128i vec;
+static inline vec v_load(const uint8_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+static inline void v_store(uint8_t *p, vec v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+static inline vec v_set1(uint8_t x) { return _mm_set1_epi8(static_cast<char>(x)); }
+static inline vec v_add(vec x, vec y) { return _mm_add_epi8(x, y); }
+static inline vec v_sub(vec x, vec y) { return _mm_sub_epi8(x, y); }
+static inline vec v_adds(vec x, vec y) { return _mm_adds_epu8(x, y); }
+static inline vec v_subs(vec x, vec y) { return _mm_subs_epu8(x, y); }
+static inline vec v_and(vec x, vec y) { return _mm_and_si128(x, y); }
+static inline vec v_or(vec x, vec y) { return _mm_or_si128(x, y); }
+static inline vec v_xor(vec x, vec y) { return _mm_xor_si128(x, y); }
+static inline vec v_andnot(vec x, vec y) { return _mm_andnot_si128(x, y); } // ~x & y
+static inline vec v_cmpeq(vec x, vec y) { return _mm_cmpeq_epi8(x, y); }
+static inline vec v_srl16(vec x, int n) { return _mm_srli_epi16(x, n); }
+static inline vec v_sll16(vec x, int n) { return _mm_slli_epi16(x, n); }
+#else
+#define Z80_VEC_WIDTH 1
+#define Z80_VEC_NAME "scalar"
+typedef uint8_t vec;
+static inline vec v_load(const uint8_t *p) { return *p; }
+static inline void v_store(uint8_t *p, vec v) { *p = v; }
+static inline vec v_set1(uint8_t x) { return x; }
+static inline vec v_add(vec x, vec y) { return x + y; }
+static inline vec v_sub(vec x, vec y) { return x - y; }
+static inline vec v_adds(vec x, vec y) { return x + y > 0xFF ? 0xFF : x + y; }
+static inline vec v_subs(vec x, vec y) { return x > y ? x - y : 0; }
+static inline vec v_and(vec x, vec y) { return x & y; }
+static inline vec v_or(vec x, vec y) { return x | y; }
+static inline vec v_xor(vec x, vec y) { return x ^ y; }
+static inline vec v_andnot(vec x, vec y) { return ~x & y; }
+static inline vec v_cmpeq(vec x, vec y) { return x == y ? 0xFF : 0x00; }
+static inline vec v_srl16(vec x, int n) { return x >> n; }
+static inline vec v_sll16(vec x, int n) { return x << n; }
+#endif
+
+// Per-byte shifts (the 16-bit shifts above leak bits between neighbours)
+static inline vec v_shr(vec x, int n) { return v_and(v_srl16(x, n), v_set1(0xFF >> n)); }
+static inline vec v_shl(vec x, int n) { return v_and(v_sll16(x, n), v_set1((0xFF << n) & 0xFF)); }
+
+// Take y where mask is set, x elsewhere
+static inline vec v_blend(vec x, vec y, vec mask) { return v_or(v_and(mask, y), v_andnot(mask, x)); }
+
+// S, Z, Y and X of an 8-bit result (sz_table in vector form)
+static inline vec v_sz(vec res)
+{
+    vec zero = v_and(v_cmpeq(res, v_set1(0)), v_set1(FLAG_Z));
+    return v_or(v_and(res, v_set1(FLAG_S | FLAG_Y | FLAG_X)), zero);
+}
+
+// S, Z, Y, X and even parity of an 8-bit result (szp_table in vector form)
+static inline vec v_szp(vec res)
+{
+    vec p = v_xor(res, v_shr(res, 4));
+    p = v_xor(p, v_shr(p, 2));
+    p = v_xor(p, v_shr(p, 1)); // Bit 0 now holds odd parity
+    vec even = v_shl(v_andnot(p, v_set1(0x01)), 2);
+    return v_or(v_sz(res), even);
+}
+
+// ---------------------------------------------------------------------------
+// Lockstep kernels. Each one updates every lane in [0, n); lanes whose mask
+// byte is 0 keep their old values.
+// ---------------------------------------------------------------------------
+
+// LD r, n
+static void k_load(uint8_t *reg, uint8_t value, const uint8_t *mask, size_t n)
+{
+    vec v = v_set1(value);
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+        v_store(reg + i, v_blend(v_load(reg + i), v, v_load(mask + i)));
+}
+
+// ADD A, r
+static void k_add(uint8_t *a, const uint8_t *src, uint8_t *f, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+    {
+        vec x = v_load(a + i), y = v_load(src + i), m = v_load(mask + i);
+        vec res = v_add(x, y);
+        vec carry = v_andnot(v_cmpeq(res, v_adds(x, y)), v_set1(FLAG_C)); // Wrapped iff it differs from the saturated sum
+        vec half = v_and(v_xor(v_xor(x, y), res), v_set1(FLAG_H));
+        vec overflow = v_shr(v_and(v_andnot(v_xor(x, y), v_xor(x, res)), v_set1(0x80)), 5);
+        vec flags = v_or(v_or(v_sz(res), half), v_or(overflow, carry));
+        v_store(a + i, v_blend(x, res, m));
+        v_store(f + i, v_blend(v_load(f + i), flags, m));
+    }
+}
+
+// SUB r
+static void k_sub(uint8_t *a, const uint8_t *src, uint8_t *f, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+    {
+        vec x = v_load(a + i), y = v_load(src + i), m = v_load(mask + i);
+        vec res = v_sub(x, y);
+        vec borrow = v_andnot(v_cmpeq(v_subs(y, x), v_set1(0)), v_set1(FLAG_C)); // Borrow iff y > x
+        vec half = v_and(v_xor(v_xor(x, y), res), v_set1(FLAG_H));
+        vec overflow = v_shr(v_and(v_and(v_xor(x, y), v_xor(x, res)), v_set1(0x80)), 5);
+        vec flags = v_or(v_or(v_sz(res), half), v_or(overflow, v_or(borrow, v_set1(FLAG_N))));
+        v_store(a + i, v_blend(x, res, m));
+        v_store(f + i, v_blend(v_load(f + i), flags, m));
+    }
+}
+
+// INC r / DEC r (carry is preserved)
+template <bool DEC>
+static void k_incdec(uint8_t *reg, uint8_t *f, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+    {
+        vec x = v_load(reg + i), old_f = v_load(f + i), m = v_load(mask + i);
+        vec res = DEC ? v_sub(x, v_set1(1)) : v_add(x, v_set1(1));
+        vec low = v_and(res, v_set1(0x0F));
+        vec half = v_and(v_cmpeq(low, v_set1(DEC ? 0x0F : 0x00)), v_set1(FLAG_H));
+        vec overflow = v_and(v_cmpeq(res, v_set1(DEC ? 0x7F : 0x80)), v_set1(FLAG_PV));
+        vec flags = v_or(v_or(v_sz(res), half), v_or(overflow, v_and(old_f, v_set1(FLAG_C))));
+        if (DEC)
+            flags = v_or(flags, v_set1(FLAG_N));
+        v_store(reg + i, v_blend(x, res, m));
+        v_store(f + i, v_blend(old_f, flags, m));
+    }
+}
+
+// CB shifts and rotates: flags are SZP of the result plus the bit shifted out
+enum Z80_ShiftOp
+{
+    SHIFT_RLC,
+    SHIFT_RRC,
+    SHIFT_RL,
+    SHIFT_RR,
+    SHIFT_SRA,
+    SHIFT_SRL,
+};
+
+template <Z80_ShiftOp OP>
+static void k_shift(uint8_t *reg, uint8_t *f, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+    {
+        vec x = v_load(reg + i), old_f = v_load(f + i), m = v_load(mask + i);
+        vec carry_in = v_and(old_f, v_set1(FLAG_C));
+        vec top = v_shr(x, 7);                     // Bit 7 moved to bit 0
+        vec bottom = v_and(x, v_set1(0x01));       // Bit 0
+        vec res, carry;
+        switch (OP)
+        {
+        case SHIFT_RLC:
+            res = v_or(v_shl(x, 1), top);
+            carry = top;
+            break;
+        case SHIFT_RRC:
+            res = v_or(v_shr(x, 1), v_shl(bottom, 7));
+            carry = bottom;
+            break;
+        case SHIFT_RL:
+            res = v_or(v_shl(x, 1), carry_in);
+            carry = top;
+            break;
+        case SHIFT_RR:
+            res = v_or(v_shr(x, 1), v_shl(carry_in, 7));
+            carry = bottom;
+            break;
+        case SHIFT_SRA:
+            res = v_or(v_shr(x, 1), v_and(x, v_set1(0x80)));
+            carry = bottom;
+            break;
+        default: // SHIFT_SRL
+            res = v_shr(x, 1);
+            carry = bottom;
+            break;
+        }
+        v_store(reg + i, v_blend(x, res, m));
+        v_store(f + i, v_blend(old_f, v_or(v_szp(res), carry), m));
+    }
+}
+
+// BIT n, r (carry is preserved, X/Y come from the register)
+static void k_bit(const uint8_t *reg, int bit, uint8_t *f, const uint8_t *mask, size_t n)
+{
+    for (size_t i = 0; i < n; i += Z80_VEC_WIDTH)
+    {
+        vec x = v_load(reg + i), old_f = v_load(f + i), m = v_load(mask + i);
+        vec clear = v_cmpeq(v_and(x, v_set1(1 << bit)), v_set1(0));
+        vec flags = v_or(v_and(old_f, v_set1(FLAG_C)), v_set1(FLAG_H));
+        flags = v_or(flags, v_and(x, v_set1(FLAG_Y | FLAG_X)));
+        flags = v_or(flags, v_and(clear, v_set1(FLAG_Z | FLAG_PV)));
+        if (bit == 7)
+            flags = v_or(flags, v_andnot(clear, v_set1(FLAG_S)));
+        v_store(f + i, v_blend(old_f, flags, m));
+    }
+}
+
+// Branch condition cc (NZ, Z, NC, C, PO, PE, P, M) against a materialized F
+static inline bool condition_met(uint8_t f, int cc)
+{
+    static const uint8_t masks[8] = {FLAG_Z, FLAG_Z, FLAG_C, FLAG_C, FLAG_PV, FLAG_PV, FLAG_S, FLAG_S};
+    return ((f & masks[cc]) != 0) == (cc & 1);
+}
+
+// ---------------------------------------------------------------------------
+// Z80Batch
+// ---------------------------------------------------------------------------
+
+Z80Batch::Z80Batch(size_t lanes)
+    : count(lanes), padded((lanes + Z80_BATCH_PAD - 1) / Z80_BATCH_PAD * Z80_BATCH_PAD),
+      image(65536), lane_ram(lanes), scratch(new Z80Machine())
+{
+    for (std::vector<uint8_t> *reg : {&a, &f, &b, &c, &d, &e, &h, &l, &r, &i, &interrupt_enable, &iff2, &im, &halted,
+                                      &a_prime, &f_prime, &b_prime, &c_prime, &d_prime, &e_prime, &h_prime, &l_prime,
+                                      &lock})
+        reg->assign(padded, 0);
+    for (std::vector<uint16_t> *reg : {&pc, &sp, &ix, &iy})
+        reg->assign(padded, 0);
+    cycles.assign(padded, 0);
+
+    // Same reset state as Z80Machine::init()
+    std::fill(ix.begin(), ix.end(), 0xFFFF);
+    std::fill(iy.begin(), iy.end(), 0xFFFF);
+    std::fill(r.begin(), r.begin() + count, 0x01);
+    std::fill(f.begin(), f.begin() + count, FLAG_Z);
+}
+
+bool Z80Batch::load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    if (size > 65536)
+    {
+        std::cerr << "Error: File too large to fit in memory." << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> data(size);
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(data.data()), size);
+    if (!file)
+    {
+        std::cerr << "Error: Failed to read file " << filename << std::endl;
+        return false;
+    }
+
+    load_image(data.data(), data.size());
+    Z80_LOG_SUMMARY("Loaded binary file: %s (Size: %ld bytes, %zu lanes)\n", filename.c_str(), static_cast<long>(size), count);
+    return true;
+}
+
+void Z80Batch::load_image(const uint8_t *data, size_t size)
+{
+    std::fill(image.begin(), image.end(), 0);
+    std::memcpy(image.data(), data, std::min<size_t>(size, image.size()));
+    for (std::unique_ptr<uint8_t[]> &memory : lane_ram)
+        memory.reset();
+}
+
+void Z80Batch::set_lane(size_t lane, const Z80_CPU &state)
+{
+    Z80_CPU cpu = state;
+    pc[lane] = cpu.pc;
+    sp[lane] = cpu.sp;
+    a[lane] = cpu.a;
+    f[lane] = flags_get(cpu);
+    b[lane] = cpu.b;
+    c[lane] = cpu.c;
+    d[lane] = cpu.d;
+    e[lane] = cpu.e;
+    h[lane] = cpu.h;
+    l[lane] = cpu.l;
+    interrupt_enable[lane] = cpu.interrupt_enable;
+    iff2[lane] = cpu.iff2;
+    im[lane] = cpu.im;
+    ix[lane] = cpu.ix;
+    iy[lane] = cpu.iy;
+    r[lane] = cpu.r;
+    i[lane] = cpu.i;
+    halted[lane] = cpu.halted;
+    a_prime[lane] = cpu.a_prime;
+    f_prime[lane] = cpu.f_prime;
+    b_prime[lane] = cpu.b_prime;
+    c_prime[lane] = cpu.c_prime;
+    d_prime[lane] = cpu.d_prime;
+    e_prime[lane] = cpu.e_prime;
+    h_prime[lane] = cpu.h_prime;
+    l_prime[lane] = cpu.l_prime;
+}
+
+Z80_CPU Z80Batch::get_lane(size_t lane) const
+{
+    Z80_CPU cpu;
+    std::memset(&cpu, 0, sizeof(cpu));
+    cpu.pc = pc[lane];
+    cpu.sp = sp[lane];
+    cpu.a = a[lane];
+    cpu.f = f[lane];
+    cpu.b = b[lane];
+    cpu.c = c[lane];
+    cpu.d = d[lane];
+    cpu.e = e[lane];
+    cpu.h = h[lane];
+    cpu.l = l[lane];
+    cpu.interrupt_enable = interrupt_enable[lane];
+    cpu.iff2 = iff2[lane];
+    cpu.im = im[lane];
+    cpu.ix = ix[lane];
+    cpu.iy = iy[lane];
+    cpu.r = r[lane];
+    cpu.i = i[lane];
+    cpu.halted = halted[lane];
+    cpu.a_prime = a_prime[lane];
+    cpu.f_prime = f_prime[lane];
+    cpu.b_prime = b_prime[lane];
+    cpu.c_prime = c_prime[lane];
+    cpu.d_prime = d_prime[lane];
+    cpu.e_prime = e_prime[lane];
+    cpu.h_prime = h_prime[lane];
+    cpu.l_prime = l_prime[lane];
+    return cpu;
+}
+
+uint8_t Z80Batch::mem_read(size_t lane, uint16_t addr) const
+{
+    return lane_ram[lane] ? lane_ram[lane][addr] : image[addr];
+}
+
+size_t Z80Batch::lockstep_lanes() const
+{
+    return std::count(lock.begin(), lock.begin() + count, 0xFF);
+}
+
+const char *Z80Batch::kernel_name()
+{
+    return Z80_VEC_NAME;
+}
+
+// A lane only needs its own memory once it runs a scalar step, which is
+// the only way it can write
+uint8_t *Z80Batch::lane_memory(size_t lane)
+{
+    if (!lane_ram[lane])
+    {
+        lane_ram[lane].reset(new uint8_t[65536]);
+        std::memcpy(lane_ram[lane].get(), image.data(), 65536);
+    }
+    return lane_ram[lane].get();
+}
+
+void Z80Batch::gather(size_t lane)
+{
+    scratch->attach_memory(lane_memory(lane));
+    scratch->cpu = get_lane(lane);
+}
+
+void Z80Batch::scatter(size_t lane)
+{
+    set_lane(lane, scratch->cpu);
+}
+
+// R counts instructions. Lockstep ops only count them, and the count is
+// applied to the group before anything looks at R.
+void Z80Batch::flush_refresh()
+{
+    if (refresh_pending == 0)
+        return;
+    for (size_t lane = 0; lane < count; lane++)
+        if (lock[lane])
+            r[lane] = (r[lane] + refresh_pending) & 0x7F;
+    refresh_pending = 0;
+}
+
+// Drop a lane from the group and finish it on the scalar interpreter
+void Z80Batch::leave_group(size_t lane, int budget)
+{
+    if (refresh_pending != 0)
+        r[lane] = (r[lane] + refresh_pending) & 0x7F;
+    lock[lane] = 0;
+    if (halted[lane] || cycles[lane] >= budget)
+        return;
+    gather(lane);
+    cycles[lane] += scratch->execute(budget - cycles[lane]);
+    scatter(lane);
+}
+
+// Run the instruction at group_pc one lane at a time. Lanes that end up
+// somewhere other than the majority leave the group. Returns false once
+// the group has halted.
+bool Z80Batch::step_scalar(uint16_t &group_pc, int &executed, int budget)
+{
+    flush_refresh(); // The scalar step bumps R itself
+
+    size_t votes = 0;
+    size_t leader = 0;
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        if (!lock[lane])
+            continue;
+        pc[lane] = group_pc; // Lockstep lanes only track PC as a group
+        gather(lane);
+        cycles[lane] = executed + scratch->step();
+        scatter(lane);
+
+        // Majority vote on where each lane ended up
+        if (votes == 0)
+            leader = lane, votes = 1;
+        else if (pc[lane] == pc[leader] && cycles[lane] == cycles[leader] && halted[lane] == halted[leader])
+            votes++;
+        else
+            votes--;
+    }
+
+    group_pc = pc[leader];
+    executed = cycles[leader];
+    bool group_halted = halted[leader];
+    for (size_t lane = 0; lane < count; lane++)
+        if (lock[lane] && (pc[lane] != group_pc || cycles[lane] != executed || halted[lane] != group_halted))
+            leave_group(lane, budget);
+    return !group_halted;
+}
+
+// Conditional branch: the larger side stays in the group, the other side
+// finishes on the scalar interpreter
+void Z80Batch::split_branch(int cc, uint16_t target, uint16_t next, int taken_cycles, int skipped_cycles,
+                            uint16_t &group_pc, int &executed, int budget)
+{
+    size_t live = 0, taken = 0;
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        if (!lock[lane])
+            continue;
+        live++;
+        taken += condition_met(f[lane], cc);
+    }
+
+    refresh_pending++;
+    bool group_takes = taken * 2 >= live;
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        if (!lock[lane] || condition_met(f[lane], cc) == group_takes)
+            continue;
+        pc[lane] = group_takes ? next : target;
+        cycles[lane] = executed + (group_takes ? skipped_cycles : taken_cycles);
+        leave_group(lane, budget);
+    }
+
+    group_pc = group_takes ? target : next;
+    executed += group_takes ? taken_cycles : skipped_cycles;
+}
+
+void Z80Batch::execute(int budget)
+{
+    // Lanes starting at lane 0's PC form the group; the rest run scalar
+    uint16_t group_pc = pc[0];
+    refresh_pending = 0;
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        cycles[lane] = 0;
+        lock[lane] = (pc[lane] == group_pc && !halted[lane]) ? 0xFF : 0x00;
+    }
+    for (size_t lane = 0; lane < count; lane++)
+        if (!lock[lane])
+            leave_group(lane, budget);
+
+    uint8_t *regs[8] = {b.data(), c.data(), d.data(), e.data(), h.data(), l.data(), nullptr, a.data()};
+    const uint8_t *mask = lock.data();
+    int executed = 0;
+    bool running = lockstep_lanes() > 0;
+
+    while (running && executed < budget)
+    {
+        uint8_t opcode = image[group_pc];
+        uint8_t n = image[static_cast<uint16_t>(group_pc + 1)];
+        uint16_t nn = n | (image[static_cast<uint16_t>(group_pc + 2)] << 8);
+        uint8_t *reg = regs[(opcode >> 3) & 7];
+        const Z80_OpMeta &meta = z80_base_meta[opcode]; // T-states, the same table decode() reads
+
+        switch (opcode)
+        {
+        case 0x00: // NOP
+            group_pc += 1;
+            executed += meta.cycles;
+            break;
+
+        case 0x06: // LD r, n
+        case 0x0E:
+        case 0x16:
+        case 0x1E:
+        case 0x26:
+        case 0x2E:
+        case 0x3E:
+            k_load(reg, n, mask, padded);
+            group_pc += 2;
+            executed += meta.cycles;
+            break;
+
+        case 0x01: // LD rr, nn
+        case 0x11:
+        case 0x21:
+            k_load(regs[(opcode >> 3) & 6], nn >> 8, mask, padded);
+            k_load(regs[((opcode >> 3) & 6) + 1], nn & 0xFF, mask, padded);
+            group_pc += 3;
+            executed += meta.cycles;
+            break;
+
+        case 0x04: // INC r
+        case 0x0C:
+        case 0x14:
+        case 0x1C:
+        case 0x24:
+        case 0x2C:
+        case 0x3C:
+            k_incdec<false>(reg, f.data(), mask, padded);
+            group_pc += 1;
+            executed += meta.cycles;
+            break;
+
+        case 0x05: // DEC r
+        case 0x0D:
+        case 0x15:
+        case 0x1D:
+        case 0x25:
+        case 0x2D:
+        case 0x3D:
+            k_incdec<true>(reg, f.data(), mask, padded);
+            group_pc += 1;
+            executed += meta.cycles;
+            break;
+
+        case 0x80: // ADD A, B
+            k_add(a.data(), b.data(), f.data(), mask, padded);
+            group_pc += 1;
+            executed += meta.cycles;
+            break;
+
+        case 0x90: // SUB B
+            k_sub(a.data(), b.data(), f.data(), mask, padded);
+            group_pc += 1;
+            executed += meta.cycles;
+            break;
+
+        case 0x18: // JR e
+            group_pc += 2 + static_cast<int8_t>(n);
+            executed += meta.cycles;
+            break;
+
+        case 0xC3: // JP nn
+            group_pc = nn;
+            executed += meta.cycles;
+            break;
+
+        case 0x20: // JR cc, e
+        case 0x28:
+        case 0x30:
+        case 0x38:
+            split_branch((opcode >> 3) & 3, group_pc + 2 + static_cast<int8_t>(n), group_pc + 2, meta.cycles,
+                         meta.cycles_short, group_pc, executed, budget);
+            continue; // R already counted
+
+        case 0xC2: // JP cc, nn
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+        case 0xE2:
+        case 0xEA:
+        case 0xF2:
+        case 0xFA:
+            split_branch((opcode >> 3) & 7, nn, group_pc + 3, meta.cycles, meta.cycles_short, group_pc, executed, budget);
+            continue; // R already counted
+
+        case 0x76: // HALT stops every lane in the group on the HALT
+            k_load(halted.data(), 1, mask, padded);
+            executed += meta.cycles;
+            running = false;
+            break;
+
+        case 0xCB:
+        {
+            // Only the CB ops the interpreter implements; the rest go scalar
+            void (*kernel)(uint8_t *, uint8_t *, const uint8_t *, size_t) = nullptr;
+            switch (n)
+            {
+            case 0x07: kernel = k_shift<SHIFT_RLC>, reg = a.data(); break;
+            case 0x08: kernel = k_shift<SHIFT_RLC>, reg = b.data(); break;
+            case 0x0F: kernel = k_shift<SHIFT_RRC>, reg = a.data(); break;
+            case 0x17: kernel = k_shift<SHIFT_RL>, reg = a.data(); break;
+            case 0x1F: kernel = k_shift<SHIFT_RR>, reg = a.data(); break;
+            case 0x27: kernel = k_shift<SHIFT_SRA>, reg = a.data(); break;
+            case 0x28: kernel = k_shift<SHIFT_SRA>, reg = b.data(); break;
+            case 0x31: kernel = k_shift<SHIFT_SRL>, reg = c.data(); break;
+            case 0x3A: kernel = k_shift<SHIFT_SRA>, reg = d.data(); break;
+            case 0x6F: // BIT 5, A
+                k_bit(a.data(), 5, f.data(), mask, padded);
+                break;
+            default:
+                running = step_scalar(group_pc, executed, budget);
+                continue;
+            }
+            if (kernel != nullptr)
+                kernel(reg, f.data(), mask, padded);
+            group_pc += 2;
+            executed += z80_cb_meta[n].cycles;
+            break;
+        }
+
+        default: // Memory, stack and ED/DD/FD ops run lane by lane
+            running = step_scalar(group_pc, executed, budget);
+            continue;
+        }
+        refresh_pending++;
+    }
+
+    // Lanes that stayed in lockstep to the end
+    flush_refresh();
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        if (!lock[lane])
+            continue;
+        pc[lane] = group_pc;
+        cycles[lane] = executed;
+    }
+}
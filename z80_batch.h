@@ -0,0 +1,86 @@
+#ifndef Z80_BATCH_H
+#define Z80_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "z80.h"
+
+// Lane counts are padded to a multiple of this, so the SIMD kernels never
+// need a tail loop
+#define Z80_BATCH_PAD 32
+
+// Many instances of one program image, with the registers stored as
+// structure-of-arrays (all A registers together, all F registers together).
+// Lanes that share a PC run in lockstep: each instruction is decoded once,
+// and the ALU and load-immediate ops run as AVX2/SSE2 kernels across every
+// lane. A lane whose branch goes a different way than the group finishes on
+// the scalar interpreter.
+//
+// Lockstep lanes fetch instructions from the shared image. A program that
+// rewrites its own code must run on Z80Machine instead.
+class Z80Batch
+{
+public:
+    explicit Z80Batch(size_t lanes);
+
+    // Program image shared by every lane, loaded at address 0
+    bool load(const std::string &filename);
+    void load_image(const uint8_t *image, size_t size);
+
+    // Per-lane register state (F is always returned fully evaluated)
+    void set_lane(size_t lane, const Z80_CPU &state);
+    Z80_CPU get_lane(size_t lane) const;
+    uint8_t mem_read(size_t lane, uint16_t addr) const;
+
+    // Run every lane for the given number of cycles
+    void execute(int cycles);
+
+    size_t lanes() const
+    {
+        return count;
+    }
+
+    // Cycles the lane ran in the last execute()
+    int lane_cycles(size_t lane) const
+    {
+        return cycles[lane];
+    }
+
+    // Lanes still in the lockstep group at the end of the last execute()
+    size_t lockstep_lanes() const;
+
+    // Instruction set the kernels were compiled for: "avx2", "sse2" or "scalar"
+    static const char *kernel_name();
+
+private:
+    uint8_t *lane_memory(size_t lane);
+    void gather(size_t lane);
+    void scatter(size_t lane);
+    void flush_refresh();
+    void leave_group(size_t lane, int budget);
+    bool step_scalar(uint16_t &group_pc, int &executed, int budget);
+    void split_branch(int cc, uint16_t target, uint16_t next, int taken_cycles, int skipped_cycles,
+                      uint16_t &group_pc, int &executed, int budget);
+
+    size_t count;  // Lanes in use
+    size_t padded; // Lanes allocated (multiple of Z80_BATCH_PAD)
+
+    // Register file, one array per register
+    std::vector<uint8_t> a, f, b, c, d, e, h, l;
+    std::vector<uint8_t> r, i, interrupt_enable, iff2, im, halted;
+    std::vector<uint8_t> a_prime, f_prime, b_prime, c_prime, d_prime, e_prime, h_prime, l_prime;
+    std::vector<uint16_t> pc, sp, ix, iy;
+    std::vector<int> cycles;
+
+    std::vector<uint8_t> lock; // 0xFF while the lane is in the lockstep group
+    uint32_t refresh_pending;  // R increments not yet applied to the group
+
+    std::vector<uint8_t> image;                        // Shared 64KB program image
+    std::vector<std::unique_ptr<uint8_t[]>> lane_ram; // Private copy, made on a lane's first scalar step
+    std::unique_ptr<Z80Machine> scratch;               // Runs scalar steps on lane state
+};
+
+#endif // Z80_BATCH_H
@@ -0,0 +1,475 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "z80.h"
+#include "z80_batch.h"
+#include "z80_trace.h"
+
+#define BENCH_CYCLES 100000000    // T-states per timed repetition of a workload
+#define BENCH_CHUNK 1000000       // T-states per execute() call
+#define BENCH_REPS 5              // Timed repetitions (after one warm-up run)
+#define BENCH_LANES 256           // Instances in the batch comparison
+#define BENCH_LANE_CYCLES 1000000 // Cycles per instance in the batch comparison
+
+// ALU loop, built only from implemented opcodes. Also the register sweep
+// for the batch comparison: there is no branch but the JR, so every pass
+// is 9 instructions and 62 T-states.
+static const uint8_t alu_program[] = {
+    0x80,       // 0000 loop: ADD A, B
+    0x90,       // 0001 SUB B
+    0xCB, 0x07, // 0002 RLC A
+    0xCB, 0x28, // 0004 SRA B
+    0x0E, 0x55, // 0006 LD C, 55h
+    0xCB, 0x31, // 0008 SRL C
+    0x14,       // 000A INC D
+    0x06, 0x03, // 000B LD B, 03h
+    0x18, 0xF1, // 000D JR loop
+};
+#define SWEEP_LOOP_INSNS 9
+#define SWEEP_LOOP_CYCLES 62
+
+// CALL/RET recursion 16 levels deep. SP starts at 0000h, so the stack
+// grows down from FFFFh.
+static const uint8_t call_program[] = {
+    0x06, 0x10,       // 0000 top: LD B, 10h
+    0xCD, 0x07, 0x00, // 0002 CALL rec
+    0x18, 0xF9,       // 0005 JR top
+    0x05,             // 0007 rec: DEC B
+    0xCA, 0x0E, 0x00, // 0008 JP Z, done
+    0xCD, 0x07, 0x00, // 000B CALL rec
+    0x04,             // 000E done: INC B
+    0xC9,             // 000F RET
+};
+
+// Memory copy: POP AF reads two bytes and walks up through the whole
+// address space, LD (BC),A stores A into a 256-byte window at C000h.
+static const uint8_t copy_program[] = {
+    0x06, 0xC0,       // 0000 LD B, C0h
+    0x0E, 0x00,       // 0002 LD C, 00h
+    0xF1,             // 0004 loop: POP AF
+    0x02,             // 0005 LD (BC), A
+    0x0C,             // 0006 INC C
+    0xC2, 0x04, 0x00, // 0007 JP NZ, loop
+    0xC3, 0x04, 0x00, // 000A JP loop
+};
+
+struct Bench_Workload
+{
+    std::string name;
+    std::vector<uint8_t> image; // Loaded at address 0
+    bool builtin;               // Also runs on the switch baseline
+};
+
+struct Bench_Result
+{
+    std::string workload;
+    std::string engine;
+    long long insns;       // Instructions per repetition
+    long long cycles;      // T-states per repetition
+    double seconds_min;    // Fastest repetition
+    double seconds_median; // Median repetition, used for the rates
+};
+
+static Z80Machine machine;
+
+// Put the workload in memory with the CPU in its reset state
+static void bench_load(Z80Machine &m, const Bench_Workload &w)
+{
+    m.init();
+    std::memcpy(m.ram, w.image.data(), w.image.size());
+    m.flush_blocks();
+}
+
+// Run the workload for at least `cycles` T-states. A program that halts
+// (the professor's tests) starts over from its reset state, keeping memory.
+static long long bench_run(Z80Machine &m, const Z80_CPU &reset, long long cycles)
+{
+    long long total = 0;
+    while (total < cycles)
+    {
+        if (m.cpu.halted)
+            m.cpu = reset;
+        long long left = cycles - total;
+        total += m.execute(static_cast<int>(left < BENCH_CHUNK ? left : BENCH_CHUNK));
+    }
+    return total;
+}
+
+// Instructions bench_run() executes for the same budget, counted with step()
+static long long bench_count(const Bench_Workload &w, long long cycles)
+{
+    bench_load(machine, w);
+    Z80_CPU reset = machine.cpu;
+    long long total = 0, insns = 0;
+    while (total < cycles)
+    {
+        if (machine.cpu.halted)
+            machine.cpu = reset;
+        total += machine.step();
+        insns++;
+    }
+    return insns;
+}
+
+static Bench_Result bench_workload(const Bench_Workload &w, bool jit, long long insns, long long cycles, int reps)
+{
+    std::vector<double> times;
+    long long ran = 0;
+    for (int rep = -1; rep < reps; rep++) // Repetition -1 is the warm-up
+    {
+        bench_load(machine, w);
+        machine.enable_jit(jit);
+        Z80_CPU reset = machine.cpu;
+
+        auto start = std::chrono::steady_clock::now();
+        ran = bench_run(machine, reset, cycles);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (rep >= 0)
+            times.push_back(seconds);
+    }
+    machine.enable_jit(false);
+
+    std::sort(times.begin(), times.end());
+    return {w.name, jit ? "jit" : "interp", insns, ran, times.front(), times[times.size() / 2]};
+}
+
+// Baseline for the handler tables: the nested switch z80_execute() used
+// before them, fetching from a flat 64KB array and evaluating F eagerly,
+// cut down to the opcodes of the built-in workloads. Anything else runs as
+// a 4 T-state NOP, as it did there. T-states match the interpreter's.
+struct Switch_CPU
+{
+    uint8_t a, f, b, c, d;
+    uint16_t pc, sp;
+};
+
+static uint8_t switch_sz(uint8_t value)
+{
+    return (value & 0x80) | (value == 0 ? 0x40 : 0);
+}
+
+static long long switch_run(Switch_CPU &cpu, uint8_t *ram, long long cycles, long long &insns)
+{
+    long long executed = 0;
+    while (executed < cycles)
+    {
+        uint8_t opcode = ram[cpu.pc++];
+        insns++;
+        switch (opcode)
+        {
+        case 0x02: // LD (BC), A
+            ram[cpu.b << 8 | cpu.c] = cpu.a;
+            executed += 7;
+            break;
+        case 0x04: // INC B
+            cpu.b++;
+            cpu.f = (cpu.f & 0x01) | switch_sz(cpu.b);
+            executed += 4;
+            break;
+        case 0x05: // DEC B
+            cpu.b--;
+            cpu.f = (cpu.f & 0x01) | switch_sz(cpu.b) | 0x02;
+            executed += 4;
+            break;
+        case 0x06: // LD B, n
+            cpu.b = ram[cpu.pc++];
+            executed += 7;
+            break;
+        case 0x0C: // INC C
+            cpu.c++;
+            cpu.f = (cpu.f & 0x01) | switch_sz(cpu.c);
+            executed += 4;
+            break;
+        case 0x0E: // LD C, n
+            cpu.c = ram[cpu.pc++];
+            executed += 7;
+            break;
+        case 0x14: // INC D
+            cpu.d++;
+            cpu.f = (cpu.f & 0x01) | switch_sz(cpu.d);
+            executed += 4;
+            break;
+        case 0x18: // JR e
+            cpu.pc += static_cast<int8_t>(ram[cpu.pc]) + 1;
+            executed += 12;
+            break;
+        case 0x80: // ADD A, B
+        {
+            int sum = cpu.a + cpu.b;
+            cpu.a = static_cast<uint8_t>(sum);
+            cpu.f = switch_sz(cpu.a) | (sum > 0xFF ? 0x01 : 0);
+            executed += 4;
+            break;
+        }
+        case 0x90: // SUB B
+        {
+            uint8_t borrow = cpu.b > cpu.a ? 0x01 : 0;
+            cpu.a -= cpu.b;
+            cpu.f = switch_sz(cpu.a) | 0x02 | borrow;
+            executed += 4;
+            break;
+        }
+        case 0xC2: // JP NZ, nn
+        case 0xCA: // JP Z, nn
+        case 0xC3: // JP nn
+        {
+            uint16_t target = ram[cpu.pc] | ram[static_cast<uint16_t>(cpu.pc + 1)] << 8;
+            bool zero = (cpu.f & 0x40) != 0;
+            if (opcode == 0xC3 || zero == (opcode == 0xCA))
+                cpu.pc = target;
+            else
+                cpu.pc += 2;
+            executed += 10;
+            break;
+        }
+        case 0xC9: // RET
+            cpu.pc = ram[cpu.sp] | ram[static_cast<uint16_t>(cpu.sp + 1)] << 8;
+            cpu.sp += 2;
+            executed += 10;
+            break;
+        case 0xCD: // CALL nn
+        {
+            uint16_t target = ram[cpu.pc] | ram[static_cast<uint16_t>(cpu.pc + 1)] << 8;
+            cpu.pc += 2;
+            ram[--cpu.sp] = cpu.pc >> 8;
+            ram[--cpu.sp] = cpu.pc & 0xFF;
+            cpu.pc = target;
+            executed += 17;
+            break;
+        }
+        case 0xF1: // POP AF
+            cpu.f = ram[cpu.sp++];
+            cpu.a = ram[cpu.sp++];
+            executed += 10;
+            break;
+        case 0xCB:
+        {
+            uint8_t cb_opcode = ram[cpu.pc++];
+            uint8_t carry;
+            switch (cb_opcode)
+            {
+            case 0x07: // RLC A
+                carry = cpu.a >> 7;
+                cpu.a = static_cast<uint8_t>(cpu.a << 1 | carry);
+                cpu.f = switch_sz(cpu.a) | carry;
+                break;
+            case 0x28: // SRA B
+                carry = cpu.b & 0x01;
+                cpu.b = (cpu.b >> 1) | (cpu.b & 0x80);
+                cpu.f = switch_sz(cpu.b) | carry;
+                break;
+            case 0x31: // SRL C
+                carry = cpu.c & 0x01;
+                cpu.c >>= 1;
+                cpu.f = switch_sz(cpu.c) | carry;
+                break;
+            default:
+                break;
+            }
+            executed += 8;
+            break;
+        }
+        default: // NOP and anything the workloads do not use
+            executed += 4;
+            break;
+        }
+    }
+    return executed;
+}
+
+static Bench_Result bench_switch(const Bench_Workload &w, long long cycles, int reps)
+{
+    std::vector<uint8_t> ram(65536);
+    std::vector<double> times;
+    long long ran = 0, insns = 0;
+    for (int rep = -1; rep < reps; rep++)
+    {
+        std::fill(ram.begin(), ram.end(), 0);
+        std::copy(w.image.begin(), w.image.end(), ram.begin());
+        Switch_CPU cpu = {0, 0x40, 0, 0, 0, 0x0000, 0x0000}; // Same reset state as Z80Machine::init()
+        insns = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        ran = switch_run(cpu, ram.data(), cycles, insns);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (rep >= 0)
+            times.push_back(seconds);
+    }
+
+    std::sort(times.begin(), times.end());
+    return {w.name, "switch", insns, ran, times.front(), times[times.size() / 2]};
+}
+
+// Initial registers for sweep instance n
+static Z80_CPU sweep_state(int n)
+{
+    machine.init();
+    Z80_CPU cpu = machine.cpu;
+    cpu.a = static_cast<uint8_t>(n);
+    cpu.b = static_cast<uint8_t>(n * 7);
+    return cpu;
+}
+
+// The ALU loop from BENCH_LANES starting states, one Z80Machine per
+// instance and then as one Z80Batch
+static void bench_sweep(int reps, std::vector<Bench_Result> &results)
+{
+    std::vector<double> scalar_times, batch_times;
+    long long scalar_cycles = 0, batch_cycles = 0;
+    for (int rep = -1; rep < reps; rep++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        scalar_cycles = 0;
+        for (int n = 0; n < BENCH_LANES; n++)
+        {
+            Z80_CPU cpu = sweep_state(n);
+            for (unsigned i = 0; i < sizeof(alu_program); i++)
+                machine.mem_write(i, alu_program[i]);
+            machine.cpu = cpu;
+            scalar_cycles += machine.execute(BENCH_LANE_CYCLES);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (rep >= 0)
+            scalar_times.push_back(seconds);
+
+        Z80Batch batch(BENCH_LANES);
+        batch.load_image(alu_program, sizeof(alu_program));
+        for (int n = 0; n < BENCH_LANES; n++)
+            batch.set_lane(n, sweep_state(n));
+
+        start = std::chrono::steady_clock::now();
+        batch.execute(BENCH_LANE_CYCLES);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (rep >= 0)
+            batch_times.push_back(seconds);
+        batch_cycles = 0;
+        for (int n = 0; n < BENCH_LANES; n++)
+            batch_cycles += batch.lane_cycles(n);
+    }
+
+    std::sort(scalar_times.begin(), scalar_times.end());
+    std::sort(batch_times.begin(), batch_times.end());
+    results.push_back({"sweep", "machines", scalar_cycles / SWEEP_LOOP_CYCLES * SWEEP_LOOP_INSNS, scalar_cycles,
+                       scalar_times.front(), scalar_times[scalar_times.size() / 2]});
+    results.push_back({"sweep", std::string("batch-") + Z80Batch::kernel_name(),
+                       batch_cycles / SWEEP_LOOP_CYCLES * SWEEP_LOOP_INSNS, batch_cycles, batch_times.front(),
+                       batch_times[batch_times.size() / 2]});
+}
+
+static std::string json_string(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void print_json(std::ostream &out, const std::vector<Bench_Result> &results, int reps)
+{
+    out << "{\n  \"reps\": " << reps << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Bench_Result &r = results[i];
+        double seconds = r.seconds_median;
+        out << "    {\"workload\": " << json_string(r.workload) << ", \"engine\": " << json_string(r.engine)
+            << ", \"insns\": " << r.insns << ", \"cycles\": " << r.cycles
+            << ", \"seconds_min\": " << r.seconds_min << ", \"seconds_median\": " << seconds
+            << ", \"insns_per_sec\": " << r.insns / seconds << ", \"mhz\": " << r.cycles / seconds / 1e6
+            << ", \"ns_per_insn\": " << seconds * 1e9 / r.insns << "}" << (i + 1 < results.size() ? "," : "")
+            << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+static void print_table(std::ostream &out, const std::vector<Bench_Result> &results, int reps)
+{
+    out << "Median of " << reps << " runs after one warm-up" << std::endl;
+    for (const Bench_Result &r : results)
+    {
+        double seconds = r.seconds_median;
+        out << r.workload << " [" << r.engine << "]: " << r.insns / seconds / 1e6 << " MIPS, "
+            << r.cycles / seconds / 1e6 << " MHz emulated, " << seconds * 1e9 / r.insns << " ns/insn" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    z80_trace_level = Z80_TRACE_OFF;
+
+    std::vector<Bench_Workload> workloads = {
+        {"alu", std::vector<uint8_t>(alu_program, alu_program + sizeof(alu_program)), true},
+        {"call", std::vector<uint8_t>(call_program, call_program + sizeof(call_program)), true},
+        {"copy", std::vector<uint8_t>(copy_program, copy_program + sizeof(copy_program)), true},
+    };
+    long long cycles = BENCH_CYCLES;
+    int reps = BENCH_REPS;
+    bool json = false;
+    std::string json_file;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (std::strncmp(argv[i], "--json=", 7) == 0)
+            json = true, json_file = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--reps=", 7) == 0)
+            reps = std::max(1, std::atoi(argv[i] + 7));
+        else if (std::strncmp(argv[i], "--cycles=", 9) == 0)
+            cycles = std::max(1LL, std::atoll(argv[i] + 9));
+        else
+        {
+            // Test program, looped from its reset state each time it halts
+            std::ifstream file(argv[i], std::ios::binary);
+            std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (!file.is_open() || image.size() > 65536)
+            {
+                std::cerr << "Usage: " << argv[0] << " [--json[=file]] [--reps=N] [--cycles=N] [program.bin ...]"
+                          << std::endl;
+                return -1;
+            }
+            workloads.push_back({argv[i], image, false});
+        }
+    }
+
+    bool have_jit = machine.enable_jit(true);
+    machine.enable_jit(false);
+
+    std::vector<Bench_Result> results;
+    for (const Bench_Workload &w : workloads)
+    {
+        long long insns = bench_count(w, cycles);
+        if (w.builtin)
+            results.push_back(bench_switch(w, cycles, reps));
+        results.push_back(bench_workload(w, false, insns, cycles, reps));
+        if (have_jit)
+            results.push_back(bench_workload(w, true, insns, cycles, reps));
+    }
+    bench_sweep(reps, results);
+
+    if (!json)
+    {
+        print_table(std::cout, results, reps);
+    }
+    else if (json_file.empty())
+    {
+        print_json(std::cout, results, reps);
+    }
+    else
+    {
+        std::ofstream out(json_file);
+        print_json(out, results, reps);
+        print_table(std::cout, results, reps);
+    }
+    return 0;
+}
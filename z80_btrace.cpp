@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <cstring>
+#include "z80_btrace.h"
+#include "z80_disasm.h"
+#include "z80_flags.h"
+
+static bool field_is_word(int n)
+{
+    return n >= Z80_TF_IX && n <= Z80_TF_PC;
+}
+
+// Current value of every traced field, with F rebuilt from the lazy flags
+static void read_fields(const Z80_CPU &cpu, uint16_t out[Z80_TF_COUNT])
+{
+    Z80_CPU copy = cpu;
+    uint16_t values[Z80_TF_COUNT] = {
+        copy.a, flags_get(copy), copy.b, copy.c, copy.d, copy.e, copy.h, copy.l,
+        copy.ix, copy.iy, copy.sp, copy.pc, copy.i, copy.r,
+        copy.interrupt_enable, copy.iff2, copy.im, copy.halted,
+        copy.a_prime, copy.f_prime, copy.b_prime, copy.c_prime, copy.d_prime, copy.e_prime,
+        copy.h_prime, copy.l_prime};
+    std::memcpy(out, values, sizeof(values));
+}
+
+static void write_field(Z80_CPU &cpu, int n, uint16_t value)
+{
+    uint8_t byte = static_cast<uint8_t>(value);
+    switch (n)
+    {
+    case Z80_TF_A: cpu.a = byte; break;
+    case Z80_TF_F: cpu.f = byte; break;
+    case Z80_TF_B: cpu.b = byte; break;
+    case Z80_TF_C: cpu.c = byte; break;
+    case Z80_TF_D: cpu.d = byte; break;
+    case Z80_TF_E: cpu.e = byte; break;
+    case Z80_TF_H: cpu.h = byte; break;
+    case Z80_TF_L: cpu.l = byte; break;
+    case Z80_TF_IX: cpu.ix = value; break;
+    case Z80_TF_IY: cpu.iy = value; break;
+    case Z80_TF_SP: cpu.sp = value; break;
+    case Z80_TF_PC: cpu.pc = value; break;
+    case Z80_TF_I: cpu.i = byte; break;
+    case Z80_TF_R: cpu.r = byte; break;
+    case Z80_TF_IFF1: cpu.interrupt_enable = byte; break;
+    case Z80_TF_IFF2: cpu.iff2 = byte; break;
+    case Z80_TF_IM: cpu.im = byte; break;
+    case Z80_TF_HALT: cpu.halted = byte; break;
+    case Z80_TF_A2: cpu.a_prime = byte; break;
+    case Z80_TF_F2: cpu.f_prime = byte; break;
+    case Z80_TF_B2: cpu.b_prime = byte; break;
+    case Z80_TF_C2: cpu.c_prime = byte; break;
+    case Z80_TF_D2: cpu.d_prime = byte; break;
+    case Z80_TF_E2: cpu.e_prime = byte; break;
+    case Z80_TF_H2: cpu.h_prime = byte; break;
+    case Z80_TF_L2: cpu.l_prime = byte; break;
+    }
+}
+
+// R after one M1 cycle, as the trace expects it
+static uint8_t next_r(uint16_t r)
+{
+    return static_cast<uint8_t>((r & 0x80) | ((r + 1) & 0x7F));
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+Z80TraceWriter::Z80TraceWriter() : file(nullptr), used(0), last(), count(0), failed(false)
+{
+}
+
+Z80TraceWriter::~Z80TraceWriter()
+{
+    close();
+}
+
+bool Z80TraceWriter::open(const std::string &filename, Z80Machine &m)
+{
+    close();
+    file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    buffer.resize(Z80_BTRACE_CHUNK);
+    used = 0;
+    count = 0;
+    failed = false;
+    writes.clear();
+
+    uint8_t magic[8] = {Z80_BTRACE_MAGIC[0], Z80_BTRACE_MAGIC[1], Z80_BTRACE_MAGIC[2], Z80_BTRACE_MAGIC[3],
+                        Z80_BTRACE_VERSION, 0, 0, 0};
+    put(magic, sizeof(magic));
+    read_fields(m.cpu, last);
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+    {
+        uint8_t bytes[2] = {static_cast<uint8_t>(last[n]), static_cast<uint8_t>(last[n] >> 8)};
+        put(bytes, field_is_word(n) ? 2 : 1);
+    }
+    for (int addr = 0; addr < 65536; addr++)
+    {
+        uint8_t byte = m.mem_read(static_cast<uint16_t>(addr));
+        put(&byte, 1);
+    }
+    return true;
+}
+
+bool Z80TraceWriter::close()
+{
+    if (file == nullptr)
+        return true;
+    flush();
+    failed |= std::fclose(file) != 0;
+    file = nullptr;
+    buffer.clear();
+    buffer.shrink_to_fit();
+    return !failed;
+}
+
+void Z80TraceWriter::flush()
+{
+    if (used != 0 && std::fwrite(buffer.data(), 1, used, file) != used)
+        failed = true;
+    used = 0;
+}
+
+void Z80TraceWriter::put(const void *data, size_t size)
+{
+    if (used + size > buffer.size())
+    {
+        flush();
+        if (size > buffer.size())
+        {
+            failed |= std::fwrite(data, 1, size, file) != size;
+            return;
+        }
+    }
+    std::memcpy(buffer.data() + used, data, size);
+    used += size;
+}
+
+void Z80TraceWriter::put_varint(uint64_t value)
+{
+    uint8_t bytes[10];
+    int n = 0;
+    do
+    {
+        bytes[n] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+        value >>= 7;
+    } while (bytes[n++] & 0x80);
+    put(bytes, n);
+}
+
+void Z80TraceWriter::insn(const Z80Machine &m, const Z80_Insn &insn, int cycles)
+{
+    // Bytes as decoded, so code that overwrote itself is traced as it ran
+    uint8_t bytes[Z80_INSN_MAX_BYTES];
+    int length = 0;
+    if (insn.prefix > 0xFF)
+    {
+        bytes[length++] = static_cast<uint8_t>(insn.prefix >> 8);
+        bytes[length++] = 0xCB;
+        bytes[length++] = static_cast<uint8_t>(insn.operand);
+        bytes[length++] = insn.opcode;
+    }
+    else
+    {
+        if (insn.prefix != 0)
+            bytes[length++] = static_cast<uint8_t>(insn.prefix);
+        bytes[length++] = insn.opcode;
+        for (int n = 0; length < insn.length && n < 2; n++)
+            bytes[length++] = static_cast<uint8_t>(insn.operand >> (8 * n));
+    }
+    record(m, static_cast<uint8_t>(length - 1), bytes, length, cycles);
+}
+
+void Z80TraceWriter::interrupt(const Z80Machine &m, int cycles)
+{
+    record(m, Z80_BTRACE_HEAD_INT, nullptr, 0, cycles);
+}
+
+void Z80TraceWriter::record(const Z80Machine &m, uint8_t head, const uint8_t *bytes, int length, int cycles)
+{
+    uint16_t now[Z80_TF_COUNT];
+    read_fields(m.cpu, now);
+
+    uint32_t mask = 0;
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+        if (now[n] != last[n])
+            mask |= 1u << n;
+    if (length != 0 && now[Z80_TF_PC] == static_cast<uint16_t>(last[Z80_TF_PC] + length))
+        mask &= ~(1u << Z80_TF_PC);
+    else
+        mask |= 1u << Z80_TF_PC, head |= Z80_BTRACE_HEAD_PC;
+    if (now[Z80_TF_R] == next_r(last[Z80_TF_R]))
+        mask &= ~(1u << Z80_TF_R);
+    else
+        mask |= 1u << Z80_TF_R;
+
+    size_t write_count = writes.size();
+    head |= (write_count < 3 ? write_count : 3) << 2;
+    put(&head, 1);
+    if (length != 0)
+        put(bytes, length);
+    put_varint(static_cast<uint64_t>(cycles));
+    put_varint(mask & ~(1u << Z80_TF_PC));
+    if (head & Z80_BTRACE_HEAD_PC)
+    {
+        uint8_t pc[2] = {static_cast<uint8_t>(now[Z80_TF_PC]), static_cast<uint8_t>(now[Z80_TF_PC] >> 8)};
+        put(pc, 2);
+    }
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+    {
+        if (n == Z80_TF_PC || !(mask & (1u << n)))
+            continue;
+        uint8_t value[2] = {static_cast<uint8_t>(now[n]), static_cast<uint8_t>(now[n] >> 8)};
+        put(value, field_is_word(n) ? 2 : 1);
+    }
+    if (write_count >= 3)
+        put_varint(write_count);
+    for (const auto &w : writes)
+    {
+        uint8_t entry[3] = {static_cast<uint8_t>(w.first), static_cast<uint8_t>(w.first >> 8), w.second};
+        put(entry, sizeof(entry));
+    }
+
+    writes.clear();
+    std::memcpy(last, now, sizeof(last));
+    count++;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+Z80TraceReader::Z80TraceReader() : file(nullptr), pos(0), end(0), state(), clock(0), count(0)
+{
+}
+
+Z80TraceReader::~Z80TraceReader()
+{
+    if (file != nullptr)
+        std::fclose(file);
+}
+
+bool Z80TraceReader::get(void *data, size_t size)
+{
+    uint8_t *out = static_cast<uint8_t *>(data);
+    while (size != 0)
+    {
+        if (pos == end)
+        {
+            pos = 0;
+            end = std::fread(buffer.data(), 1, buffer.size(), file);
+            if (end == 0)
+                return false;
+        }
+        size_t n = end - pos < size ? end - pos : size;
+        std::memcpy(out, buffer.data() + pos, n);
+        pos += n, out += n, size -= n;
+    }
+    return true;
+}
+
+bool Z80TraceReader::get_varint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte;
+        if (!get(&byte, 1))
+            return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool Z80TraceReader::open(const std::string &filename)
+{
+    if (file != nullptr)
+        std::fclose(file);
+    file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    buffer.resize(Z80_BTRACE_CHUNK);
+    pos = end = 0;
+    clock = count = 0;
+
+    uint8_t magic[8];
+    if (!get(magic, sizeof(magic)) || std::memcmp(magic, Z80_BTRACE_MAGIC, 4) != 0 || magic[4] != Z80_BTRACE_VERSION)
+        return false;
+    std::memset(&state, 0, sizeof(state));
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+    {
+        uint8_t bytes[2] = {0, 0};
+        if (!get(bytes, field_is_word(n) ? 2 : 1))
+            return false;
+        write_field(state, n, static_cast<uint16_t>(bytes[0] | bytes[1] << 8));
+    }
+    mem.resize(65536);
+    return get(mem.data(), mem.size());
+}
+
+bool Z80TraceReader::next(Z80_TraceRecord &r)
+{
+    uint8_t head;
+    if (file == nullptr || !get(&head, 1))
+        return false;
+
+    r.index = count;
+    r.pc = state.pc;
+    r.interrupt = (head & Z80_BTRACE_HEAD_INT) != 0;
+    r.length = r.interrupt ? 0 : (head & Z80_BTRACE_HEAD_LENGTH) + 1;
+    uint64_t cycles, mask;
+    if ((r.length != 0 && !get(r.bytes, r.length)) || !get_varint(cycles) || !get_varint(mask))
+        return false;
+    r.insn_cycles = static_cast<int>(cycles);
+
+    uint16_t pc = static_cast<uint16_t>(state.pc + r.length);
+    if (head & Z80_BTRACE_HEAD_PC)
+    {
+        uint8_t bytes[2];
+        if (!get(bytes, 2))
+            return false;
+        pc = static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+        mask |= 1u << Z80_TF_PC;
+    }
+    r.changed = static_cast<uint32_t>(mask);
+    state.pc = pc;
+    if (!(mask & (1u << Z80_TF_R)))
+        state.r = next_r(state.r);
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+    {
+        if (n == Z80_TF_PC || !(mask & (1u << n)))
+            continue;
+        uint8_t bytes[2] = {0, 0};
+        if (!get(bytes, field_is_word(n) ? 2 : 1))
+            return false;
+        write_field(state, n, static_cast<uint16_t>(bytes[0] | bytes[1] << 8));
+    }
+
+    uint64_t write_count = (head & Z80_BTRACE_HEAD_WRITES) >> 2;
+    if (write_count == 3 && !get_varint(write_count))
+        return false;
+    r.writes.resize(write_count);
+    for (auto &w : r.writes)
+    {
+        uint8_t entry[3];
+        if (!get(entry, sizeof(entry)))
+            return false;
+        w.first = static_cast<uint16_t>(entry[0] | entry[1] << 8);
+        w.second = entry[2];
+        mem[w.first] = w.second;
+    }
+
+    clock += cycles;
+    r.cycles = clock;
+    count++;
+    return true;
+}
+
+std::string z80_trace_text(const Z80_TraceRecord &r, const Z80_CPU &after)
+{
+    static const char *const names[Z80_TF_COUNT] = {
+        "A", "F", "B", "C", "D", "E", "H", "L", "IX", "IY", "SP", "PC", "I", "R",
+        "IFF1", "IFF2", "IM", "HALT", "A'", "F'", "B'", "C'", "D'", "E'", "H'", "L'"};
+    char line[96];
+    std::string text;
+    if (r.interrupt)
+        std::snprintf(line, sizeof(line), "Interrupt accepted, jumping to %04x\n", after.pc);
+    else
+    {
+        uint8_t bytes[Z80_INSN_MAX_BYTES] = {};
+        std::copy(r.bytes, r.bytes + r.length, bytes);
+        std::string insn;
+        z80_disasm(bytes, r.pc, insn);
+        std::snprintf(line, sizeof(line), "Executing opcode: %02x at PC: %04x (%s)\n", r.bytes[0], r.pc, insn.c_str());
+    }
+    text = line;
+
+    uint16_t values[Z80_TF_COUNT];
+    read_fields(after, values);
+    std::snprintf(line, sizeof(line), "  [%llu] %d T-states:", static_cast<unsigned long long>(r.cycles),
+                  r.insn_cycles);
+    text += line;
+    for (int n = 0; n < Z80_TF_COUNT; n++)
+    {
+        if (!(r.changed & (1u << n)))
+            continue;
+        std::snprintf(line, sizeof(line), " %s=%0*x", names[n], field_is_word(n) ? 4 : 2, values[n]);
+        text += line;
+    }
+    for (const auto &w : r.writes)
+    {
+        std::snprintf(line, sizeof(line), " (%04x)=%02x", w.first, w.second);
+        text += line;
+    }
+    return text + "\n";
+}
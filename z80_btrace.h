@@ -0,0 +1,184 @@
+#ifndef Z80_BTRACE_H
+#define Z80_BTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "z80.h"
+#include "z80_trace.h"
+
+// Binary execution trace. A file is a header followed by one record per
+// instruction or interrupt acknowledge:
+//
+//   header  "Z80T", version byte, 3 reserved bytes, then every field below
+//           in order (words little-endian) and the 64KB memory image
+//   record  head byte:
+//             bits 0-1  opcode bytes - 1 (0 for an interrupt)
+//             bits 2-3  memory writes, 3 meaning a varint count follows
+//             bit 4     interrupt acknowledge, no opcode bytes
+//             bit 5     PC is stored (it is not the next instruction)
+//           opcode bytes
+//           varint T-states the record took
+//           varint mask of the fields that changed, then [PC] and their
+//           new values in field order
+//           [varint write count] and (address, value) pairs
+//
+// PC and R are left out of the mask when they hold the expected value:
+// PC just past the instruction, R incremented once in its low 7 bits.
+// Varints are unsigned LEB128.
+
+#define Z80_BTRACE_MAGIC "Z80T"
+#define Z80_BTRACE_VERSION 2
+#define Z80_BTRACE_CHUNK (1 << 20) // Bytes buffered between writes and reads
+
+#define Z80_BTRACE_HEAD_LENGTH 0x03
+#define Z80_BTRACE_HEAD_WRITES 0x0C
+#define Z80_BTRACE_HEAD_INT 0x10
+#define Z80_BTRACE_HEAD_PC 0x20
+
+// Traced CPU fields, in file order. IX, IY, SP and PC are words.
+enum Z80_TraceField
+{
+    Z80_TF_A, Z80_TF_F, Z80_TF_B, Z80_TF_C, Z80_TF_D, Z80_TF_E, Z80_TF_H, Z80_TF_L,
+    Z80_TF_IX, Z80_TF_IY, Z80_TF_SP, Z80_TF_PC, Z80_TF_I, Z80_TF_R,
+    Z80_TF_IFF1, Z80_TF_IFF2, Z80_TF_IM, Z80_TF_HALT,
+    Z80_TF_A2, Z80_TF_F2, Z80_TF_B2, Z80_TF_C2, Z80_TF_D2, Z80_TF_E2, Z80_TF_H2, Z80_TF_L2,
+    Z80_TF_COUNT
+};
+
+// Streaming writer. Records are packed into a 1MB buffer and written out a
+// chunk at a time. Attach it with Z80Machine::set_recorder(); while it is
+// attached the machine stays on the interpreter.
+class Z80TraceWriter
+{
+public:
+    Z80TraceWriter();
+    ~Z80TraceWriter();
+    Z80TraceWriter(const Z80TraceWriter &) = delete;
+    Z80TraceWriter &operator=(const Z80TraceWriter &) = delete;
+
+    // Start a trace of m from its current state. Returns false if the file
+    // could not be created.
+    bool open(const std::string &filename, Z80Machine &m);
+
+    // Write out what is buffered and close the file
+    bool close();
+
+    uint64_t records() const
+    {
+        return count;
+    }
+
+    // Hooks called by the machine
+    void insn(const Z80Machine &m, const Z80_Insn &insn, int cycles);
+    void interrupt(const Z80Machine &m, int cycles);
+    void write(uint16_t addr, uint8_t value)
+    {
+        writes.emplace_back(addr, value);
+    }
+
+private:
+    void record(const Z80Machine &m, uint8_t head, const uint8_t *bytes, int length, int cycles);
+    void put(const void *data, size_t size);
+    void put_varint(uint64_t value);
+    void flush();
+
+    FILE *file;
+    std::vector<uint8_t> buffer;
+    size_t used;
+    uint16_t last[Z80_TF_COUNT]; // Field values as of the last record
+    std::vector<std::pair<uint16_t, uint8_t>> writes; // Made by the current instruction
+    uint64_t count;
+    bool failed; // A write to the file went wrong
+};
+
+// One record as read back
+struct Z80_TraceRecord
+{
+    uint64_t index;  // 0 for the first record
+    uint64_t cycles; // T-states from the start of the trace to the end of this record
+    uint16_t pc;     // Address of the instruction (PC before an interrupt)
+    bool interrupt;
+    int length;      // Opcode bytes
+    uint8_t bytes[Z80_INSN_MAX_BYTES];
+    int insn_cycles;
+    uint32_t changed; // 1 << Z80_TraceField for every field the record stored
+    std::vector<std::pair<uint16_t, uint8_t>> writes;
+};
+
+// Reads a trace back, replaying it onto a CPU and a 64KB memory image
+class Z80TraceReader
+{
+public:
+    Z80TraceReader();
+    ~Z80TraceReader();
+    Z80TraceReader(const Z80TraceReader &) = delete;
+    Z80TraceReader &operator=(const Z80TraceReader &) = delete;
+
+    // Open a trace and load its starting state. Returns false if the file
+    // cannot be read or is not a trace.
+    bool open(const std::string &filename);
+
+    // Read the next record and apply it. Returns false at the end of the
+    // trace or on a truncated record.
+    bool next(Z80_TraceRecord &r);
+
+    // State after the records read so far. F is held in cpu.f.
+    const Z80_CPU &cpu() const
+    {
+        return state;
+    }
+
+    const uint8_t *memory() const
+    {
+        return mem.data();
+    }
+
+    uint64_t cycles() const
+    {
+        return clock;
+    }
+
+private:
+    bool get(void *data, size_t size);
+    bool get_varint(uint64_t &value);
+
+    FILE *file;
+    std::vector<uint8_t> buffer;
+    size_t pos, end;
+    Z80_CPU state;
+    std::vector<uint8_t> mem;
+    uint64_t clock;
+    uint64_t count;
+};
+
+// Text form of a record in the style of the --trace=insn output
+std::string z80_trace_text(const Z80_TraceRecord &r, const Z80_CPU &after);
+
+#if Z80_TRACE_LEVEL >= Z80_TRACE_INSN
+#define Z80_RECORD_INSN(recorder, m, decoded, cycles) \
+    do                                                \
+    {                                                 \
+        if (recorder)                                 \
+            (recorder)->insn(m, decoded, cycles);     \
+    } while (0)
+#define Z80_RECORD_INT(recorder, m, cycles)   \
+    do                                        \
+    {                                         \
+        if (recorder)                         \
+            (recorder)->interrupt(m, cycles); \
+    } while (0)
+#else
+#define Z80_RECORD_INSN(recorder, m, decoded, cycles) \
+    do                                                \
+    {                                                 \
+    } while (0)
+#define Z80_RECORD_INT(recorder, m, cycles) \
+    do                                      \
+    {                                       \
+    } while (0)
+#endif
+
+#endif // Z80_BTRACE_H
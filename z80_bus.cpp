@@ -0,0 +1,152 @@
+#include "z80_bus.h"
+
+#define Z80_BUS_CYCLES_MAX (4 + Z80_BUS_LOG_MAX) // Fetches and operand reads, accesses, one internal
+
+const char *z80_bus_kind_name(uint8_t kind)
+{
+    static const char *const names[] = {"fetch", "read", "write", "in", "out", "int-ack", "internal"};
+    return kind <= Z80_BUS_INTERNAL ? names[kind] : "?";
+}
+
+#if Z80_BUS_CYCLES
+
+static uint8_t bus_control(uint8_t kind)
+{
+    switch (kind)
+    {
+    case Z80_BUS_FETCH: return Z80_CTRL_M1 | Z80_CTRL_MREQ | Z80_CTRL_RD;
+    case Z80_BUS_READ: return Z80_CTRL_MREQ | Z80_CTRL_RD;
+    case Z80_BUS_WRITE: return Z80_CTRL_MREQ | Z80_CTRL_WR;
+    case Z80_BUS_IN: return Z80_CTRL_IORQ | Z80_CTRL_RD;
+    case Z80_BUS_OUT: return Z80_CTRL_IORQ | Z80_CTRL_WR;
+    case Z80_BUS_INT_ACK: return Z80_CTRL_M1 | Z80_CTRL_IORQ;
+    default: return 0;
+    }
+}
+
+// T-states of a logged access: 3 for memory, 4 for a port (one wait state)
+static int access_tstates(uint8_t kind)
+{
+    return kind == Z80_BUS_IN || kind == Z80_BUS_OUT ? 4 : 3;
+}
+
+// The cycles of one instruction or acknowledge. The `head` cycles come from
+// the opcode bytes and are already in place; the logged accesses follow, and
+// whatever `total` has left over goes in an internal cycle between the two.
+// An opcode the interpreter does not implement runs as a NOP that can be
+// shorter than its fetches; the fetches past its T-states are dropped, so
+// the cycles always add up to what execute() counts.
+static int finish_cycles(Z80_BusCycle *cycles, int head, int head_tstates, const Z80_BusLog &log, int total)
+{
+    int spent = head_tstates;
+    for (int i = 0; i < log.count; i++)
+        spent += access_tstates(log.access[i].kind);
+    while (spent > total && head > 1)
+        spent -= cycles[--head].tstates;
+    int n = head;
+    if (total > spent)
+        cycles[n++] = {0, 0, 0, Z80_BUS_INTERNAL, 0, static_cast<uint8_t>(total - spent)};
+    for (int i = 0; i < log.count; i++)
+    {
+        const Z80_BusLog::Access &access = log.access[i];
+        cycles[n++] = {0, access.addr, access.data, access.kind, 0,
+                       static_cast<uint8_t>(access_tstates(access.kind))};
+    }
+    return n;
+}
+
+Z80BusCycles Z80BusCycles::run(Z80Machine &m)
+{
+    Z80_BusCycle cycles[Z80_BUS_CYCLES_MAX];
+    Z80_BusLog log;
+    uint64_t time = 0;
+    for (;;)
+    {
+        int n = 0;
+        log.count = 0;
+        bool delayed = m.cpu.ei_delay != 0; // The instruction after EI runs first, as in execute()
+        m.cpu.ei_delay = 0;
+        if (!delayed && (m.int_lines & (Z80_LINE_INT | Z80_LINE_NMI)))
+        {
+            uint16_t pc = m.cpu.halted ? static_cast<uint16_t>(m.cpu.pc + 1) : m.cpu.pc;
+            bool nmi = (m.int_lines & Z80_LINE_NMI) != 0;
+            uint8_t data = nmi ? m.peek(pc) : m.int_data;
+            m.bus_log = &log;
+            int taken = m.accept_interrupt();
+            m.bus_log = nullptr;
+            if (taken != 0)
+            {
+                // An NMI fetches and ignores the opcode at PC; an INT reads
+                // the device's byte in a longer M1
+                cycles[0] = {0, pc, data, static_cast<uint8_t>(nmi ? Z80_BUS_FETCH : Z80_BUS_INT_ACK), 0,
+                             static_cast<uint8_t>(nmi ? 5 : 6)};
+                n = finish_cycles(cycles, 1, cycles[0].tstates, log, taken);
+            }
+        }
+        if (n == 0 && m.cpu.halted)
+        {
+            // HALT repeats NOP fetches of the byte after it until an interrupt
+            uint16_t pc = m.cpu.pc + 1;
+            cycles[0] = {0, pc, m.peek(pc), Z80_BUS_FETCH, 0, static_cast<uint8_t>(m.idle(4))};
+            n = 1;
+        }
+        else if (n == 0)
+        {
+            uint16_t pc = m.cpu.pc;
+            uint8_t opcode = m.peek(pc);
+            uint16_t prefix = 0;
+            int head = 0, head_tstates = 0, operand_bytes = 0;
+            cycles[head++] = {0, pc, opcode, Z80_BUS_FETCH, 0, 4};
+            uint16_t addr = pc + 1;
+            if (opcode == 0xCB || opcode == 0xED || opcode == 0xDD || opcode == 0xFD)
+            {
+                prefix = opcode;
+                opcode = m.peek(addr);
+                if ((prefix == 0xDD || prefix == 0xFD) && opcode == 0xCB)
+                {
+                    // DD CB d op: d and op are plain reads, not M1 fetches
+                    prefix = prefix << 8 | 0xCB;
+                    cycles[head++] = {0, addr, 0xCB, Z80_BUS_FETCH, 0, 4};
+                    cycles[head++] = {0, static_cast<uint16_t>(addr + 1), m.peek(addr + 1), Z80_BUS_READ, 0, 3};
+                    opcode = m.peek(addr + 2);
+                    cycles[head++] = {0, static_cast<uint16_t>(addr + 2), opcode, Z80_BUS_READ, 0, 3};
+                    addr += 3;
+                }
+                else
+                {
+                    cycles[head++] = {0, addr, opcode, Z80_BUS_FETCH, 0, 4};
+                    addr++;
+                }
+            }
+            if (prefix >> 8 == 0 && z80_opcode_info(prefix, opcode, operand_bytes))
+            {
+                for (int i = 0; i < operand_bytes; i++, addr++)
+                    cycles[head++] = {0, addr, m.peek(addr), Z80_BUS_READ, 0, 3};
+            }
+            for (int i = 0; i < head; i++)
+                head_tstates += cycles[i].tstates;
+
+            m.bus_log = &log;
+            int total = m.step();
+            m.bus_log = nullptr;
+            n = finish_cycles(cycles, head, head_tstates, log, total);
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            cycles[i].time = time;
+            cycles[i].control = bus_control(cycles[i].kind);
+            time += cycles[i].tstates;
+            co_yield cycles[i];
+        }
+    }
+}
+
+#else
+
+Z80BusCycles Z80BusCycles::run(Z80Machine &)
+{
+    co_return; // The machine keeps no bus log in this build
+}
+
+#endif
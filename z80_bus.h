@@ -0,0 +1,135 @@
+#ifndef Z80_BUS_H
+#define Z80_BUS_H
+
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+#include "z80.h"
+
+// Control lines active during a bus cycle (Z80_BusCycle::control)
+#define Z80_CTRL_M1 0x01
+#define Z80_CTRL_MREQ 0x02
+#define Z80_CTRL_IORQ 0x04
+#define Z80_CTRL_RD 0x08
+#define Z80_CTRL_WR 0x10
+
+// One machine cycle as the pins see it
+struct Z80_BusCycle
+{
+    uint64_t time;   // T-state the cycle starts on, counted from the first cycle
+    uint16_t addr;   // Address bus (PC for an interrupt acknowledge)
+    uint8_t data;    // Byte fetched, read, written or put on the bus by the device
+    uint8_t kind;    // Z80_BUS_*
+    uint8_t control; // Z80_CTRL_* lines asserted
+    uint8_t tstates; // Length of the cycle
+};
+
+// M-cycle stepping as a C++20 coroutine, for device models that need to
+// see the bus (video, DMA, contended memory). Each instruction runs on the
+// interpreter with a bus log attached, then comes out as its M-cycles in
+// order: the opcode fetches and operand reads, the T-states it spends with
+// the bus idle as one internal cycle, then its memory and port accesses.
+// The instruction's effects are in place from its first cycle on, so a
+// device sees the right bus traffic at the right time but cannot change a
+// byte the instruction has already read. Interrupts are taken between
+// instructions, as execute() takes them; a halted CPU yields an opcode
+// fetch every 4 T-states.
+//
+// The machine only logs its bus in a build with Z80_BUS_CYCLES; elsewhere
+// the sequence is empty. execute() pays nothing for it either way.
+//
+//   for (const Z80_BusCycle &cycle : z80_bus_cycles(m))
+//   {
+//       video.run(cycle.tstates);
+//       if (cycle.time >= frame_end)
+//           break;
+//   }
+class Z80BusCycles
+{
+public:
+    struct promise_type
+    {
+        Z80_BusCycle cycle;
+
+        Z80BusCycles get_return_object()
+        {
+            return Z80BusCycles(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const Z80_BusCycle &next) noexcept
+        {
+            cycle = next;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { throw; } // Out of next(), to the caller
+    };
+
+    struct iterator
+    {
+        Z80BusCycles *cycles; // nullptr at the end
+
+        const Z80_BusCycle &operator*() const { return cycles->cycle(); }
+        iterator &operator++()
+        {
+            if (!cycles->next())
+                cycles = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return cycles == other.cycles; }
+        bool operator!=(const iterator &other) const { return cycles != other.cycles; }
+    };
+
+    Z80BusCycles(Z80BusCycles &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Z80BusCycles(const Z80BusCycles &) = delete;
+    Z80BusCycles &operator=(const Z80BusCycles &) = delete;
+    ~Z80BusCycles()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    // Move to the next cycle. Returns false when there are no more.
+    bool next()
+    {
+        if (!handle || handle.done())
+            return false;
+        handle.resume();
+        return !handle.done();
+    }
+
+    const Z80_BusCycle &cycle() const
+    {
+        return handle.promise().cycle;
+    }
+
+    iterator begin()
+    {
+        return iterator{next() ? this : nullptr};
+    }
+
+    iterator end()
+    {
+        return iterator{nullptr};
+    }
+
+    // The coroutine behind z80_bus_cycles()
+    static Z80BusCycles run(Z80Machine &m);
+
+private:
+    explicit Z80BusCycles(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Endless M-cycles of m, starting from its current state
+inline Z80BusCycles z80_bus_cycles(Z80Machine &m)
+{
+    return Z80BusCycles::run(m);
+}
+
+// Short name of a Z80_BUS_* kind, for traces
+const char *z80_bus_kind_name(uint8_t kind);
+
+#endif // Z80_BUS_H
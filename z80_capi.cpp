@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include "z80.h"
+#include "z80_capi.h"
+#include "z80_flags.h"
+#include "z80_sched.h"
+
+struct z80_machine
+{
+    Z80Machine m;
+};
+
+int z80_api_version(void)
+{
+    return Z80_API_VERSION;
+}
+
+z80_machine *z80_create(void)
+{
+    z80_machine *machine = new (std::nothrow) z80_machine;
+    if (machine != nullptr)
+        machine->m.init();
+    return machine;
+}
+
+void z80_destroy(z80_machine *machine)
+{
+    delete machine;
+}
+
+int z80_load(z80_machine *machine, const uint8_t *image, size_t size)
+{
+    if (size > 65536)
+        return -1;
+    machine->m.init();
+    if (size != 0)
+        std::memcpy(machine->m.ram, image, size);
+    machine->m.flush_blocks(); // Written behind the block cache's back
+    return 0;
+}
+
+int z80_load_file(z80_machine *machine, const char *path)
+{
+    machine->m.init();
+    return machine->m.load(path) ? 0 : -1;
+}
+
+int z80_set_jit(z80_machine *machine, int on)
+{
+    return machine->m.enable_jit(on != 0) ? 1 : 0;
+}
+
+uint64_t z80_run(z80_machine *machine, uint64_t cycles)
+{
+    uint64_t ran = 0;
+    while (ran < cycles && !machine->m.cpu.halted)
+    {
+        uint64_t burst = std::min<uint64_t>(cycles - ran, Z80_SCHED_MAX_BURST);
+        int executed = machine->m.execute(static_cast<int>(burst));
+        if (executed == 0)
+            break;
+        ran += static_cast<uint64_t>(executed);
+    }
+    return ran;
+}
+
+void z80_read_regs(const z80_machine *machine, z80_regs *regs)
+{
+    Z80_CPU cpu = machine->m.cpu;
+    regs->pc = cpu.pc;
+    regs->sp = cpu.sp;
+    regs->af = static_cast<uint16_t>(cpu.a << 8 | flags_get(cpu));
+    regs->bc = cpu.bc;
+    regs->de = cpu.de;
+    regs->hl = cpu.hl;
+    regs->ix = cpu.ix;
+    regs->iy = cpu.iy;
+    regs->af_prime = cpu.af_prime;
+    regs->bc_prime = cpu.bc_prime;
+    regs->de_prime = cpu.de_prime;
+    regs->hl_prime = cpu.hl_prime;
+    regs->i = cpu.i;
+    regs->r = cpu.r;
+    regs->iff1 = cpu.interrupt_enable;
+    regs->iff2 = cpu.iff2;
+    regs->im = cpu.im;
+    regs->halted = cpu.halted;
+}
+
+void z80_read_memory(const z80_machine *machine, uint16_t addr, uint8_t *out, size_t size)
+{
+    for (size_t n = 0; n < size; n++)
+        out[n] = machine->m.peek(static_cast<uint16_t>(addr + n));
+}
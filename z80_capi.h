@@ -0,0 +1,70 @@
+#ifndef Z80_CAPI_H
+#define Z80_CAPI_H
+
+/* C interface of libz80, for embedding the emulator in other programs and
+ * languages. Machines are opaque handles; everything else is plain C types
+ * with a fixed layout. Functions and structures only ever gain members at
+ * the end, and Z80_API_VERSION goes up when they do. Each handle is used by
+ * one thread at a time; different handles share nothing. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define Z80_API __attribute__((visibility("default")))
+#else
+#define Z80_API
+#endif
+
+#define Z80_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct z80_machine z80_machine;
+
+/* Registers after a run. F is always current. */
+typedef struct z80_regs
+{
+    uint16_t pc, sp;
+    uint16_t af, bc, de, hl, ix, iy;
+    uint16_t af_prime, bc_prime, de_prime, hl_prime;
+    uint8_t i, r;
+    uint8_t iff1, iff2, im;
+    uint8_t halted;
+} z80_regs;
+
+/* Z80_API_VERSION of the library actually loaded */
+Z80_API int z80_api_version(void);
+
+/* New machine, reset, with zeroed memory. NULL if out of memory. */
+Z80_API z80_machine *z80_create(void);
+Z80_API void z80_destroy(z80_machine *m);
+
+/* Reset the CPU and zero memory, then copy size bytes (at most 65536) to
+ * address 0. Returns 0, or -1 if the image is too big. */
+Z80_API int z80_load(z80_machine *m, const uint8_t *image, size_t size);
+
+/* Same from a file. Files over 64KB are mapped as ROM (see Z80Machine::load).
+ * Returns 0, or -1 if the file cannot be read. */
+Z80_API int z80_load_file(z80_machine *m, const char *path);
+
+/* Translate hot code to native code where the host supports it. Returns 1 if
+ * the JIT is on afterwards. */
+Z80_API int z80_set_jit(z80_machine *m, int on);
+
+/* Run for at least `cycles` T-states, or until the CPU halts (nothing can
+ * interrupt it through this interface). Returns the T-states that passed. */
+Z80_API uint64_t z80_run(z80_machine *m, uint64_t cycles);
+
+Z80_API void z80_read_regs(const z80_machine *m, z80_regs *regs);
+
+/* Copy size bytes of memory from addr (wrapping at 64KB) into out */
+Z80_API void z80_read_memory(const z80_machine *m, uint16_t addr, uint8_t *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* Z80_CAPI_H */
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include "z80_disasm.h"
+#include "z80_opmeta.h"
+
+// Hex in assembler style: a leading 0 when the first digit is a letter
+static void put_hex(std::string &text, unsigned value, int digits)
+{
+    char hex[8];
+    std::snprintf(hex, sizeof(hex), "%0*X", digits, value);
+    if (hex[0] > '9')
+        text += '0';
+    text += hex;
+    text += 'h';
+}
+
+int z80_disasm(const uint8_t *bytes, uint16_t pc, std::string &text)
+{
+    const Z80_OpMeta *meta;
+    const char *index = nullptr; // IX or IY
+    int length = 1;              // Prefixes and opcode
+    int displacement = 0;
+    text.clear();
+
+    switch (bytes[0])
+    {
+    case 0xCB:
+        meta = &z80_cb_meta[bytes[1]];
+        length = 2;
+        break;
+    case 0xED:
+        meta = &z80_ed_meta[bytes[1]];
+        length = 2;
+        break;
+    case 0xDD:
+    case 0xFD:
+        index = bytes[0] == 0xDD ? "IX" : "IY";
+        if (bytes[1] == 0xCB)
+        {
+            meta = &z80_index_cb_meta[bytes[3]];
+            displacement = static_cast<int8_t>(bytes[2]);
+            length = 4;
+        }
+        else
+        {
+            meta = &z80_index_meta[bytes[1]];
+            length = meta->format != nullptr ? 2 : 1; // Cancelled by DD, ED or FD
+        }
+        break;
+    default:
+        meta = &z80_base_meta[bytes[0]];
+        break;
+    }
+
+    const uint8_t *operand = bytes + length;
+    if (meta->operands == Z80_OPND_D || meta->operands == Z80_OPND_D_N)
+        displacement = static_cast<int8_t>(*operand++);
+
+    if (meta->format == nullptr)
+    {
+        text = "DB ";
+        for (int n = 0; n < length; n++)
+        {
+            if (n != 0)
+                text += ',';
+            put_hex(text, bytes[n], 2);
+        }
+        return length;
+    }
+
+    for (const char *p = meta->format; *p != '\0'; p++)
+    {
+        if (p[0] == 'X' && p[1] == 'Y')
+        {
+            text += index;
+            p++;
+        }
+        else if (p[0] == '+' && p[1] == 'd')
+        {
+            text += displacement < 0 ? '-' : '+';
+            put_hex(text, displacement < 0 ? -displacement : displacement, 2);
+            p++;
+        }
+        else if (p[0] == 'n' && p[1] == 'n')
+        {
+            put_hex(text, operand[0] | operand[1] << 8, 4);
+            p++;
+        }
+        else if (p[0] == 'n')
+        {
+            put_hex(text, *operand, 2);
+        }
+        else if (p[0] == 'e')
+        {
+            uint16_t next = pc + length + 1;
+            put_hex(text, static_cast<uint16_t>(next + static_cast<int8_t>(*operand)), 4);
+        }
+        else
+        {
+            text += *p;
+        }
+    }
+    return length + z80_operand_bytes(meta->operands);
+}
+
+int z80_disasm(const Z80Machine &m, uint16_t pc, std::string &text)
+{
+    uint8_t bytes[Z80_INSN_MAX_BYTES];
+    for (int n = 0; n < Z80_INSN_MAX_BYTES; n++)
+        bytes[n] = m.peek(static_cast<uint16_t>(pc + n));
+    return z80_disasm(bytes, pc, text);
+}
@@ -0,0 +1,20 @@
+#ifndef Z80_DISASM_H
+#define Z80_DISASM_H
+
+#include <cstdint>
+#include <string>
+#include "z80.h"
+
+// Disassembler over the metadata tables in z80_opmeta.h. Nothing on the
+// execute path calls it; traces and the profiler ask for text only when they
+// print it. Numbers come out in hex assembler style (3Eh, 0C000h), relative
+// jumps as their target, and a prefix the next byte cancels as a DB.
+
+// Disassemble the instruction at the start of bytes (Z80_INSN_MAX_BYTES of
+// them, whatever its length) found at pc. Returns its length in bytes.
+int z80_disasm(const uint8_t *bytes, uint16_t pc, std::string &text);
+
+// Same, reading the instruction from a machine's memory
+int z80_disasm(const Z80Machine &m, uint16_t pc, std::string &text);
+
+#endif // Z80_DISASM_H
@@ -1,698 +1,372 @@
 #include <iostream>
-#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
-#include <iomanip> // For hex formatting
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "z80.h"
+#include "z80_btrace.h"
+#include "z80_bus.h"
+#include "z80_pool.h"
+#include "z80_profile.h"
+#include "z80_runner.h"
+#include "z80_sched.h"
+#include "z80_state.h"
+#include "z80_trace.h"
 
 #define NUM_CYCLES 1024
+#define CONSOLE_PORT 0x01 // Default --console data port; status is the next one
 
-// Z80 CPU Structure
-struct Z80_CPU
-{
-    uint16_t pc;              // Program Counter
-    uint16_t sp;              // Stack Pointer
-    uint8_t a, f;             // Accumulator and Flags
-    uint8_t b, c;             // BC register pair
-    uint8_t d, e;             // DE register pair
-    uint8_t h, l;             // HL register pair
-    uint8_t interrupt_enable; // Interrupt flag
-    uint16_t ix, iy;          // Index registers
-    uint8_t r;                // Refresh register
-    uint8_t i;                // Interrupt register
-
-    // Shadow registers
-    uint8_t a_prime, f_prime;
-    uint8_t b_prime, c_prime;
-    uint8_t d_prime, e_prime;
-};
-
-static Z80_CPU cpu;
-static uint8_t ram[65536];
-
-// Function to set flags based on a result
-void set_flags(uint8_t result)
-{
-    cpu.f = 0; // Reset flags
-    if (result == 0)
-        cpu.f |= 0x40; // Zero flag
-    if (result & 0x80)
-        cpu.f |= 0x80; // Sign flag
-}
-
-// Function to set flags for BIT operations
-void set_bit_flags(uint8_t value, uint8_t bit)
-{
-    cpu.f &= ~(0x40 | 0x80 | 0x10); // Clear Zero, Sign, and Half carry flags
-    if (!(value & (1 << bit)))
-    {
-        cpu.f |= 0x40; // Set Zero flag if bit is 0
-    }
-    else
-    {
-        cpu.f &= ~0x40; // Clear Zero flag if bit is 1
-    }
-    cpu.f |= 0x10; // Set Half carry flag
-    if (bit == 7 && (value & 0x80))
-    {
-        cpu.f |= 0x80; // Set Sign flag for bit 7
-    }
-}
-
-// Function to display CPU state
-void display_cpu_state()
-{
-    std::cout << "A: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.a) << std::endl;
-    std::cout << "F: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.f) << std::endl;
-    std::cout << "B: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.b) << std::endl;
-    std::cout << "C: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.c) << std::endl;
-    std::cout << "D: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.d) << std::endl;
-    std::cout << "E: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.e) << std::endl;
-    std::cout << "H: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.h) << std::endl;
-    std::cout << "L: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.l) << std::endl;
-    std::cout << "I: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.i) << std::endl;
-    std::cout << "R: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.r) << std::endl;
-    std::cout << "A': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.a_prime) << std::endl;
-    std::cout << "F': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.f_prime) << std::endl;
-    std::cout << "B': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.b_prime) << std::endl;
-    std::cout << "C': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.c_prime) << std::endl;
-    std::cout << "D': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.d_prime) << std::endl;
-    std::cout << "E': " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(cpu.e_prime) << std::endl;
-    std::cout << "IFF1: " << static_cast<int>(cpu.interrupt_enable) << std::endl;
-    std::cout << "IFF2: " << static_cast<int>(cpu.interrupt_enable) << std::endl;
-    std::cout << "IM: 0" << std::endl;
-    std::cout << "Hidden 16-bit math register: 00" << std::endl;
-    std::cout << "IX: " << std::hex << std::setw(4) << std::setfill('0') << cpu.ix << std::endl;
-    std::cout << "IY: " << std::hex << std::setw(4) << std::setfill('0') << cpu.iy << std::endl;
-    std::cout << "PC: " << std::hex << std::setw(4) << std::setfill('0') << cpu.pc << std::endl;
-    std::cout << "SP: " << std::hex << std::setw(4) << std::setfill('0') << cpu.sp << std::endl;
-}
-
-// Initialize the Z80
-void z80_init()
-{
-    std::memset(&cpu, 0, sizeof(Z80_CPU));
-    std::memset(ram, 0, sizeof(ram));
-    cpu.pc = 0x0000; // Start execution at address 0x0001
-    cpu.sp = 0x0000; // Initialize stack pointer to 0x0000
-    cpu.ix = 0xFFFF; // Initialize IX register
-    cpu.iy = 0xFFFF; // Initialize IY register
-    cpu.r = 0x01;    // Initialize Refresh register
-    cpu.f = 0x40;    // Set Zero flag
-    std::cout << "Z80 initialized. PC: " << std::hex << std::setw(4) << std::setfill('0') << cpu.pc << ", SP: " << cpu.sp << std::endl;
-}
+static Z80Machine machine;
 
-// Memory functions
-void z80_mem_write(uint16_t addr, uint8_t value)
+// Run every program on its own machine across the thread pool, then print
+// the final states in command-line order. A program named more than once
+// is loaded once, and its machines share the image copy-on-write.
+static void run_batch(const std::vector<std::string> &programs, unsigned threads, bool jit, int cycles)
 {
-    ram[addr] = value;
-}
-
-uint8_t z80_mem_read(uint16_t addr)
-{
-    return ram[addr];
-}
-
-// Execute Z80 instructions for the given number of cycles
-int z80_execute(int cycles)
-{
-    int executed_cycles = 0;
-
-    while (executed_cycles < cycles)
-    {
-        // Fetch instruction at the current PC
-        uint8_t opcode = ram[cpu.pc];
-        cpu.r = (cpu.r + 1) & 0x7F; // Increment refresh register
-        std::cout << "Executing opcode: " << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(opcode) << " at PC: " << std::setw(4) << cpu.pc << std::endl;
-
-        if (opcode == 0xCB)
+    std::vector<std::string> states(programs.size());
+    std::map<std::string, std::shared_ptr<const Z80_Image>> images;
+    for (size_t i = 0; i < programs.size(); i++)
+        for (size_t j = i + 1; j < programs.size(); j++)
+            if (programs[j] == programs[i] && images.count(programs[i]) == 0)
+                images[programs[i]] = z80_load_image(programs[i]); // nullptr (load() instead) for ROM-sized files
+    Z80Pool pool(threads);
+
+    pool.run(programs.size(), [&](size_t index, Z80Machine &m) {
+        auto shared = images.find(programs[index]);
+        bool loaded;
+        if (shared != images.end() && shared->second)
         {
-            uint8_t cb_opcode = ram[++cpu.pc];
-            switch (cb_opcode)
-            {
-
-            case 0x2F:
-            {
-                uint16_t address = (cpu.h << 8) | cpu.l;
-                uint8_t value = z80_mem_read(address);
-                set_bit_flags(value, 5);
-                executed_cycles += 12;
-                std::cout << "BIT 5, (HL) at address: " << std::hex << address << std::endl;
-                break;
-            }
-
-            case 0x27:
-            {
-                uint8_t carry = cpu.a & 0x01;          // LSB for carry
-                cpu.a = (cpu.a >> 1) | (cpu.a & 0x80); // Preserve MSB
-                cpu.f = carry ? 0x01 : 0x00;           // Set carry flag
-                set_flags(cpu.a);                      // Update Zero and Sign flags
-                executed_cycles += 8;                  // Correct cycle count
-                std::cout << "SRA A (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-                break;
-            }
-
-            case 0x07:
-            {
-                uint8_t carry = (cpu.a & 0x80) >> 7;                        // MSB as carry
-                cpu.a = (cpu.a << 1) | carry;                               // Rotate left
-                cpu.f = (cpu.a == 0 ? 0x40 : 0x00) | (carry ? 0x01 : 0x00); // Set Zero and carry flags
-                std::cout << "RLC A (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-                executed_cycles += 8;
-                break;
-            }
-
-            case 0x0F:
-            {
-                uint8_t carry = cpu.a & 0x01;                               // LSB as carry
-                cpu.a = (cpu.a >> 1) | (carry << 7);                        // Rotate right
-                cpu.f = (cpu.a == 0 ? 0x40 : 0x00) | (carry ? 0x01 : 0x00); // Set Zero and carry flags
-                std::cout << "RRC A (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-                executed_cycles += 8;
-                break;
-            }
-
-            case 0x17:
-            {
-                uint8_t carry = (cpu.f & 0x01);                                 // Carry flag
-                uint8_t new_carry = (cpu.a & 0x80) >> 7;                        // MSB as new carry
-                cpu.a = (cpu.a << 1) | carry;                                   // Rotate left through carry
-                cpu.f = (cpu.a == 0 ? 0x40 : 0x00) | (new_carry ? 0x01 : 0x00); // Set Zero and carry flags
-                std::cout << "RL A (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-                executed_cycles += 8;
-                break;
-            }
-
-            case 0x1F:
-            {
-                uint8_t carry = (cpu.f & 0x01);                                 // Carry flag
-                uint8_t new_carry = cpu.a & 0x01;                               // LSB as new carry
-                cpu.a = (cpu.a >> 1) | (carry << 7);                            // Rotate right through carry
-                cpu.f = (cpu.a == 0 ? 0x40 : 0x00) | (new_carry ? 0x01 : 0x00); // Set Zero and carry flags
-                std::cout << "RR A (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-                executed_cycles += 8;
-                break;
-            }
-
-            case 0x08:
-            {
-                uint8_t carry = (cpu.b & 0x80) >> 7;                        // Extract MSB
-                cpu.b = (cpu.b << 1) | carry;                               // Rotate left circular
-                cpu.f = (cpu.b == 0 ? 0x40 : 0x00) | (carry ? 0x01 : 0x00); // Set flags
-                std::cout << "RLC B (Result: " << std::hex << static_cast<int>(cpu.b) << ")" << std::endl;
-                executed_cycles += 8; // Correct cycle count
-                break;
-            }
-
-            case 0x28:
-            {
-                cpu.b = (cpu.b >> 1) | (cpu.b & 0x80);
-                cpu.f = (cpu.b == 0 ? 0x40 : 0) | (cpu.b & 0x80); // Set Zero and Sign flags
-                executed_cycles += 8;
-                std::cout << "SRA B (Result: " << std::hex << static_cast<int>(cpu.b) << ")" << std::endl;
-                break;
-            }
-
-            case 0x31:
-            {
-                cpu.f = (cpu.c & 0x01) ? 0x01 : 0; // Set carry flag
-                cpu.c >>= 1;
-                if (cpu.c == 0)
-                    cpu.f |= 0x40; // Zero flag
-                executed_cycles += 8;
-                std::cout << "SRL C (Result: " << std::hex << static_cast<int>(cpu.c) << ")" << std::endl;
-                break;
-            }
-
-            case 0x3A:
-            {
-                cpu.d = (cpu.d >> 1) | (cpu.d & 0x80);
-                cpu.f = (cpu.d == 0 ? 0x40 : 0) | (cpu.d & 0x80); // Set Zero and Sign flags
-                executed_cycles += 8;
-                std::cout << "SRA D (Result: " << std::hex << static_cast<int>(cpu.d) << ")" << std::endl;
-                break;
-            }
-
-            case 0x6F: // BIT 5, A
-            {
-                uint8_t mask = 1 << 5;                                     // Mask for bit 5
-                cpu.f = (cpu.a & mask) ? (cpu.f & ~0x40) : (cpu.f | 0x40); // Set Zero flag if bit is 0
-                cpu.f = (cpu.f & ~0x02) | 0x10;                            // Maintain unaffected flags (Half Carry set)
-                std::cout << "BIT 5, A (Value: " << std::hex << static_cast<int>(cpu.a) << ", Result: "
-                          << ((cpu.a & mask) ? "Set" : "Unset") << ")" << std::endl;
-                executed_cycles += 8;
-                break;
-            }
-
-            default:
-                std::cout << "Unknown CB-prefixed opcode: " << std::hex << static_cast<int>(cb_opcode) << std::endl;
-                executed_cycles += 4;
-                break;
-            }
-            cpu.pc++;
-            continue;
+            m.init(shared->second);
+            loaded = true;
         }
-
-        // Decode and execute the opcode
-        switch (opcode)
+        else
         {
-        case 0x00: // NOP
-            std::cout << "NOP (No Operation)" << std::endl;
-            cpu.pc++;
-            executed_cycles += 4;
-            break;
-
-        case 0x02:
-        {
-            uint16_t address = (cpu.b << 8) | cpu.c;
-            z80_mem_write(address, cpu.a);
-            cpu.pc++;
-            executed_cycles += 7;
-            std::cout << "LD (BC), A (Address: " << std::hex << address << ")" << std::endl;
-            break;
-        }
-
-        case 0x06:
-        {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.b = value;
-            cpu.pc += 2;
-            executed_cycles += 7;
-            std::cout << "LD B, " << std::hex << static_cast<int>(value) << std::endl;
-            break;
-        }
-
-        case 0x76:
-            std::cout << "HLT (Halt Execution)" << std::endl;
-            executed_cycles += 4;
-            std::cout << "Ran " << std::dec << executed_cycles << " cycles" << std::endl;
-            return executed_cycles;
-
-        case 0x3E:
-        {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.a = value;
-            std::cout << "LD A, " << std::hex << static_cast<int>(value) << std::endl;
-            cpu.pc += 2;
-            executed_cycles += 7;
-            break;
+            m.init();
+            loaded = m.load(programs[index]);
         }
-
-        case 0x80:
+        m.enable_jit(jit);
+        std::ostringstream out;
+        if (loaded)
         {
-            uint16_t result = cpu.a + cpu.b;
-            cpu.a = static_cast<uint8_t>(result);
-
-            cpu.f = 0; // Reset flags
-            if (cpu.a == 0)
-                cpu.f |= 0x40; // Zero flag
-            if (cpu.a & 0x80)
-                cpu.f |= 0x80; // Sign flag
-            if ((cpu.a ^ cpu.b ^ result) & 0x10)
-                cpu.f |= 0x10; // Half-carry flag
-            if (result > 0xFF)
-                cpu.f |= 0x01; // carry flag
-
-            std::cout << "ADD A, B (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-            cpu.pc++;
-            executed_cycles += 4;
-            break;
+            m.execute(cycles);
+            m.display_state(out);
         }
-
-        case 0xCD:
+        else
         {
-            uint16_t target_address = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8); // Fetch 16-bit target address
-            cpu.pc += 3;                                                        // Advance PC to the instruction after CALL
-            ram[--cpu.sp] = (cpu.pc >> 8) & 0xFF;                               // Push high byte of PC to stack
-            ram[--cpu.sp] = cpu.pc & 0xFF;                                      // Push low byte of PC to stack
-            cpu.pc = target_address;                                            // Jump to target address
-            executed_cycles += 17;                                              // CALL takes 17 cycles
-            std::cout << "CALL to address: " << std::hex << target_address << std::endl;
-            break;
+            out << "Error: could not load " << programs[index] << std::endl;
         }
+        states[index] = out.str();
+    });
 
-        case 0xC9:
-        {
-            uint16_t low_byte = ram[cpu.sp++];
-            uint16_t high_byte = ram[cpu.sp++];
-            cpu.pc = (high_byte << 8) | low_byte; // Pop the return address
-            executed_cycles += 10;
-            std::cout << "RET to address: " << std::hex << cpu.pc << std::endl;
-            break;
-        }
+    for (size_t i = 0; i < programs.size(); i++)
+        std::cout << "== " << programs[i] << " ==" << std::endl
+                  << states[i];
+}
 
-        case 0x2E:
-        {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.l = value;
-            cpu.pc += 2;
-            executed_cycles += 7;
-            std::cout << "LD L, " << std::hex << static_cast<int>(value) << std::endl;
-            break;
-        }
+// Run every .bin under dir against its expected state and write the
+// reports. Returns the process exit code: 0 if nothing failed.
+static int run_conformance(const std::string &dir, unsigned threads, bool jit, int cycles,
+                           const std::string &json_file, const std::string &junit_file)
+{
+    std::vector<Z80_TestCase> tests = z80_find_tests(dir);
+    std::vector<Z80_TestResult> results = z80_run_tests(tests, threads, cycles, jit);
 
-        case 0x01:
+    size_t failed = 0, skipped = 0;
+    for (const Z80_TestResult &r : results)
+    {
+        if (r.skipped)
         {
-            uint16_t value = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8);
-            cpu.b = (value >> 8) & 0xFF;
-            cpu.c = value & 0xFF;
-            cpu.pc += 3;
-            executed_cycles += 10;
-            std::cout << "LD BC, " << std::hex << value << std::endl;
-            break;
+            skipped++;
         }
-
-        case 0xED:
-        { // Extended instructions
-            uint8_t ed_opcode = ram[++cpu.pc];
-            switch (ed_opcode)
-            {
-
-            case 0x4F:
-            {
-                cpu.r = cpu.a;
-                cpu.pc++;
-                executed_cycles += 9;
-                std::cout << "LD R, A" << std::endl;
-                break;
-            }
-
-            case 0x5A:
-            {
-                uint32_t result = (cpu.h << 8 | cpu.l) + (cpu.d << 8 | cpu.e) + (cpu.f & 0x01);
-                cpu.h = (result >> 8) & 0xFF;
-                cpu.l = result & 0xFF;
-
-                // Set flags
-                cpu.f = 0;
-                if (result & 0x10000)
-                    cpu.f |= 0x01; // carry flag
-                if ((cpu.h << 8 | cpu.l) == 0)
-                    cpu.f |= 0x40; // Zero flag
-                if (result & 0x8000)
-                    cpu.f |= 0x80; // Sign flag
-                if (((cpu.h << 8 | cpu.l) ^ (cpu.d << 8 | cpu.e) ^ result) & 0x1000)
-                    cpu.f |= 0x10; // Half-carry flag
-
-                executed_cycles += 15;
-                std::cout << "ADC HL, DE (Result: " << std::hex << (cpu.h << 8 | cpu.l) << ")" << std::endl;
-                cpu.pc++;
-                break;
-            }
-
-            case 0x42:
-            {
-                uint32_t result = (cpu.h << 8 | cpu.l) - (cpu.b << 8 | cpu.c) - (cpu.f & 0x01);
-                cpu.h = (result >> 8) & 0xFF;
-                cpu.l = result & 0xFF;
-
-                // Set flags
-                cpu.f = 0x02; // Set Subtract flag
-                if (result & 0x10000)
-                    cpu.f |= 0x01; // carry flag
-                if ((cpu.h << 8 | cpu.l) == 0)
-                    cpu.f |= 0x40; // Zero flag
-                if (result & 0x8000)
-                    cpu.f |= 0x80; // Sign flag
-                if (((cpu.h << 8 | cpu.l) ^ (cpu.b << 8 | cpu.c) ^ result) & 0x1000)
-                    cpu.f |= 0x10; // Half-carry flag
-
-                executed_cycles += 15;
-                std::cout << "SBC HL, BC (Result: " << std::hex << (cpu.h << 8 | cpu.l) << ")" << std::endl;
-                cpu.pc++;
-                break;
-            }
-
-            default:
-                std::cout << "Unknown ED-prefixed opcode: " << std::hex << static_cast<int>(ed_opcode) << std::endl;
-                executed_cycles += 4;
-                cpu.pc++;
-                break;
-            }
-            break;
-        }
-
-        case 0xC3:
+        else if (!r.passed)
         {
-            uint16_t target_address = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8);
-            std::cout << "JP to address: " << std::hex << target_address << std::endl;
-            cpu.pc = target_address; // Update PC to the target address
-            executed_cycles += 10;
-            break;
+            failed++;
+            std::cout << "FAIL " << r.name << std::endl;
+            for (const std::string &m : r.mismatches)
+                std::cout << "  - " << m << std::endl;
         }
+    }
+    std::cout << results.size() - failed - skipped << " passed, " << failed << " failed, " << skipped
+              << " skipped" << std::endl;
 
-        case 0x18:
-        {
-            int8_t offset = static_cast<int8_t>(ram[cpu.pc + 1]); // Signed 8-bit offset
-            cpu.pc += 2;                                          // Move to next instruction
-            cpu.pc += offset;                                     // Apply the relative jump
-            executed_cycles += 12;
-            std::cout << "JR (Jump Relative) by offset: " << std::dec << static_cast<int>(offset) << std::endl;
-            break;
-        }
+    if (!json_file.empty())
+    {
+        std::ofstream out(json_file);
+        z80_write_json(out, results);
+    }
+    if (!junit_file.empty())
+    {
+        std::ofstream out(junit_file);
+        z80_write_junit(out, results);
+    }
+    return failed == 0 ? 0 : 1;
+}
 
-        case 0x11:
-        {
-            uint16_t value = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8);
-            cpu.d = (value >> 8) & 0xFF;
-            cpu.e = value & 0xFF;
-            cpu.pc += 3;
-            executed_cycles += 10;
-            std::cout << "LD DE, " << std::hex << value << std::endl;
-            break;
-        }
+// --break=addr: a hex address, 0x prefix optional. Returns false unless the
+// whole argument is one no larger than 0xFFFF.
+static bool parse_break(const char *arg, uint16_t &addr)
+{
+    char *end;
+    unsigned long value = std::strtoul(arg, &end, 16);
+    if (end == arg || *end != '\0' || *arg == '-' || value > 0xFFFF)
+        return false;
+    addr = static_cast<uint16_t>(value);
+    return true;
+}
 
-        case 0x21:
-        {
-            uint16_t value = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8);
-            cpu.h = (value >> 8) & 0xFF;
-            cpu.l = value & 0xFF;
-            cpu.pc += 3;
-            executed_cycles += 10;
-            std::cout << "LD HL, " << std::hex << value << std::endl;
-            break;
-        }
+// --watch=addr[,size][,r|w|rw]: set the watch on m. Returns false if the
+// argument is malformed or this build cannot watch reads.
+static bool add_watch(Z80Machine &m, const char *arg)
+{
+    char *end;
+    unsigned long addr = std::strtoul(arg, &end, 0);
+    unsigned long size = 1;
+    int kinds = Z80_WATCH_WRITE;
+    if (end == arg || addr > 0xFFFF)
+        return false;
+    if (*end == ',' && end[1] >= '0' && end[1] <= '9')
+        size = std::strtoul(end + 1, &end, 0);
+    if (*end == ',')
+    {
+        std::string access = end + 1;
+        kinds = access == "r" ? Z80_WATCH_READ : access == "w" ? Z80_WATCH_WRITE : access == "rw" ? Z80_WATCH_READ | Z80_WATCH_WRITE : 0;
+        end += 1 + access.size();
+    }
+    return *end == '\0' && kinds != 0 && m.set_watch(static_cast<uint16_t>(addr), size, kinds, true);
+}
 
-        case 0x16:
+// --bus: run m for at least `cycles` T-states in M-cycle steps, printing
+// every cycle, with INT raised every int_period T-states if that is not 0
+static void run_bus(Z80Machine &m, uint64_t cycles, uint64_t int_period)
+{
+    uint64_t next_int = int_period;
+    char line[64];
+    for (const Z80_BusCycle &cycle : z80_bus_cycles(m))
+    {
+        std::snprintf(line, sizeof(line), "%8llu %-8s %04X %02X %dT\n", static_cast<unsigned long long>(cycle.time),
+                      z80_bus_kind_name(cycle.kind), cycle.addr, cycle.data, cycle.tstates);
+        std::cout << line;
+        uint64_t end = cycle.time + cycle.tstates;
+        if (int_period != 0 && end >= next_int)
         {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.d = value;
-            cpu.pc += 2; // Advance PC past the opcode and immediate value
-            executed_cycles += 7;
-            std::cout << "LD D, " << std::hex << static_cast<int>(value) << std::endl;
-            break;
+            m.set_int(true);
+            next_int += int_period;
         }
-
-        case 0x26:
-        {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.h = value;
-            cpu.pc += 2; // Advance PC past the opcode and immediate value
-            executed_cycles += 7;
-            std::cout << "LD H, " << std::hex << static_cast<int>(value) << std::endl;
+        if (end >= cycles)
             break;
-        }
+    }
+}
 
-        case 0x0E:
-        {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.c = value;
-            cpu.pc += 2; // Advance PC past opcode and immediate value
-            executed_cycles += 7;
-            std::cout << "LD C, " << std::hex << static_cast<int>(value) << std::endl;
+// Host side of --console: stream what the program writes to stdout until
+// told to stop, then take whatever is left
+static void console_loop(Z80Console &console, const std::atomic<bool> &stop)
+{
+    uint8_t buffer[4096];
+    for (;;)
+    {
+        bool last = stop.load(std::memory_order_acquire);
+        size_t n = console.receive(buffer, sizeof(buffer));
+        if (n != 0)
+            std::cout.write(reinterpret_cast<const char *>(buffer), static_cast<std::streamsize>(n));
+        else if (last)
             break;
-        }
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::cout.flush();
+}
 
-        case 0x1E:
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> programs;
+    unsigned threads = 0;
+    bool trace_given = false;
+    bool jit = false;
+    int cycles = NUM_CYCLES;
+    long long int_period = 0; // T-states between maskable interrupts, 0 for none
+    int console_port = -1;    // Console data port, -1 for no console
+    long profile_top = 0;     // Rows per --profile report section, 0 for no profile
+    bool profile_code = false;
+    bool bus = false;         // --bus: M-cycle steps instead of execute()
+    std::string conform_dir, json_file, junit_file, record_file;
+    std::string state_file, save_file; // --state and --save-state
+    std::vector<uint16_t> breaks;       // --break addresses
+    std::vector<const char *> watches; // --watch arguments
+    bool bad_option = false;           // A malformed --break
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--trace=off") == 0)
+            z80_trace_level = Z80_TRACE_OFF, trace_given = true;
+        else if (std::strcmp(argv[i], "--trace=summary") == 0)
+            z80_trace_level = Z80_TRACE_SUMMARY, trace_given = true;
+        else if (std::strcmp(argv[i], "--trace=insn") == 0)
+            z80_trace_level = Z80_TRACE_INSN, trace_given = true;
+        else if (std::strcmp(argv[i], "--jit") == 0)
+            jit = true;
+        else if (std::strncmp(argv[i], "--cycles=", 9) == 0)
+            cycles = std::atoi(argv[i] + 9);
+        else if (std::strncmp(argv[i], "--int-period=", 13) == 0)
+            int_period = std::atoll(argv[i] + 13);
+        else if (std::strcmp(argv[i], "--console") == 0)
+            console_port = CONSOLE_PORT;
+        else if (std::strncmp(argv[i], "--console=", 10) == 0)
+            console_port = static_cast<int>(std::strtol(argv[i] + 10, nullptr, 0)) & 0xFF;
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile_top = Z80_PROFILE_TOP;
+        else if (std::strncmp(argv[i], "--profile=", 10) == 0)
+            profile_top = std::max(1L, std::atol(argv[i] + 10));
+        else if (std::strcmp(argv[i], "--profile-code") == 0)
+            profile_code = true;
+        else if (std::strcmp(argv[i], "--bus") == 0)
+            bus = true;
+        else if (std::strncmp(argv[i], "--record=", 9) == 0)
+            record_file = argv[i] + 9;
+        else if (std::strncmp(argv[i], "--break=", 8) == 0)
         {
-            uint8_t value = ram[cpu.pc + 1];
-            cpu.e = value;
-            cpu.pc += 2; // Advance PC past opcode and immediate value
-            executed_cycles += 7;
-            std::cout << "LD E, " << std::hex << static_cast<int>(value) << std::endl;
-            break;
-        }
-
-        case 0xDD: // Prefix for IX operations
-        case 0xFD:
-        {                                                             // Prefix for IY operations
-            uint16_t &index_reg = (opcode == 0xDD) ? cpu.ix : cpu.iy; // Select IX or IY
-            uint8_t next_opcode = ram[++cpu.pc];                      // Fetch the next opcode
-
-            if (next_opcode == 0xCB)
-            {
-                int8_t offset = static_cast<int8_t>(ram[++cpu.pc]); // Signed offset
-                uint8_t cb_opcode = ram[++cpu.pc];                  // Fetch CB-prefixed opcode
-
-                switch (cb_opcode)
-                {
-                case 0x6E:
-                {
-                    uint16_t address = index_reg + offset; // Calculate address
-                    uint8_t value = z80_mem_read(address); // Read from memory
-                    set_bit_flags(value, 5);               // Test bit 5
-                    executed_cycles += 20;
-                    std::cout << "BIT 5, (" << ((opcode == 0xDD) ? "IX" : "IY") << "+" << std::hex << static_cast<int>(offset) << ") (Address: " << address << ")" << std::endl;
-                    break;
-                }
-                default:
-                    std::cout << "Unknown CB-prefixed opcode after " << ((opcode == 0xDD) ? "DD" : "FD") << ": " << std::hex << static_cast<int>(cb_opcode) << std::endl;
-                    executed_cycles += 4;
-                    break;
-                }
-            }
+            uint16_t addr;
+            if (parse_break(argv[i] + 8, addr))
+                breaks.push_back(addr);
             else
-            {
-
-                switch (next_opcode)
-                {
-                case 0x21:
-                {
-                    uint16_t value = ram[cpu.pc + 1] | (ram[cpu.pc + 2] << 8);
-                    index_reg = value;
-                    cpu.pc += 3;
-                    executed_cycles += 14;
-                    std::cout << "LD " << ((opcode == 0xDD) ? "IX" : "IY") << ", " << std::hex << value << std::endl;
-                    break;
-                }
-
-                case 0x77:
-                {
-                    int8_t offset = static_cast<int8_t>(ram[++cpu.pc]);
-                    uint16_t address = index_reg + offset;
-                    z80_mem_write(address, cpu.a);
-                    cpu.pc++;
-                    executed_cycles += 19;
-                    std::cout << "LD (" << ((opcode == 0xDD) ? "IX" : "IY") << "+" << std::hex << static_cast<int>(offset) << "), A (Address: " << address << ")" << std::endl;
-                    break;
-                }
-
-                case 0x96:
-                {
-                    int8_t offset = static_cast<int8_t>(ram[++cpu.pc]);
-                    uint16_t address = index_reg + offset;
-                    uint8_t value = z80_mem_read(address);
-                    uint16_t result = cpu.a - value;
-                    cpu.f = 0; // Reset flags
-                    if (result == 0)
-                        cpu.f |= 0x40; // Zero flag
-                    if (result & 0x80)
-                        cpu.f |= 0x80; // Sign flag
-                    if ((cpu.a ^ value ^ result) & 0x10)
-                        cpu.f |= 0x10; // Half-carry flag
-                    if (result > 0xFF)
-                        cpu.f |= 0x01; // Carry flag
-                    cpu.a = static_cast<uint8_t>(result);
-
-                    cpu.pc++;
-                    executed_cycles += 19;
-                    std::cout << "SUB (" << ((opcode == 0xDD) ? "IX" : "IY") << "+" << std::hex << static_cast<int>(offset) << ") (Address: " << address << ")" << std::endl;
-                    break;
-                }
-
-                default:
-                    std::cout << "Unknown opcode after prefix: " << std::hex << static_cast<int>(next_opcode) << std::endl;
-                    cpu.pc++;
-                    executed_cycles += 4;
-                    break;
-                }
-            }
-            break;
-        }
-
-        case 0x90:
-        {
-            uint16_t result = cpu.a - cpu.b; // Perform subtraction
-            cpu.f = 0;                       // Reset flags
-            if (result == 0)
-                cpu.f |= 0x40; // Zero flag
-            if (result & 0x80)
-                cpu.f |= 0x80; // Sign flag
-            if ((cpu.a ^ cpu.b ^ result) & 0x10)
-                cpu.f |= 0x10; // Half-carry flag
-            if (cpu.a < cpu.b)
-                cpu.f |= 0x01;                    // Carry flag
-            cpu.a = static_cast<uint8_t>(result); // Store the result
-            cpu.pc++;
-            executed_cycles += 4;
-            std::cout << "SUB A, B (Result: " << std::hex << static_cast<int>(cpu.a) << ")" << std::endl;
-            break;
+                bad_option = true;
         }
+        else if (std::strncmp(argv[i], "--watch=", 8) == 0)
+            watches.push_back(argv[i] + 8);
+        else if (std::strncmp(argv[i], "--state=", 8) == 0)
+            state_file = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--save-state=", 13) == 0)
+            save_file = argv[i] + 13;
+        else if (std::strncmp(argv[i], "--conform=", 10) == 0)
+            conform_dir = argv[i] + 10;
+        else if (std::strncmp(argv[i], "--json=", 7) == 0)
+            json_file = argv[i] + 7;
+        else if (std::strncmp(argv[i], "--junit=", 8) == 0)
+            junit_file = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--threads=", 10) == 0)
+            threads = static_cast<unsigned>(std::atoi(argv[i] + 10));
+        else
+            programs.push_back(argv[i]);
+    }
 
-        case 0x37:
-        {
-            cpu.f &= ~(0x10); // Clear H flag
-            cpu.f |= 0x01;    // Set Carry flag
-            cpu.f &= ~(0x02); // Clear N flag
+    if (!conform_dir.empty())
+        return run_conformance(conform_dir, threads, jit, cycles, json_file, junit_file);
 
-            std::cout << "SCF (Set Carry Flag)" << std::endl;
-            cpu.pc++;
-            executed_cycles += 4;
-            break;
-        }
+    if (bad_option || programs.empty() == state_file.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--trace=off|summary|insn] [--threads=N] [--jit] [--cycles=N] [--int-period=N] [--console[=port]] [--profile[=N]] [--profile-code] [--bus] [--record=file] [--break=addr] [--watch=addr[,size][,r|w|rw]] [--save-state=file] program.bin [more.bin ...]" << std::endl
+                  << "       " << argv[0] << " [same options] --state=file" << std::endl
+                  << "       " << argv[0] << " --conform=dir [--threads=N] [--jit] [--cycles=N] [--json=file] [--junit=file]" << std::endl;
+        return -1;
+    }
 
-        default:
-            std::cout << "Unknown opcode: " << std::hex << static_cast<int>(opcode) << std::endl;
-            cpu.pc++;
-            executed_cycles += 4; // Default cycle count for unimplemented instructions
-            break;
-        }
+    if (programs.size() > 1)
+    {
+        // Traces from concurrent machines would interleave, so only trace when asked
+        if (!trace_given)
+            z80_trace_level = Z80_TRACE_OFF;
+        run_batch(programs, threads, jit, cycles);
+        return 0;
+    }
 
-        // Break if PC goes out of bounds
-        if (cpu.pc >= 65536)
+    machine.init();
+    machine.enable_jit(jit);
+    Z80SavedState state; // Memory of a machine started from --state; outlives the run
+    if (!state_file.empty())
+    {
+        if (!state.open(state_file))
         {
-            std::cout << "PC out of bounds. Halting execution." << std::endl;
-            break;
+            std::cerr << "Error: " << state_file << " is not a readable state file" << std::endl;
+            return -1;
         }
+        state.restore(machine);
     }
-
-    std::cout << "Ran " << executed_cycles << " cycles" << std::endl;
-    return executed_cycles;
-}
-
-void z80_mem_load(const std::string &filename)
-{
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file)
+    else
+    {
+        machine.load(programs[0]);
+    }
+    for (uint16_t addr : breaks)
+        machine.set_breakpoint(addr, true);
+    for (const char *arg : watches)
+        if (!add_watch(machine, arg))
+            std::cerr << "Error: bad watch " << arg << (Z80_WATCH_READS ? "" : " (read watches need -DZ80_WATCH_READS=ON)")
+                      << std::endl;
+    if (profile_top != 0 && !machine.enable_profile(true))
+    {
+        std::cerr << "Error: this build has no profiler (configure with -DZ80_PROFILE=ON)" << std::endl;
+        profile_top = 0;
+    }
+    if (bus && !Z80_BUS_CYCLES)
+    {
+        std::cerr << "Error: this build keeps no bus log (configure with -DZ80_BUS_CYCLES=ON)" << std::endl;
+        bus = false;
+    }
+    Z80TraceWriter recorder;
+    if (!record_file.empty())
     {
-        std::cerr << "Error: Cannot open file " << filename << std::endl;
-        return;
+        if (!recorder.open(record_file, machine))
+            std::cerr << "Error: cannot create " << record_file << std::endl;
+        else if (!machine.set_recorder(&recorder))
+            std::cerr << "Error: this build has instruction tracing compiled out (Z80_TRACE_LEVEL < 2)" << std::endl;
     }
 
-    std::streamsize size = file.tellg();
-    if (size > 65536)
+    Z80Console console;
+    std::atomic<bool> console_stop(false);
+    std::thread console_thread;
+    if (console_port >= 0)
     {
-        std::cerr << "Error: File too large to fit in memory." << std::endl;
-        file.close();
-        return;
+        console.attach(machine.ports, static_cast<uint8_t>(console_port));
+        console_thread = std::thread(console_loop, std::ref(console), std::cref(console_stop));
     }
 
-    file.seekg(0, std::ios::beg);
-    file.read(reinterpret_cast<char *>(ram), size);
-    if (!file)
+    if (bus)
     {
-        std::cerr << "Error: Failed to read file " << filename << std::endl;
+        run_bus(machine, static_cast<uint64_t>(cycles), static_cast<uint64_t>(std::max(0LL, int_period)));
+    }
+    else if (int_period > 0)
+    {
+        // Periodic timer on the INT line, like a video frame interrupt
+        Z80Scheduler sched(machine);
+        sched.every(static_cast<uint64_t>(int_period), [](Z80Scheduler &s) { s.machine().set_int(true); });
+        sched.run(static_cast<uint64_t>(cycles));
     }
     else
     {
-        std::cout << "Loaded binary file: " << filename << " (Size: " << size << " bytes)" << std::endl;
+        machine.execute(cycles);
     }
-
-    file.close();
-}
-
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
+    if (console_thread.joinable())
     {
-        std::cerr << "Usage: " << argv[0] << " program.bin" << std::endl;
-        return -1;
+        console_stop.store(true, std::memory_order_release);
+        console_thread.join();
+        if (console.dropped() != 0)
+            std::cerr << "Warning: console output full, " << console.dropped() << " bytes dropped" << std::endl;
     }
-
-    z80_init();
-    z80_mem_load(argv[1]);
-
-    int cycles = z80_execute(NUM_CYCLES);
-    display_cpu_state();
+    machine.set_recorder(nullptr);
+    if (!recorder.close())
+        std::cerr << "Error: failed writing " << record_file << std::endl;
+    z80_trace_flush();
+    if (!save_file.empty() && !z80_save_state(save_file, machine))
+        std::cerr << "Error: cannot write " << save_file << std::endl;
+    const Z80_Stop &stop = machine.stop_info();
+    char line[64];
+    if (stop.reason == Z80_STOP_BREAK)
+        std::snprintf(line, sizeof(line), "Stopped at breakpoint %04X\n", stop.addr);
+    else if (stop.reason != Z80_STOP_NONE)
+        std::snprintf(line, sizeof(line), "Stopped: %s %02X at %04X\n", stop.reason == Z80_STOP_READ ? "read" : "wrote",
+                      stop.value, stop.addr);
+    if (stop.reason != Z80_STOP_NONE)
+        std::cout << line;
+    machine.display_state(std::cout);
+    if (profile_top != 0)
+        z80_profile_report(std::cout, *machine.profile_data(), static_cast<size_t>(profile_top),
+                           profile_code ? &machine : nullptr);
 
     return 0;
 }
@@ -0,0 +1,167 @@
+#ifndef Z80_FLAGS_H
+#define Z80_FLAGS_H
+
+#include <cstdint>
+#include "z80.h"
+
+// Flag register bits
+#define FLAG_C 0x01  // Carry
+#define FLAG_N 0x02  // Add/Subtract
+#define FLAG_PV 0x04 // Parity/Overflow
+#define FLAG_X 0x08  // Undocumented, copy of result bit 3
+#define FLAG_H 0x10  // Half carry
+#define FLAG_Y 0x20  // Undocumented, copy of result bit 5
+#define FLAG_Z 0x40  // Zero
+#define FLAG_S 0x80  // Sign
+
+// Kinds of lazily evaluated flag results (Z80_CPU::flag_op). F is only
+// rebuilt from the recorded operands when something reads it.
+enum Z80_FlagOp : uint8_t
+{
+    FLAGS_NONE = 0, // cpu.f is up to date
+    FLAGS_ADD8,     // ADD/ADC: flag_x + flag_y (+ carry) = flag_res
+    FLAGS_SUB8,     // SUB/SBC: flag_x - flag_y (- carry) = flag_res
+    FLAGS_ADD16,    // ADC HL: flag_x + flag_y + carry = flag_res
+    FLAGS_SUB16,    // SBC HL: flag_x - flag_y - carry = flag_res
+    FLAGS_SZP,      // Shifts and rotates: SZP of flag_res, carry out in flag_x
+    FLAGS_INC8,     // INC r: result in flag_res, previous carry in flag_x
+    FLAGS_DEC8,     // DEC r: result in flag_res, previous carry in flag_x
+};
+
+// 256-entry flag tables, indexed by an 8-bit result
+struct Z80_FlagTable
+{
+    uint8_t f[256];
+};
+
+static constexpr Z80_FlagTable make_sz_table()
+{
+    Z80_FlagTable table{};
+    for (int i = 0; i < 256; i++)
+        table.f[i] = (i & (FLAG_S | FLAG_Y | FLAG_X)) | (i == 0 ? FLAG_Z : 0);
+    return table;
+}
+
+static constexpr Z80_FlagTable make_szp_table()
+{
+    Z80_FlagTable table = make_sz_table();
+    for (int i = 0; i < 256; i++)
+    {
+        int bits = 0;
+        for (int b = 0; b < 8; b++)
+            bits += (i >> b) & 1;
+        if ((bits & 1) == 0)
+            table.f[i] |= FLAG_PV; // Even parity
+    }
+    return table;
+}
+
+static constexpr Z80_FlagTable make_szhv_inc_table()
+{
+    Z80_FlagTable table = make_sz_table();
+    for (int i = 0; i < 256; i++)
+    {
+        if ((i & 0x0F) == 0x00)
+            table.f[i] |= FLAG_H; // Carry out of bit 3
+        if (i == 0x80)
+            table.f[i] |= FLAG_PV; // 7F + 1 overflows
+    }
+    return table;
+}
+
+static constexpr Z80_FlagTable make_szhv_dec_table()
+{
+    Z80_FlagTable table = make_sz_table();
+    for (int i = 0; i < 256; i++)
+    {
+        table.f[i] |= FLAG_N;
+        if ((i & 0x0F) == 0x0F)
+            table.f[i] |= FLAG_H; // Borrow from bit 4
+        if (i == 0x7F)
+            table.f[i] |= FLAG_PV; // 80 - 1 overflows
+    }
+    return table;
+}
+
+static constexpr Z80_FlagTable sz_table = make_sz_table();
+static constexpr Z80_FlagTable szp_table = make_szp_table();
+static constexpr Z80_FlagTable szhv_inc_table = make_szhv_inc_table();
+static constexpr Z80_FlagTable szhv_dec_table = make_szhv_dec_table();
+
+// Record the operands of a flag-setting op instead of computing F
+static inline void flags_defer(Z80_CPU &cpu, uint8_t op, uint16_t x, uint16_t y, uint32_t res)
+{
+    cpu.flag_op = op;
+    cpu.flag_x = x;
+    cpu.flag_y = y;
+    cpu.flag_res = res;
+}
+
+// Build F from the last recorded op and make it current
+static inline uint8_t flags_get(Z80_CPU &cpu)
+{
+    uint32_t x = cpu.flag_x, y = cpu.flag_y, res = cpu.flag_res;
+    switch (cpu.flag_op)
+    {
+    case FLAGS_NONE:
+        return cpu.f;
+    case FLAGS_ADD8:
+        cpu.f = sz_table.f[res & 0xFF] | ((x ^ y ^ res) & FLAG_H) |
+                ((~(x ^ y) & (x ^ res) & 0x80) >> 5) | ((res >> 8) & FLAG_C);
+        break;
+    case FLAGS_SUB8:
+        cpu.f = sz_table.f[res & 0xFF] | ((x ^ y ^ res) & FLAG_H) |
+                (((x ^ y) & (x ^ res) & 0x80) >> 5) | ((res >> 8) & FLAG_C) | FLAG_N;
+        break;
+    case FLAGS_ADD16:
+        cpu.f = (sz_table.f[(res >> 8) & 0xFF] & ~FLAG_Z) | ((res & 0xFFFF) == 0 ? FLAG_Z : 0) |
+                (((x ^ y ^ res) >> 8) & FLAG_H) | ((~(x ^ y) & (x ^ res) & 0x8000) >> 13) |
+                ((res >> 16) & FLAG_C);
+        break;
+    case FLAGS_SUB16:
+        cpu.f = (sz_table.f[(res >> 8) & 0xFF] & ~FLAG_Z) | ((res & 0xFFFF) == 0 ? FLAG_Z : 0) |
+                (((x ^ y ^ res) >> 8) & FLAG_H) | (((x ^ y) & (x ^ res) & 0x8000) >> 13) |
+                ((res >> 16) & FLAG_C) | FLAG_N;
+        break;
+    case FLAGS_SZP:
+        cpu.f = szp_table.f[res & 0xFF] | x;
+        break;
+    case FLAGS_INC8:
+        cpu.f = szhv_inc_table.f[res & 0xFF] | x;
+        break;
+    case FLAGS_DEC8:
+        cpu.f = szhv_dec_table.f[res & 0xFF] | x;
+        break;
+    }
+    cpu.flag_op = FLAGS_NONE;
+    return cpu.f;
+}
+
+// Overwrite F directly, dropping any pending lazy result
+static inline void flags_set(Z80_CPU &cpu, uint8_t f)
+{
+    cpu.f = f;
+    cpu.flag_op = FLAGS_NONE;
+}
+
+// Carry alone, without building the rest of F
+static inline uint8_t flags_carry(const Z80_CPU &cpu)
+{
+    switch (cpu.flag_op)
+    {
+    case FLAGS_ADD8:
+    case FLAGS_SUB8:
+        return (cpu.flag_res >> 8) & FLAG_C;
+    case FLAGS_ADD16:
+    case FLAGS_SUB16:
+        return (cpu.flag_res >> 16) & FLAG_C;
+    case FLAGS_SZP:
+    case FLAGS_INC8:
+    case FLAGS_DEC8:
+        return cpu.flag_x;
+    default:
+        return cpu.f & FLAG_C;
+    }
+}
+
+#endif // Z80_FLAGS_H
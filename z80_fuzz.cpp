@@ -0,0 +1,810 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "z80.h"
+#include "z80_flags.h"
+#include "z80_jit.h"
+#include "z80_pool.h"
+#include "z80_ref.h"
+#include "z80_trace.h"
+
+#define FUZZ_CASES 10000000   // Default number of cases
+#define FUZZ_STATES 128       // Random states per generated program, enough for the JIT to translate it
+#define FUZZ_JOB_PROGRAMS 64  // Programs per pool job
+#define FUZZ_MAX_INSNS 4      // Default longest sequence
+#define FUZZ_REPORTS 20       // Default number of distinct divergences to shrink and print
+#define FUZZ_BASE 0x8000      // Programs are placed here
+
+// Compared state, in report order. "cycles" is the T-states execute() ran.
+enum Fuzz_Field
+{
+    FIELD_A, FIELD_F, FIELD_B, FIELD_C, FIELD_D, FIELD_E, FIELD_H, FIELD_L,
+    FIELD_IX, FIELD_IY, FIELD_SP, FIELD_PC, FIELD_I, FIELD_R,
+    FIELD_IFF1, FIELD_IFF2, FIELD_IM, FIELD_HALT,
+    FIELD_A2, FIELD_F2, FIELD_B2, FIELD_C2, FIELD_D2, FIELD_E2, FIELD_H2, FIELD_L2,
+    FIELD_CYCLES, FIELD_MEM,
+    FIELD_COUNT
+};
+
+static const char *const field_names[FIELD_COUNT] = {
+    "A", "F", "B", "C", "D", "E", "H", "L", "IX", "IY", "SP", "PC", "I", "R",
+    "IFF1", "IFF2", "IM", "HALT", "A'", "F'", "B'", "C'", "D'", "E'", "H'", "L'", "cycles", "mem"};
+
+// One generated instruction: bytes with the operands still to be filled in
+struct Fuzz_Op
+{
+    uint8_t bytes[Z80_INSN_MAX_BYTES];
+    uint8_t length;
+    uint8_t random_from;  // Bytes from here on are random operands...
+    uint8_t random_count; // ...this many of them
+    bool displacement;    // The first random byte is an (IX+d) displacement
+};
+
+// A case: program at FUZZ_BASE, starting registers, extra memory bytes
+struct Fuzz_Case
+{
+    std::vector<uint8_t> program;
+    std::vector<uint8_t> lengths;      // Bytes of each instruction in the program, in order
+    std::vector<int8_t> displacements; // Every (IX+d) in the program, for seeding
+    Z80_CPU start;
+    std::vector<std::pair<uint16_t, uint8_t>> seeds;
+    int steps; // Instructions the reference runs
+};
+
+struct Fuzz_Result
+{
+    bool skipped;  // Ran into an instruction outside the reference or the decoder
+    bool diverged;
+    uint32_t key;  // Prefix and opcode of the reference's last instruction
+    std::string diffs;
+    std::vector<uint16_t> pcs; // Where each instruction the reference ran started
+};
+
+struct Fuzz_Options
+{
+    long long cases = FUZZ_CASES;
+    int max_insns = FUZZ_MAX_INSNS;
+    int max_reports = FUZZ_REPORTS;
+    unsigned threads = 0;
+    unsigned long long seed = 1;
+    bool jit = false;
+    bool vs_interp = false; // Check the JIT against the interpreter instead of the reference
+    uint8_t flag_mask = 0xFF;
+    uint32_t ignore = 0; // 1 << Fuzz_Field for fields left out of the comparison
+};
+
+// Shared between the workers
+struct Fuzz_Totals
+{
+    std::atomic<long long> cases{0};
+    std::atomic<long long> skipped{0};
+    std::atomic<long long> diverged{0};
+    std::mutex mutex;
+    std::set<uint32_t> keys; // Divergences already reported
+    std::vector<std::string> reports;
+};
+
+static const uint16_t prefixes[] = {0x00, 0xCB, 0xED, 0xDD, 0xFD, 0xDDCB, 0xFDCB};
+static std::vector<Fuzz_Op> fuzz_ops;
+static bool implemented[7][256]; // By position in prefixes[] and opcode: the decoder has a handler
+static Fuzz_Options options;
+static Fuzz_Totals totals;
+
+static uint64_t splitmix(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static std::string hex(unsigned value, int digits)
+{
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%0*X", digits, value);
+    return buffer;
+}
+
+static std::string key_name(uint32_t key)
+{
+    if (key > 0xFFFF)
+        return hex(key >> 16, 2) + " " + hex((key >> 8) & 0xFF, 2) + " d " + hex(key & 0xFF, 2);
+    if (key > 0xFF)
+        return hex(key >> 8, 2) + " " + hex(key & 0xFF, 2);
+    return hex(key, 2);
+}
+
+// Whether the instruction at addr is one the decoder implements. Jumps can
+// land in seeded memory, and an opcode the emulator does not have says
+// nothing about the ones it does.
+static bool decodable(const uint8_t *mem, uint16_t addr)
+{
+    uint8_t b0 = mem[addr], b1 = mem[static_cast<uint16_t>(addr + 1)];
+    switch (b0)
+    {
+    case 0xCB: return implemented[1][b1];
+    case 0xED: return implemented[2][b1];
+    case 0xDD:
+    case 0xFD:
+        if (b1 == 0xCB)
+            return implemented[b0 == 0xDD ? 5 : 6][mem[static_cast<uint16_t>(addr + 3)]];
+        return implemented[b0 == 0xDD ? 3 : 4][b1];
+    default: return implemented[0][b0];
+    }
+}
+
+// Every opcode the decoder implements, as a template for the generator
+static void build_ops()
+{
+    for (int p = 0; p < 7; p++)
+    {
+        uint16_t prefix = prefixes[p];
+        for (int opcode = 0; opcode < 256; opcode++)
+        {
+            int operand_bytes;
+            if (!z80_opcode_info(prefix, static_cast<uint8_t>(opcode), operand_bytes))
+                continue;
+            implemented[p][opcode] = true;
+            Fuzz_Op op{};
+            if (prefix > 0xFF) // DD CB d op
+            {
+                op.bytes[0] = prefix >> 8, op.bytes[1] = 0xCB, op.bytes[3] = static_cast<uint8_t>(opcode);
+                op.length = 4, op.random_from = 2, op.random_count = 1, op.displacement = true;
+            }
+            else
+            {
+                int at = 0;
+                if (prefix != 0)
+                    op.bytes[at++] = static_cast<uint8_t>(prefix);
+                op.bytes[at++] = static_cast<uint8_t>(opcode);
+                op.length = static_cast<uint8_t>(at + operand_bytes);
+                op.random_from = static_cast<uint8_t>(at), op.random_count = static_cast<uint8_t>(operand_bytes);
+                op.displacement = (prefix == 0xDD || prefix == 0xFD) && operand_bytes == 1;
+            }
+            fuzz_ops.push_back(op);
+        }
+    }
+}
+
+// Register value biased towards the edges where flags change
+static uint8_t random_byte(uint64_t &rng)
+{
+    static const uint8_t edges[] = {0x00, 0x01, 0x0F, 0x10, 0x7F, 0x80, 0xFF};
+    uint64_t r = splitmix(rng);
+    return (r & 3) == 0 ? edges[(r >> 8) % sizeof(edges)] : static_cast<uint8_t>(r >> 16);
+}
+
+static uint16_t random_word(uint64_t &rng)
+{
+    return random_byte(rng) << 8 | random_byte(rng);
+}
+
+class Fuzz_Worker
+{
+public:
+    Fuzz_Worker(Z80Machine &machine) : m(machine), ref(new Z80Reference())
+    {
+        std::memset(ref->mem, 0, sizeof(ref->mem));
+        m.init();
+        m.enable_jit(options.jit);
+        if (options.vs_interp)
+        {
+            interp.reset(new Z80Machine());
+            interp->init();
+        }
+    }
+
+    // Generate programs and run each from FUZZ_STATES random states
+    void run_job(uint64_t rng, long long cases)
+    {
+        while (cases > 0)
+        {
+            Fuzz_Case c;
+            generate_program(rng, c);
+            load_program(c.program);
+            uint64_t states_rng = rng;
+            int states = static_cast<int>(std::min<long long>(cases, FUZZ_STATES));
+            for (int s = 0; s < states; s++)
+            {
+                randomize_state(rng, c);
+                Fuzz_Result r;
+                run(c, false, r);
+                if (r.skipped)
+                    totals.skipped++;
+                else if (r.diverged)
+                    report(c, r.key);
+            }
+            totals.cases += states;
+            cases -= states;
+            if (std::memcmp(m.ram, expected_mem(), 65536) != 0)
+                find_stray(c, states_rng, states); // The emulator wrote somewhere the reference did not
+            unload_program(c.program);
+        }
+    }
+
+private:
+    Z80Machine &m;
+    std::unique_ptr<Z80Reference> ref; // 64KB of memory, so not on the stack
+    std::unique_ptr<Z80Machine> interp; // --vs-interp: what the JIT is compared with; ref only counts T-states
+    std::vector<uint8_t> loaded;       // Program currently at FUZZ_BASE
+    std::set<uint32_t> seen;           // Keys this worker has already tried to report
+
+    void generate_program(uint64_t &rng, Fuzz_Case &c)
+    {
+        int count = 1 + static_cast<int>(splitmix(rng) % options.max_insns);
+        for (int n = 0; n < count; n++)
+        {
+            const Fuzz_Op &op = fuzz_ops[splitmix(rng) % fuzz_ops.size()];
+            size_t at = c.program.size();
+            c.program.insert(c.program.end(), op.bytes, op.bytes + op.length);
+            c.lengths.push_back(op.length);
+            for (int k = 0; k < op.random_count; k++)
+                c.program[at + op.random_from + k] = static_cast<uint8_t>(splitmix(rng));
+            if (op.displacement)
+                c.displacements.push_back(static_cast<int8_t>(c.program[at + op.random_from]));
+        }
+        if (options.vs_interp)
+        {
+            // Without the HALT the block runs on into the zeros after the
+            // program and never fits the budget, so it is never run native
+            c.program.push_back(0x76);
+            c.lengths.push_back(1);
+            count++;
+        }
+        c.steps = count;
+    }
+
+    void randomize_state(uint64_t &rng, Fuzz_Case &c)
+    {
+        Z80_CPU &cpu = c.start;
+        std::memset(&cpu, 0, sizeof(cpu));
+        cpu.a = random_byte(rng), cpu.f = random_byte(rng);
+        cpu.b = random_byte(rng), cpu.c = random_byte(rng);
+        cpu.d = random_byte(rng), cpu.e = random_byte(rng);
+        cpu.h = random_byte(rng), cpu.l = random_byte(rng);
+        cpu.a_prime = random_byte(rng), cpu.f_prime = random_byte(rng);
+        cpu.b_prime = random_byte(rng), cpu.c_prime = random_byte(rng);
+        cpu.d_prime = random_byte(rng), cpu.e_prime = random_byte(rng);
+        cpu.h_prime = random_byte(rng), cpu.l_prime = random_byte(rng);
+        cpu.ix = random_word(rng), cpu.iy = random_word(rng), cpu.sp = random_word(rng);
+        cpu.i = random_byte(rng), cpu.r = random_byte(rng);
+        uint64_t r = splitmix(rng);
+        cpu.interrupt_enable = r & 1, cpu.iff2 = (r >> 1) & 1, cpu.im = (r >> 2) % 3;
+        cpu.pc = FUZZ_BASE;
+        cpu.flag_op = FLAGS_NONE;
+
+        // Random bytes wherever the program may read through a pointer
+        c.seeds.clear();
+        uint16_t targets[] = {static_cast<uint16_t>(cpu.b << 8 | cpu.c), static_cast<uint16_t>(cpu.d << 8 | cpu.e),
+                              static_cast<uint16_t>(cpu.h << 8 | cpu.l), cpu.sp, static_cast<uint16_t>(cpu.sp + 1)};
+        for (uint16_t addr : targets)
+            add_seed(c, addr, static_cast<uint8_t>(splitmix(rng)));
+        for (int8_t d : c.displacements)
+        {
+            add_seed(c, static_cast<uint16_t>(cpu.ix + d), static_cast<uint8_t>(splitmix(rng)));
+            add_seed(c, static_cast<uint16_t>(cpu.iy + d), static_cast<uint8_t>(splitmix(rng)));
+        }
+    }
+
+    static void add_seed(Fuzz_Case &c, uint16_t addr, uint8_t value)
+    {
+        if (static_cast<size_t>(addr - FUZZ_BASE) < c.program.size())
+            return; // Leave the program itself alone
+        c.seeds.emplace_back(addr, value);
+    }
+
+    uint8_t baseline(uint16_t addr) const
+    {
+        return static_cast<size_t>(addr - FUZZ_BASE) < loaded.size() ? loaded[addr - FUZZ_BASE] : 0;
+    }
+
+    // Memory the emulator's is compared with
+    const uint8_t *expected_mem() const
+    {
+        return interp ? interp->ram : ref->mem;
+    }
+
+    // Write a byte to every model
+    void poke(uint16_t addr, uint8_t value)
+    {
+        m.mem_write(addr, value);
+        if (interp)
+            interp->mem_write(addr, value);
+        ref->mem[addr] = value;
+    }
+
+    void load_program(const std::vector<uint8_t> &program)
+    {
+        loaded = program;
+        for (size_t i = 0; i < program.size(); i++)
+            poke(static_cast<uint16_t>(FUZZ_BASE + i), program[i]);
+    }
+
+    void unload_program(const std::vector<uint8_t> &program)
+    {
+        loaded.clear();
+        for (size_t i = 0; i < program.size(); i++)
+            poke(static_cast<uint16_t>(FUZZ_BASE + i), 0);
+    }
+
+    // Put every memory back to zeros plus the loaded program
+    void reset_memory()
+    {
+        std::memset(ref->mem, 0, sizeof(ref->mem));
+        std::memset(m.ram, 0, 65536);
+        m.flush_blocks();
+        if (interp)
+        {
+            std::memset(interp->ram, 0, 65536);
+            interp->flush_blocks();
+        }
+        std::vector<uint8_t> program = loaded;
+        load_program(program);
+    }
+
+    // Run one case on both models and compare. With `full`, all 64KB are
+    // compared and memory is reset afterwards; otherwise only the bytes the
+    // reference wrote are checked and put back.
+    void run(const Fuzz_Case &c, bool full, Fuzz_Result &r)
+    {
+        r.skipped = r.diverged = false;
+        r.key = 0;
+        r.diffs.clear();
+        r.pcs.clear();
+
+        for (const auto &seed : c.seeds)
+            poke(seed.first, seed.second);
+
+        ref->cpu = c.start;
+        ref->writes.clear();
+        ref->f_known = 0xFF;
+        int cycles = 0;
+        for (int n = 0; n < c.steps && !ref->cpu.halted; n++)
+        {
+            r.pcs.push_back(ref->cpu.pc);
+            int t = decodable(ref->mem, ref->cpu.pc) ? ref->step() : 0;
+            if (t == 0)
+            {
+                r.skipped = true;
+                break;
+            }
+            cycles += t;
+            r.key = ref->last_key;
+        }
+
+        if (!r.skipped)
+        {
+            if (interp)
+            {
+                interp->cpu = c.start;
+                cycles = interp->execute(cycles);
+            }
+            m.cpu = c.start;
+            int ran = m.execute(cycles);
+            compare(ran, cycles, full, r);
+        }
+
+        if (full)
+        {
+            reset_memory();
+            return;
+        }
+        for (const auto &seed : c.seeds)
+            restore(seed.first);
+        for (uint16_t addr : ref->writes)
+            restore(addr);
+    }
+
+    void restore(uint16_t addr)
+    {
+        uint8_t value = baseline(addr);
+        if (m.mem_read(addr) != value || (interp && interp->mem_read(addr) != value))
+            poke(addr, value);
+        ref->mem[addr] = value;
+    }
+
+    static void fields(Z80_CPU &cpu, uint8_t f, int cycles, uint32_t out[FIELD_COUNT])
+    {
+        uint32_t values[FIELD_COUNT] = {
+            cpu.a, f, cpu.b, cpu.c, cpu.d, cpu.e, cpu.h, cpu.l,
+            cpu.ix, cpu.iy, cpu.sp, cpu.pc, cpu.i, cpu.r,
+            cpu.interrupt_enable, cpu.iff2, cpu.im, cpu.halted,
+            cpu.a_prime, cpu.f_prime, cpu.b_prime, cpu.c_prime, cpu.d_prime, cpu.e_prime, cpu.h_prime, cpu.l_prime,
+            static_cast<uint32_t>(cycles), 0};
+        std::memcpy(out, values, sizeof(values));
+    }
+
+    void compare(int ran, int cycles, bool full, Fuzz_Result &r)
+    {
+        uint8_t mask = options.flag_mask & (interp ? 0xFF : ref->f_known);
+        uint32_t want[FIELD_COUNT], have[FIELD_COUNT];
+        if (interp)
+            fields(interp->cpu, flags_get(interp->cpu) & mask, cycles, want);
+        else
+            fields(ref->cpu, ref->cpu.f & mask, cycles, want);
+        fields(m.cpu, flags_get(m.cpu) & mask, ran, have);
+        const char *expected = interp ? ": interpreter " : ": reference ";
+
+        for (int n = 0; n < FIELD_MEM; n++)
+        {
+            if (want[n] == have[n] || (options.ignore & (1u << n)))
+                continue;
+            r.diverged = true;
+            int digits = n >= FIELD_IX && n <= FIELD_PC ? 4 : 2;
+            r.diffs += std::string("    ") + field_names[n] + expected +
+                       (n == FIELD_CYCLES ? std::to_string(want[n]) : hex(want[n], digits)) + ", emulator " +
+                       (n == FIELD_CYCLES ? std::to_string(have[n]) : hex(have[n], digits)) + "\n";
+        }
+        if (options.ignore & (1u << FIELD_MEM))
+            return;
+
+        // Memory: every byte, or just the ones the reference wrote
+        int shown = 0;
+        if (full)
+        {
+            for (int addr = 0; addr < 65536; addr++)
+                compare_byte(static_cast<uint16_t>(addr), shown, r);
+        }
+        else
+        {
+            for (uint16_t addr : ref->writes)
+                compare_byte(addr, shown, r);
+        }
+    }
+
+    void compare_byte(uint16_t addr, int &shown, Fuzz_Result &r)
+    {
+        const uint8_t *mem = expected_mem();
+        if (m.ram[addr] == mem[addr])
+            return;
+        r.diverged = true;
+        if (shown++ < 8)
+            r.diffs += "    (" + hex(addr, 4) + (interp ? "): interpreter " : "): reference ") + hex(mem[addr], 2) +
+                       ", emulator " + hex(m.ram[addr], 2) + "\n";
+    }
+
+    bool diverges(const Fuzz_Case &c, Fuzz_Result &r)
+    {
+        for (int n = 0; interp && n < Z80_JIT_THRESHOLD; n++)
+            run(c, false, r); // Translated by now, as in run_job()
+        run(c, true, r);
+        return r.diverged;
+    }
+
+    // Put another program at FUZZ_BASE in place of the loaded one
+    void swap_program(const std::vector<uint8_t> &program)
+    {
+        std::vector<uint8_t> old = loaded;
+        unload_program(old);
+        load_program(program);
+    }
+
+    // Same divergence, in the same instruction, with c's program loaded
+    bool still_diverges(Fuzz_Case &c, uint32_t key, Fuzz_Result &r)
+    {
+        swap_program(c.program);
+        return diverges(c, r) && r.key == key;
+    }
+
+    // Byte offset of instruction n in c's program
+    static size_t insn_offset(const Fuzz_Case &c, size_t n)
+    {
+        size_t offset = 0;
+        for (size_t i = 0; i < n; i++)
+            offset += c.lengths[i];
+        return offset;
+    }
+
+    // Delta debugging over the instructions: drop runs of `chunk`
+    // instructions, halving the chunk until single instructions stay put.
+    // A dropped run usually held some of the steps, so fewer steps are tried
+    // first, then the same number.
+    void drop_instructions(Fuzz_Case &c, uint32_t key, Fuzz_Result &r)
+    {
+        for (size_t chunk = c.lengths.size() / 2; chunk >= 1; chunk /= 2)
+        {
+            for (size_t start = 0; start + chunk <= c.lengths.size() && c.lengths.size() > chunk;)
+            {
+                Fuzz_Case t = c;
+                size_t from = insn_offset(c, start), to = insn_offset(c, start + chunk);
+                t.program.erase(t.program.begin() + from, t.program.begin() + to);
+                t.lengths.erase(t.lengths.begin() + start, t.lengths.begin() + start + chunk);
+                bool kept = false;
+                for (int steps : {c.steps - static_cast<int>(chunk), c.steps})
+                {
+                    t.steps = steps;
+                    if (steps >= 1 && still_diverges(t, key, r))
+                    {
+                        kept = true;
+                        break;
+                    }
+                }
+                if (kept)
+                    c = t; // Try the same place again: the next run moved up
+                else
+                    start += chunk;
+            }
+        }
+        swap_program(c.program);
+    }
+
+    // Program bytes as printed in a report: only the instructions the
+    // reference ran, each at its offset, when the rest can be zeros without
+    // losing the divergence; otherwise the whole program
+    std::string program_text(Fuzz_Case &c, uint32_t key, Fuzz_Result &r)
+    {
+        diverges(c, r);
+        std::vector<bool> ran(c.lengths.size(), false);
+        for (uint16_t pc : r.pcs)
+        {
+            size_t offset = 0;
+            for (size_t n = 0; n < c.lengths.size(); offset += c.lengths[n], n++)
+                if (static_cast<size_t>(pc - FUZZ_BASE) == offset)
+                    ran[n] = true;
+        }
+        size_t last = 0; // Instructions up to the last one that ran
+        for (size_t n = 0; n < ran.size(); n++)
+            if (ran[n])
+                last = n + 1;
+
+        Fuzz_Case t = c;
+        t.program.resize(insn_offset(c, last));
+        t.lengths.resize(last);
+        size_t offset = 0;
+        for (size_t n = 0; n < last; offset += t.lengths[n], n++)
+            if (!ran[n])
+                std::fill(t.program.begin() + offset, t.program.begin() + offset + t.lengths[n], 0);
+        if (still_diverges(t, key, r))
+            c = t;
+        else
+            std::fill(ran.begin(), ran.end(), true), last = ran.size();
+        swap_program(c.program);
+
+        std::string text;
+        offset = 0;
+        bool gap = false;
+        for (size_t n = 0; n < last; offset += c.lengths[n], n++)
+        {
+            if (!ran[n])
+            {
+                gap = true;
+                continue;
+            }
+            if (gap || n == 0)
+                text += (n == 0 ? " " : " | ") + hex(static_cast<uint32_t>(FUZZ_BASE + offset), 4) + ":";
+            gap = false;
+            for (size_t i = 0; i < c.lengths[n]; i++)
+                text += " " + hex(c.program[offset + i], 2);
+        }
+        return text;
+    }
+
+    // Shrink a diverging case and record it, unless the same instruction
+    // already has a report. Shrinking resets all of memory on every try, so
+    // cases whose last instruction was seen before are only counted.
+    void report(Fuzz_Case c, uint32_t key)
+    {
+        totals.diverged++;
+        if (!seen.insert(key).second)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(totals.mutex);
+            if (totals.reports.size() >= static_cast<size_t>(options.max_reports) || totals.keys.count(key) != 0)
+                return;
+        }
+        Fuzz_Result r;
+
+        // Shortest prefix of the sequence that still diverges
+        int steps = c.steps;
+        for (c.steps = 1; c.steps < steps; c.steps++)
+            if (diverges(c, r))
+                break;
+        if (!diverges(c, r))
+            return; // Only diverged together with state left over from earlier cases
+
+        {
+            std::lock_guard<std::mutex> lock(totals.mutex);
+            if (totals.reports.size() >= static_cast<size_t>(options.max_reports) || !totals.keys.insert(r.key).second)
+                return;
+        }
+
+        // Then drop the earlier instructions it does not need. The worker
+        // goes on with the original program afterwards.
+        std::vector<uint8_t> original = loaded;
+        key = r.key;
+        drop_instructions(c, key, r);
+
+        // Zero every register and drop every seed the divergence does not need
+        uint8_t *bytes[] = {&c.start.a, &c.start.f, &c.start.b, &c.start.c, &c.start.d, &c.start.e, &c.start.h,
+                            &c.start.l, &c.start.i, &c.start.r, &c.start.a_prime, &c.start.f_prime,
+                            &c.start.b_prime, &c.start.c_prime, &c.start.d_prime, &c.start.e_prime,
+                            &c.start.h_prime, &c.start.l_prime,
+                            &c.start.interrupt_enable, &c.start.iff2, &c.start.im};
+        for (uint8_t *field : bytes)
+        {
+            uint8_t saved = *field;
+            *field = 0;
+            if (!diverges(c, r))
+                *field = saved;
+        }
+        uint16_t *words[] = {&c.start.ix, &c.start.iy, &c.start.sp};
+        for (uint16_t *field : words)
+        {
+            uint16_t saved = *field;
+            *field = 0;
+            if (!diverges(c, r))
+                *field = saved;
+        }
+        for (size_t n = c.seeds.size(); n-- > 0;)
+        {
+            auto saved = c.seeds[n];
+            c.seeds.erase(c.seeds.begin() + n);
+            if (!diverges(c, r))
+                c.seeds.insert(c.seeds.begin() + n, saved);
+        }
+        std::string program = program_text(c, key, r);
+        diverges(c, r);
+        swap_program(original);
+
+        std::string text = key_name(r.key) + " after " + std::to_string(c.steps) + " instruction(s)\n    program:";
+        text += program;
+        const Z80_CPU &s = c.start;
+        text += "\n    start: A=" + hex(s.a, 2) + " F=" + hex(s.f, 2) + " BC=" + hex(s.bc, 4) + " DE=" + hex(s.de, 4) +
+                " HL=" + hex(s.hl, 4) + " IX=" + hex(s.ix, 4) + " IY=" + hex(s.iy, 4) + " SP=" + hex(s.sp, 4) +
+                " PC=" + hex(s.pc, 4) + " I=" + hex(s.i, 2) + " R=" + hex(s.r, 2) +
+                " IFF=" + hex(s.interrupt_enable, 1) + hex(s.iff2, 1) + " IM=" + hex(s.im, 1) +
+                "\n           AF'=" + hex(s.af_prime, 4) + " BC'=" + hex(s.bc_prime, 4) + " DE'=" + hex(s.de_prime, 4) +
+                " HL'=" + hex(s.hl_prime, 4) + "\n";
+        if (!c.seeds.empty())
+        {
+            text += "    memory:";
+            for (const auto &seed : c.seeds)
+                text += " (" + hex(seed.first, 4) + ")=" + hex(seed.second, 2);
+            text += "\n";
+        }
+        text += r.diffs;
+
+        std::lock_guard<std::mutex> lock(totals.mutex);
+        totals.reports.push_back(text);
+    }
+
+    // The program's states left a difference outside what the reference
+    // wrote: replay them one at a time with full comparison to find it
+    void find_stray(Fuzz_Case &c, uint64_t rng, int states)
+    {
+        reset_memory();
+        for (int s = 0; s < states; s++)
+        {
+            randomize_state(rng, c);
+            Fuzz_Result r;
+            if (diverges(c, r))
+            {
+                report(c, r.key);
+                return;
+            }
+        }
+    }
+};
+
+static bool same_name(const std::string &x, const char *y)
+{
+    size_t n = 0;
+    for (; n < x.size() && y[n] != '\0'; n++)
+        if (std::tolower(static_cast<unsigned char>(x[n])) != std::tolower(static_cast<unsigned char>(y[n])))
+            return false;
+    return n == x.size() && y[n] == '\0';
+}
+
+// --ignore=r,f,cycles: leave those fields out of the comparison
+static bool parse_ignore(const char *list)
+{
+    std::string names(list);
+    size_t start = 0;
+    while (start <= names.size())
+    {
+        size_t end = names.find(',', start);
+        if (end == std::string::npos)
+            end = names.size();
+        std::string name = names.substr(start, end - start);
+        int n = 0;
+        while (n < FIELD_COUNT && !same_name(name, field_names[n]))
+            n++;
+        if (n == FIELD_COUNT)
+            return false;
+        options.ignore |= 1u << n;
+        start = end + 1;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    z80_trace_level = Z80_TRACE_OFF;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strncmp(argv[i], "--cases=", 8) == 0)
+            options.cases = std::max(1LL, std::atoll(argv[i] + 8));
+        else if (std::strncmp(argv[i], "--len=", 6) == 0)
+            options.max_insns = std::max(1, std::atoi(argv[i] + 6));
+        else if (std::strncmp(argv[i], "--reports=", 10) == 0)
+            options.max_reports = std::max(0, std::atoi(argv[i] + 10));
+        else if (std::strncmp(argv[i], "--threads=", 10) == 0)
+            options.threads = static_cast<unsigned>(std::atoi(argv[i] + 10));
+        else if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            options.seed = std::strtoull(argv[i] + 7, nullptr, 0);
+        else if (std::strncmp(argv[i], "--flag-mask=", 12) == 0)
+            options.flag_mask = static_cast<uint8_t>(std::strtoul(argv[i] + 12, nullptr, 16));
+        else if (std::strncmp(argv[i], "--ignore=", 9) == 0 && parse_ignore(argv[i] + 9))
+            continue;
+        else if (std::strcmp(argv[i], "--jit") == 0)
+            options.jit = true;
+        else if (std::strcmp(argv[i], "--vs-interp") == 0)
+            options.jit = options.vs_interp = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--cases=N] [--len=N] [--threads=N] [--seed=N] [--jit] [--vs-interp] [--reports=N]"
+                         " [--flag-mask=hex] [--ignore=field,...]"
+                      << std::endl;
+            return -1;
+        }
+    }
+
+    build_ops();
+
+    // Opcodes the reference cannot check are left out of the generator
+    std::unique_ptr<Z80Reference> probe(new Z80Reference());
+    std::vector<Fuzz_Op> checked;
+    std::string unchecked;
+    for (const Fuzz_Op &op : fuzz_ops)
+    {
+        std::memset(probe->mem, 0, sizeof(probe->mem));
+        std::memcpy(probe->mem, op.bytes, op.length);
+        std::memset(&probe->cpu, 0, sizeof(probe->cpu));
+        if (probe->step() != 0)
+            checked.push_back(op);
+        else
+            unchecked += " " + key_name(probe->last_key);
+    }
+    fuzz_ops.swap(checked);
+    if (!unchecked.empty())
+        std::cout << "Not in the reference model, skipped:" << unchecked << std::endl;
+    if (fuzz_ops.empty())
+        return 0;
+
+    long long per_job = static_cast<long long>(FUZZ_JOB_PROGRAMS) * FUZZ_STATES;
+    size_t jobs = static_cast<size_t>((options.cases + per_job - 1) / per_job);
+    Z80Pool pool(options.threads);
+    std::cout << "Fuzzing " << fuzz_ops.size() << " opcodes, " << options.cases << " cases on " << pool.size()
+              << " threads" << (options.vs_interp ? ", JIT against the interpreter" : options.jit ? " with the JIT" : "")
+              << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(jobs, [&](size_t job, Z80Machine &m) {
+        uint64_t rng = options.seed * 0x100000001B3ULL + job;
+        long long cases = std::min(per_job, options.cases - static_cast<long long>(job) * per_job);
+        Fuzz_Worker worker(m);
+        worker.run_job(rng, cases);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t n = 0; n < totals.reports.size(); n++)
+        std::cout << "[" << n + 1 << "] " << totals.reports[n];
+    long long cases = totals.cases;
+    std::cout << cases << " cases in " << seconds << " s (" << cases / seconds / 1e6 << "M/s), "
+              << totals.skipped << " skipped, " << totals.diverged << " diverged, " << totals.keys.size()
+              << " distinct" << std::endl;
+    return totals.diverged == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include "z80_io.h"
+
+static uint8_t open_bus_read(void *, uint16_t)
+{
+    return 0xFF;
+}
+
+static void open_bus_write(void *, uint16_t, uint8_t)
+{
+}
+
+Z80PortBus::Z80PortBus()
+{
+    reset();
+}
+
+void Z80PortBus::reset()
+{
+    handlers.assign(1, {open_bus_read, open_bus_write, nullptr, true});
+    index.assign(256, 0);
+    mask = 0x00FF;
+}
+
+bool Z80PortBus::reads_stable(uint8_t low) const
+{
+    for (size_t port = low; port < index.size(); port += 256)
+        if (!handlers[index[port]].stable && handlers[index[port]].read != open_bus_read)
+            return false;
+    return true;
+}
+
+// Handler number for a device, reusing an existing entry for the same one
+int Z80PortBus::add(Z80_PortHandler handler)
+{
+    if (handler.read == nullptr)
+        handler.read = open_bus_read;
+    if (handler.write == nullptr)
+        handler.write = open_bus_write;
+    for (size_t n = 0; n < handlers.size(); n++)
+    {
+        const Z80_PortHandler &h = handlers[n];
+        if (h.read == handler.read && h.write == handler.write && h.ctx == handler.ctx && h.stable == handler.stable)
+            return static_cast<int>(n);
+    }
+    if (handlers.size() == Z80_PORT_HANDLERS)
+        return -1;
+    handlers.push_back(handler);
+    return static_cast<int>(handlers.size() - 1);
+}
+
+bool Z80PortBus::map(uint8_t first, uint8_t last, Z80_PortHandler handler)
+{
+    int n = add(handler);
+    if (n < 0)
+        return false;
+    // With full decoding on, a low-byte device answers on all 256 high bytes
+    for (size_t port = first; port <= last; port++)
+        for (size_t high = 0; high < index.size(); high += 256)
+            index[high | port] = static_cast<uint8_t>(n);
+    return true;
+}
+
+bool Z80PortBus::map_full(uint16_t first, uint16_t last, Z80_PortHandler handler)
+{
+    int n = add(handler);
+    if (n < 0)
+        return false;
+    if (mask != 0xFFFF)
+    {
+        // Switch to full decoding: every port keeps its low-byte handler
+        std::vector<uint8_t> low(index);
+        index.resize(65536);
+        for (size_t port = 0; port < 65536; port++)
+            index[port] = low[port & 0xFF];
+        mask = 0xFFFF;
+    }
+    for (size_t port = first; port <= last; port++)
+        index[port] = static_cast<uint8_t>(n);
+    return true;
+}
+
+bool Z80Console::attach(Z80PortBus &bus, uint8_t port)
+{
+    data_port = port;
+    return bus.map(port, port, {read_port, write_port, this, false}) &&
+           bus.map(static_cast<uint8_t>(port + 1), static_cast<uint8_t>(port + 1), {read_port, write_port, this, false});
+}
+
+uint8_t Z80Console::read_port(void *ctx, uint16_t port)
+{
+    Z80Console *console = static_cast<Z80Console *>(ctx);
+    if ((port & 0xFF) == console->data_port)
+    {
+        uint8_t value;
+        return console->input.pop(value) ? value : 0xFF;
+    }
+    uint8_t status = 0;
+    if (!console->input.empty())
+        status |= 0x01;
+    if (console->output.size() < console->output.capacity())
+        status |= 0x02;
+    return status;
+}
+
+void Z80Console::write_port(void *ctx, uint16_t port, uint8_t value)
+{
+    Z80Console *console = static_cast<Z80Console *>(ctx);
+    if ((port & 0xFF) != console->data_port)
+        return; // Status port is read-only
+    if (!console->output.push(value))
+        console->dropped_bytes.fetch_add(1, std::memory_order_relaxed); // Ring full: never stall the CPU on the host
+}
@@ -0,0 +1,123 @@
+#ifndef Z80_IO_H
+#define Z80_IO_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "z80_ring.h"
+
+#define Z80_PORT_HANDLERS 256   // Distinct handlers a bus can hold, open bus included
+#define Z80_CONSOLE_RING 65536  // Bytes buffered each way by Z80Console
+
+// Port device callbacks. ctx is the pointer the device was mapped with;
+// port is the full 16-bit address the CPU put on the bus.
+typedef uint8_t (*Z80_PortRead)(void *ctx, uint16_t port);
+typedef void (*Z80_PortWrite)(void *ctx, uint16_t port, uint8_t value);
+
+struct Z80_PortHandler
+{
+    Z80_PortRead read;
+    Z80_PortWrite write;
+    void *ctx;
+    bool stable; // Reads give the same value until the device raises an interrupt or execute() returns
+};
+
+// I/O port bus. Every port number maps through a dense table to one
+// handler, so IN and OUT cost a table load and an indirect call whatever
+// the number of devices. Most Z80 systems only decode A0-A7, so the bus
+// starts with a 256-entry table on the low byte; the first map_full()
+// switches it to a 65536-entry table on the whole address. Unmapped ports
+// read FFh and ignore writes.
+class Z80PortBus
+{
+public:
+    Z80PortBus();
+
+    Z80PortBus(const Z80PortBus &) = delete;
+    Z80PortBus &operator=(const Z80PortBus &) = delete;
+
+    uint8_t read(uint16_t port) const
+    {
+        const Z80_PortHandler &h = handlers[index[port & mask]];
+        return h.read(h.ctx, port);
+    }
+
+    void write(uint16_t port, uint8_t value) const
+    {
+        const Z80_PortHandler &h = handlers[index[port & mask]];
+        h.write(h.ctx, port, value);
+    }
+
+    // Send ports whose low byte is in [first, last] to the handler. Either
+    // callback may be null for a read-only or write-only device. Returns
+    // false if the bus already holds Z80_PORT_HANDLERS handlers.
+    bool map(uint8_t first, uint8_t last, Z80_PortHandler handler);
+
+    // Same, decoding all 16 address bits
+    bool map_full(uint16_t first, uint16_t last, Z80_PortHandler handler);
+
+    // Put every port back on the open bus
+    void reset();
+
+    // True if every port with this low byte reads the open bus or a stable
+    // handler, so the value cannot change from one IN to the next while no
+    // interrupt comes
+    bool reads_stable(uint8_t low) const;
+
+private:
+    int add(Z80_PortHandler handler);
+
+    std::vector<Z80_PortHandler> handlers; // Entry 0 is the open bus
+    std::vector<uint8_t> index;            // Handler number per (masked) port
+    uint16_t mask;                         // 00FFh, or FFFFh once map_full() was used
+};
+
+// Serial console backed by two SPSC rings, for a host thread that streams
+// output and feeds input without blocking the emulation thread. OUT to the
+// data port queues a byte for the host; IN from it takes the next byte the
+// host sent (FFh if none). The status port (data port + 1) reads bit 0 set
+// when input is waiting and bit 1 set when there is room for output.
+// Neither side ever waits: an OUT to a full ring drops the byte and counts
+// it in dropped(), so programs that must not lose output poll the status
+// port first.
+class Z80Console
+{
+public:
+    Z80Console() = default;
+    Z80Console(const Z80Console &) = delete;
+    Z80Console &operator=(const Z80Console &) = delete;
+
+    // Map the data and status ports on a bus
+    bool attach(Z80PortBus &bus, uint8_t data_port);
+
+    // Host thread: take up to n bytes the program wrote
+    size_t receive(uint8_t *buffer, size_t n)
+    {
+        return output.pop(buffer, n);
+    }
+
+    // Host thread: queue up to n bytes for the program to read. Returns how
+    // many fit.
+    size_t send(const uint8_t *data, size_t n)
+    {
+        return input.push(data, n);
+    }
+
+    // Bytes the program wrote while the output ring was full
+    uint64_t dropped() const
+    {
+        return dropped_bytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    static uint8_t read_port(void *ctx, uint16_t port);
+    static void write_port(void *ctx, uint16_t port, uint8_t value);
+
+    uint8_t data_port = 0;
+    Z80Ring<uint8_t, Z80_CONSOLE_RING> output; // Program to host
+    Z80Ring<uint8_t, Z80_CONSOLE_RING> input;  // Host to program
+    std::atomic<uint64_t> dropped_bytes{0};
+};
+
+#endif // Z80_IO_H
@@ -0,0 +1,1202 @@
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "z80_jit.h"
+#include "z80_flags.h"
+#include "z80_opmeta.h"
+
+#if Z80_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+uint32_t Z80Jit::mem_write(Z80Machine *m, uint32_t addr, uint32_t value)
+{
+    m->mem_write(static_cast<uint16_t>(addr), static_cast<uint8_t>(value));
+    return m->code_written;
+}
+
+#if Z80_JIT_SUPPORTED
+
+// Lazy flag helpers for the cases native code does not evaluate inline
+static uint32_t jit_flags_get(Z80_CPU *cpu)
+{
+    return flags_get(*cpu);
+}
+
+static uint32_t jit_flags_carry(Z80_CPU *cpu)
+{
+    return flags_carry(*cpu);
+}
+
+// ---------------------------------------------------------------------------
+// x86-64 encoder. Only the handful of forms the translator needs; every
+// ALU op works on 32-bit registers.
+// ---------------------------------------------------------------------------
+
+enum Z80_HostReg
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// Register-register opcodes (op r/m32, r32)
+#define X86_ADD 0x01
+#define X86_OR 0x09
+#define X86_AND 0x21
+#define X86_SUB 0x29
+#define X86_XOR 0x31
+#define X86_TEST 0x85
+#define X86_MOV 0x89
+
+// /digit of the 0x81 immediate group and of the 0xC1 shift group
+#define X86_IMM_ADD 0
+#define X86_IMM_OR 1
+#define X86_IMM_AND 4
+#define X86_IMM_SUB 5
+#define X86_IMM_XOR 6
+#define X86_SHL 4
+#define X86_SHR 5
+
+// Condition codes for jcc/setcc
+#define X86_CC_E 0x4
+#define X86_CC_NE 0x5
+
+struct Z80_Asm
+{
+    std::vector<uint8_t> code;
+
+    void byte(uint8_t b)
+    {
+        code.push_back(b);
+    }
+
+    void dword(uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void qword(uint64_t v)
+    {
+        for (int i = 0; i < 8; i++)
+            byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    // REX prefix, only emitted when needed (or forced, for byte registers)
+    void rex(bool wide, int reg, int index, int base, bool force = false)
+    {
+        uint8_t r = 0x40 | (wide ? 8 : 0) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+        if (r != 0x40 || force)
+            byte(r);
+    }
+
+    void modrm_reg(int reg, int rm)
+    {
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    // [base + disp32]
+    void modrm_mem(int reg, int base, int32_t disp)
+    {
+        byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == RSP)
+            byte(0x24);
+        dword(static_cast<uint32_t>(disp));
+    }
+
+    // [base + index], base must not be RBP/R13
+    void modrm_index(int reg, int base, int index)
+    {
+        byte(0x04 | ((reg & 7) << 3));
+        byte(((index & 7) << 3) | (base & 7));
+    }
+
+    void alu(uint8_t op, int dst, int src)
+    {
+        rex(false, src, 0, dst);
+        byte(op);
+        modrm_reg(src, dst);
+    }
+
+    void alu_imm(int ext, int dst, uint32_t imm)
+    {
+        rex(false, 0, 0, dst);
+        byte(0x81);
+        modrm_reg(ext, dst);
+        dword(imm);
+    }
+
+    void alu_imm64(int ext, int dst, uint32_t imm)
+    {
+        rex(true, 0, 0, dst);
+        byte(0x81);
+        modrm_reg(ext, dst);
+        dword(imm);
+    }
+
+    void shift(int ext, int dst, uint8_t n)
+    {
+        rex(false, 0, 0, dst);
+        byte(0xC1);
+        modrm_reg(ext, dst);
+        byte(n);
+    }
+
+    void mov_imm(int dst, uint32_t imm)
+    {
+        rex(false, 0, 0, dst);
+        byte(0xB8 + (dst & 7));
+        dword(imm);
+    }
+
+    void mov64(int dst, int src)
+    {
+        rex(true, src, 0, dst);
+        byte(X86_MOV);
+        modrm_reg(src, dst);
+    }
+
+    // Zero-extending loads
+    void load8(int dst, int base, int32_t disp)
+    {
+        rex(false, dst, 0, base);
+        byte(0x0F);
+        byte(0xB6);
+        modrm_mem(dst, base, disp);
+    }
+
+    void load16(int dst, int base, int32_t disp)
+    {
+        rex(false, dst, 0, base);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_mem(dst, base, disp);
+    }
+
+    void load32(int dst, int base, int32_t disp)
+    {
+        rex(false, dst, 0, base);
+        byte(0x8B);
+        modrm_mem(dst, base, disp);
+    }
+
+    // dst = [base + index * 8], 64-bit
+    void load64_scaled(int dst, int base, int index)
+    {
+        rex(true, dst, index, base);
+        byte(0x8B);
+        byte(0x04 | ((dst & 7) << 3));
+        byte(0xC0 | ((index & 7) << 3) | (base & 7));
+    }
+
+    void load8_index(int dst, int base, int index)
+    {
+        rex(false, dst, index, base);
+        byte(0x0F);
+        byte(0xB6);
+        modrm_index(dst, base, index);
+    }
+
+    void store8(int base, int32_t disp, int src)
+    {
+        rex(false, src, 0, base, true);
+        byte(0x88);
+        modrm_mem(src, base, disp);
+    }
+
+    void store16(int base, int32_t disp, int src)
+    {
+        byte(0x66);
+        rex(false, src, 0, base);
+        byte(X86_MOV);
+        modrm_mem(src, base, disp);
+    }
+
+    void store32(int base, int32_t disp, int src)
+    {
+        rex(false, src, 0, base);
+        byte(X86_MOV);
+        modrm_mem(src, base, disp);
+    }
+
+    void store8_imm(int base, int32_t disp, uint8_t imm)
+    {
+        rex(false, 0, 0, base);
+        byte(0xC6);
+        modrm_mem(0, base, disp);
+        byte(imm);
+    }
+
+    void store16_imm(int base, int32_t disp, uint16_t imm)
+    {
+        byte(0x66);
+        rex(false, 0, 0, base);
+        byte(0xC7);
+        modrm_mem(0, base, disp);
+        byte(static_cast<uint8_t>(imm));
+        byte(static_cast<uint8_t>(imm >> 8));
+    }
+
+    // dst = 0 or 1
+    void setcc(int cc, int dst)
+    {
+        rex(false, 0, 0, dst, true);
+        byte(0x0F);
+        byte(0x90 + cc);
+        modrm_reg(0, dst);
+        alu_imm(X86_IMM_AND, dst, 1);
+    }
+
+    // Forward jumps return the offset of their rel32, for bind()
+    size_t jcc(int cc)
+    {
+        byte(0x0F);
+        byte(0x80 + cc);
+        dword(0);
+        return code.size() - 4;
+    }
+
+    void bind(size_t patch)
+    {
+        uint32_t rel = static_cast<uint32_t>(code.size() - (patch + 4));
+        std::memcpy(&code[patch], &rel, 4);
+    }
+
+    void call(uint64_t target)
+    {
+        byte(0x48); // mov rax, imm64
+        byte(0xB8);
+        qword(target);
+        byte(0xFF); // call rax
+        byte(0xD0);
+    }
+
+    void push(int reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(int reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Instruction coverage. Only opcodes with a real handler in z80.cpp are
+// listed; anything else (including the opcodes z80.cpp runs as 4-cycle
+// NOPs) keeps its block on the interpreter.
+// ---------------------------------------------------------------------------
+
+enum Z80_JitOp : uint8_t
+{
+    JIT_NOP,
+    JIT_LD_R_N,
+    JIT_LD_RR_NN,
+    JIT_LD_IND_BC_A,
+    JIT_INC_R,
+    JIT_DEC_R,
+    JIT_ADD_A_B,
+    JIT_SUB_B,
+    JIT_SCF,
+    JIT_POP_AF,
+    JIT_PUSH_AF,
+    JIT_SHIFT,
+    JIT_BIT_A,
+    JIT_BIT_IND_HL,
+    JIT_SBC_HL_BC,
+    JIT_ADC_HL_DE,
+    JIT_LD_R_A,
+    JIT_LD_IDX_NN,
+    JIT_LD_IND_IDX_A,
+    JIT_SUB_IND_IDX,
+    JIT_BIT_IND_IDX,
+    JIT_JR,
+    JIT_JR_CC,
+    JIT_JP,
+    JIT_JP_CC,
+    JIT_CALL,
+    JIT_RET,
+    JIT_HALT,
+};
+
+// Z80 registers pinned in host registers, in opcode order (B C D E H L - A)
+enum Z80_JitReg
+{
+    JIT_B, JIT_C, JIT_D, JIT_E, JIT_H, JIT_L, JIT_A, JIT_REGS
+};
+
+static const int jit_host[JIT_REGS] = {R9, R10, R11, RCX, RDX, RSI, R8};
+static const int32_t jit_offset[JIT_REGS] = {
+    offsetof(Z80_CPU, b), offsetof(Z80_CPU, c), offsetof(Z80_CPU, d), offsetof(Z80_CPU, e),
+    offsetof(Z80_CPU, h), offsetof(Z80_CPU, l), offsetof(Z80_CPU, a),
+};
+
+// Shift kinds for JIT_SHIFT
+enum Z80_JitShift
+{
+    JIT_RLC, JIT_RRC, JIT_RL, JIT_RR, JIT_SRA, JIT_SRL
+};
+
+// How an instruction uses F
+#define JIT_READS_NONE 0
+#define JIT_READS_OWN 1  // Only to build its own flags (INC's carry, SCF, BIT)
+#define JIT_READS_DATA 2 // As an input (RL's carry, branch conditions, PUSH AF)
+
+struct Z80_JitInfo
+{
+    uint8_t op;
+    uint8_t reg;      // Z80_JitReg
+    uint8_t cc;       // Branch condition, or Z80_JitShift for JIT_SHIFT
+    uint8_t reads;    // JIT_READS_*
+    bool sets_flags;
+    bool writes;      // Memory write: the block may have to stop after it
+    bool flags_live;  // Its flag result can be seen later
+};
+
+// Z80 register operand (opcode bits) to Z80_JitReg; (HL) is never passed in
+static uint8_t jit_reg(int r)
+{
+    return r == 7 ? static_cast<uint8_t>(JIT_A) : static_cast<uint8_t>(r);
+}
+
+static bool jit_classify(const Z80_Insn &insn, Z80_JitInfo &info)
+{
+    std::memset(&info, 0, sizeof(info));
+    uint8_t opcode = insn.opcode;
+    switch (insn.prefix << 8 | opcode)
+    {
+    case 0x00:
+        info.op = JIT_NOP;
+        return true;
+    case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E:
+        info.op = JIT_LD_R_N;
+        info.reg = jit_reg(opcode >> 3);
+        return true;
+    case 0x01: case 0x11: case 0x21:
+        info.op = JIT_LD_RR_NN;
+        info.reg = (opcode >> 4) * 2; // High register of the pair
+        return true;
+    case 0x02:
+        info.op = JIT_LD_IND_BC_A;
+        info.writes = true;
+        return true;
+    case 0x04: case 0x0C: case 0x14: case 0x1C: case 0x24: case 0x2C: case 0x3C:
+    case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x3D:
+        info.op = (opcode & 1) ? JIT_DEC_R : JIT_INC_R;
+        info.reg = jit_reg(opcode >> 3);
+        info.reads = JIT_READS_OWN;
+        info.sets_flags = true;
+        return true;
+    case 0x80:
+        info.op = JIT_ADD_A_B;
+        info.sets_flags = true;
+        return true;
+    case 0x90:
+        info.op = JIT_SUB_B;
+        info.sets_flags = true;
+        return true;
+    case 0x37:
+        info.op = JIT_SCF;
+        info.reads = JIT_READS_OWN;
+        info.sets_flags = true;
+        return true;
+    case 0xF1:
+        info.op = JIT_POP_AF;
+        info.sets_flags = true;
+        return true;
+    case 0xF5:
+        info.op = JIT_PUSH_AF;
+        info.reads = JIT_READS_DATA;
+        info.writes = true;
+        return true;
+    case 0xCB07: case 0xCB08: case 0xCB0F: case 0xCB17: case 0xCB1F:
+    case 0xCB27: case 0xCB28: case 0xCB3A: case 0xCB31:
+    {
+        // Shift kind and register as z80.cpp implements them (which does
+        // not follow the opcode bit layout for SRA/SRL)
+        static const struct { uint8_t opcode, shift, reg; } shifts[] = {
+            {0x07, JIT_RLC, JIT_A}, {0x08, JIT_RLC, JIT_B}, {0x0F, JIT_RRC, JIT_A},
+            {0x17, JIT_RL, JIT_A},  {0x1F, JIT_RR, JIT_A},  {0x27, JIT_SRA, JIT_A},
+            {0x28, JIT_SRA, JIT_B}, {0x3A, JIT_SRA, JIT_D}, {0x31, JIT_SRL, JIT_C},
+        };
+        for (const auto &s : shifts)
+            if (s.opcode == opcode)
+                info.cc = s.shift, info.reg = s.reg;
+        info.op = JIT_SHIFT;
+        info.reads = (info.cc == JIT_RL || info.cc == JIT_RR) ? JIT_READS_DATA : JIT_READS_NONE;
+        info.sets_flags = true;
+        return true;
+    }
+    case 0xCB6F:
+        info.op = JIT_BIT_A;
+        info.reads = JIT_READS_OWN;
+        info.sets_flags = true;
+        return true;
+    case 0xCB2F:
+        info.op = JIT_BIT_IND_HL;
+        info.reads = JIT_READS_OWN;
+        info.sets_flags = true;
+        return true;
+    case 0xED42:
+    case 0xED5A:
+        info.op = opcode == 0x42 ? JIT_SBC_HL_BC : JIT_ADC_HL_DE;
+        info.reads = JIT_READS_DATA;
+        info.sets_flags = true;
+        return true;
+    case 0xED4F:
+        info.op = JIT_LD_R_A;
+        return true;
+    case 0xDD21:
+    case 0xFD21:
+        info.op = JIT_LD_IDX_NN;
+        return true;
+    case 0xDD77:
+    case 0xFD77:
+        info.op = JIT_LD_IND_IDX_A;
+        info.writes = true;
+        return true;
+    case 0xDD96:
+    case 0xFD96:
+        info.op = JIT_SUB_IND_IDX;
+        info.sets_flags = true;
+        return true;
+    case 0xDDCB6E:
+    case 0xFDCB6E:
+        info.op = JIT_BIT_IND_IDX;
+        info.reads = JIT_READS_OWN;
+        info.sets_flags = true;
+        return true;
+    case 0x18:
+        info.op = JIT_JR;
+        return true;
+    case 0x20: case 0x28: case 0x30: case 0x38:
+        info.op = JIT_JR_CC;
+        info.cc = (opcode >> 3) & 3;
+        info.reads = JIT_READS_DATA;
+        return true;
+    case 0xC3:
+        info.op = JIT_JP;
+        return true;
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA:
+        info.op = JIT_JP_CC;
+        info.cc = (opcode >> 3) & 7;
+        info.reads = JIT_READS_DATA;
+        return true;
+    case 0xCD:
+        info.op = JIT_CALL;
+        info.writes = true;
+        return true;
+    case 0xC9:
+        info.op = JIT_RET;
+        return true;
+    case 0x76:
+        info.op = JIT_HALT;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Translator
+//
+// Native block layout: R15 = Z80_CPU, R14 = the read page table, R13 =
+// Z80Machine; A-L in the registers of jit_host[]; RAX, RBX, RBP, RDI and
+// R12 are scratch.
+// Helper calls spill A-L back to Z80_CPU first and reload them after.
+// ---------------------------------------------------------------------------
+
+#define JIT_FLAGS_UNKNOWN 0xFF // Flags come from before the block
+
+struct Z80_JitExit
+{
+    size_t patch;   // jcc to bind
+    uint16_t pc;    // Where the interpreter picks up
+    int cycles;     // T-states run up to here
+    int refresh;    // Instructions not yet added to R
+};
+
+struct Z80_Translator
+{
+    Z80_Asm a;
+    uint8_t kind;  // Last flag-setting op in this block, or JIT_FLAGS_UNKNOWN
+    uint8_t dirty; // Z80_JitReg bits changed since the last spill
+    std::vector<Z80_JitExit> exits;
+
+    Z80_Translator() : kind(JIT_FLAGS_UNKNOWN), dirty(0) {}
+
+    void reload()
+    {
+        for (int r = 0; r < JIT_REGS; r++)
+            a.load8(jit_host[r], R15, jit_offset[r]);
+    }
+
+    void spill()
+    {
+        for (int r = 0; r < JIT_REGS; r++)
+            if (dirty & (1 << r))
+                a.store8(R15, jit_offset[r], jit_host[r]);
+        dirty = 0;
+    }
+
+    void prologue()
+    {
+        a.push(RBX);
+        a.push(RBP);
+        a.push(R12);
+        a.push(R13);
+        a.push(R14);
+        a.push(R15);
+        a.alu_imm64(X86_IMM_SUB, RSP, 8); // Keep calls 16-byte aligned
+        a.mov64(R15, RDI);
+        a.mov64(R14, RSI);
+        a.mov64(R13, RDX);
+        reload();
+    }
+
+    // Return with PC already stored; cycles go back in EAX
+    void epilogue(int cycles)
+    {
+        a.mov_imm(RAX, static_cast<uint32_t>(cycles));
+        a.alu_imm64(X86_IMM_ADD, RSP, 8);
+        a.pop(R15);
+        a.pop(R14);
+        a.pop(R13);
+        a.pop(R12);
+        a.pop(RBP);
+        a.pop(RBX);
+        a.byte(0xC3); // ret
+    }
+
+    // Add the instructions run since the last LD R,A to R
+    void refresh(int count)
+    {
+        if (count == 0)
+            return;
+        a.load8(RAX, R15, offsetof(Z80_CPU, r));
+        a.alu_imm(X86_IMM_ADD, RAX, static_cast<uint32_t>(count));
+        a.alu_imm(X86_IMM_AND, RAX, 0x7F);
+        a.store8(R15, offsetof(Z80_CPU, r), RAX);
+    }
+
+    void set_pc(uint16_t pc)
+    {
+        a.store16_imm(R15, offsetof(Z80_CPU, pc), pc);
+    }
+
+    void call_flags(uint32_t (*helper)(Z80_CPU *))
+    {
+        spill();
+        a.mov64(RDI, R15);
+        a.call(reinterpret_cast<uint64_t>(helper));
+        reload();
+    }
+
+    // Memory write through Z80Jit::mem_write; EAX is nonzero if it hit cached
+    // code. addr and value must not be RDI, RSI or RDX.
+    void call_write(int addr, int value)
+    {
+        spill();
+        a.mov64(RDI, R13);
+        a.alu(X86_MOV, RSI, addr);
+        a.alu(X86_MOV, RDX, value);
+        a.call(reinterpret_cast<uint64_t>(&Z80Jit::mem_write));
+        reload();
+    }
+
+    // Carry flag (0 or 1) into dst, which must be RBX, RBP or R12
+    void carry(int dst)
+    {
+        switch (kind)
+        {
+        case FLAGS_ADD8:
+        case FLAGS_SUB8:
+            a.load32(dst, R15, offsetof(Z80_CPU, flag_res));
+            a.shift(X86_SHR, dst, 8);
+            a.alu_imm(X86_IMM_AND, dst, 1);
+            break;
+        case FLAGS_ADD16:
+        case FLAGS_SUB16:
+            a.load32(dst, R15, offsetof(Z80_CPU, flag_res));
+            a.shift(X86_SHR, dst, 16);
+            a.alu_imm(X86_IMM_AND, dst, 1);
+            break;
+        case FLAGS_SZP:
+        case FLAGS_INC8:
+        case FLAGS_DEC8:
+            a.load16(dst, R15, offsetof(Z80_CPU, flag_x));
+            break;
+        case FLAGS_NONE:
+            a.load8(dst, R15, offsetof(Z80_CPU, f));
+            a.alu_imm(X86_IMM_AND, dst, FLAG_C);
+            break;
+        default:
+            call_flags(jit_flags_carry);
+            a.alu(X86_MOV, dst, RAX);
+            break;
+        }
+    }
+
+    // One bit of F (0 or 1) into RBX
+    void flag_bit(uint8_t mask)
+    {
+        int shift = 0;
+        while ((mask >> shift) != 1)
+            shift++;
+
+        if (mask == FLAG_C)
+        {
+            carry(RBX);
+        }
+        else if (mask == FLAG_Z && kind != FLAGS_NONE && kind != JIT_FLAGS_UNKNOWN)
+        {
+            if (kind == FLAGS_ADD16 || kind == FLAGS_SUB16)
+                a.load16(RBX, R15, offsetof(Z80_CPU, flag_res));
+            else
+                a.load8(RBX, R15, offsetof(Z80_CPU, flag_res));
+            a.alu(X86_TEST, RBX, RBX);
+            a.setcc(X86_CC_E, RBX);
+        }
+        else
+        {
+            if (kind == FLAGS_NONE)
+                a.load8(RBX, R15, offsetof(Z80_CPU, f));
+            else
+            {
+                call_flags(jit_flags_get);
+                a.alu(X86_MOV, RBX, RAX);
+            }
+            a.shift(X86_SHR, RBX, static_cast<uint8_t>(shift));
+            a.alu_imm(X86_IMM_AND, RBX, 1);
+        }
+    }
+
+    // Record a lazy flag result (y < 0 records 0)
+    void record(uint8_t op, int x, int y, int res)
+    {
+        a.store8_imm(R15, offsetof(Z80_CPU, flag_op), op);
+        a.store16(R15, offsetof(Z80_CPU, flag_x), x);
+        if (y < 0)
+            a.store16_imm(R15, offsetof(Z80_CPU, flag_y), 0);
+        else
+            a.store16(R15, offsetof(Z80_CPU, flag_y), y);
+        a.store32(R15, offsetof(Z80_CPU, flag_res), res);
+    }
+
+    // F set outright (flags_set)
+    void set_f(int reg)
+    {
+        a.store8(R15, offsetof(Z80_CPU, f), reg);
+        a.store8_imm(R15, offsetof(Z80_CPU, flag_op), FLAGS_NONE);
+    }
+
+    // dst = memory byte at the 16-bit address in addr, through the page
+    // table. Uses RDI and RAX, so addr must be neither (dst may be RAX).
+    void read8(int dst, int addr)
+    {
+        a.alu(X86_MOV, RDI, addr);
+        a.shift(X86_SHR, RDI, Z80_PAGE_BITS);
+        a.load64_scaled(RDI, R14, RDI);
+        a.alu(X86_MOV, RAX, addr);
+        a.alu_imm(X86_IMM_AND, RAX, Z80_PAGE_MASK);
+        a.load8_index(dst, RDI, RAX);
+    }
+
+    // RBX = (IX or IY) + d, wrapped to 16 bits
+    void index_address(const Z80_Insn &insn)
+    {
+        bool iy = (insn.prefix >> 8 == 0xFD) || insn.prefix == 0xFD;
+        a.load16(RBX, R15, iy ? offsetof(Z80_CPU, iy) : offsetof(Z80_CPU, ix));
+        a.alu_imm(X86_IMM_ADD, RBX, static_cast<uint32_t>(static_cast<int8_t>(insn.operand)));
+        a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+    }
+
+    // RBX = register pair hi:lo
+    void pair(int dst, int hi, int lo)
+    {
+        a.alu(X86_MOV, dst, jit_host[hi]);
+        a.shift(X86_SHL, dst, 8);
+        a.alu(X86_OR, dst, jit_host[lo]);
+    }
+
+    // BIT n: F from the tested value, X/Y from xy, carry kept. value and xy
+    // must be RBX, RBP or A.
+    void bit_flags(int value, int xy, int bit)
+    {
+        carry(R12);
+        a.alu(X86_MOV, RAX, value);
+        a.alu_imm(X86_IMM_XOR, RAX, 0xFFFFFFFF);
+        a.shift(X86_SHR, RAX, static_cast<uint8_t>(bit));
+        a.alu_imm(X86_IMM_AND, RAX, 1); // 1 if the bit is clear
+        a.alu(X86_MOV, RDI, RAX);
+        a.shift(X86_SHL, RAX, 6); // Z
+        a.shift(X86_SHL, RDI, 2); // P/V
+        a.alu(X86_OR, RAX, RDI);
+        if (bit == 7)
+        {
+            a.alu(X86_MOV, RDI, value);
+            a.alu_imm(X86_IMM_AND, RDI, FLAG_S);
+            a.alu(X86_OR, RAX, RDI);
+        }
+        a.alu(X86_OR, RAX, R12);
+        a.alu_imm(X86_IMM_OR, RAX, FLAG_H);
+        a.alu(X86_MOV, RDI, xy);
+        a.alu_imm(X86_IMM_AND, RDI, FLAG_Y | FLAG_X);
+        a.alu(X86_OR, RAX, RDI);
+        set_f(RAX);
+    }
+
+    // Leave early if the write(s) just made hit cached code (flag in reg)
+    void check_write(int reg, uint16_t next, int cycles, int refresh_count)
+    {
+        a.alu(X86_TEST, reg, reg);
+        exits.push_back({a.jcc(X86_CC_NE), next, cycles, refresh_count});
+    }
+
+    void emit_exits()
+    {
+        for (const Z80_JitExit &exit : exits)
+        {
+            a.bind(exit.patch);
+            refresh(exit.refresh);
+            set_pc(exit.pc);
+            epilogue(exit.cycles);
+        }
+    }
+
+    void shift_op(int shift, int reg, bool live)
+    {
+        int p = jit_host[reg];
+        if (shift == JIT_RL || shift == JIT_RR)
+            carry(RBP); // Rotate the old carry in
+
+        a.alu(X86_MOV, RBX, p);
+        switch (shift)
+        {
+        case JIT_RLC:
+            a.shift(X86_SHR, RBX, 7);
+            a.shift(X86_SHL, p, 1);
+            a.alu(X86_OR, p, RBX);
+            a.alu_imm(X86_IMM_AND, p, 0xFF);
+            break;
+        case JIT_RRC:
+            a.alu_imm(X86_IMM_AND, RBX, 1);
+            a.shift(X86_SHR, p, 1);
+            a.alu(X86_MOV, RDI, RBX);
+            a.shift(X86_SHL, RDI, 7);
+            a.alu(X86_OR, p, RDI);
+            break;
+        case JIT_RL:
+            a.shift(X86_SHR, RBX, 7);
+            a.shift(X86_SHL, p, 1);
+            a.alu(X86_OR, p, RBP);
+            a.alu_imm(X86_IMM_AND, p, 0xFF);
+            break;
+        case JIT_RR:
+            a.alu_imm(X86_IMM_AND, RBX, 1);
+            a.shift(X86_SHR, p, 1);
+            a.alu(X86_MOV, RDI, RBP);
+            a.shift(X86_SHL, RDI, 7);
+            a.alu(X86_OR, p, RDI);
+            break;
+        case JIT_SRA:
+            a.alu_imm(X86_IMM_AND, RBX, 1);
+            a.alu(X86_MOV, RDI, p);
+            a.alu_imm(X86_IMM_AND, RDI, 0x80);
+            a.shift(X86_SHR, p, 1);
+            a.alu(X86_OR, p, RDI);
+            break;
+        default: // JIT_SRL
+            a.alu_imm(X86_IMM_AND, RBX, 1);
+            a.shift(X86_SHR, p, 1);
+            break;
+        }
+        if (live)
+            record(FLAGS_SZP, RBX, -1, p);
+        dirty |= 1 << reg;
+        kind = FLAGS_SZP;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Z80Jit
+// ---------------------------------------------------------------------------
+
+Z80Jit::Z80Jit() : buffer(nullptr), used(0)
+{
+}
+
+Z80Jit::~Z80Jit()
+{
+    if (buffer != nullptr)
+        munmap(buffer, Z80_JIT_BUFFER_SIZE);
+}
+
+void Z80Jit::reset()
+{
+    used = 0;
+}
+
+bool Z80Jit::translate(Z80_Block &block)
+{
+    Z80_JitInfo info[Z80_BLOCK_MAX_INSNS];
+    for (int n = 0; n < block.count; n++)
+        if (!jit_classify(block.insn[n], info[n]))
+            return true; // Not covered: stays on the interpreter
+
+    // Flag liveness, walking back from the block exit (where F is live)
+    bool live = true;
+    for (int n = block.count - 1; n >= 0; n--)
+    {
+        if (info[n].writes)
+            live = true; // The block may stop right after this write
+        if (info[n].sets_flags)
+        {
+            info[n].flags_live = live;
+            live = false;
+        }
+        if (info[n].reads == JIT_READS_DATA || (info[n].reads == JIT_READS_OWN && info[n].flags_live))
+            live = true;
+    }
+
+    Z80_Translator t;
+    Z80_Asm &a = t.a;
+    t.prologue();
+
+    uint16_t pc = block.start;
+    int cycles = 0;
+    int refresh = 0; // Instructions since the block start or the last LD R,A
+    bool ended = false;
+
+    for (int n = 0; n < block.count; n++)
+    {
+        const Z80_Insn &insn = block.insn[n];
+        const Z80_JitInfo &in = info[n];
+        uint16_t next = pc + insn.length;
+        bool flags_live = in.flags_live;
+        int p = jit_host[in.reg];
+        refresh++;
+
+        switch (in.op)
+        {
+        case JIT_NOP:
+            break;
+
+        case JIT_LD_R_N:
+            a.mov_imm(p, insn.operand & 0xFF);
+            t.dirty |= 1 << in.reg;
+            break;
+
+        case JIT_LD_RR_NN:
+            a.mov_imm(jit_host[in.reg], insn.operand >> 8);
+            a.mov_imm(jit_host[in.reg + 1], insn.operand & 0xFF);
+            t.dirty |= 3 << in.reg;
+            break;
+
+        case JIT_LD_IND_BC_A:
+            t.pair(RBX, JIT_B, JIT_C);
+            t.call_write(RBX, jit_host[JIT_A]);
+            t.check_write(RAX, next, cycles + insn.cycles, refresh);
+            break;
+
+        case JIT_INC_R:
+        case JIT_DEC_R:
+            if (flags_live)
+                t.carry(RBX);
+            a.alu_imm(in.op == JIT_INC_R ? X86_IMM_ADD : X86_IMM_SUB, p, 1);
+            a.alu_imm(X86_IMM_AND, p, 0xFF);
+            if (flags_live)
+                t.record(in.op == JIT_INC_R ? FLAGS_INC8 : FLAGS_DEC8, RBX, -1, p);
+            t.dirty |= 1 << in.reg;
+            t.kind = in.op == JIT_INC_R ? FLAGS_INC8 : FLAGS_DEC8;
+            break;
+
+        case JIT_ADD_A_B:
+        case JIT_SUB_B:
+        case JIT_SUB_IND_IDX:
+        {
+            int y = jit_host[JIT_B];
+            if (in.op == JIT_SUB_IND_IDX)
+            {
+                t.index_address(insn);
+                t.read8(RBP, RBX);
+                y = RBP;
+            }
+            int res = jit_host[JIT_A];
+            if (flags_live)
+            {
+                a.store16(R15, offsetof(Z80_CPU, flag_x), res);
+                a.store16(R15, offsetof(Z80_CPU, flag_y), y);
+            }
+            if (in.op == JIT_ADD_A_B)
+            {
+                a.alu(X86_ADD, res, y);
+            }
+            else
+            {
+                a.alu(X86_SUB, res, y);
+                a.alu_imm(X86_IMM_AND, res, 0xFFFF); // The interpreter keeps a 16-bit result
+            }
+            uint8_t op = in.op == JIT_ADD_A_B ? FLAGS_ADD8 : FLAGS_SUB8;
+            if (flags_live)
+            {
+                a.store32(R15, offsetof(Z80_CPU, flag_res), res);
+                a.store8_imm(R15, offsetof(Z80_CPU, flag_op), op);
+            }
+            a.alu_imm(X86_IMM_AND, res, 0xFF);
+            t.dirty |= 1 << JIT_A;
+            t.kind = op;
+            break;
+        }
+
+        case JIT_SCF:
+            if (flags_live)
+            {
+                if (t.kind == FLAGS_NONE)
+                    a.load8(RAX, R15, offsetof(Z80_CPU, f));
+                else
+                    t.call_flags(jit_flags_get);
+                a.alu_imm(X86_IMM_AND, RAX, FLAG_S | FLAG_Z | FLAG_PV);
+                a.alu_imm(X86_IMM_OR, RAX, FLAG_C);
+                a.alu(X86_MOV, RDI, jit_host[JIT_A]);
+                a.alu_imm(X86_IMM_AND, RDI, FLAG_Y | FLAG_X);
+                a.alu(X86_OR, RAX, RDI);
+                t.set_f(RAX);
+            }
+            t.kind = FLAGS_NONE;
+            break;
+
+        case JIT_POP_AF:
+            a.load16(RBX, R15, offsetof(Z80_CPU, sp));
+            t.read8(RBP, RBX);
+            a.alu_imm(X86_IMM_ADD, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            t.read8(jit_host[JIT_A], RBX);
+            a.alu_imm(X86_IMM_ADD, RBX, 1);
+            a.store16(R15, offsetof(Z80_CPU, sp), RBX);
+            if (flags_live)
+                t.set_f(RBP);
+            t.dirty |= 1 << JIT_A;
+            t.kind = FLAGS_NONE;
+            break;
+
+        case JIT_PUSH_AF:
+            if (t.kind == FLAGS_NONE)
+                a.load8(RBP, R15, offsetof(Z80_CPU, f));
+            else
+            {
+                t.call_flags(jit_flags_get);
+                a.alu(X86_MOV, RBP, RAX);
+            }
+            a.load16(RBX, R15, offsetof(Z80_CPU, sp));
+            a.alu_imm(X86_IMM_SUB, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            t.call_write(RBX, jit_host[JIT_A]);
+            a.alu(X86_MOV, R12, RAX);
+            a.alu_imm(X86_IMM_SUB, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            t.call_write(RBX, RBP);
+            a.alu(X86_OR, R12, RAX);
+            a.store16(R15, offsetof(Z80_CPU, sp), RBX);
+            t.kind = FLAGS_NONE; // flags_get above left F current
+            t.check_write(R12, next, cycles + insn.cycles, refresh);
+            break;
+
+        case JIT_SHIFT:
+            t.shift_op(in.cc, in.reg, flags_live);
+            break;
+
+        case JIT_BIT_A:
+        case JIT_BIT_IND_HL:
+        case JIT_BIT_IND_IDX:
+            if (flags_live)
+            {
+                int value = jit_host[JIT_A];
+                int xy = value;
+                if (in.op == JIT_BIT_IND_HL)
+                {
+                    t.pair(RBX, JIT_H, JIT_L);
+                    t.read8(RBP, RBX);
+                    value = xy = RBP;
+                }
+                else if (in.op == JIT_BIT_IND_IDX)
+                {
+                    t.index_address(insn);
+                    t.read8(RBP, RBX);
+                    a.shift(X86_SHR, RBX, 8); // X/Y come from the address high byte
+                    value = RBP;
+                    xy = RBX;
+                }
+                t.bit_flags(value, xy, 5);
+            }
+            t.kind = FLAGS_NONE;
+            break;
+
+        case JIT_SBC_HL_BC:
+        case JIT_ADC_HL_DE:
+        {
+            bool sbc = in.op == JIT_SBC_HL_BC;
+            t.carry(R12);
+            t.pair(RBX, JIT_H, JIT_L);
+            t.pair(RBP, sbc ? JIT_B : JIT_D, sbc ? JIT_C : JIT_E);
+            a.alu(X86_MOV, RDI, RBX);
+            a.alu(sbc ? X86_SUB : X86_ADD, RDI, RBP);
+            a.alu(sbc ? X86_SUB : X86_ADD, RDI, R12);
+            if (flags_live)
+                t.record(sbc ? FLAGS_SUB16 : FLAGS_ADD16, RBX, RBP, RDI);
+            a.alu(X86_MOV, jit_host[JIT_H], RDI);
+            a.shift(X86_SHR, jit_host[JIT_H], 8);
+            a.alu_imm(X86_IMM_AND, jit_host[JIT_H], 0xFF);
+            a.alu(X86_MOV, jit_host[JIT_L], RDI);
+            a.alu_imm(X86_IMM_AND, jit_host[JIT_L], 0xFF);
+            t.dirty |= (1 << JIT_H) | (1 << JIT_L);
+            t.kind = sbc ? FLAGS_SUB16 : FLAGS_ADD16;
+            break;
+        }
+
+        case JIT_LD_R_A:
+            a.store8(R15, offsetof(Z80_CPU, r), jit_host[JIT_A]);
+            refresh = 0;
+            break;
+
+        case JIT_LD_IDX_NN:
+            a.store16_imm(R15, insn.prefix == 0xFD ? offsetof(Z80_CPU, iy) : offsetof(Z80_CPU, ix), insn.operand);
+            break;
+
+        case JIT_LD_IND_IDX_A:
+            t.index_address(insn);
+            t.call_write(RBX, jit_host[JIT_A]);
+            t.check_write(RAX, next, cycles + insn.cycles, refresh);
+            break;
+
+        case JIT_JR:
+        case JIT_JP:
+            t.spill();
+            t.refresh(refresh);
+            t.set_pc(in.op == JIT_JR ? static_cast<uint16_t>(next + static_cast<int8_t>(insn.operand)) : insn.operand);
+            t.epilogue(cycles + insn.cycles);
+            ended = true;
+            break;
+
+        case JIT_JR_CC:
+        case JIT_JP_CC:
+        {
+            static const uint8_t masks[8] = {FLAG_Z, FLAG_Z, FLAG_C, FLAG_C, FLAG_PV, FLAG_PV, FLAG_S, FLAG_S};
+            t.flag_bit(masks[in.cc]);
+            if ((in.cc & 1) == 0)
+                a.alu_imm(X86_IMM_XOR, RBX, 1); // NZ, NC, PO, P: taken when the flag is clear
+            t.spill();
+            t.refresh(refresh);
+            a.alu(X86_TEST, RBX, RBX);
+            size_t not_taken = a.jcc(X86_CC_E);
+            bool jr = in.op == JIT_JR_CC;
+            t.set_pc(jr ? static_cast<uint16_t>(next + static_cast<int8_t>(insn.operand)) : insn.operand);
+            t.epilogue(cycles + insn.cycles);
+            a.bind(not_taken);
+            t.set_pc(next);
+            t.epilogue(cycles + z80_op_meta(insn.table, insn.opcode).cycles_short);
+            ended = true;
+            break;
+        }
+
+        case JIT_CALL:
+            a.load16(RBX, R15, offsetof(Z80_CPU, sp));
+            a.alu_imm(X86_IMM_SUB, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            a.mov_imm(RBP, next >> 8);
+            t.call_write(RBX, RBP);
+            a.alu_imm(X86_IMM_SUB, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            a.mov_imm(RBP, next & 0xFF);
+            t.call_write(RBX, RBP);
+            a.store16(R15, offsetof(Z80_CPU, sp), RBX);
+            t.spill();
+            t.refresh(refresh);
+            t.set_pc(insn.operand);
+            t.epilogue(cycles + insn.cycles);
+            ended = true;
+            break;
+
+        case JIT_RET:
+            a.load16(RBX, R15, offsetof(Z80_CPU, sp));
+            t.read8(RBP, RBX);
+            a.alu_imm(X86_IMM_ADD, RBX, 1);
+            a.alu_imm(X86_IMM_AND, RBX, 0xFFFF);
+            t.read8(RAX, RBX);
+            a.shift(X86_SHL, RAX, 8);
+            a.alu(X86_OR, RBP, RAX);
+            a.alu_imm(X86_IMM_ADD, RBX, 1);
+            a.store16(R15, offsetof(Z80_CPU, sp), RBX);
+            a.store16(R15, offsetof(Z80_CPU, pc), RBP);
+            t.spill();
+            t.refresh(refresh);
+            t.epilogue(cycles + insn.cycles);
+            ended = true;
+            break;
+
+        case JIT_HALT:
+            t.spill();
+            t.refresh(refresh);
+            a.store8_imm(R15, offsetof(Z80_CPU, halted), 1);
+            t.set_pc(pc); // Stay on the HALT
+            t.epilogue(cycles + insn.cycles);
+            ended = true;
+            break;
+        }
+
+        cycles += insn.cycles;
+        pc = next;
+    }
+
+    if (!ended)
+    {
+        // Block stopped at Z80_BLOCK_MAX_INSNS: carry on at the next one
+        t.spill();
+        t.refresh(refresh);
+        t.set_pc(pc);
+        t.epilogue(cycles);
+    }
+    t.emit_exits();
+
+    if (buffer == nullptr)
+    {
+        void *memory = mmap(nullptr, Z80_JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return true; // No executable memory: everything stays interpreted
+        buffer = static_cast<uint8_t *>(memory);
+    }
+
+    size_t size = (a.code.size() + 15) & ~static_cast<size_t>(15);
+    if (used + size > Z80_JIT_BUFFER_SIZE)
+        return false;
+    std::memcpy(buffer + used, a.code.data(), a.code.size());
+    block.native = reinterpret_cast<Z80_Native>(buffer + used);
+    used += size;
+    return true;
+}
+
+#else // !Z80_JIT_SUPPORTED
+
+Z80Jit::Z80Jit() : buffer(nullptr), used(0)
+{
+}
+
+Z80Jit::~Z80Jit()
+{
+}
+
+void Z80Jit::reset()
+{
+    used = 0;
+}
+
+bool Z80Jit::translate(Z80_Block &)
+{
+    return true; // Nothing is ever translated
+}
+
+#endif // Z80_JIT_SUPPORTED
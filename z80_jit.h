@@ -0,0 +1,50 @@
+#ifndef Z80_JIT_H
+#define Z80_JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "z80.h"
+
+// Native code is only generated for x86-64 Linux. Elsewhere, or when built
+// with -DZ80_NO_JIT, Z80Machine::enable_jit() returns false.
+#if defined(__x86_64__) && defined(__linux__) && !defined(Z80_NO_JIT)
+#define Z80_JIT_SUPPORTED 1
+#else
+#define Z80_JIT_SUPPORTED 0
+#endif
+
+#define Z80_JIT_THRESHOLD 64                 // Interpreted runs before a block is translated
+#define Z80_JIT_BUFFER_SIZE (4 * 1024 * 1024) // Native code bytes per machine
+
+// Translates hot basic blocks to x86-64. Inside a translated block the Z80
+// registers A-L live in host registers, and flag results are only recorded
+// (in the lazy flag fields of Z80_CPU) where a later instruction or the
+// block exit can see them. A block with any instruction the JIT does not
+// cover keeps running on the interpreter.
+class Z80Jit
+{
+public:
+    Z80Jit();
+    ~Z80Jit();
+    Z80Jit(const Z80Jit &) = delete;
+    Z80Jit &operator=(const Z80Jit &) = delete;
+
+    // Set block.native if every instruction in the block can be translated.
+    // Returns false only when the code buffer is full.
+    bool translate(Z80_Block &block);
+
+    // Forget all native code. Every block that pointed into it must be gone.
+    void reset();
+
+private:
+    friend struct Z80_Translator;
+
+    // Called from native code for every memory write; returns nonzero if the
+    // write invalidated cached code
+    static uint32_t mem_write(Z80Machine *m, uint32_t addr, uint32_t value);
+
+    uint8_t *buffer; // Executable memory, Z80_JIT_BUFFER_SIZE bytes
+    size_t used;
+};
+
+#endif // Z80_JIT_H
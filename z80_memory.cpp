@@ -0,0 +1,144 @@
+#include <cstring>
+#include <fstream>
+#include "z80_memory.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define Z80_MEMORY_MMAP 1
+#else
+#define Z80_MEMORY_MMAP 0
+#endif
+
+std::shared_ptr<const Z80_Image> z80_load_image(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return nullptr;
+    std::streamsize size = file.tellg();
+    if (size > 65536)
+        return nullptr;
+    std::shared_ptr<Z80_Image> image = std::make_shared<Z80_Image>(); // Zeroed
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char *>(image->bytes), size))
+        return nullptr;
+    return image;
+}
+
+uint8_t Z80Memory::scratch[Z80_PAGE_SIZE];
+
+Z80Memory::Z80Memory(uint8_t *memory)
+{
+    map_flat(memory);
+}
+
+Z80Memory::Z80Memory() : read_page(), write_page()
+{
+}
+
+Z80Memory::~Z80Memory()
+{
+    drop_banks();
+}
+
+void Z80Memory::drop_banks()
+{
+    for (Bank &bank : banks)
+    {
+#if Z80_MEMORY_MMAP
+        if (bank.mapped != 0)
+        {
+            munmap(bank.data, bank.mapped);
+            continue;
+        }
+#endif
+        delete[] bank.data;
+    }
+    banks.clear();
+}
+
+void Z80Memory::map_flat(uint8_t *memory)
+{
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        map_private(slot, memory + slot * Z80_PAGE_SIZE);
+}
+
+int Z80Memory::add_ram(size_t pages)
+{
+    if (pages == 0)
+        return -1;
+    banks.push_back({new uint8_t[pages * Z80_PAGE_SIZE](), pages, 0, false});
+    return static_cast<int>(banks.size() - 1);
+}
+
+int Z80Memory::add_rom(const std::string &filename)
+{
+#if Z80_MEMORY_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Reserve whole pages of zeros, then map the file over the start of
+    // them, so a partial last page reads as zeros instead of faulting
+    size_t size = static_cast<size_t>(st.st_size);
+    size_t pages = (size + Z80_PAGE_SIZE - 1) / Z80_PAGE_SIZE;
+    size_t mapped = pages * Z80_PAGE_SIZE;
+    void *region = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+    if (mmap(region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(region, mapped);
+        close(fd);
+        return -1;
+    }
+    close(fd); // The mapping keeps the file open
+
+    banks.push_back({static_cast<uint8_t *>(region), pages, mapped, true});
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return -1;
+    size_t size = static_cast<size_t>(file.tellg());
+    if (size == 0)
+        return -1;
+    size_t pages = (size + Z80_PAGE_SIZE - 1) / Z80_PAGE_SIZE;
+    uint8_t *data = new uint8_t[pages * Z80_PAGE_SIZE]();
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char *>(data), size))
+    {
+        delete[] data;
+        return -1;
+    }
+    banks.push_back({data, pages, 0, true});
+#endif
+    return static_cast<int>(banks.size() - 1);
+}
+
+size_t Z80Memory::bank_pages(int bank) const
+{
+    if (bank < 0 || static_cast<size_t>(bank) >= banks.size())
+        return 0;
+    return banks[bank].pages;
+}
+
+bool Z80Memory::map(int slot, int bank, size_t page)
+{
+    if (slot < 0 || slot >= Z80_PAGES || page >= bank_pages(bank))
+        return false;
+    uint8_t *data = banks[bank].data + page * Z80_PAGE_SIZE;
+    read_page[slot] = data;
+    write_page[slot] = banks[bank].rom ? scratch : data;
+    return true;
+}
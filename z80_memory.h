@@ -0,0 +1,112 @@
+#ifndef Z80_MEMORY_H
+#define Z80_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Page size of the memory map. 12 gives 16 slots of 4KB; build with
+// -DZ80_PAGE_BITS=14 for 4 slots of 16KB, and so on.
+#ifndef Z80_PAGE_BITS
+#define Z80_PAGE_BITS 12
+#endif
+
+#define Z80_PAGE_SIZE (1 << Z80_PAGE_BITS)
+#define Z80_PAGE_MASK (Z80_PAGE_SIZE - 1)
+#define Z80_PAGES (65536 >> Z80_PAGE_BITS) // Slots in the 64KB address space
+
+// Read-only 64KB memory image that any number of machines can run on at
+// once (Z80Machine::init(image)). Each machine copies a page of it only
+// when it first writes there.
+struct Z80_Image
+{
+    uint8_t bytes[65536];
+};
+
+// Load a binary of up to 64KB into a new image, zeros past its end. Returns
+// nullptr if the file cannot be read or is bigger.
+std::shared_ptr<const Z80_Image> z80_load_image(const std::string &filename);
+
+// Paged memory map. The 64KB address space is split into Z80_PAGES slots,
+// each pointing at one page of a bank: the machine's own 64KB, an extra
+// RAM bank, or a ROM image mapped straight from disk. Switching banks only
+// swaps slot pointers, and a read or write is one table lookup plus the
+// byte access. Writes to a ROM page go to a scratch page and are lost;
+// every map shares the one scratch page, since nothing reads it back.
+class Z80Memory
+{
+public:
+    uint8_t *read_page[Z80_PAGES];  // Slot base addresses for reads
+    uint8_t *write_page[Z80_PAGES]; // Same, except ROM slots point at scratch
+
+    // Start with every slot on the given 64KB buffer (see map_flat), or
+    // with none mapped, to be mapped before the first access
+    explicit Z80Memory(uint8_t *memory);
+    Z80Memory();
+    ~Z80Memory();
+    Z80Memory(const Z80Memory &) = delete;
+    Z80Memory &operator=(const Z80Memory &) = delete;
+
+    uint8_t read(uint16_t addr) const
+    {
+        return read_page[addr >> Z80_PAGE_BITS][addr & Z80_PAGE_MASK];
+    }
+
+    void write(uint16_t addr, uint8_t value)
+    {
+        write_page[addr >> Z80_PAGE_BITS][addr & Z80_PAGE_MASK] = value;
+    }
+
+    // Point every slot at one contiguous, writable 64KB buffer
+    void map_flat(uint8_t *memory);
+
+    // Add a zeroed RAM bank of the given number of pages. Returns its bank
+    // number.
+    int add_ram(size_t pages);
+
+    // Add a read-only bank backed by the file (mmap'd where available, so
+    // even large images load without copying). Returns its bank number, or
+    // -1 if the file could not be opened or mapped.
+    int add_rom(const std::string &filename);
+
+    // Free every bank, unmapping ROM files. Slots still pointing into one
+    // have to be remapped before the next access.
+    void drop_banks();
+
+    // Pages in a bank (0 for an unknown bank)
+    size_t bank_pages(int bank) const;
+
+    // Map page `page` of `bank` into slot `slot`. Returns false if any of
+    // them is out of range.
+    bool map(int slot, int bank, size_t page);
+
+    // Point a slot at a page outside the banks: one the machine owns, or a
+    // read-only shared one whose writes go to scratch
+    void map_private(int slot, uint8_t *page)
+    {
+        read_page[slot] = page;
+        write_page[slot] = page;
+    }
+
+    void map_shared(int slot, const uint8_t *page)
+    {
+        read_page[slot] = const_cast<uint8_t *>(page);
+        write_page[slot] = scratch;
+    }
+
+private:
+    struct Bank
+    {
+        uint8_t *data;  // pages * Z80_PAGE_SIZE bytes
+        size_t pages;
+        size_t mapped;  // Bytes mmap'd (0 for memory from new[])
+        bool rom;
+    };
+
+    std::vector<Bank> banks;
+    static uint8_t scratch[Z80_PAGE_SIZE]; // Write target for ROM and shared slots of every map; never read
+};
+
+#endif // Z80_MEMORY_H
@@ -0,0 +1,1361 @@
+#ifndef Z80_OPMETA_H
+#define Z80_OPMETA_H
+
+#include <cstdint>
+
+// Instruction metadata for every opcode of every prefix group, as the Zilog
+// manual gives it (undocumented forms included). decode() takes lengths and
+// T-states from here, and z80_disasm() the text; nothing on the execute
+// path reads the format strings.
+
+// Operands that follow the opcode, as Z80_OpMeta::operands
+enum Z80_OperandKind : uint8_t
+{
+    Z80_OPND_NONE, // Nothing
+    Z80_OPND_N,    // n: one byte
+    Z80_OPND_NN,   // nn: little-endian word
+    Z80_OPND_E,    // e: relative jump displacement, shown as the target
+    Z80_OPND_D,    // d: (IX+d) displacement
+    Z80_OPND_D_N,  // d then n: LD (IX+d),n
+    Z80_OPND_CB_D, // DD CB d op: d comes before the opcode, none after it
+};
+
+// One opcode. format is the mnemonic with lowercase placeholders for the
+// operands (n, nn, e, d) and XY for IX or IY; nullptr if the opcode is a
+// prefix or does nothing. cycles is the longer case: a branch taken, a
+// block instruction repeating; cycles_short the other (equal when there is
+// only one). flags has the FLAG_* bits the instruction may change.
+struct Z80_OpMeta
+{
+    const char *format;
+    uint8_t operands;
+    uint8_t cycles;
+    uint8_t cycles_short;
+    uint8_t flags;
+};
+
+// Bytes an operand kind takes after the opcode
+static constexpr int z80_operand_bytes(uint8_t kind)
+{
+    return kind == Z80_OPND_NN || kind == Z80_OPND_D_N ? 2 : kind == Z80_OPND_NONE || kind == Z80_OPND_CB_D ? 0 : 1;
+}
+
+// Unprefixed opcodes. CB, DD, ED and FD are prefixes (nullptr).
+inline constexpr Z80_OpMeta z80_base_meta[256] = {
+    {"NOP", Z80_OPND_NONE, 4, 4, 0x00},              // 00
+    {"LD BC,nn", Z80_OPND_NN, 10, 10, 0x00},         // 01
+    {"LD (BC),A", Z80_OPND_NONE, 7, 7, 0x00},        // 02
+    {"INC BC", Z80_OPND_NONE, 6, 6, 0x00},           // 03
+    {"INC B", Z80_OPND_NONE, 4, 4, 0xFE},            // 04
+    {"DEC B", Z80_OPND_NONE, 4, 4, 0xFE},            // 05
+    {"LD B,n", Z80_OPND_N, 7, 7, 0x00},              // 06
+    {"RLCA", Z80_OPND_NONE, 4, 4, 0x3B},             // 07
+    {"EX AF,AF'", Z80_OPND_NONE, 4, 4, 0xFF},        // 08
+    {"ADD HL,BC", Z80_OPND_NONE, 11, 11, 0x3B},      // 09
+    {"LD A,(BC)", Z80_OPND_NONE, 7, 7, 0x00},        // 0A
+    {"DEC BC", Z80_OPND_NONE, 6, 6, 0x00},           // 0B
+    {"INC C", Z80_OPND_NONE, 4, 4, 0xFE},            // 0C
+    {"DEC C", Z80_OPND_NONE, 4, 4, 0xFE},            // 0D
+    {"LD C,n", Z80_OPND_N, 7, 7, 0x00},              // 0E
+    {"RRCA", Z80_OPND_NONE, 4, 4, 0x3B},             // 0F
+    {"DJNZ e", Z80_OPND_E, 13, 8, 0x00},             // 10
+    {"LD DE,nn", Z80_OPND_NN, 10, 10, 0x00},         // 11
+    {"LD (DE),A", Z80_OPND_NONE, 7, 7, 0x00},        // 12
+    {"INC DE", Z80_OPND_NONE, 6, 6, 0x00},           // 13
+    {"INC D", Z80_OPND_NONE, 4, 4, 0xFE},            // 14
+    {"DEC D", Z80_OPND_NONE, 4, 4, 0xFE},            // 15
+    {"LD D,n", Z80_OPND_N, 7, 7, 0x00},              // 16
+    {"RLA", Z80_OPND_NONE, 4, 4, 0x3B},              // 17
+    {"JR e", Z80_OPND_E, 12, 12, 0x00},              // 18
+    {"ADD HL,DE", Z80_OPND_NONE, 11, 11, 0x3B},      // 19
+    {"LD A,(DE)", Z80_OPND_NONE, 7, 7, 0x00},        // 1A
+    {"DEC DE", Z80_OPND_NONE, 6, 6, 0x00},           // 1B
+    {"INC E", Z80_OPND_NONE, 4, 4, 0xFE},            // 1C
+    {"DEC E", Z80_OPND_NONE, 4, 4, 0xFE},            // 1D
+    {"LD E,n", Z80_OPND_N, 7, 7, 0x00},              // 1E
+    {"RRA", Z80_OPND_NONE, 4, 4, 0x3B},              // 1F
+    {"JR NZ,e", Z80_OPND_E, 12, 7, 0x00},            // 20
+    {"LD HL,nn", Z80_OPND_NN, 10, 10, 0x00},         // 21
+    {"LD (nn),HL", Z80_OPND_NN, 16, 16, 0x00},       // 22
+    {"INC HL", Z80_OPND_NONE, 6, 6, 0x00},           // 23
+    {"INC H", Z80_OPND_NONE, 4, 4, 0xFE},            // 24
+    {"DEC H", Z80_OPND_NONE, 4, 4, 0xFE},            // 25
+    {"LD H,n", Z80_OPND_N, 7, 7, 0x00},              // 26
+    {"DAA", Z80_OPND_NONE, 4, 4, 0xFD},              // 27
+    {"JR Z,e", Z80_OPND_E, 12, 7, 0x00},             // 28
+    {"ADD HL,HL", Z80_OPND_NONE, 11, 11, 0x3B},      // 29
+    {"LD HL,(nn)", Z80_OPND_NN, 16, 16, 0x00},       // 2A
+    {"DEC HL", Z80_OPND_NONE, 6, 6, 0x00},           // 2B
+    {"INC L", Z80_OPND_NONE, 4, 4, 0xFE},            // 2C
+    {"DEC L", Z80_OPND_NONE, 4, 4, 0xFE},            // 2D
+    {"LD L,n", Z80_OPND_N, 7, 7, 0x00},              // 2E
+    {"CPL", Z80_OPND_NONE, 4, 4, 0x3A},              // 2F
+    {"JR NC,e", Z80_OPND_E, 12, 7, 0x00},            // 30
+    {"LD SP,nn", Z80_OPND_NN, 10, 10, 0x00},         // 31
+    {"LD (nn),A", Z80_OPND_NN, 13, 13, 0x00},        // 32
+    {"INC SP", Z80_OPND_NONE, 6, 6, 0x00},           // 33
+    {"INC (HL)", Z80_OPND_NONE, 11, 11, 0xFE},       // 34
+    {"DEC (HL)", Z80_OPND_NONE, 11, 11, 0xFE},       // 35
+    {"LD (HL),n", Z80_OPND_N, 10, 10, 0x00},         // 36
+    {"SCF", Z80_OPND_NONE, 4, 4, 0x3B},              // 37
+    {"JR C,e", Z80_OPND_E, 12, 7, 0x00},             // 38
+    {"ADD HL,SP", Z80_OPND_NONE, 11, 11, 0x3B},      // 39
+    {"LD A,(nn)", Z80_OPND_NN, 13, 13, 0x00},        // 3A
+    {"DEC SP", Z80_OPND_NONE, 6, 6, 0x00},           // 3B
+    {"INC A", Z80_OPND_NONE, 4, 4, 0xFE},            // 3C
+    {"DEC A", Z80_OPND_NONE, 4, 4, 0xFE},            // 3D
+    {"LD A,n", Z80_OPND_N, 7, 7, 0x00},              // 3E
+    {"CCF", Z80_OPND_NONE, 4, 4, 0x3B},              // 3F
+    {"LD B,B", Z80_OPND_NONE, 4, 4, 0x00},           // 40
+    {"LD B,C", Z80_OPND_NONE, 4, 4, 0x00},           // 41
+    {"LD B,D", Z80_OPND_NONE, 4, 4, 0x00},           // 42
+    {"LD B,E", Z80_OPND_NONE, 4, 4, 0x00},           // 43
+    {"LD B,H", Z80_OPND_NONE, 4, 4, 0x00},           // 44
+    {"LD B,L", Z80_OPND_NONE, 4, 4, 0x00},           // 45
+    {"LD B,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 46
+    {"LD B,A", Z80_OPND_NONE, 4, 4, 0x00},           // 47
+    {"LD C,B", Z80_OPND_NONE, 4, 4, 0x00},           // 48
+    {"LD C,C", Z80_OPND_NONE, 4, 4, 0x00},           // 49
+    {"LD C,D", Z80_OPND_NONE, 4, 4, 0x00},           // 4A
+    {"LD C,E", Z80_OPND_NONE, 4, 4, 0x00},           // 4B
+    {"LD C,H", Z80_OPND_NONE, 4, 4, 0x00},           // 4C
+    {"LD C,L", Z80_OPND_NONE, 4, 4, 0x00},           // 4D
+    {"LD C,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 4E
+    {"LD C,A", Z80_OPND_NONE, 4, 4, 0x00},           // 4F
+    {"LD D,B", Z80_OPND_NONE, 4, 4, 0x00},           // 50
+    {"LD D,C", Z80_OPND_NONE, 4, 4, 0x00},           // 51
+    {"LD D,D", Z80_OPND_NONE, 4, 4, 0x00},           // 52
+    {"LD D,E", Z80_OPND_NONE, 4, 4, 0x00},           // 53
+    {"LD D,H", Z80_OPND_NONE, 4, 4, 0x00},           // 54
+    {"LD D,L", Z80_OPND_NONE, 4, 4, 0x00},           // 55
+    {"LD D,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 56
+    {"LD D,A", Z80_OPND_NONE, 4, 4, 0x00},           // 57
+    {"LD E,B", Z80_OPND_NONE, 4, 4, 0x00},           // 58
+    {"LD E,C", Z80_OPND_NONE, 4, 4, 0x00},           // 59
+    {"LD E,D", Z80_OPND_NONE, 4, 4, 0x00},           // 5A
+    {"LD E,E", Z80_OPND_NONE, 4, 4, 0x00},           // 5B
+    {"LD E,H", Z80_OPND_NONE, 4, 4, 0x00},           // 5C
+    {"LD E,L", Z80_OPND_NONE, 4, 4, 0x00},           // 5D
+    {"LD E,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 5E
+    {"LD E,A", Z80_OPND_NONE, 4, 4, 0x00},           // 5F
+    {"LD H,B", Z80_OPND_NONE, 4, 4, 0x00},           // 60
+    {"LD H,C", Z80_OPND_NONE, 4, 4, 0x00},           // 61
+    {"LD H,D", Z80_OPND_NONE, 4, 4, 0x00},           // 62
+    {"LD H,E", Z80_OPND_NONE, 4, 4, 0x00},           // 63
+    {"LD H,H", Z80_OPND_NONE, 4, 4, 0x00},           // 64
+    {"LD H,L", Z80_OPND_NONE, 4, 4, 0x00},           // 65
+    {"LD H,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 66
+    {"LD H,A", Z80_OPND_NONE, 4, 4, 0x00},           // 67
+    {"LD L,B", Z80_OPND_NONE, 4, 4, 0x00},           // 68
+    {"LD L,C", Z80_OPND_NONE, 4, 4, 0x00},           // 69
+    {"LD L,D", Z80_OPND_NONE, 4, 4, 0x00},           // 6A
+    {"LD L,E", Z80_OPND_NONE, 4, 4, 0x00},           // 6B
+    {"LD L,H", Z80_OPND_NONE, 4, 4, 0x00},           // 6C
+    {"LD L,L", Z80_OPND_NONE, 4, 4, 0x00},           // 6D
+    {"LD L,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 6E
+    {"LD L,A", Z80_OPND_NONE, 4, 4, 0x00},           // 6F
+    {"LD (HL),B", Z80_OPND_NONE, 7, 7, 0x00},        // 70
+    {"LD (HL),C", Z80_OPND_NONE, 7, 7, 0x00},        // 71
+    {"LD (HL),D", Z80_OPND_NONE, 7, 7, 0x00},        // 72
+    {"LD (HL),E", Z80_OPND_NONE, 7, 7, 0x00},        // 73
+    {"LD (HL),H", Z80_OPND_NONE, 7, 7, 0x00},        // 74
+    {"LD (HL),L", Z80_OPND_NONE, 7, 7, 0x00},        // 75
+    {"HALT", Z80_OPND_NONE, 4, 4, 0x00},             // 76
+    {"LD (HL),A", Z80_OPND_NONE, 7, 7, 0x00},        // 77
+    {"LD A,B", Z80_OPND_NONE, 4, 4, 0x00},           // 78
+    {"LD A,C", Z80_OPND_NONE, 4, 4, 0x00},           // 79
+    {"LD A,D", Z80_OPND_NONE, 4, 4, 0x00},           // 7A
+    {"LD A,E", Z80_OPND_NONE, 4, 4, 0x00},           // 7B
+    {"LD A,H", Z80_OPND_NONE, 4, 4, 0x00},           // 7C
+    {"LD A,L", Z80_OPND_NONE, 4, 4, 0x00},           // 7D
+    {"LD A,(HL)", Z80_OPND_NONE, 7, 7, 0x00},        // 7E
+    {"LD A,A", Z80_OPND_NONE, 4, 4, 0x00},           // 7F
+    {"ADD A,B", Z80_OPND_NONE, 4, 4, 0xFF},          // 80
+    {"ADD A,C", Z80_OPND_NONE, 4, 4, 0xFF},          // 81
+    {"ADD A,D", Z80_OPND_NONE, 4, 4, 0xFF},          // 82
+    {"ADD A,E", Z80_OPND_NONE, 4, 4, 0xFF},          // 83
+    {"ADD A,H", Z80_OPND_NONE, 4, 4, 0xFF},          // 84
+    {"ADD A,L", Z80_OPND_NONE, 4, 4, 0xFF},          // 85
+    {"ADD A,(HL)", Z80_OPND_NONE, 7, 7, 0xFF},       // 86
+    {"ADD A,A", Z80_OPND_NONE, 4, 4, 0xFF},          // 87
+    {"ADC A,B", Z80_OPND_NONE, 4, 4, 0xFF},          // 88
+    {"ADC A,C", Z80_OPND_NONE, 4, 4, 0xFF},          // 89
+    {"ADC A,D", Z80_OPND_NONE, 4, 4, 0xFF},          // 8A
+    {"ADC A,E", Z80_OPND_NONE, 4, 4, 0xFF},          // 8B
+    {"ADC A,H", Z80_OPND_NONE, 4, 4, 0xFF},          // 8C
+    {"ADC A,L", Z80_OPND_NONE, 4, 4, 0xFF},          // 8D
+    {"ADC A,(HL)", Z80_OPND_NONE, 7, 7, 0xFF},       // 8E
+    {"ADC A,A", Z80_OPND_NONE, 4, 4, 0xFF},          // 8F
+    {"SUB B", Z80_OPND_NONE, 4, 4, 0xFF},            // 90
+    {"SUB C", Z80_OPND_NONE, 4, 4, 0xFF},            // 91
+    {"SUB D", Z80_OPND_NONE, 4, 4, 0xFF},            // 92
+    {"SUB E", Z80_OPND_NONE, 4, 4, 0xFF},            // 93
+    {"SUB H", Z80_OPND_NONE, 4, 4, 0xFF},            // 94
+    {"SUB L", Z80_OPND_NONE, 4, 4, 0xFF},            // 95
+    {"SUB (HL)", Z80_OPND_NONE, 7, 7, 0xFF},         // 96
+    {"SUB A", Z80_OPND_NONE, 4, 4, 0xFF},            // 97
+    {"SBC A,B", Z80_OPND_NONE, 4, 4, 0xFF},          // 98
+    {"SBC A,C", Z80_OPND_NONE, 4, 4, 0xFF},          // 99
+    {"SBC A,D", Z80_OPND_NONE, 4, 4, 0xFF},          // 9A
+    {"SBC A,E", Z80_OPND_NONE, 4, 4, 0xFF},          // 9B
+    {"SBC A,H", Z80_OPND_NONE, 4, 4, 0xFF},          // 9C
+    {"SBC A,L", Z80_OPND_NONE, 4, 4, 0xFF},          // 9D
+    {"SBC A,(HL)", Z80_OPND_NONE, 7, 7, 0xFF},       // 9E
+    {"SBC A,A", Z80_OPND_NONE, 4, 4, 0xFF},          // 9F
+    {"AND B", Z80_OPND_NONE, 4, 4, 0xFF},            // A0
+    {"AND C", Z80_OPND_NONE, 4, 4, 0xFF},            // A1
+    {"AND D", Z80_OPND_NONE, 4, 4, 0xFF},            // A2
+    {"AND E", Z80_OPND_NONE, 4, 4, 0xFF},            // A3
+    {"AND H", Z80_OPND_NONE, 4, 4, 0xFF},            // A4
+    {"AND L", Z80_OPND_NONE, 4, 4, 0xFF},            // A5
+    {"AND (HL)", Z80_OPND_NONE, 7, 7, 0xFF},         // A6
+    {"AND A", Z80_OPND_NONE, 4, 4, 0xFF},            // A7
+    {"XOR B", Z80_OPND_NONE, 4, 4, 0xFF},            // A8
+    {"XOR C", Z80_OPND_NONE, 4, 4, 0xFF},            // A9
+    {"XOR D", Z80_OPND_NONE, 4, 4, 0xFF},            // AA
+    {"XOR E", Z80_OPND_NONE, 4, 4, 0xFF},            // AB
+    {"XOR H", Z80_OPND_NONE, 4, 4, 0xFF},            // AC
+    {"XOR L", Z80_OPND_NONE, 4, 4, 0xFF},            // AD
+    {"XOR (HL)", Z80_OPND_NONE, 7, 7, 0xFF},         // AE
+    {"XOR A", Z80_OPND_NONE, 4, 4, 0xFF},            // AF
+    {"OR B", Z80_OPND_NONE, 4, 4, 0xFF},             // B0
+    {"OR C", Z80_OPND_NONE, 4, 4, 0xFF},             // B1
+    {"OR D", Z80_OPND_NONE, 4, 4, 0xFF},             // B2
+    {"OR E", Z80_OPND_NONE, 4, 4, 0xFF},             // B3
+    {"OR H", Z80_OPND_NONE, 4, 4, 0xFF},             // B4
+    {"OR L", Z80_OPND_NONE, 4, 4, 0xFF},             // B5
+    {"OR (HL)", Z80_OPND_NONE, 7, 7, 0xFF},          // B6
+    {"OR A", Z80_OPND_NONE, 4, 4, 0xFF},             // B7
+    {"CP B", Z80_OPND_NONE, 4, 4, 0xFF},             // B8
+    {"CP C", Z80_OPND_NONE, 4, 4, 0xFF},             // B9
+    {"CP D", Z80_OPND_NONE, 4, 4, 0xFF},             // BA
+    {"CP E", Z80_OPND_NONE, 4, 4, 0xFF},             // BB
+    {"CP H", Z80_OPND_NONE, 4, 4, 0xFF},             // BC
+    {"CP L", Z80_OPND_NONE, 4, 4, 0xFF},             // BD
+    {"CP (HL)", Z80_OPND_NONE, 7, 7, 0xFF},          // BE
+    {"CP A", Z80_OPND_NONE, 4, 4, 0xFF},             // BF
+    {"RET NZ", Z80_OPND_NONE, 11, 5, 0x00},          // C0
+    {"POP BC", Z80_OPND_NONE, 10, 10, 0x00},         // C1
+    {"JP NZ,nn", Z80_OPND_NN, 10, 10, 0x00},         // C2
+    {"JP nn", Z80_OPND_NN, 10, 10, 0x00},            // C3
+    {"CALL NZ,nn", Z80_OPND_NN, 17, 10, 0x00},       // C4
+    {"PUSH BC", Z80_OPND_NONE, 11, 11, 0x00},        // C5
+    {"ADD A,n", Z80_OPND_N, 7, 7, 0xFF},             // C6
+    {"RST 00h", Z80_OPND_NONE, 11, 11, 0x00},        // C7
+    {"RET Z", Z80_OPND_NONE, 11, 5, 0x00},           // C8
+    {"RET", Z80_OPND_NONE, 10, 10, 0x00},            // C9
+    {"JP Z,nn", Z80_OPND_NN, 10, 10, 0x00},          // CA
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // CB
+    {"CALL Z,nn", Z80_OPND_NN, 17, 10, 0x00},        // CC
+    {"CALL nn", Z80_OPND_NN, 17, 17, 0x00},          // CD
+    {"ADC A,n", Z80_OPND_N, 7, 7, 0xFF},             // CE
+    {"RST 08h", Z80_OPND_NONE, 11, 11, 0x00},        // CF
+    {"RET NC", Z80_OPND_NONE, 11, 5, 0x00},          // D0
+    {"POP DE", Z80_OPND_NONE, 10, 10, 0x00},         // D1
+    {"JP NC,nn", Z80_OPND_NN, 10, 10, 0x00},         // D2
+    {"OUT (n),A", Z80_OPND_N, 11, 11, 0x00},         // D3
+    {"CALL NC,nn", Z80_OPND_NN, 17, 10, 0x00},       // D4
+    {"PUSH DE", Z80_OPND_NONE, 11, 11, 0x00},        // D5
+    {"SUB n", Z80_OPND_N, 7, 7, 0xFF},               // D6
+    {"RST 10h", Z80_OPND_NONE, 11, 11, 0x00},        // D7
+    {"RET C", Z80_OPND_NONE, 11, 5, 0x00},           // D8
+    {"EXX", Z80_OPND_NONE, 4, 4, 0x00},              // D9
+    {"JP C,nn", Z80_OPND_NN, 10, 10, 0x00},          // DA
+    {"IN A,(n)", Z80_OPND_N, 11, 11, 0x00},          // DB
+    {"CALL C,nn", Z80_OPND_NN, 17, 10, 0x00},        // DC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // DD
+    {"SBC A,n", Z80_OPND_N, 7, 7, 0xFF},             // DE
+    {"RST 18h", Z80_OPND_NONE, 11, 11, 0x00},        // DF
+    {"RET PO", Z80_OPND_NONE, 11, 5, 0x00},          // E0
+    {"POP HL", Z80_OPND_NONE, 10, 10, 0x00},         // E1
+    {"JP PO,nn", Z80_OPND_NN, 10, 10, 0x00},         // E2
+    {"EX (SP),HL", Z80_OPND_NONE, 19, 19, 0x00},     // E3
+    {"CALL PO,nn", Z80_OPND_NN, 17, 10, 0x00},       // E4
+    {"PUSH HL", Z80_OPND_NONE, 11, 11, 0x00},        // E5
+    {"AND n", Z80_OPND_N, 7, 7, 0xFF},               // E6
+    {"RST 20h", Z80_OPND_NONE, 11, 11, 0x00},        // E7
+    {"RET PE", Z80_OPND_NONE, 11, 5, 0x00},          // E8
+    {"JP (HL)", Z80_OPND_NONE, 4, 4, 0x00},          // E9
+    {"JP PE,nn", Z80_OPND_NN, 10, 10, 0x00},         // EA
+    {"EX DE,HL", Z80_OPND_NONE, 4, 4, 0x00},         // EB
+    {"CALL PE,nn", Z80_OPND_NN, 17, 10, 0x00},       // EC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // ED
+    {"XOR n", Z80_OPND_N, 7, 7, 0xFF},               // EE
+    {"RST 28h", Z80_OPND_NONE, 11, 11, 0x00},        // EF
+    {"RET P", Z80_OPND_NONE, 11, 5, 0x00},           // F0
+    {"POP AF", Z80_OPND_NONE, 10, 10, 0xFF},         // F1
+    {"JP P,nn", Z80_OPND_NN, 10, 10, 0x00},          // F2
+    {"DI", Z80_OPND_NONE, 4, 4, 0x00},               // F3
+    {"CALL P,nn", Z80_OPND_NN, 17, 10, 0x00},        // F4
+    {"PUSH AF", Z80_OPND_NONE, 11, 11, 0x00},        // F5
+    {"OR n", Z80_OPND_N, 7, 7, 0xFF},                // F6
+    {"RST 30h", Z80_OPND_NONE, 11, 11, 0x00},        // F7
+    {"RET M", Z80_OPND_NONE, 11, 5, 0x00},           // F8
+    {"LD SP,HL", Z80_OPND_NONE, 6, 6, 0x00},         // F9
+    {"JP M,nn", Z80_OPND_NN, 10, 10, 0x00},          // FA
+    {"EI", Z80_OPND_NONE, 4, 4, 0x00},               // FB
+    {"CALL M,nn", Z80_OPND_NN, 17, 10, 0x00},        // FC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // FD
+    {"CP n", Z80_OPND_N, 7, 7, 0xFF},                // FE
+    {"RST 38h", Z80_OPND_NONE, 11, 11, 0x00},        // FF
+};
+
+// CB prefix
+inline constexpr Z80_OpMeta z80_cb_meta[256] = {
+    {"RLC B", Z80_OPND_NONE, 8, 8, 0xFF},            // 00
+    {"RLC C", Z80_OPND_NONE, 8, 8, 0xFF},            // 01
+    {"RLC D", Z80_OPND_NONE, 8, 8, 0xFF},            // 02
+    {"RLC E", Z80_OPND_NONE, 8, 8, 0xFF},            // 03
+    {"RLC H", Z80_OPND_NONE, 8, 8, 0xFF},            // 04
+    {"RLC L", Z80_OPND_NONE, 8, 8, 0xFF},            // 05
+    {"RLC (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 06
+    {"RLC A", Z80_OPND_NONE, 8, 8, 0xFF},            // 07
+    {"RRC B", Z80_OPND_NONE, 8, 8, 0xFF},            // 08
+    {"RRC C", Z80_OPND_NONE, 8, 8, 0xFF},            // 09
+    {"RRC D", Z80_OPND_NONE, 8, 8, 0xFF},            // 0A
+    {"RRC E", Z80_OPND_NONE, 8, 8, 0xFF},            // 0B
+    {"RRC H", Z80_OPND_NONE, 8, 8, 0xFF},            // 0C
+    {"RRC L", Z80_OPND_NONE, 8, 8, 0xFF},            // 0D
+    {"RRC (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 0E
+    {"RRC A", Z80_OPND_NONE, 8, 8, 0xFF},            // 0F
+    {"RL B", Z80_OPND_NONE, 8, 8, 0xFF},             // 10
+    {"RL C", Z80_OPND_NONE, 8, 8, 0xFF},             // 11
+    {"RL D", Z80_OPND_NONE, 8, 8, 0xFF},             // 12
+    {"RL E", Z80_OPND_NONE, 8, 8, 0xFF},             // 13
+    {"RL H", Z80_OPND_NONE, 8, 8, 0xFF},             // 14
+    {"RL L", Z80_OPND_NONE, 8, 8, 0xFF},             // 15
+    {"RL (HL)", Z80_OPND_NONE, 15, 15, 0xFF},        // 16
+    {"RL A", Z80_OPND_NONE, 8, 8, 0xFF},             // 17
+    {"RR B", Z80_OPND_NONE, 8, 8, 0xFF},             // 18
+    {"RR C", Z80_OPND_NONE, 8, 8, 0xFF},             // 19
+    {"RR D", Z80_OPND_NONE, 8, 8, 0xFF},             // 1A
+    {"RR E", Z80_OPND_NONE, 8, 8, 0xFF},             // 1B
+    {"RR H", Z80_OPND_NONE, 8, 8, 0xFF},             // 1C
+    {"RR L", Z80_OPND_NONE, 8, 8, 0xFF},             // 1D
+    {"RR (HL)", Z80_OPND_NONE, 15, 15, 0xFF},        // 1E
+    {"RR A", Z80_OPND_NONE, 8, 8, 0xFF},             // 1F
+    {"SLA B", Z80_OPND_NONE, 8, 8, 0xFF},            // 20
+    {"SLA C", Z80_OPND_NONE, 8, 8, 0xFF},            // 21
+    {"SLA D", Z80_OPND_NONE, 8, 8, 0xFF},            // 22
+    {"SLA E", Z80_OPND_NONE, 8, 8, 0xFF},            // 23
+    {"SLA H", Z80_OPND_NONE, 8, 8, 0xFF},            // 24
+    {"SLA L", Z80_OPND_NONE, 8, 8, 0xFF},            // 25
+    {"SLA (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 26
+    {"SLA A", Z80_OPND_NONE, 8, 8, 0xFF},            // 27
+    {"SRA B", Z80_OPND_NONE, 8, 8, 0xFF},            // 28
+    {"SRA C", Z80_OPND_NONE, 8, 8, 0xFF},            // 29
+    {"SRA D", Z80_OPND_NONE, 8, 8, 0xFF},            // 2A
+    {"SRA E", Z80_OPND_NONE, 8, 8, 0xFF},            // 2B
+    {"SRA H", Z80_OPND_NONE, 8, 8, 0xFF},            // 2C
+    {"SRA L", Z80_OPND_NONE, 8, 8, 0xFF},            // 2D
+    {"SRA (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 2E
+    {"SRA A", Z80_OPND_NONE, 8, 8, 0xFF},            // 2F
+    {"SLL B", Z80_OPND_NONE, 8, 8, 0xFF},            // 30
+    {"SLL C", Z80_OPND_NONE, 8, 8, 0xFF},            // 31
+    {"SLL D", Z80_OPND_NONE, 8, 8, 0xFF},            // 32
+    {"SLL E", Z80_OPND_NONE, 8, 8, 0xFF},            // 33
+    {"SLL H", Z80_OPND_NONE, 8, 8, 0xFF},            // 34
+    {"SLL L", Z80_OPND_NONE, 8, 8, 0xFF},            // 35
+    {"SLL (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 36
+    {"SLL A", Z80_OPND_NONE, 8, 8, 0xFF},            // 37
+    {"SRL B", Z80_OPND_NONE, 8, 8, 0xFF},            // 38
+    {"SRL C", Z80_OPND_NONE, 8, 8, 0xFF},            // 39
+    {"SRL D", Z80_OPND_NONE, 8, 8, 0xFF},            // 3A
+    {"SRL E", Z80_OPND_NONE, 8, 8, 0xFF},            // 3B
+    {"SRL H", Z80_OPND_NONE, 8, 8, 0xFF},            // 3C
+    {"SRL L", Z80_OPND_NONE, 8, 8, 0xFF},            // 3D
+    {"SRL (HL)", Z80_OPND_NONE, 15, 15, 0xFF},       // 3E
+    {"SRL A", Z80_OPND_NONE, 8, 8, 0xFF},            // 3F
+    {"BIT 0,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 40
+    {"BIT 0,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 41
+    {"BIT 0,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 42
+    {"BIT 0,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 43
+    {"BIT 0,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 44
+    {"BIT 0,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 45
+    {"BIT 0,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 46
+    {"BIT 0,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 47
+    {"BIT 1,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 48
+    {"BIT 1,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 49
+    {"BIT 1,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 4A
+    {"BIT 1,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 4B
+    {"BIT 1,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 4C
+    {"BIT 1,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 4D
+    {"BIT 1,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 4E
+    {"BIT 1,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 4F
+    {"BIT 2,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 50
+    {"BIT 2,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 51
+    {"BIT 2,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 52
+    {"BIT 2,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 53
+    {"BIT 2,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 54
+    {"BIT 2,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 55
+    {"BIT 2,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 56
+    {"BIT 2,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 57
+    {"BIT 3,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 58
+    {"BIT 3,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 59
+    {"BIT 3,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 5A
+    {"BIT 3,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 5B
+    {"BIT 3,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 5C
+    {"BIT 3,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 5D
+    {"BIT 3,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 5E
+    {"BIT 3,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 5F
+    {"BIT 4,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 60
+    {"BIT 4,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 61
+    {"BIT 4,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 62
+    {"BIT 4,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 63
+    {"BIT 4,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 64
+    {"BIT 4,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 65
+    {"BIT 4,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 66
+    {"BIT 4,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 67
+    {"BIT 5,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 68
+    {"BIT 5,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 69
+    {"BIT 5,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 6A
+    {"BIT 5,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 6B
+    {"BIT 5,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 6C
+    {"BIT 5,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 6D
+    {"BIT 5,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 6E
+    {"BIT 5,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 6F
+    {"BIT 6,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 70
+    {"BIT 6,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 71
+    {"BIT 6,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 72
+    {"BIT 6,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 73
+    {"BIT 6,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 74
+    {"BIT 6,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 75
+    {"BIT 6,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 76
+    {"BIT 6,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 77
+    {"BIT 7,B", Z80_OPND_NONE, 8, 8, 0xFE},          // 78
+    {"BIT 7,C", Z80_OPND_NONE, 8, 8, 0xFE},          // 79
+    {"BIT 7,D", Z80_OPND_NONE, 8, 8, 0xFE},          // 7A
+    {"BIT 7,E", Z80_OPND_NONE, 8, 8, 0xFE},          // 7B
+    {"BIT 7,H", Z80_OPND_NONE, 8, 8, 0xFE},          // 7C
+    {"BIT 7,L", Z80_OPND_NONE, 8, 8, 0xFE},          // 7D
+    {"BIT 7,(HL)", Z80_OPND_NONE, 12, 12, 0xFE},     // 7E
+    {"BIT 7,A", Z80_OPND_NONE, 8, 8, 0xFE},          // 7F
+    {"RES 0,B", Z80_OPND_NONE, 8, 8, 0x00},          // 80
+    {"RES 0,C", Z80_OPND_NONE, 8, 8, 0x00},          // 81
+    {"RES 0,D", Z80_OPND_NONE, 8, 8, 0x00},          // 82
+    {"RES 0,E", Z80_OPND_NONE, 8, 8, 0x00},          // 83
+    {"RES 0,H", Z80_OPND_NONE, 8, 8, 0x00},          // 84
+    {"RES 0,L", Z80_OPND_NONE, 8, 8, 0x00},          // 85
+    {"RES 0,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // 86
+    {"RES 0,A", Z80_OPND_NONE, 8, 8, 0x00},          // 87
+    {"RES 1,B", Z80_OPND_NONE, 8, 8, 0x00},          // 88
+    {"RES 1,C", Z80_OPND_NONE, 8, 8, 0x00},          // 89
+    {"RES 1,D", Z80_OPND_NONE, 8, 8, 0x00},          // 8A
+    {"RES 1,E", Z80_OPND_NONE, 8, 8, 0x00},          // 8B
+    {"RES 1,H", Z80_OPND_NONE, 8, 8, 0x00},          // 8C
+    {"RES 1,L", Z80_OPND_NONE, 8, 8, 0x00},          // 8D
+    {"RES 1,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // 8E
+    {"RES 1,A", Z80_OPND_NONE, 8, 8, 0x00},          // 8F
+    {"RES 2,B", Z80_OPND_NONE, 8, 8, 0x00},          // 90
+    {"RES 2,C", Z80_OPND_NONE, 8, 8, 0x00},          // 91
+    {"RES 2,D", Z80_OPND_NONE, 8, 8, 0x00},          // 92
+    {"RES 2,E", Z80_OPND_NONE, 8, 8, 0x00},          // 93
+    {"RES 2,H", Z80_OPND_NONE, 8, 8, 0x00},          // 94
+    {"RES 2,L", Z80_OPND_NONE, 8, 8, 0x00},          // 95
+    {"RES 2,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // 96
+    {"RES 2,A", Z80_OPND_NONE, 8, 8, 0x00},          // 97
+    {"RES 3,B", Z80_OPND_NONE, 8, 8, 0x00},          // 98
+    {"RES 3,C", Z80_OPND_NONE, 8, 8, 0x00},          // 99
+    {"RES 3,D", Z80_OPND_NONE, 8, 8, 0x00},          // 9A
+    {"RES 3,E", Z80_OPND_NONE, 8, 8, 0x00},          // 9B
+    {"RES 3,H", Z80_OPND_NONE, 8, 8, 0x00},          // 9C
+    {"RES 3,L", Z80_OPND_NONE, 8, 8, 0x00},          // 9D
+    {"RES 3,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // 9E
+    {"RES 3,A", Z80_OPND_NONE, 8, 8, 0x00},          // 9F
+    {"RES 4,B", Z80_OPND_NONE, 8, 8, 0x00},          // A0
+    {"RES 4,C", Z80_OPND_NONE, 8, 8, 0x00},          // A1
+    {"RES 4,D", Z80_OPND_NONE, 8, 8, 0x00},          // A2
+    {"RES 4,E", Z80_OPND_NONE, 8, 8, 0x00},          // A3
+    {"RES 4,H", Z80_OPND_NONE, 8, 8, 0x00},          // A4
+    {"RES 4,L", Z80_OPND_NONE, 8, 8, 0x00},          // A5
+    {"RES 4,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // A6
+    {"RES 4,A", Z80_OPND_NONE, 8, 8, 0x00},          // A7
+    {"RES 5,B", Z80_OPND_NONE, 8, 8, 0x00},          // A8
+    {"RES 5,C", Z80_OPND_NONE, 8, 8, 0x00},          // A9
+    {"RES 5,D", Z80_OPND_NONE, 8, 8, 0x00},          // AA
+    {"RES 5,E", Z80_OPND_NONE, 8, 8, 0x00},          // AB
+    {"RES 5,H", Z80_OPND_NONE, 8, 8, 0x00},          // AC
+    {"RES 5,L", Z80_OPND_NONE, 8, 8, 0x00},          // AD
+    {"RES 5,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // AE
+    {"RES 5,A", Z80_OPND_NONE, 8, 8, 0x00},          // AF
+    {"RES 6,B", Z80_OPND_NONE, 8, 8, 0x00},          // B0
+    {"RES 6,C", Z80_OPND_NONE, 8, 8, 0x00},          // B1
+    {"RES 6,D", Z80_OPND_NONE, 8, 8, 0x00},          // B2
+    {"RES 6,E", Z80_OPND_NONE, 8, 8, 0x00},          // B3
+    {"RES 6,H", Z80_OPND_NONE, 8, 8, 0x00},          // B4
+    {"RES 6,L", Z80_OPND_NONE, 8, 8, 0x00},          // B5
+    {"RES 6,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // B6
+    {"RES 6,A", Z80_OPND_NONE, 8, 8, 0x00},          // B7
+    {"RES 7,B", Z80_OPND_NONE, 8, 8, 0x00},          // B8
+    {"RES 7,C", Z80_OPND_NONE, 8, 8, 0x00},          // B9
+    {"RES 7,D", Z80_OPND_NONE, 8, 8, 0x00},          // BA
+    {"RES 7,E", Z80_OPND_NONE, 8, 8, 0x00},          // BB
+    {"RES 7,H", Z80_OPND_NONE, 8, 8, 0x00},          // BC
+    {"RES 7,L", Z80_OPND_NONE, 8, 8, 0x00},          // BD
+    {"RES 7,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // BE
+    {"RES 7,A", Z80_OPND_NONE, 8, 8, 0x00},          // BF
+    {"SET 0,B", Z80_OPND_NONE, 8, 8, 0x00},          // C0
+    {"SET 0,C", Z80_OPND_NONE, 8, 8, 0x00},          // C1
+    {"SET 0,D", Z80_OPND_NONE, 8, 8, 0x00},          // C2
+    {"SET 0,E", Z80_OPND_NONE, 8, 8, 0x00},          // C3
+    {"SET 0,H", Z80_OPND_NONE, 8, 8, 0x00},          // C4
+    {"SET 0,L", Z80_OPND_NONE, 8, 8, 0x00},          // C5
+    {"SET 0,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // C6
+    {"SET 0,A", Z80_OPND_NONE, 8, 8, 0x00},          // C7
+    {"SET 1,B", Z80_OPND_NONE, 8, 8, 0x00},          // C8
+    {"SET 1,C", Z80_OPND_NONE, 8, 8, 0x00},          // C9
+    {"SET 1,D", Z80_OPND_NONE, 8, 8, 0x00},          // CA
+    {"SET 1,E", Z80_OPND_NONE, 8, 8, 0x00},          // CB
+    {"SET 1,H", Z80_OPND_NONE, 8, 8, 0x00},          // CC
+    {"SET 1,L", Z80_OPND_NONE, 8, 8, 0x00},          // CD
+    {"SET 1,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // CE
+    {"SET 1,A", Z80_OPND_NONE, 8, 8, 0x00},          // CF
+    {"SET 2,B", Z80_OPND_NONE, 8, 8, 0x00},          // D0
+    {"SET 2,C", Z80_OPND_NONE, 8, 8, 0x00},          // D1
+    {"SET 2,D", Z80_OPND_NONE, 8, 8, 0x00},          // D2
+    {"SET 2,E", Z80_OPND_NONE, 8, 8, 0x00},          // D3
+    {"SET 2,H", Z80_OPND_NONE, 8, 8, 0x00},          // D4
+    {"SET 2,L", Z80_OPND_NONE, 8, 8, 0x00},          // D5
+    {"SET 2,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // D6
+    {"SET 2,A", Z80_OPND_NONE, 8, 8, 0x00},          // D7
+    {"SET 3,B", Z80_OPND_NONE, 8, 8, 0x00},          // D8
+    {"SET 3,C", Z80_OPND_NONE, 8, 8, 0x00},          // D9
+    {"SET 3,D", Z80_OPND_NONE, 8, 8, 0x00},          // DA
+    {"SET 3,E", Z80_OPND_NONE, 8, 8, 0x00},          // DB
+    {"SET 3,H", Z80_OPND_NONE, 8, 8, 0x00},          // DC
+    {"SET 3,L", Z80_OPND_NONE, 8, 8, 0x00},          // DD
+    {"SET 3,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // DE
+    {"SET 3,A", Z80_OPND_NONE, 8, 8, 0x00},          // DF
+    {"SET 4,B", Z80_OPND_NONE, 8, 8, 0x00},          // E0
+    {"SET 4,C", Z80_OPND_NONE, 8, 8, 0x00},          // E1
+    {"SET 4,D", Z80_OPND_NONE, 8, 8, 0x00},          // E2
+    {"SET 4,E", Z80_OPND_NONE, 8, 8, 0x00},          // E3
+    {"SET 4,H", Z80_OPND_NONE, 8, 8, 0x00},          // E4
+    {"SET 4,L", Z80_OPND_NONE, 8, 8, 0x00},          // E5
+    {"SET 4,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // E6
+    {"SET 4,A", Z80_OPND_NONE, 8, 8, 0x00},          // E7
+    {"SET 5,B", Z80_OPND_NONE, 8, 8, 0x00},          // E8
+    {"SET 5,C", Z80_OPND_NONE, 8, 8, 0x00},          // E9
+    {"SET 5,D", Z80_OPND_NONE, 8, 8, 0x00},          // EA
+    {"SET 5,E", Z80_OPND_NONE, 8, 8, 0x00},          // EB
+    {"SET 5,H", Z80_OPND_NONE, 8, 8, 0x00},          // EC
+    {"SET 5,L", Z80_OPND_NONE, 8, 8, 0x00},          // ED
+    {"SET 5,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // EE
+    {"SET 5,A", Z80_OPND_NONE, 8, 8, 0x00},          // EF
+    {"SET 6,B", Z80_OPND_NONE, 8, 8, 0x00},          // F0
+    {"SET 6,C", Z80_OPND_NONE, 8, 8, 0x00},          // F1
+    {"SET 6,D", Z80_OPND_NONE, 8, 8, 0x00},          // F2
+    {"SET 6,E", Z80_OPND_NONE, 8, 8, 0x00},          // F3
+    {"SET 6,H", Z80_OPND_NONE, 8, 8, 0x00},          // F4
+    {"SET 6,L", Z80_OPND_NONE, 8, 8, 0x00},          // F5
+    {"SET 6,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // F6
+    {"SET 6,A", Z80_OPND_NONE, 8, 8, 0x00},          // F7
+    {"SET 7,B", Z80_OPND_NONE, 8, 8, 0x00},          // F8
+    {"SET 7,C", Z80_OPND_NONE, 8, 8, 0x00},          // F9
+    {"SET 7,D", Z80_OPND_NONE, 8, 8, 0x00},          // FA
+    {"SET 7,E", Z80_OPND_NONE, 8, 8, 0x00},          // FB
+    {"SET 7,H", Z80_OPND_NONE, 8, 8, 0x00},          // FC
+    {"SET 7,L", Z80_OPND_NONE, 8, 8, 0x00},          // FD
+    {"SET 7,(HL)", Z80_OPND_NONE, 15, 15, 0x00},     // FE
+    {"SET 7,A", Z80_OPND_NONE, 8, 8, 0x00},          // FF
+};
+
+// ED prefix. Opcodes that do nothing (8 T-states) are nullptr.
+inline constexpr Z80_OpMeta z80_ed_meta[256] = {
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 00
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 01
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 02
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 03
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 04
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 05
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 06
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 07
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 08
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 09
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 0F
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 10
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 11
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 12
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 13
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 14
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 15
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 16
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 17
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 18
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 19
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 1F
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 20
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 21
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 22
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 23
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 24
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 25
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 26
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 27
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 28
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 29
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 2F
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 30
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 31
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 32
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 33
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 34
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 35
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 36
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 37
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 38
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 39
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 3F
+    {"IN B,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 40
+    {"OUT (C),B", Z80_OPND_NONE, 12, 12, 0x00},      // 41
+    {"SBC HL,BC", Z80_OPND_NONE, 15, 15, 0xFF},      // 42
+    {"LD (nn),BC", Z80_OPND_NN, 20, 20, 0x00},       // 43
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 44
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 45
+    {"IM 0", Z80_OPND_NONE, 8, 8, 0x00},             // 46
+    {"LD I,A", Z80_OPND_NONE, 9, 9, 0x00},           // 47
+    {"IN C,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 48
+    {"OUT (C),C", Z80_OPND_NONE, 12, 12, 0x00},      // 49
+    {"ADC HL,BC", Z80_OPND_NONE, 15, 15, 0xFF},      // 4A
+    {"LD BC,(nn)", Z80_OPND_NN, 20, 20, 0x00},       // 4B
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 4C
+    {"RETI", Z80_OPND_NONE, 14, 14, 0x00},           // 4D
+    {"IM 0", Z80_OPND_NONE, 8, 8, 0x00},             // 4E
+    {"LD R,A", Z80_OPND_NONE, 9, 9, 0x00},           // 4F
+    {"IN D,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 50
+    {"OUT (C),D", Z80_OPND_NONE, 12, 12, 0x00},      // 51
+    {"SBC HL,DE", Z80_OPND_NONE, 15, 15, 0xFF},      // 52
+    {"LD (nn),DE", Z80_OPND_NN, 20, 20, 0x00},       // 53
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 54
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 55
+    {"IM 1", Z80_OPND_NONE, 8, 8, 0x00},             // 56
+    {"LD A,I", Z80_OPND_NONE, 9, 9, 0xFE},           // 57
+    {"IN E,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 58
+    {"OUT (C),E", Z80_OPND_NONE, 12, 12, 0x00},      // 59
+    {"ADC HL,DE", Z80_OPND_NONE, 15, 15, 0xFF},      // 5A
+    {"LD DE,(nn)", Z80_OPND_NN, 20, 20, 0x00},       // 5B
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 5C
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 5D
+    {"IM 2", Z80_OPND_NONE, 8, 8, 0x00},             // 5E
+    {"LD A,R", Z80_OPND_NONE, 9, 9, 0xFE},           // 5F
+    {"IN H,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 60
+    {"OUT (C),H", Z80_OPND_NONE, 12, 12, 0x00},      // 61
+    {"SBC HL,HL", Z80_OPND_NONE, 15, 15, 0xFF},      // 62
+    {"LD (nn),HL", Z80_OPND_NN, 20, 20, 0x00},       // 63
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 64
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 65
+    {"IM 0", Z80_OPND_NONE, 8, 8, 0x00},             // 66
+    {"RRD", Z80_OPND_NONE, 18, 18, 0xFE},            // 67
+    {"IN L,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 68
+    {"OUT (C),L", Z80_OPND_NONE, 12, 12, 0x00},      // 69
+    {"ADC HL,HL", Z80_OPND_NONE, 15, 15, 0xFF},      // 6A
+    {"LD HL,(nn)", Z80_OPND_NN, 20, 20, 0x00},       // 6B
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 6C
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 6D
+    {"IM 0", Z80_OPND_NONE, 8, 8, 0x00},             // 6E
+    {"RLD", Z80_OPND_NONE, 18, 18, 0xFE},            // 6F
+    {"IN (C)", Z80_OPND_NONE, 12, 12, 0xFE},         // 70
+    {"OUT (C),0", Z80_OPND_NONE, 12, 12, 0x00},      // 71
+    {"SBC HL,SP", Z80_OPND_NONE, 15, 15, 0xFF},      // 72
+    {"LD (nn),SP", Z80_OPND_NN, 20, 20, 0x00},       // 73
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 74
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 75
+    {"IM 1", Z80_OPND_NONE, 8, 8, 0x00},             // 76
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 77
+    {"IN A,(C)", Z80_OPND_NONE, 12, 12, 0xFE},       // 78
+    {"OUT (C),A", Z80_OPND_NONE, 12, 12, 0x00},      // 79
+    {"ADC HL,SP", Z80_OPND_NONE, 15, 15, 0xFF},      // 7A
+    {"LD SP,(nn)", Z80_OPND_NN, 20, 20, 0x00},       // 7B
+    {"NEG", Z80_OPND_NONE, 8, 8, 0xFF},              // 7C
+    {"RETN", Z80_OPND_NONE, 14, 14, 0x00},           // 7D
+    {"IM 2", Z80_OPND_NONE, 8, 8, 0x00},             // 7E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 7F
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 80
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 81
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 82
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 83
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 84
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 85
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 86
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 87
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 88
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 89
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 8F
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 90
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 91
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 92
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 93
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 94
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 95
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 96
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 97
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 98
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 99
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9A
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9B
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9C
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9D
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9E
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // 9F
+    {"LDI", Z80_OPND_NONE, 16, 16, 0x3E},            // A0
+    {"CPI", Z80_OPND_NONE, 16, 16, 0xFE},            // A1
+    {"INI", Z80_OPND_NONE, 16, 16, 0xFF},            // A2
+    {"OUTI", Z80_OPND_NONE, 16, 16, 0xFF},           // A3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // A4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // A5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // A6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // A7
+    {"LDD", Z80_OPND_NONE, 16, 16, 0x3E},            // A8
+    {"CPD", Z80_OPND_NONE, 16, 16, 0xFE},            // A9
+    {"IND", Z80_OPND_NONE, 16, 16, 0xFF},            // AA
+    {"OUTD", Z80_OPND_NONE, 16, 16, 0xFF},           // AB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // AC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // AD
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // AE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // AF
+    {"LDIR", Z80_OPND_NONE, 21, 16, 0x3E},           // B0
+    {"CPIR", Z80_OPND_NONE, 21, 16, 0xFE},           // B1
+    {"INIR", Z80_OPND_NONE, 21, 16, 0xFF},           // B2
+    {"OTIR", Z80_OPND_NONE, 21, 16, 0xFF},           // B3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // B4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // B5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // B6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // B7
+    {"LDDR", Z80_OPND_NONE, 21, 16, 0x3E},           // B8
+    {"CPDR", Z80_OPND_NONE, 21, 16, 0xFE},           // B9
+    {"INDR", Z80_OPND_NONE, 21, 16, 0xFF},           // BA
+    {"OTDR", Z80_OPND_NONE, 21, 16, 0xFF},           // BB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // BC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // BD
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // BE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // BF
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C0
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C1
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C2
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C7
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C8
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // C9
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CA
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CD
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // CF
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D0
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D1
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D2
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D7
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D8
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // D9
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DA
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DD
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // DF
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E0
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E1
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E2
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E7
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E8
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // E9
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // EA
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // EB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // EC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // ED
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // EE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // EF
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F0
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F1
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F2
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F3
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F4
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F5
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F6
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F7
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F8
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // F9
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FA
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FB
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FC
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FD
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FE
+    {nullptr, Z80_OPND_NONE, 8, 8, 0x00},            // FF
+};
+
+// DD and FD prefixes, XY standing for IX or IY. Opcodes that do not involve
+// HL run as unprefixed, 4 T-states later; DD, ED and FD after the prefix
+// cancel it (nullptr).
+inline constexpr Z80_OpMeta z80_index_meta[256] = {
+    {"NOP", Z80_OPND_NONE, 8, 8, 0x00},              // 00
+    {"LD BC,nn", Z80_OPND_NN, 14, 14, 0x00},         // 01
+    {"LD (BC),A", Z80_OPND_NONE, 11, 11, 0x00},      // 02
+    {"INC BC", Z80_OPND_NONE, 10, 10, 0x00},         // 03
+    {"INC B", Z80_OPND_NONE, 8, 8, 0xFE},            // 04
+    {"DEC B", Z80_OPND_NONE, 8, 8, 0xFE},            // 05
+    {"LD B,n", Z80_OPND_N, 11, 11, 0x00},            // 06
+    {"RLCA", Z80_OPND_NONE, 8, 8, 0x3B},             // 07
+    {"EX AF,AF'", Z80_OPND_NONE, 8, 8, 0xFF},        // 08
+    {"ADD XY,BC", Z80_OPND_NONE, 15, 15, 0x3B},      // 09
+    {"LD A,(BC)", Z80_OPND_NONE, 11, 11, 0x00},      // 0A
+    {"DEC BC", Z80_OPND_NONE, 10, 10, 0x00},         // 0B
+    {"INC C", Z80_OPND_NONE, 8, 8, 0xFE},            // 0C
+    {"DEC C", Z80_OPND_NONE, 8, 8, 0xFE},            // 0D
+    {"LD C,n", Z80_OPND_N, 11, 11, 0x00},            // 0E
+    {"RRCA", Z80_OPND_NONE, 8, 8, 0x3B},             // 0F
+    {"DJNZ e", Z80_OPND_E, 17, 12, 0x00},            // 10
+    {"LD DE,nn", Z80_OPND_NN, 14, 14, 0x00},         // 11
+    {"LD (DE),A", Z80_OPND_NONE, 11, 11, 0x00},      // 12
+    {"INC DE", Z80_OPND_NONE, 10, 10, 0x00},         // 13
+    {"INC D", Z80_OPND_NONE, 8, 8, 0xFE},            // 14
+    {"DEC D", Z80_OPND_NONE, 8, 8, 0xFE},            // 15
+    {"LD D,n", Z80_OPND_N, 11, 11, 0x00},            // 16
+    {"RLA", Z80_OPND_NONE, 8, 8, 0x3B},              // 17
+    {"JR e", Z80_OPND_E, 16, 16, 0x00},              // 18
+    {"ADD XY,DE", Z80_OPND_NONE, 15, 15, 0x3B},      // 19
+    {"LD A,(DE)", Z80_OPND_NONE, 11, 11, 0x00},      // 1A
+    {"DEC DE", Z80_OPND_NONE, 10, 10, 0x00},         // 1B
+    {"INC E", Z80_OPND_NONE, 8, 8, 0xFE},            // 1C
+    {"DEC E", Z80_OPND_NONE, 8, 8, 0xFE},            // 1D
+    {"LD E,n", Z80_OPND_N, 11, 11, 0x00},            // 1E
+    {"RRA", Z80_OPND_NONE, 8, 8, 0x3B},              // 1F
+    {"JR NZ,e", Z80_OPND_E, 16, 11, 0x00},           // 20
+    {"LD XY,nn", Z80_OPND_NN, 14, 14, 0x00},         // 21
+    {"LD (nn),XY", Z80_OPND_NN, 20, 20, 0x00},       // 22
+    {"INC XY", Z80_OPND_NONE, 10, 10, 0x00},         // 23
+    {"INC XYH", Z80_OPND_NONE, 8, 8, 0xFE},          // 24
+    {"DEC XYH", Z80_OPND_NONE, 8, 8, 0xFE},          // 25
+    {"LD XYH,n", Z80_OPND_N, 11, 11, 0x00},          // 26
+    {"DAA", Z80_OPND_NONE, 8, 8, 0xFD},              // 27
+    {"JR Z,e", Z80_OPND_E, 16, 11, 0x00},            // 28
+    {"ADD XY,XY", Z80_OPND_NONE, 15, 15, 0x3B},      // 29
+    {"LD XY,(nn)", Z80_OPND_NN, 20, 20, 0x00},       // 2A
+    {"DEC XY", Z80_OPND_NONE, 10, 10, 0x00},         // 2B
+    {"INC XYL", Z80_OPND_NONE, 8, 8, 0xFE},          // 2C
+    {"DEC XYL", Z80_OPND_NONE, 8, 8, 0xFE},          // 2D
+    {"LD XYL,n", Z80_OPND_N, 11, 11, 0x00},          // 2E
+    {"CPL", Z80_OPND_NONE, 8, 8, 0x3A},              // 2F
+    {"JR NC,e", Z80_OPND_E, 16, 11, 0x00},           // 30
+    {"LD SP,nn", Z80_OPND_NN, 14, 14, 0x00},         // 31
+    {"LD (nn),A", Z80_OPND_NN, 17, 17, 0x00},        // 32
+    {"INC SP", Z80_OPND_NONE, 10, 10, 0x00},         // 33
+    {"INC (XY+d)", Z80_OPND_D, 23, 23, 0xFE},        // 34
+    {"DEC (XY+d)", Z80_OPND_D, 23, 23, 0xFE},        // 35
+    {"LD (XY+d),n", Z80_OPND_D_N, 19, 19, 0x00},     // 36
+    {"SCF", Z80_OPND_NONE, 8, 8, 0x3B},              // 37
+    {"JR C,e", Z80_OPND_E, 16, 11, 0x00},            // 38
+    {"ADD XY,SP", Z80_OPND_NONE, 15, 15, 0x3B},      // 39
+    {"LD A,(nn)", Z80_OPND_NN, 17, 17, 0x00},        // 3A
+    {"DEC SP", Z80_OPND_NONE, 10, 10, 0x00},         // 3B
+    {"INC A", Z80_OPND_NONE, 8, 8, 0xFE},            // 3C
+    {"DEC A", Z80_OPND_NONE, 8, 8, 0xFE},            // 3D
+    {"LD A,n", Z80_OPND_N, 11, 11, 0x00},            // 3E
+    {"CCF", Z80_OPND_NONE, 8, 8, 0x3B},              // 3F
+    {"LD B,B", Z80_OPND_NONE, 8, 8, 0x00},           // 40
+    {"LD B,C", Z80_OPND_NONE, 8, 8, 0x00},           // 41
+    {"LD B,D", Z80_OPND_NONE, 8, 8, 0x00},           // 42
+    {"LD B,E", Z80_OPND_NONE, 8, 8, 0x00},           // 43
+    {"LD B,XYH", Z80_OPND_NONE, 8, 8, 0x00},         // 44
+    {"LD B,XYL", Z80_OPND_NONE, 8, 8, 0x00},         // 45
+    {"LD B,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 46
+    {"LD B,A", Z80_OPND_NONE, 8, 8, 0x00},           // 47
+    {"LD C,B", Z80_OPND_NONE, 8, 8, 0x00},           // 48
+    {"LD C,C", Z80_OPND_NONE, 8, 8, 0x00},           // 49
+    {"LD C,D", Z80_OPND_NONE, 8, 8, 0x00},           // 4A
+    {"LD C,E", Z80_OPND_NONE, 8, 8, 0x00},           // 4B
+    {"LD C,XYH", Z80_OPND_NONE, 8, 8, 0x00},         // 4C
+    {"LD C,XYL", Z80_OPND_NONE, 8, 8, 0x00},         // 4D
+    {"LD C,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 4E
+    {"LD C,A", Z80_OPND_NONE, 8, 8, 0x00},           // 4F
+    {"LD D,B", Z80_OPND_NONE, 8, 8, 0x00},           // 50
+    {"LD D,C", Z80_OPND_NONE, 8, 8, 0x00},           // 51
+    {"LD D,D", Z80_OPND_NONE, 8, 8, 0x00},           // 52
+    {"LD D,E", Z80_OPND_NONE, 8, 8, 0x00},           // 53
+    {"LD D,XYH", Z80_OPND_NONE, 8, 8, 0x00},         // 54
+    {"LD D,XYL", Z80_OPND_NONE, 8, 8, 0x00},         // 55
+    {"LD D,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 56
+    {"LD D,A", Z80_OPND_NONE, 8, 8, 0x00},           // 57
+    {"LD E,B", Z80_OPND_NONE, 8, 8, 0x00},           // 58
+    {"LD E,C", Z80_OPND_NONE, 8, 8, 0x00},           // 59
+    {"LD E,D", Z80_OPND_NONE, 8, 8, 0x00},           // 5A
+    {"LD E,E", Z80_OPND_NONE, 8, 8, 0x00},           // 5B
+    {"LD E,XYH", Z80_OPND_NONE, 8, 8, 0x00},         // 5C
+    {"LD E,XYL", Z80_OPND_NONE, 8, 8, 0x00},         // 5D
+    {"LD E,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 5E
+    {"LD E,A", Z80_OPND_NONE, 8, 8, 0x00},           // 5F
+    {"LD XYH,B", Z80_OPND_NONE, 8, 8, 0x00},         // 60
+    {"LD XYH,C", Z80_OPND_NONE, 8, 8, 0x00},         // 61
+    {"LD XYH,D", Z80_OPND_NONE, 8, 8, 0x00},         // 62
+    {"LD XYH,E", Z80_OPND_NONE, 8, 8, 0x00},         // 63
+    {"LD XYH,XYH", Z80_OPND_NONE, 8, 8, 0x00},       // 64
+    {"LD XYH,XYL", Z80_OPND_NONE, 8, 8, 0x00},       // 65
+    {"LD H,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 66
+    {"LD XYH,A", Z80_OPND_NONE, 8, 8, 0x00},         // 67
+    {"LD XYL,B", Z80_OPND_NONE, 8, 8, 0x00},         // 68
+    {"LD XYL,C", Z80_OPND_NONE, 8, 8, 0x00},         // 69
+    {"LD XYL,D", Z80_OPND_NONE, 8, 8, 0x00},         // 6A
+    {"LD XYL,E", Z80_OPND_NONE, 8, 8, 0x00},         // 6B
+    {"LD XYL,XYH", Z80_OPND_NONE, 8, 8, 0x00},       // 6C
+    {"LD XYL,XYL", Z80_OPND_NONE, 8, 8, 0x00},       // 6D
+    {"LD L,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 6E
+    {"LD XYL,A", Z80_OPND_NONE, 8, 8, 0x00},         // 6F
+    {"LD (XY+d),B", Z80_OPND_D, 19, 19, 0x00},       // 70
+    {"LD (XY+d),C", Z80_OPND_D, 19, 19, 0x00},       // 71
+    {"LD (XY+d),D", Z80_OPND_D, 19, 19, 0x00},       // 72
+    {"LD (XY+d),E", Z80_OPND_D, 19, 19, 0x00},       // 73
+    {"LD (XY+d),H", Z80_OPND_D, 19, 19, 0x00},       // 74
+    {"LD (XY+d),L", Z80_OPND_D, 19, 19, 0x00},       // 75
+    {"HALT", Z80_OPND_NONE, 8, 8, 0x00},             // 76
+    {"LD (XY+d),A", Z80_OPND_D, 19, 19, 0x00},       // 77
+    {"LD A,B", Z80_OPND_NONE, 8, 8, 0x00},           // 78
+    {"LD A,C", Z80_OPND_NONE, 8, 8, 0x00},           // 79
+    {"LD A,D", Z80_OPND_NONE, 8, 8, 0x00},           // 7A
+    {"LD A,E", Z80_OPND_NONE, 8, 8, 0x00},           // 7B
+    {"LD A,XYH", Z80_OPND_NONE, 8, 8, 0x00},         // 7C
+    {"LD A,XYL", Z80_OPND_NONE, 8, 8, 0x00},         // 7D
+    {"LD A,(XY+d)", Z80_OPND_D, 19, 19, 0x00},       // 7E
+    {"LD A,A", Z80_OPND_NONE, 8, 8, 0x00},           // 7F
+    {"ADD A,B", Z80_OPND_NONE, 8, 8, 0xFF},          // 80
+    {"ADD A,C", Z80_OPND_NONE, 8, 8, 0xFF},          // 81
+    {"ADD A,D", Z80_OPND_NONE, 8, 8, 0xFF},          // 82
+    {"ADD A,E", Z80_OPND_NONE, 8, 8, 0xFF},          // 83
+    {"ADD A,XYH", Z80_OPND_NONE, 8, 8, 0xFF},        // 84
+    {"ADD A,XYL", Z80_OPND_NONE, 8, 8, 0xFF},        // 85
+    {"ADD A,(XY+d)", Z80_OPND_D, 19, 19, 0xFF},      // 86
+    {"ADD A,A", Z80_OPND_NONE, 8, 8, 0xFF},          // 87
+    {"ADC A,B", Z80_OPND_NONE, 8, 8, 0xFF},          // 88
+    {"ADC A,C", Z80_OPND_NONE, 8, 8, 0xFF},          // 89
+    {"ADC A,D", Z80_OPND_NONE, 8, 8, 0xFF},          // 8A
+    {"ADC A,E", Z80_OPND_NONE, 8, 8, 0xFF},          // 8B
+    {"ADC A,XYH", Z80_OPND_NONE, 8, 8, 0xFF},        // 8C
+    {"ADC A,XYL", Z80_OPND_NONE, 8, 8, 0xFF},        // 8D
+    {"ADC A,(XY+d)", Z80_OPND_D, 19, 19, 0xFF},      // 8E
+    {"ADC A,A", Z80_OPND_NONE, 8, 8, 0xFF},          // 8F
+    {"SUB B", Z80_OPND_NONE, 8, 8, 0xFF},            // 90
+    {"SUB C", Z80_OPND_NONE, 8, 8, 0xFF},            // 91
+    {"SUB D", Z80_OPND_NONE, 8, 8, 0xFF},            // 92
+    {"SUB E", Z80_OPND_NONE, 8, 8, 0xFF},            // 93
+    {"SUB XYH", Z80_OPND_NONE, 8, 8, 0xFF},          // 94
+    {"SUB XYL", Z80_OPND_NONE, 8, 8, 0xFF},          // 95
+    {"SUB (XY+d)", Z80_OPND_D, 19, 19, 0xFF},        // 96
+    {"SUB A", Z80_OPND_NONE, 8, 8, 0xFF},            // 97
+    {"SBC A,B", Z80_OPND_NONE, 8, 8, 0xFF},          // 98
+    {"SBC A,C", Z80_OPND_NONE, 8, 8, 0xFF},          // 99
+    {"SBC A,D", Z80_OPND_NONE, 8, 8, 0xFF},          // 9A
+    {"SBC A,E", Z80_OPND_NONE, 8, 8, 0xFF},          // 9B
+    {"SBC A,XYH", Z80_OPND_NONE, 8, 8, 0xFF},        // 9C
+    {"SBC A,XYL", Z80_OPND_NONE, 8, 8, 0xFF},        // 9D
+    {"SBC A,(XY+d)", Z80_OPND_D, 19, 19, 0xFF},      // 9E
+    {"SBC A,A", Z80_OPND_NONE, 8, 8, 0xFF},          // 9F
+    {"AND B", Z80_OPND_NONE, 8, 8, 0xFF},            // A0
+    {"AND C", Z80_OPND_NONE, 8, 8, 0xFF},            // A1
+    {"AND D", Z80_OPND_NONE, 8, 8, 0xFF},            // A2
+    {"AND E", Z80_OPND_NONE, 8, 8, 0xFF},            // A3
+    {"AND XYH", Z80_OPND_NONE, 8, 8, 0xFF},          // A4
+    {"AND XYL", Z80_OPND_NONE, 8, 8, 0xFF},          // A5
+    {"AND (XY+d)", Z80_OPND_D, 19, 19, 0xFF},        // A6
+    {"AND A", Z80_OPND_NONE, 8, 8, 0xFF},            // A7
+    {"XOR B", Z80_OPND_NONE, 8, 8, 0xFF},            // A8
+    {"XOR C", Z80_OPND_NONE, 8, 8, 0xFF},            // A9
+    {"XOR D", Z80_OPND_NONE, 8, 8, 0xFF},            // AA
+    {"XOR E", Z80_OPND_NONE, 8, 8, 0xFF},            // AB
+    {"XOR XYH", Z80_OPND_NONE, 8, 8, 0xFF},          // AC
+    {"XOR XYL", Z80_OPND_NONE, 8, 8, 0xFF},          // AD
+    {"XOR (XY+d)", Z80_OPND_D, 19, 19, 0xFF},        // AE
+    {"XOR A", Z80_OPND_NONE, 8, 8, 0xFF},            // AF
+    {"OR B", Z80_OPND_NONE, 8, 8, 0xFF},             // B0
+    {"OR C", Z80_OPND_NONE, 8, 8, 0xFF},             // B1
+    {"OR D", Z80_OPND_NONE, 8, 8, 0xFF},             // B2
+    {"OR E", Z80_OPND_NONE, 8, 8, 0xFF},             // B3
+    {"OR XYH", Z80_OPND_NONE, 8, 8, 0xFF},           // B4
+    {"OR XYL", Z80_OPND_NONE, 8, 8, 0xFF},           // B5
+    {"OR (XY+d)", Z80_OPND_D, 19, 19, 0xFF},         // B6
+    {"OR A", Z80_OPND_NONE, 8, 8, 0xFF},             // B7
+    {"CP B", Z80_OPND_NONE, 8, 8, 0xFF},             // B8
+    {"CP C", Z80_OPND_NONE, 8, 8, 0xFF},             // B9
+    {"CP D", Z80_OPND_NONE, 8, 8, 0xFF},             // BA
+    {"CP E", Z80_OPND_NONE, 8, 8, 0xFF},             // BB
+    {"CP XYH", Z80_OPND_NONE, 8, 8, 0xFF},           // BC
+    {"CP XYL", Z80_OPND_NONE, 8, 8, 0xFF},           // BD
+    {"CP (XY+d)", Z80_OPND_D, 19, 19, 0xFF},         // BE
+    {"CP A", Z80_OPND_NONE, 8, 8, 0xFF},             // BF
+    {"RET NZ", Z80_OPND_NONE, 15, 9, 0x00},          // C0
+    {"POP BC", Z80_OPND_NONE, 14, 14, 0x00},         // C1
+    {"JP NZ,nn", Z80_OPND_NN, 14, 14, 0x00},         // C2
+    {"JP nn", Z80_OPND_NN, 14, 14, 0x00},            // C3
+    {"CALL NZ,nn", Z80_OPND_NN, 21, 14, 0x00},       // C4
+    {"PUSH BC", Z80_OPND_NONE, 15, 15, 0x00},        // C5
+    {"ADD A,n", Z80_OPND_N, 11, 11, 0xFF},           // C6
+    {"RST 00h", Z80_OPND_NONE, 15, 15, 0x00},        // C7
+    {"RET Z", Z80_OPND_NONE, 15, 9, 0x00},           // C8
+    {"RET", Z80_OPND_NONE, 14, 14, 0x00},            // C9
+    {"JP Z,nn", Z80_OPND_NN, 14, 14, 0x00},          // CA
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // CB
+    {"CALL Z,nn", Z80_OPND_NN, 21, 14, 0x00},        // CC
+    {"CALL nn", Z80_OPND_NN, 21, 21, 0x00},          // CD
+    {"ADC A,n", Z80_OPND_N, 11, 11, 0xFF},           // CE
+    {"RST 08h", Z80_OPND_NONE, 15, 15, 0x00},        // CF
+    {"RET NC", Z80_OPND_NONE, 15, 9, 0x00},          // D0
+    {"POP DE", Z80_OPND_NONE, 14, 14, 0x00},         // D1
+    {"JP NC,nn", Z80_OPND_NN, 14, 14, 0x00},         // D2
+    {"OUT (n),A", Z80_OPND_N, 15, 15, 0x00},         // D3
+    {"CALL NC,nn", Z80_OPND_NN, 21, 14, 0x00},       // D4
+    {"PUSH DE", Z80_OPND_NONE, 15, 15, 0x00},        // D5
+    {"SUB n", Z80_OPND_N, 11, 11, 0xFF},             // D6
+    {"RST 10h", Z80_OPND_NONE, 15, 15, 0x00},        // D7
+    {"RET C", Z80_OPND_NONE, 15, 9, 0x00},           // D8
+    {"EXX", Z80_OPND_NONE, 8, 8, 0x00},              // D9
+    {"JP C,nn", Z80_OPND_NN, 14, 14, 0x00},          // DA
+    {"IN A,(n)", Z80_OPND_N, 15, 15, 0x00},          // DB
+    {"CALL C,nn", Z80_OPND_NN, 21, 14, 0x00},        // DC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // DD
+    {"SBC A,n", Z80_OPND_N, 11, 11, 0xFF},           // DE
+    {"RST 18h", Z80_OPND_NONE, 15, 15, 0x00},        // DF
+    {"RET PO", Z80_OPND_NONE, 15, 9, 0x00},          // E0
+    {"POP XY", Z80_OPND_NONE, 14, 14, 0x00},         // E1
+    {"JP PO,nn", Z80_OPND_NN, 14, 14, 0x00},         // E2
+    {"EX (SP),XY", Z80_OPND_NONE, 23, 23, 0x00},     // E3
+    {"CALL PO,nn", Z80_OPND_NN, 21, 14, 0x00},       // E4
+    {"PUSH XY", Z80_OPND_NONE, 15, 15, 0x00},        // E5
+    {"AND n", Z80_OPND_N, 11, 11, 0xFF},             // E6
+    {"RST 20h", Z80_OPND_NONE, 15, 15, 0x00},        // E7
+    {"RET PE", Z80_OPND_NONE, 15, 9, 0x00},          // E8
+    {"JP (XY)", Z80_OPND_NONE, 8, 8, 0x00},          // E9
+    {"JP PE,nn", Z80_OPND_NN, 14, 14, 0x00},         // EA
+    {"EX DE,HL", Z80_OPND_NONE, 8, 8, 0x00},         // EB
+    {"CALL PE,nn", Z80_OPND_NN, 21, 14, 0x00},       // EC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // ED
+    {"XOR n", Z80_OPND_N, 11, 11, 0xFF},             // EE
+    {"RST 28h", Z80_OPND_NONE, 15, 15, 0x00},        // EF
+    {"RET P", Z80_OPND_NONE, 15, 9, 0x00},           // F0
+    {"POP AF", Z80_OPND_NONE, 14, 14, 0xFF},         // F1
+    {"JP P,nn", Z80_OPND_NN, 14, 14, 0x00},          // F2
+    {"DI", Z80_OPND_NONE, 8, 8, 0x00},               // F3
+    {"CALL P,nn", Z80_OPND_NN, 21, 14, 0x00},        // F4
+    {"PUSH AF", Z80_OPND_NONE, 15, 15, 0x00},        // F5
+    {"OR n", Z80_OPND_N, 11, 11, 0xFF},              // F6
+    {"RST 30h", Z80_OPND_NONE, 15, 15, 0x00},        // F7
+    {"RET M", Z80_OPND_NONE, 15, 9, 0x00},           // F8
+    {"LD SP,XY", Z80_OPND_NONE, 10, 10, 0x00},       // F9
+    {"JP M,nn", Z80_OPND_NN, 14, 14, 0x00},          // FA
+    {"EI", Z80_OPND_NONE, 8, 8, 0x00},               // FB
+    {"CALL M,nn", Z80_OPND_NN, 21, 14, 0x00},        // FC
+    {nullptr, Z80_OPND_NONE, 4, 4, 0x00},            // FD
+    {"CP n", Z80_OPND_N, 11, 11, 0xFF},              // FE
+    {"RST 38h", Z80_OPND_NONE, 15, 15, 0x00},        // FF
+};
+
+// DD CB d and FD CB d. Forms with a register after (XY+d) also copy the
+// result into it.
+inline constexpr Z80_OpMeta z80_index_cb_meta[256] = {
+    {"RLC (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 00
+    {"RLC (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 01
+    {"RLC (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 02
+    {"RLC (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 03
+    {"RLC (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 04
+    {"RLC (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 05
+    {"RLC (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 06
+    {"RLC (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 07
+    {"RRC (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 08
+    {"RRC (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 09
+    {"RRC (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 0A
+    {"RRC (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 0B
+    {"RRC (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 0C
+    {"RRC (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 0D
+    {"RRC (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 0E
+    {"RRC (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 0F
+    {"RL (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},    // 10
+    {"RL (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},    // 11
+    {"RL (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},    // 12
+    {"RL (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},    // 13
+    {"RL (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},    // 14
+    {"RL (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},    // 15
+    {"RL (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},      // 16
+    {"RL (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},    // 17
+    {"RR (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},    // 18
+    {"RR (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},    // 19
+    {"RR (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},    // 1A
+    {"RR (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},    // 1B
+    {"RR (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},    // 1C
+    {"RR (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},    // 1D
+    {"RR (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},      // 1E
+    {"RR (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},    // 1F
+    {"SLA (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 20
+    {"SLA (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 21
+    {"SLA (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 22
+    {"SLA (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 23
+    {"SLA (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 24
+    {"SLA (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 25
+    {"SLA (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 26
+    {"SLA (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 27
+    {"SRA (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 28
+    {"SRA (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 29
+    {"SRA (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 2A
+    {"SRA (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 2B
+    {"SRA (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 2C
+    {"SRA (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 2D
+    {"SRA (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 2E
+    {"SRA (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 2F
+    {"SLL (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 30
+    {"SLL (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 31
+    {"SLL (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 32
+    {"SLL (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 33
+    {"SLL (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 34
+    {"SLL (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 35
+    {"SLL (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 36
+    {"SLL (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 37
+    {"SRL (XY+d),B", Z80_OPND_CB_D, 23, 23, 0xFF},   // 38
+    {"SRL (XY+d),C", Z80_OPND_CB_D, 23, 23, 0xFF},   // 39
+    {"SRL (XY+d),D", Z80_OPND_CB_D, 23, 23, 0xFF},   // 3A
+    {"SRL (XY+d),E", Z80_OPND_CB_D, 23, 23, 0xFF},   // 3B
+    {"SRL (XY+d),H", Z80_OPND_CB_D, 23, 23, 0xFF},   // 3C
+    {"SRL (XY+d),L", Z80_OPND_CB_D, 23, 23, 0xFF},   // 3D
+    {"SRL (XY+d)", Z80_OPND_CB_D, 23, 23, 0xFF},     // 3E
+    {"SRL (XY+d),A", Z80_OPND_CB_D, 23, 23, 0xFF},   // 3F
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 40
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 41
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 42
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 43
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 44
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 45
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 46
+    {"BIT 0,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 47
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 48
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 49
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4A
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4B
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4C
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4D
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4E
+    {"BIT 1,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 4F
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 50
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 51
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 52
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 53
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 54
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 55
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 56
+    {"BIT 2,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 57
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 58
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 59
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5A
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5B
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5C
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5D
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5E
+    {"BIT 3,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 5F
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 60
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 61
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 62
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 63
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 64
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 65
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 66
+    {"BIT 4,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 67
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 68
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 69
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6A
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6B
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6C
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6D
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6E
+    {"BIT 5,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 6F
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 70
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 71
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 72
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 73
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 74
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 75
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 76
+    {"BIT 6,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 77
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 78
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 79
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7A
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7B
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7C
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7D
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7E
+    {"BIT 7,(XY+d)", Z80_OPND_CB_D, 20, 20, 0xFE},   // 7F
+    {"RES 0,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // 80
+    {"RES 0,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // 81
+    {"RES 0,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // 82
+    {"RES 0,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // 83
+    {"RES 0,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // 84
+    {"RES 0,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // 85
+    {"RES 0,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // 86
+    {"RES 0,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // 87
+    {"RES 1,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // 88
+    {"RES 1,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // 89
+    {"RES 1,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // 8A
+    {"RES 1,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // 8B
+    {"RES 1,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // 8C
+    {"RES 1,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // 8D
+    {"RES 1,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // 8E
+    {"RES 1,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // 8F
+    {"RES 2,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // 90
+    {"RES 2,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // 91
+    {"RES 2,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // 92
+    {"RES 2,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // 93
+    {"RES 2,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // 94
+    {"RES 2,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // 95
+    {"RES 2,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // 96
+    {"RES 2,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // 97
+    {"RES 3,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // 98
+    {"RES 3,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // 99
+    {"RES 3,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // 9A
+    {"RES 3,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // 9B
+    {"RES 3,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // 9C
+    {"RES 3,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // 9D
+    {"RES 3,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // 9E
+    {"RES 3,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // 9F
+    {"RES 4,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // A0
+    {"RES 4,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // A1
+    {"RES 4,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // A2
+    {"RES 4,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // A3
+    {"RES 4,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // A4
+    {"RES 4,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // A5
+    {"RES 4,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // A6
+    {"RES 4,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // A7
+    {"RES 5,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // A8
+    {"RES 5,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // A9
+    {"RES 5,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // AA
+    {"RES 5,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // AB
+    {"RES 5,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // AC
+    {"RES 5,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // AD
+    {"RES 5,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // AE
+    {"RES 5,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // AF
+    {"RES 6,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // B0
+    {"RES 6,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // B1
+    {"RES 6,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // B2
+    {"RES 6,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // B3
+    {"RES 6,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // B4
+    {"RES 6,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // B5
+    {"RES 6,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // B6
+    {"RES 6,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // B7
+    {"RES 7,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // B8
+    {"RES 7,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // B9
+    {"RES 7,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // BA
+    {"RES 7,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // BB
+    {"RES 7,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // BC
+    {"RES 7,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // BD
+    {"RES 7,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // BE
+    {"RES 7,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // BF
+    {"SET 0,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // C0
+    {"SET 0,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // C1
+    {"SET 0,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // C2
+    {"SET 0,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // C3
+    {"SET 0,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // C4
+    {"SET 0,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // C5
+    {"SET 0,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // C6
+    {"SET 0,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // C7
+    {"SET 1,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // C8
+    {"SET 1,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // C9
+    {"SET 1,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // CA
+    {"SET 1,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // CB
+    {"SET 1,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // CC
+    {"SET 1,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // CD
+    {"SET 1,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // CE
+    {"SET 1,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // CF
+    {"SET 2,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // D0
+    {"SET 2,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // D1
+    {"SET 2,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // D2
+    {"SET 2,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // D3
+    {"SET 2,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // D4
+    {"SET 2,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // D5
+    {"SET 2,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // D6
+    {"SET 2,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // D7
+    {"SET 3,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // D8
+    {"SET 3,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // D9
+    {"SET 3,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // DA
+    {"SET 3,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // DB
+    {"SET 3,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // DC
+    {"SET 3,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // DD
+    {"SET 3,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // DE
+    {"SET 3,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // DF
+    {"SET 4,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // E0
+    {"SET 4,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // E1
+    {"SET 4,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // E2
+    {"SET 4,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // E3
+    {"SET 4,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // E4
+    {"SET 4,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // E5
+    {"SET 4,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // E6
+    {"SET 4,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // E7
+    {"SET 5,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // E8
+    {"SET 5,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // E9
+    {"SET 5,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // EA
+    {"SET 5,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // EB
+    {"SET 5,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // EC
+    {"SET 5,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // ED
+    {"SET 5,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // EE
+    {"SET 5,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // EF
+    {"SET 6,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // F0
+    {"SET 6,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // F1
+    {"SET 6,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // F2
+    {"SET 6,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // F3
+    {"SET 6,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // F4
+    {"SET 6,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // F5
+    {"SET 6,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // F6
+    {"SET 6,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // F7
+    {"SET 7,(XY+d),B", Z80_OPND_CB_D, 23, 23, 0x00}, // F8
+    {"SET 7,(XY+d),C", Z80_OPND_CB_D, 23, 23, 0x00}, // F9
+    {"SET 7,(XY+d),D", Z80_OPND_CB_D, 23, 23, 0x00}, // FA
+    {"SET 7,(XY+d),E", Z80_OPND_CB_D, 23, 23, 0x00}, // FB
+    {"SET 7,(XY+d),H", Z80_OPND_CB_D, 23, 23, 0x00}, // FC
+    {"SET 7,(XY+d),L", Z80_OPND_CB_D, 23, 23, 0x00}, // FD
+    {"SET 7,(XY+d)", Z80_OPND_CB_D, 23, 23, 0x00},   // FE
+    {"SET 7,(XY+d),A", Z80_OPND_CB_D, 23, 23, 0x00}, // FF
+};
+
+// Metadata for an opcode in one of the Z80_TABLE_* groups (z80.h)
+static constexpr const Z80_OpMeta &z80_op_meta(int table, uint8_t opcode)
+{
+    switch (table)
+    {
+    case 1: return z80_cb_meta[opcode];
+    case 2: return z80_ed_meta[opcode];
+    case 3:
+    case 4: return z80_index_meta[opcode];
+    case 5:
+    case 6: return z80_index_cb_meta[opcode];
+    default: return z80_base_meta[opcode];
+    }
+}
+
+#endif // Z80_OPMETA_H
@@ -0,0 +1,69 @@
+#include "z80_pool.h"
+#include "z80_trace.h"
+
+Z80Pool::Z80Pool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&Z80Pool::worker_loop, this);
+}
+
+Z80Pool::~Z80Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void Z80Pool::run(size_t jobs, const Task &job_task)
+{
+    if (jobs == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    task = &job_task;
+    count = jobs;
+    next.store(0);
+    busy = size();
+    batch++;
+    work_ready.notify_all();
+    work_done.wait(lock, [this] { return busy == 0; });
+    task = nullptr;
+}
+
+void Z80Pool::worker_loop()
+{
+    // 64KB of RAM per machine, so keep it off the thread stack
+    std::unique_ptr<Z80Machine> machine(new Z80Machine());
+    unsigned long long seen = 0;
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_ready.wait(lock, [&] { return stopping || batch != seen; });
+        if (stopping)
+            return;
+        seen = batch;
+        const Task &job_task = *task;
+        size_t jobs = count;
+        lock.unlock();
+
+        for (size_t i = next.fetch_add(1); i < jobs; i = next.fetch_add(1))
+        {
+            job_task(i, *machine);
+            z80_trace_flush();
+        }
+
+        lock.lock();
+        if (--busy == 0)
+            work_done.notify_one();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef Z80_POOL_H
+#define Z80_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "z80.h"
+
+// Fixed pool of worker threads, each owning one reusable Z80Machine.
+// run() hands out job indices to whichever worker is free, so thousands of
+// short programs run without a process or a machine allocation per job.
+class Z80Pool
+{
+public:
+    typedef std::function<void(size_t index, Z80Machine &machine)> Task;
+
+    // Start the workers. 0 threads means one per hardware thread.
+    explicit Z80Pool(unsigned threads = 0);
+    ~Z80Pool();
+
+    Z80Pool(const Z80Pool &) = delete;
+    Z80Pool &operator=(const Z80Pool &) = delete;
+
+    // Call task(i, machine) for every i in [0, count) and wait for all of them
+    void run(size_t count, const Task &task);
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready; // New batch posted or shutting down
+    std::condition_variable work_done;  // Last worker left the batch
+
+    const Task *task = nullptr;     // Current batch
+    size_t count = 0;               // Jobs in the current batch
+    std::atomic<size_t> next{0};    // Next job index to hand out
+    unsigned busy = 0;              // Workers still inside the batch
+    unsigned long long batch = 0;   // Incremented for every run()
+    bool stopping = false;
+};
+
+#endif // Z80_POOL_H
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "z80_profile.h"
+#include "z80_disasm.h"
+
+static const char *const table_prefixes[Z80_TABLE_COUNT] = {"", "CB ", "ED ", "DD ", "FD ", "DD CB d ", "FD CB d "};
+
+struct Z80_ProfileRow
+{
+    unsigned key; // Table << 8 | opcode, or an address
+    uint64_t count;
+    uint64_t cycles;
+};
+
+// Rows with any executions, hottest (by T-states) first, at most top of them
+static std::vector<Z80_ProfileRow> hottest(const uint64_t *count, const uint64_t *cycles, unsigned size, size_t top)
+{
+    std::vector<Z80_ProfileRow> rows;
+    for (unsigned key = 0; key < size; key++)
+        if (count[key] != 0)
+            rows.push_back({key, count[key], cycles[key]});
+    size_t shown = std::min(top, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + shown, rows.end(),
+                      [](const Z80_ProfileRow &x, const Z80_ProfileRow &y) {
+                          return x.cycles != y.cycles ? x.cycles > y.cycles : x.key < y.key;
+                      });
+    rows.resize(shown);
+    return rows;
+}
+
+void z80_profile_report(std::ostream &out, const Z80_Profile &profile, size_t top, const Z80Machine *code)
+{
+    uint64_t total_count = 0, total_cycles = 0;
+    for (int table = 0; table < Z80_TABLE_COUNT; table++)
+    {
+        for (int opcode = 0; opcode < 256; opcode++)
+        {
+            total_count += profile.op_count[table][opcode];
+            total_cycles += profile.op_cycles[table][opcode];
+        }
+    }
+    double scale = total_cycles != 0 ? 100.0 / total_cycles : 0;
+    char line[160];
+
+    std::snprintf(line, sizeof(line), "Profile: %llu instructions, %llu T-states\n",
+                  static_cast<unsigned long long>(total_count), static_cast<unsigned long long>(total_cycles));
+    out << line << "Opcodes by T-states:\n            count         T-states       %  opcode\n";
+    for (const Z80_ProfileRow &row : hottest(&profile.op_count[0][0], &profile.op_cycles[0][0], Z80_TABLE_COUNT * 256, top))
+    {
+        std::snprintf(line, sizeof(line), "  %15llu  %15llu  %5.1f%%  %s%02X\n", static_cast<unsigned long long>(row.count),
+                      static_cast<unsigned long long>(row.cycles), row.cycles * scale, table_prefixes[row.key >> 8],
+                      row.key & 0xFF);
+        out << line;
+    }
+
+    out << "Hot spots by T-states:\n            count         T-states       %  address\n";
+    for (const Z80_ProfileRow &row : hottest(profile.pc_count, profile.pc_cycles, 65536, top))
+    {
+        int n = std::snprintf(line, sizeof(line), "  %15llu  %15llu  %5.1f%%  %04X", static_cast<unsigned long long>(row.count),
+                              static_cast<unsigned long long>(row.cycles), row.cycles * scale, row.key);
+        if (code != nullptr)
+        {
+            std::string text;
+            int length = z80_disasm(*code, static_cast<uint16_t>(row.key), text);
+            n += std::snprintf(line + n, sizeof(line) - n, ":");
+            for (int k = 0; k < Z80_INSN_MAX_BYTES; k++)
+            {
+                uint8_t byte = code->peek(static_cast<uint16_t>(row.key + k));
+                n += k < length ? std::snprintf(line + n, sizeof(line) - n, " %02X", byte)
+                                : std::snprintf(line + n, sizeof(line) - n, "   ");
+            }
+            n += std::snprintf(line + n, sizeof(line) - n, "  %s", text.c_str());
+        }
+        out << line << "\n";
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef Z80_PROFILE_H
+#define Z80_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "z80.h"
+
+// Build with -DZ80_PROFILE=1 to compile the profiler into the execute loop.
+// Without it Z80_PROFILE_INSN is empty and the loop is unchanged.
+#ifndef Z80_PROFILE
+#define Z80_PROFILE 0
+#endif
+
+#define Z80_PROFILE_TOP 20 // Default rows per report section
+
+// Executions and T-states per opcode (one row per prefix table, indexed by
+// Z80_Insn::table) and per instruction address
+struct Z80_Profile
+{
+    uint64_t op_count[Z80_TABLE_COUNT][256];
+    uint64_t op_cycles[Z80_TABLE_COUNT][256];
+    uint64_t pc_count[65536];
+    uint64_t pc_cycles[65536];
+
+    void record(uint16_t pc, const Z80_Insn &insn, int cycles)
+    {
+        op_count[insn.table][insn.opcode]++;
+        op_cycles[insn.table][insn.opcode] += cycles;
+        pc_count[pc]++;
+        pc_cycles[pc] += cycles;
+    }
+};
+
+#if Z80_PROFILE
+#define Z80_PROFILE_INSN(profile, pc, insn, cycles)   \
+    do                                                \
+    {                                                 \
+        if (profile)                                  \
+            (profile)->record(pc, insn, cycles);      \
+    } while (0)
+#else
+#define Z80_PROFILE_INSN(profile, pc, insn, cycles) \
+    do                                              \
+    {                                               \
+        (void)(pc); /* Only the profiler uses it */ \
+    } while (0)
+#endif
+
+// Print the top opcodes and the top addresses by T-states. With a machine,
+// each hot address is followed by the instruction found there, as bytes
+// and disassembled.
+void z80_profile_report(std::ostream &out, const Z80_Profile &profile, size_t top = Z80_PROFILE_TOP,
+                        const Z80Machine *code = nullptr);
+
+#endif // Z80_PROFILE_H
@@ -0,0 +1,833 @@
+#include <utility>
+#include "z80_flags.h" // FLAG_* bit positions only
+#include "z80_ref.h"
+
+// S and Z from an 8-bit result, plus the undocumented copies of bits 5 and 3
+static uint8_t sign_zero_xy(uint8_t value)
+{
+    return (value & FLAG_S) | (value == 0 ? FLAG_Z : 0) | (value & (FLAG_Y | FLAG_X));
+}
+
+static uint8_t parity(uint8_t value)
+{
+    int bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits += (value >> i) & 1;
+    return bits % 2 == 0 ? FLAG_PV : 0;
+}
+
+uint16_t Z80Reference::fetch16()
+{
+    uint8_t low = fetch();
+    uint8_t high = fetch();
+    return high << 8 | low;
+}
+
+void Z80Reference::push16(uint16_t value)
+{
+    write(--cpu.sp, value >> 8);
+    write(--cpu.sp, value & 0xFF);
+}
+
+uint16_t Z80Reference::pop16()
+{
+    uint8_t low = read(cpu.sp++);
+    uint8_t high = read(cpu.sp++);
+    return high << 8 | low;
+}
+
+// One M1 cycle: the low 7 bits of R count, bit 7 stays as LD R,A left it
+void Z80Reference::refresh()
+{
+    cpu.r = (cpu.r & 0x80) | ((cpu.r + 1) & 0x7F);
+}
+
+uint8_t &Z80Reference::reg(int r)
+{
+    switch (r)
+    {
+    case 0: return cpu.b;
+    case 1: return cpu.c;
+    case 2: return cpu.d;
+    case 3: return cpu.e;
+    case 4: return cpu.h;
+    case 5: return cpu.l;
+    default: return cpu.a;
+    }
+}
+
+uint16_t Z80Reference::get_rp(int p)
+{
+    switch (p)
+    {
+    case 0: return cpu.b << 8 | cpu.c;
+    case 1: return cpu.d << 8 | cpu.e;
+    case 2: return cpu.h << 8 | cpu.l;
+    default: return cpu.sp;
+    }
+}
+
+void Z80Reference::set_rp(int p, uint16_t value)
+{
+    switch (p)
+    {
+    case 0: cpu.b = value >> 8, cpu.c = value & 0xFF; break;
+    case 1: cpu.d = value >> 8, cpu.e = value & 0xFF; break;
+    case 2: cpu.h = value >> 8, cpu.l = value & 0xFF; break;
+    default: cpu.sp = value; break;
+    }
+}
+
+bool Z80Reference::condition(int cc) const
+{
+    switch (cc)
+    {
+    case 0: return !(cpu.f & FLAG_Z);
+    case 1: return (cpu.f & FLAG_Z) != 0;
+    case 2: return !(cpu.f & FLAG_C);
+    case 3: return (cpu.f & FLAG_C) != 0;
+    case 4: return !(cpu.f & FLAG_PV);
+    case 5: return (cpu.f & FLAG_PV) != 0;
+    case 6: return !(cpu.f & FLAG_S);
+    default: return (cpu.f & FLAG_S) != 0;
+    }
+}
+
+void Z80Reference::alu(int op, uint8_t value)
+{
+    int a = cpu.a;
+    int carry = cpu.f & FLAG_C;
+    switch (op)
+    {
+    case 0: // ADD
+    case 1: // ADC
+    {
+        int carry_in = op == 1 ? carry : 0;
+        int result = a + value + carry_in;
+        int signed_result = static_cast<int8_t>(a) + static_cast<int8_t>(value) + carry_in;
+        cpu.a = static_cast<uint8_t>(result);
+        cpu.f = sign_zero_xy(cpu.a);
+        if ((a & 0x0F) + (value & 0x0F) + carry_in > 0x0F)
+            cpu.f |= FLAG_H;
+        if (signed_result < -128 || signed_result > 127)
+            cpu.f |= FLAG_PV;
+        if (result > 0xFF)
+            cpu.f |= FLAG_C;
+        break;
+    }
+    case 2: // SUB
+    case 3: // SBC
+    case 7: // CP
+    {
+        int carry_in = op == 3 ? carry : 0;
+        int result = a - value - carry_in;
+        int signed_result = static_cast<int8_t>(a) - static_cast<int8_t>(value) - carry_in;
+        uint8_t result8 = static_cast<uint8_t>(result);
+        cpu.f = (result8 & FLAG_S) | (result8 == 0 ? FLAG_Z : 0) | FLAG_N;
+        if ((a & 0x0F) - (value & 0x0F) - carry_in < 0)
+            cpu.f |= FLAG_H;
+        if (signed_result < -128 || signed_result > 127)
+            cpu.f |= FLAG_PV;
+        if (result < 0)
+            cpu.f |= FLAG_C;
+        if (op == 7)
+        {
+            cpu.f |= value & (FLAG_Y | FLAG_X); // CP copies bits 5 and 3 from the operand
+        }
+        else
+        {
+            cpu.f |= result8 & (FLAG_Y | FLAG_X);
+            cpu.a = result8;
+        }
+        break;
+    }
+    case 4: // AND
+        cpu.a = a & value;
+        cpu.f = sign_zero_xy(cpu.a) | FLAG_H | parity(cpu.a);
+        break;
+    case 5: // XOR
+        cpu.a = a ^ value;
+        cpu.f = sign_zero_xy(cpu.a) | parity(cpu.a);
+        break;
+    default: // OR
+        cpu.a = a | value;
+        cpu.f = sign_zero_xy(cpu.a) | parity(cpu.a);
+        break;
+    }
+}
+
+uint8_t Z80Reference::inc8(uint8_t value)
+{
+    uint8_t result = value + 1;
+    cpu.f = (cpu.f & FLAG_C) | sign_zero_xy(result);
+    if ((value & 0x0F) == 0x0F)
+        cpu.f |= FLAG_H;
+    if (value == 0x7F)
+        cpu.f |= FLAG_PV;
+    return result;
+}
+
+uint8_t Z80Reference::dec8(uint8_t value)
+{
+    uint8_t result = value - 1;
+    cpu.f = (cpu.f & FLAG_C) | sign_zero_xy(result) | FLAG_N;
+    if ((value & 0x0F) == 0x00)
+        cpu.f |= FLAG_H;
+    if (value == 0x80)
+        cpu.f |= FLAG_PV;
+    return result;
+}
+
+uint8_t Z80Reference::rotate(int op, uint8_t value)
+{
+    int carry_in = cpu.f & FLAG_C;
+    int carry_out;
+    uint8_t result;
+    switch (op)
+    {
+    case 0: carry_out = value >> 7, result = value << 1 | carry_out; break;        // RLC
+    case 1: carry_out = value & 1, result = value >> 1 | carry_out << 7; break;    // RRC
+    case 2: carry_out = value >> 7, result = value << 1 | carry_in; break;         // RL
+    case 3: carry_out = value & 1, result = value >> 1 | carry_in << 7; break;     // RR
+    case 4: carry_out = value >> 7, result = value << 1; break;                    // SLA
+    case 5: carry_out = value & 1, result = value >> 1 | (value & 0x80); break;    // SRA
+    case 6: carry_out = value >> 7, result = value << 1 | 1; break;                // SLL
+    default: carry_out = value & 1, result = value >> 1; break;                    // SRL
+    }
+    cpu.f = sign_zero_xy(result) | parity(result) | carry_out;
+    return result;
+}
+
+// BIT n: bits 5 and 3 come from `xy`, which depends on the addressing mode
+void Z80Reference::bit(int n, uint8_t value, uint8_t xy)
+{
+    cpu.f = (cpu.f & FLAG_C) | FLAG_H | (xy & (FLAG_Y | FLAG_X));
+    if (!(value & (1 << n)))
+        cpu.f |= FLAG_Z | FLAG_PV;
+    else if (n == 7)
+        cpu.f |= FLAG_S;
+}
+
+uint16_t Z80Reference::adc16(uint16_t x, uint16_t y, int carry)
+{
+    int result = x + y + carry;
+    int signed_result = static_cast<int16_t>(x) + static_cast<int16_t>(y) + carry;
+    uint16_t result16 = static_cast<uint16_t>(result);
+    cpu.f = ((result16 >> 8) & (FLAG_S | FLAG_Y | FLAG_X)) | (result16 == 0 ? FLAG_Z : 0);
+    if ((x & 0x0FFF) + (y & 0x0FFF) + carry > 0x0FFF)
+        cpu.f |= FLAG_H;
+    if (signed_result < -32768 || signed_result > 32767)
+        cpu.f |= FLAG_PV;
+    if (result > 0xFFFF)
+        cpu.f |= FLAG_C;
+    return result16;
+}
+
+uint16_t Z80Reference::sbc16(uint16_t x, uint16_t y, int carry)
+{
+    int result = x - y - carry;
+    int signed_result = static_cast<int16_t>(x) - static_cast<int16_t>(y) - carry;
+    uint16_t result16 = static_cast<uint16_t>(result);
+    cpu.f = ((result16 >> 8) & (FLAG_S | FLAG_Y | FLAG_X)) | (result16 == 0 ? FLAG_Z : 0) | FLAG_N;
+    if ((x & 0x0FFF) - (y & 0x0FFF) - carry < 0)
+        cpu.f |= FLAG_H;
+    if (signed_result < -32768 || signed_result > 32767)
+        cpu.f |= FLAG_PV;
+    if (result < 0)
+        cpu.f |= FLAG_C;
+    return result16;
+}
+
+int Z80Reference::step()
+{
+    Z80_CPU saved = cpu;
+    uint16_t start = cpu.pc;
+    uint8_t op = fetch();
+    refresh();
+    last_key = op;
+
+    int x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+    uint16_t hl = cpu.h << 8 | cpu.l;
+    int t = 0;
+
+    switch (x)
+    {
+    case 0:
+        switch (z)
+        {
+        case 0:
+            if (y == 0) // NOP
+            {
+                t = 4;
+            }
+            else if (y == 1) // EX AF, AF'
+            {
+                uint8_t a = cpu.a, f = cpu.f;
+                cpu.a = cpu.a_prime, cpu.f = cpu.f_prime;
+                cpu.a_prime = a, cpu.f_prime = f;
+                t = 4;
+            }
+            else if (y == 2) // DJNZ e
+            {
+                int8_t e = static_cast<int8_t>(fetch());
+                t = 8;
+                if (--cpu.b != 0)
+                    cpu.pc += e, t = 13;
+            }
+            else // JR e, JR cc, e
+            {
+                int8_t e = static_cast<int8_t>(fetch());
+                t = 7;
+                if (y == 3 || condition(y - 4))
+                    cpu.pc += e, t = 12;
+            }
+            break;
+        case 1:
+            if (q == 0) // LD rp, nn
+            {
+                set_rp(p, fetch16());
+                t = 10;
+            }
+            else // ADD HL, rp
+            {
+                uint16_t value = get_rp(p);
+                int result = hl + value;
+                cpu.f = (cpu.f & (FLAG_S | FLAG_Z | FLAG_PV)) | ((result >> 8) & (FLAG_Y | FLAG_X));
+                if ((hl & 0x0FFF) + (value & 0x0FFF) > 0x0FFF)
+                    cpu.f |= FLAG_H;
+                if (result > 0xFFFF)
+                    cpu.f |= FLAG_C;
+                set_rp(2, static_cast<uint16_t>(result));
+                t = 11;
+            }
+            break;
+        case 2:
+        {
+            switch (op)
+            {
+            case 0x02: write(get_rp(0), cpu.a), t = 7; break;
+            case 0x12: write(get_rp(1), cpu.a), t = 7; break;
+            case 0x0A: cpu.a = read(get_rp(0)), t = 7; break;
+            case 0x1A: cpu.a = read(get_rp(1)), t = 7; break;
+            case 0x22:
+            {
+                uint16_t addr = fetch16();
+                write(addr, cpu.l);
+                write(addr + 1, cpu.h);
+                t = 16;
+                break;
+            }
+            case 0x2A:
+            {
+                uint16_t addr = fetch16();
+                cpu.l = read(addr);
+                cpu.h = read(addr + 1);
+                t = 16;
+                break;
+            }
+            case 0x32: write(fetch16(), cpu.a), t = 13; break;
+            default: cpu.a = read(fetch16()), t = 13; break; // 0x3A
+            }
+            break;
+        }
+        case 3: // INC rp, DEC rp
+            set_rp(p, get_rp(p) + (q == 0 ? 1 : -1));
+            t = 6;
+            break;
+        case 4: // INC r
+            if (y == 6)
+                write(hl, inc8(read(hl))), t = 11;
+            else
+                reg(y) = inc8(reg(y)), t = 4;
+            break;
+        case 5: // DEC r
+            if (y == 6)
+                write(hl, dec8(read(hl))), t = 11;
+            else
+                reg(y) = dec8(reg(y)), t = 4;
+            break;
+        case 6: // LD r, n
+            if (y == 6)
+                write(hl, fetch()), t = 10;
+            else
+                reg(y) = fetch(), t = 7;
+            break;
+        default:
+        {
+            uint8_t keep = cpu.f & (FLAG_S | FLAG_Z | FLAG_PV);
+            int carry = cpu.f & FLAG_C;
+            switch (y)
+            {
+            case 0: // RLCA
+                cpu.a = cpu.a << 1 | cpu.a >> 7;
+                cpu.f = keep | (cpu.a & (FLAG_Y | FLAG_X)) | (cpu.a & 1);
+                break;
+            case 1: // RRCA
+                cpu.f = keep | (cpu.a & 1);
+                cpu.a = cpu.a >> 1 | cpu.a << 7;
+                cpu.f |= cpu.a & (FLAG_Y | FLAG_X);
+                break;
+            case 2: // RLA
+                cpu.f = keep | (cpu.a >> 7);
+                cpu.a = cpu.a << 1 | carry;
+                cpu.f |= cpu.a & (FLAG_Y | FLAG_X);
+                break;
+            case 3: // RRA
+                cpu.f = keep | (cpu.a & 1);
+                cpu.a = cpu.a >> 1 | carry << 7;
+                cpu.f |= cpu.a & (FLAG_Y | FLAG_X);
+                break;
+            case 4: // DAA is left out of the model
+                cpu = saved;
+                return 0;
+            case 5: // CPL
+                cpu.a = ~cpu.a;
+                cpu.f = (cpu.f & (FLAG_S | FLAG_Z | FLAG_PV | FLAG_C)) | FLAG_H | FLAG_N | (cpu.a & (FLAG_Y | FLAG_X));
+                break;
+            case 6: // SCF
+                cpu.f = keep | (cpu.a & (FLAG_Y | FLAG_X)) | FLAG_C;
+                break;
+            default: // CCF: H gets the old carry
+                cpu.f = keep | (cpu.a & (FLAG_Y | FLAG_X)) | (carry ? FLAG_H : FLAG_C);
+                break;
+            }
+            t = 4;
+            break;
+        }
+        }
+        break;
+
+    case 1:
+        if (op == 0x76) // HALT: stay on it
+        {
+            cpu.pc = start;
+            cpu.halted = 1;
+            t = 4;
+        }
+        else if (y == 6) // LD (HL), r
+        {
+            write(hl, reg(z));
+            t = 7;
+        }
+        else if (z == 6) // LD r, (HL)
+        {
+            reg(y) = read(hl);
+            t = 7;
+        }
+        else // LD r, r'
+        {
+            reg(y) = reg(z);
+            t = 4;
+        }
+        break;
+
+    case 2: // ALU A, r
+        alu(y, z == 6 ? read(hl) : reg(z));
+        t = z == 6 ? 7 : 4;
+        break;
+
+    default:
+        switch (z)
+        {
+        case 0: // RET cc
+            t = 5;
+            if (condition(y))
+                cpu.pc = pop16(), t = 11;
+            break;
+        case 1:
+            if (q == 0) // POP rp2
+            {
+                uint16_t value = pop16();
+                if (p == 3)
+                    cpu.a = value >> 8, cpu.f = value & 0xFF;
+                else
+                    set_rp(p, value);
+                t = 10;
+            }
+            else if (p == 0) // RET
+            {
+                cpu.pc = pop16();
+                t = 10;
+            }
+            else if (p == 1) // EXX
+            {
+                std::swap(cpu.b, cpu.b_prime), std::swap(cpu.c, cpu.c_prime);
+                std::swap(cpu.d, cpu.d_prime), std::swap(cpu.e, cpu.e_prime);
+                std::swap(cpu.h, cpu.h_prime), std::swap(cpu.l, cpu.l_prime);
+                t = 4;
+            }
+            else if (p == 2) // JP (HL)
+            {
+                cpu.pc = hl;
+                t = 4;
+            }
+            else // LD SP, HL
+            {
+                cpu.sp = hl;
+                t = 6;
+            }
+            break;
+        case 2: // JP cc, nn
+        {
+            uint16_t addr = fetch16();
+            if (condition(y))
+                cpu.pc = addr;
+            t = 10;
+            break;
+        }
+        case 3:
+            switch (y)
+            {
+            case 0: cpu.pc = fetch16(), t = 10; break; // JP nn
+            case 1: t = step_cb(); break;
+            case 2: fetch(), t = 11; break;              // OUT (n), A: nothing listens
+            case 3: fetch(), cpu.a = 0xFF, t = 11; break; // IN A, (n): an empty bus reads FFh
+            case 4: // EX (SP), HL
+            {
+                uint16_t value = pop16();
+                push16(hl);
+                set_rp(2, value);
+                t = 19;
+                break;
+            }
+            case 5: // EX DE, HL
+            {
+                uint16_t de = get_rp(1);
+                set_rp(1, hl);
+                set_rp(2, de);
+                t = 4;
+                break;
+            }
+            case 6: cpu.interrupt_enable = cpu.iff2 = 0, t = 4; break; // DI
+            default: cpu.interrupt_enable = cpu.iff2 = 1, t = 4; break; // EI
+            }
+            break;
+        case 4: // CALL cc, nn
+        {
+            uint16_t addr = fetch16();
+            t = 10;
+            if (condition(y))
+                push16(cpu.pc), cpu.pc = addr, t = 17;
+            break;
+        }
+        case 5:
+            if (q == 0) // PUSH rp2
+            {
+                push16(p == 3 ? (cpu.a << 8 | cpu.f) : get_rp(p));
+                t = 11;
+            }
+            else if (p == 0) // CALL nn
+            {
+                uint16_t addr = fetch16();
+                push16(cpu.pc);
+                cpu.pc = addr;
+                t = 17;
+            }
+            else if (p == 2)
+            {
+                t = step_ed();
+            }
+            else
+            {
+                t = step_index(p == 1 ? 0xDD : 0xFD);
+            }
+            break;
+        case 6: // ALU A, n
+            alu(y, fetch());
+            t = 7;
+            break;
+        default: // RST
+            push16(cpu.pc);
+            cpu.pc = y * 8;
+            t = 11;
+            break;
+        }
+        break;
+    }
+
+    if (t == 0)
+        cpu = saved;
+    return t;
+}
+
+int Z80Reference::step_cb()
+{
+    uint8_t op = fetch();
+    refresh();
+    last_key = 0xCB00 | op;
+
+    int x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+    uint16_t hl = cpu.h << 8 | cpu.l;
+    uint8_t value = z == 6 ? read(hl) : reg(z);
+
+    if (x == 1) // BIT y, r
+    {
+        if (z == 6)
+            f_known &= ~(FLAG_Y | FLAG_X); // Bits 5 and 3 come from the hidden MEMPTR
+        bit(y, value, value);
+        return z == 6 ? 12 : 8;
+    }
+
+    if (x == 0)
+        value = rotate(y, value);
+    else if (x == 2)
+        value &= ~(1 << y); // RES
+    else
+        value |= 1 << y; // SET
+
+    if (z == 6)
+        write(hl, value);
+    else
+        reg(z) = value;
+    return z == 6 ? 15 : 8;
+}
+
+int Z80Reference::step_ed()
+{
+    uint8_t op = fetch();
+    refresh();
+    last_key = 0xED00 | op;
+
+    int x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+    if (x == 2 && y >= 4 && z <= 3)
+        return step_block(y, z);
+    if (x != 1)
+        return 0;
+
+    switch (z)
+    {
+    case 0: // IN r, (C); y == 6 only sets the flags
+    {
+        uint8_t value = 0xFF; // Nothing on the bus
+        cpu.f = (cpu.f & FLAG_C) | sign_zero_xy(value) | parity(value);
+        if (y != 6)
+            reg(y) = value;
+        return 12;
+    }
+    case 1: // OUT (C), r; y == 6 sends 0
+        return 12;
+    case 2: // SBC HL, rp / ADC HL, rp
+    {
+        uint16_t hl = get_rp(2);
+        int carry = cpu.f & FLAG_C;
+        set_rp(2, q == 0 ? sbc16(hl, get_rp(p), carry) : adc16(hl, get_rp(p), carry));
+        return 15;
+    }
+    case 3: // LD (nn), rp / LD rp, (nn)
+    {
+        uint16_t addr = fetch16();
+        if (q == 0)
+        {
+            uint16_t value = get_rp(p);
+            write(addr, value & 0xFF);
+            write(addr + 1, value >> 8);
+        }
+        else
+        {
+            set_rp(p, read(addr) | read(addr + 1) << 8);
+        }
+        return 20;
+    }
+    case 4: // NEG
+    {
+        uint8_t value = cpu.a;
+        cpu.a = 0;
+        alu(2, value);
+        return 8;
+    }
+    case 5: // RETN, RETI
+        cpu.pc = pop16();
+        cpu.interrupt_enable = cpu.iff2;
+        return 14;
+    case 6: // IM 0/0/1/2, repeated
+    {
+        static const uint8_t modes[4] = {0, 0, 1, 2};
+        cpu.im = modes[y & 3];
+        return 8;
+    }
+    default:
+        switch (y)
+        {
+        case 0: cpu.i = cpu.a; return 9; // LD I, A
+        case 1: cpu.r = cpu.a; return 9; // LD R, A
+        case 2: // LD A, I
+        case 3: // LD A, R
+            cpu.a = y == 2 ? cpu.i : cpu.r;
+            cpu.f = (cpu.f & FLAG_C) | sign_zero_xy(cpu.a) | (cpu.iff2 ? FLAG_PV : 0);
+            return 9;
+        default: // RRD and RLD are not in the model
+            return 0;
+        }
+    }
+}
+
+// One iteration of a block instruction. y picks the direction (bit 0 set:
+// decrement) and repeat (y >= 6); z picks LD, CP, IN or OUT. A repeating
+// form that is not finished moves PC back onto itself and takes 21 T-states.
+int Z80Reference::step_block(int y, int z)
+{
+    int step = (y & 1) ? -1 : 1;
+    uint16_t hl = get_rp(2);
+    uint16_t bc = get_rp(0);
+    bool again;
+    switch (z)
+    {
+    case 0: // LDI: bits 5 and 3 of F come from bits 1 and 3 of A + the byte
+    {
+        uint8_t value = read(hl);
+        uint16_t de = get_rp(1);
+        write(de, value);
+        set_rp(1, de + step);
+        set_rp(2, hl + step);
+        set_rp(0, --bc);
+        uint8_t n = value + cpu.a;
+        cpu.f = (cpu.f & (FLAG_S | FLAG_Z | FLAG_C)) | (bc != 0 ? FLAG_PV : 0) | (n & FLAG_X) | ((n << 4) & FLAG_Y);
+        again = bc != 0;
+        break;
+    }
+    case 1: // CPI: as CP (HL) with carry kept, bits 5 and 3 from A - (HL) - H
+    {
+        uint8_t value = read(hl);
+        uint8_t result = cpu.a - value;
+        bool half = ((cpu.a & 0x0F) - (value & 0x0F)) < 0;
+        set_rp(2, hl + step);
+        set_rp(0, --bc);
+        uint8_t n = result - (half ? 1 : 0);
+        cpu.f = (cpu.f & FLAG_C) | (result & FLAG_S) | (result == 0 ? FLAG_Z : 0) | (half ? FLAG_H : 0) | FLAG_N |
+                (bc != 0 ? FLAG_PV : 0) | (n & FLAG_X) | ((n << 4) & FLAG_Y);
+        again = bc != 0 && result != 0;
+        break;
+    }
+    default: // INI, OUTI: B counts, flags from B and from the byte plus C +/- 1 or L
+    {
+        uint8_t value;
+        int k;
+        if (z == 2)
+        {
+            value = 0xFF; // Nothing on the bus
+            write(hl, value);
+            cpu.b--;
+            set_rp(2, hl + step);
+            k = value + ((cpu.c + step) & 0xFF);
+        }
+        else
+        {
+            value = read(hl);
+            cpu.b--;
+            set_rp(2, hl + step);
+            k = value + cpu.l;
+        }
+        cpu.f = sign_zero_xy(cpu.b) | (value & 0x80 ? FLAG_N : 0) | (k > 0xFF ? FLAG_H | FLAG_C : 0) |
+                parity((k & 7) ^ cpu.b);
+        again = cpu.b != 0;
+        break;
+    }
+    }
+
+    if (y >= 6 && again)
+    {
+        cpu.pc -= 2;
+        return 21;
+    }
+    return 16;
+}
+
+int Z80Reference::step_index(uint8_t prefix)
+{
+    uint8_t op = fetch();
+    refresh();
+    last_key = prefix << 8 | op;
+
+    uint16_t &index = prefix == 0xDD ? cpu.ix : cpu.iy;
+    int x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1;
+
+    if (op == 0xCB) // DD CB d op: no refresh for the last two bytes
+    {
+        int8_t d = static_cast<int8_t>(fetch());
+        uint8_t cb = fetch();
+        last_key = static_cast<uint32_t>(prefix) << 16 | 0xCB00 | cb;
+        uint16_t addr = index + d;
+        uint8_t value = read(addr);
+        int cx = cb >> 6, cy = (cb >> 3) & 7, cz = cb & 7;
+        if (cx == 1) // BIT: bits 5 and 3 from the high byte of the address
+        {
+            bit(cy, value, addr >> 8);
+            return 20;
+        }
+        if (cx == 0)
+            value = rotate(cy, value);
+        else if (cx == 2)
+            value &= ~(1 << cy);
+        else
+            value |= 1 << cy;
+        write(addr, value);
+        if (cz != 6)
+            reg(cz) = value; // Undocumented copy into a register
+        return 23;
+    }
+
+    switch (op)
+    {
+    case 0x21: index = fetch16(); return 14;
+    case 0x22:
+    {
+        uint16_t addr = fetch16();
+        write(addr, index & 0xFF);
+        write(addr + 1, index >> 8);
+        return 20;
+    }
+    case 0x2A:
+    {
+        uint16_t addr = fetch16();
+        index = read(addr) | read(addr + 1) << 8;
+        return 20;
+    }
+    case 0x23: index++; return 10;
+    case 0x2B: index--; return 10;
+    case 0x34:
+    case 0x35:
+    case 0x36:
+    {
+        uint16_t addr = index + static_cast<int8_t>(fetch());
+        if (op == 0x36)
+            write(addr, fetch());
+        else
+            write(addr, op == 0x34 ? inc8(read(addr)) : dec8(read(addr)));
+        return op == 0x36 ? 19 : 23;
+    }
+    case 0xE1: index = pop16(); return 14;
+    case 0xE5: push16(index); return 15;
+    case 0xE9: cpu.pc = index; return 8;
+    case 0xF9: cpu.sp = index; return 10;
+    default: break;
+    }
+
+    if (x == 0 && z == 1 && (y & 1)) // ADD IX, rp (rp 2 is IX itself)
+    {
+        uint16_t value = p == 2 ? index : get_rp(p);
+        int result = index + value;
+        cpu.f = (cpu.f & (FLAG_S | FLAG_Z | FLAG_PV)) | ((result >> 8) & (FLAG_Y | FLAG_X));
+        if ((index & 0x0FFF) + (value & 0x0FFF) > 0x0FFF)
+            cpu.f |= FLAG_H;
+        if (result > 0xFFFF)
+            cpu.f |= FLAG_C;
+        index = static_cast<uint16_t>(result);
+        return 15;
+    }
+    if (x == 1 && y == 6 && z != 6) // LD (IX+d), r
+    {
+        write(index + static_cast<int8_t>(fetch()), reg(z));
+        return 19;
+    }
+    if (x == 1 && z == 6 && y != 6) // LD r, (IX+d)
+    {
+        reg(y) = read(index + static_cast<int8_t>(fetch()));
+        return 19;
+    }
+    if (x == 2 && z == 6) // ALU A, (IX+d)
+    {
+        alu(y, read(index + static_cast<int8_t>(fetch())));
+        return 19;
+    }
+    return 0; // IXH/IXL and the other undocumented forms are not in the model
+}
@@ -0,0 +1,67 @@
+#ifndef Z80_REF_H
+#define Z80_REF_H
+
+#include <cstdint>
+#include <vector>
+#include "z80.h"
+
+// Reference Z80 for differential testing (z80_fuzz). It is written to be
+// obviously right rather than fast: one switch on the opcode fields as the
+// Zilog manual lays them out, flat 64KB memory, and every flag worked out
+// bit by bit from its definition. It shares nothing with the emulator but
+// the Z80_CPU layout, and keeps F in cpu.f (flag_op is always FLAGS_NONE).
+class Z80Reference
+{
+public:
+    Z80_CPU cpu;
+    uint8_t mem[65536];
+    std::vector<uint16_t> writes; // Every address written, in order
+    uint8_t f_known;              // F bits the model can vouch for (see BIT n,(HL))
+    uint32_t last_key;            // Prefix and opcode of the last instruction run
+
+    // Run one instruction and return its T-states, or 0 (with nothing
+    // changed) if it is outside the model
+    int step();
+
+private:
+    uint8_t read(uint16_t addr) const
+    {
+        return mem[addr];
+    }
+
+    void write(uint16_t addr, uint8_t value)
+    {
+        mem[addr] = value;
+        writes.push_back(addr);
+    }
+
+    uint8_t fetch()
+    {
+        return mem[cpu.pc++];
+    }
+
+    uint16_t fetch16();
+    void push16(uint16_t value);
+    uint16_t pop16();
+    void refresh();
+
+    uint8_t &reg(int r);          // B C D E H L - A by the 3-bit field (6 is not a register)
+    uint16_t get_rp(int p);       // BC DE HL SP
+    void set_rp(int p, uint16_t value);
+    bool condition(int cc) const; // NZ Z NC C PO PE P M
+
+    void alu(int op, uint8_t value); // ADD ADC SUB SBC AND XOR OR CP into A
+    uint8_t inc8(uint8_t value);
+    uint8_t dec8(uint8_t value);
+    uint8_t rotate(int op, uint8_t value); // RLC RRC RL RR SLA SRA SLL SRL
+    void bit(int n, uint8_t value, uint8_t xy);
+    uint16_t adc16(uint16_t x, uint16_t y, int carry);
+    uint16_t sbc16(uint16_t x, uint16_t y, int carry);
+
+    int step_cb();
+    int step_ed();
+    int step_block(int y, int z); // LDI/CPI/INI/OUTI and their D, R and DR forms
+    int step_index(uint8_t prefix);
+};
+
+#endif // Z80_REF_H
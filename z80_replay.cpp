@@ -0,0 +1,55 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "z80.h"
+#include "z80_btrace.h"
+
+// Replay a binary trace written by z80_emulator --record: print the CPU
+// state after any record, or convert the trace to text
+int main(int argc, char *argv[])
+{
+    std::string filename;
+    unsigned long long stop = ~0ULL; // Records to replay
+    bool text = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strncmp(argv[i], "--at=", 5) == 0)
+            stop = std::strtoull(argv[i] + 5, nullptr, 0);
+        else if (std::strcmp(argv[i], "--text") == 0)
+            text = true;
+        else if (filename.empty() && argv[i][0] != '-')
+            filename = argv[i];
+        else
+            filename.clear(), i = argc;
+    }
+    if (filename.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--at=N] [--text] trace.z80t" << std::endl;
+        return -1;
+    }
+
+    Z80TraceReader reader;
+    if (!reader.open(filename))
+    {
+        std::cerr << "Error: " << filename << " is not a readable trace" << std::endl;
+        return 1;
+    }
+
+    Z80_TraceRecord record;
+    unsigned long long count = 0;
+    while (count < stop && reader.next(record))
+    {
+        count++;
+        if (text)
+            std::cout << z80_trace_text(record, reader.cpu());
+    }
+    if (count < stop && stop != ~0ULL)
+        std::cerr << "Warning: the trace ends after " << count << " records" << std::endl;
+
+    std::cout << "Replayed " << count << " records, " << reader.cycles() << " T-states" << std::endl;
+    static Z80Machine machine; // For display_state
+    machine.cpu = reader.cpu();
+    machine.display_state(std::cout);
+    return 0;
+}
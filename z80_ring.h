@@ -0,0 +1,110 @@
+#ifndef Z80_RING_H
+#define Z80_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define Z80_CACHE_LINE 64
+
+// Lock-free single-producer/single-consumer ring of SIZE elements (a power
+// of two). One thread pushes, one other thread pops, and neither ever
+// blocks or takes a lock. Each side keeps a private copy of the other
+// side's index and only reloads the shared one when the ring looks full
+// (or empty), so a burst of pushes costs one atomic store per element and
+// no cache-line traffic from the consumer.
+template <typename T, size_t SIZE>
+class Z80Ring
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "Z80Ring size must be a power of two");
+
+public:
+    // Producer: add one element. Returns false if the ring is full.
+    bool push(const T &value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_cache == SIZE)
+        {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t - head_cache == SIZE)
+                return false;
+        }
+        buffer[t & (SIZE - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: add up to n elements. Returns how many went in.
+    size_t push(const T *values, size_t n)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (SIZE - (t - head_cache) < n)
+            head_cache = head.load(std::memory_order_acquire);
+        size_t room = SIZE - (t - head_cache);
+        if (n > room)
+            n = room;
+        for (size_t k = 0; k < n; k++)
+            buffer[(t + k) & (SIZE - 1)] = values[k];
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: take one element. Returns false if the ring is empty.
+    bool pop(T &value)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail_cache)
+        {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h == tail_cache)
+                return false;
+        }
+        value = buffer[h & (SIZE - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: take up to n elements. Returns how many came out.
+    size_t pop(T *values, size_t n)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (tail_cache - h < n)
+            tail_cache = tail.load(std::memory_order_acquire);
+        size_t available = tail_cache - h;
+        if (n > available)
+            n = available;
+        for (size_t k = 0; k < n; k++)
+            values[k] = buffer[(h + k) & (SIZE - 1)];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Either side: a snapshot that may be stale by the time it is used
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return SIZE;
+    }
+
+private:
+    // Consumer side
+    alignas(Z80_CACHE_LINE) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+
+    // Producer side
+    alignas(Z80_CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
+
+    alignas(Z80_CACHE_LINE) T buffer[SIZE];
+};
+
+#endif // Z80_RING_H
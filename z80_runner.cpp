@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include "z80.h"
+#include "z80_pool.h"
+#include "z80_runner.h"
+#include "z80_trace.h"
+
+typedef std::vector<std::pair<std::string, std::string>> Z80_StateLines;
+
+std::vector<Z80_TestCase> z80_find_tests(const std::string &dir)
+{
+    namespace fs = std::filesystem;
+    std::vector<Z80_TestCase> tests;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(dir, error), end; !error && it != end; it.increment(error))
+    {
+        if (!it->is_regular_file() || it->path().extension() != ".bin")
+            continue;
+        fs::path expected = it->path();
+        expected.replace_extension(Z80_EXPECTED_EXT);
+        tests.push_back({fs::relative(it->path(), dir).generic_string(), it->path().string(),
+                         fs::is_regular_file(expected) ? expected.string() : std::string()});
+    }
+    std::sort(tests.begin(), tests.end(),
+              [](const Z80_TestCase &x, const Z80_TestCase &y) { return x.name < y.name; });
+    return tests;
+}
+
+// "Name: value" lines, in file order. Anything else is ignored.
+static Z80_StateLines parse_state(std::istream &in)
+{
+    Z80_StateLines lines;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t colon = line.find(": ");
+        if (colon == std::string::npos)
+            continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        lines.emplace_back(line.substr(0, colon), line.substr(colon + 2, last - colon - 1));
+    }
+    return lines;
+}
+
+// Check every expected line against the machine's final state
+static void compare_state(const Z80_StateLines &expected, const Z80_StateLines &actual, int cycles,
+                          std::vector<std::string> &mismatches)
+{
+    for (const auto &want : expected)
+    {
+        if (want.first == "Cycles")
+        {
+            if (std::strtol(want.second.c_str(), nullptr, 10) != cycles)
+                mismatches.push_back("Cycle count is " + std::to_string(cycles) + " instead of " + want.second);
+            continue;
+        }
+        auto have = std::find_if(actual.begin(), actual.end(),
+                                 [&](const std::pair<std::string, std::string> &p) { return p.first == want.first; });
+        if (have == actual.end())
+            mismatches.push_back(want.first + " is not part of the machine state");
+        else if (std::strtoul(have->second.c_str(), nullptr, 16) != std::strtoul(want.second.c_str(), nullptr, 16))
+            mismatches.push_back(want.first + " is " + have->second + " instead of " + want.second);
+    }
+}
+
+static void run_test(Z80Machine &m, const Z80_TestCase &test, int cycles, bool jit, Z80_TestResult &result)
+{
+    auto start = std::chrono::steady_clock::now();
+    result.name = test.name;
+    result.passed = false;
+    result.skipped = false;
+    result.cycles = 0;
+
+    std::ifstream expected_file(test.expected);
+    if (test.expected.empty() || !expected_file)
+    {
+        result.skipped = true;
+        result.message = "no " Z80_EXPECTED_EXT " file";
+    }
+    else
+    {
+        m.init();
+        m.enable_jit(jit);
+        if (!m.load(test.image))
+        {
+            result.skipped = true;
+            result.message = "could not load image";
+        }
+        else
+        {
+            result.cycles = m.execute(cycles);
+            std::stringstream state;
+            m.display_state(state);
+            compare_state(parse_state(expected_file), parse_state(state), result.cycles, result.mismatches);
+            result.passed = result.mismatches.empty();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<Z80_TestResult> z80_run_tests(const std::vector<Z80_TestCase> &tests, unsigned threads, int cycles,
+                                          bool jit)
+{
+    std::vector<Z80_TestResult> results(tests.size());
+    int level = z80_trace_level;
+    z80_trace_level = Z80_TRACE_OFF; // Headless: nothing but the report
+    Z80Pool pool(threads);
+    pool.run(tests.size(), [&](size_t index, Z80Machine &m) { run_test(m, tests[index], cycles, jit, results[index]); });
+    z80_trace_level = level;
+    return results;
+}
+
+static std::string json_string(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string xml_string(const std::string &s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+struct Z80_TestTotals
+{
+    size_t passed = 0, failed = 0, skipped = 0;
+    double seconds = 0;
+};
+
+static Z80_TestTotals totals(const std::vector<Z80_TestResult> &results)
+{
+    Z80_TestTotals t;
+    for (const Z80_TestResult &r : results)
+    {
+        if (r.skipped)
+            t.skipped++;
+        else if (r.passed)
+            t.passed++;
+        else
+            t.failed++;
+        t.seconds += r.seconds;
+    }
+    return t;
+}
+
+void z80_write_json(std::ostream &out, const std::vector<Z80_TestResult> &results)
+{
+    Z80_TestTotals t = totals(results);
+    out << "{\n  \"tests\": " << results.size() << ", \"passed\": " << t.passed << ", \"failed\": " << t.failed
+        << ", \"skipped\": " << t.skipped << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Z80_TestResult &r = results[i];
+        out << "    {\"name\": " << json_string(r.name) << ", \"status\": "
+            << (r.skipped ? "\"skipped\"" : r.passed ? "\"passed\"" : "\"failed\"") << ", \"cycles\": " << r.cycles
+            << ", \"seconds\": " << r.seconds;
+        if (r.skipped)
+            out << ", \"message\": " << json_string(r.message);
+        if (!r.mismatches.empty())
+        {
+            out << ", \"mismatches\": [";
+            for (size_t k = 0; k < r.mismatches.size(); k++)
+                out << (k != 0 ? ", " : "") << json_string(r.mismatches[k]);
+            out << "]";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void z80_write_junit(std::ostream &out, const std::vector<Z80_TestResult> &results)
+{
+    Z80_TestTotals t = totals(results);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<testsuite name=\"z80-conformance\" tests=\"" << results.size() << "\" failures=\"" << t.failed
+        << "\" skipped=\"" << t.skipped << "\" time=\"" << t.seconds << "\">\n";
+    for (const Z80_TestResult &r : results)
+    {
+        out << "  <testcase classname=\"z80\" name=\"" << xml_string(r.name) << "\" time=\"" << r.seconds << "\"";
+        if (r.passed)
+        {
+            out << "/>\n";
+            continue;
+        }
+        out << ">\n";
+        if (r.skipped)
+        {
+            out << "    <skipped message=\"" << xml_string(r.message) << "\"/>\n";
+        }
+        else
+        {
+            out << "    <failure message=\"" << r.mismatches.size() << " mismatches\">";
+            for (const std::string &m : r.mismatches)
+                out << xml_string(m) << "\n";
+            out << "</failure>\n";
+        }
+        out << "  </testcase>\n";
+    }
+    out << "</testsuite>\n";
+}
@@ -0,0 +1,43 @@
+#ifndef Z80_RUNNER_H
+#define Z80_RUNNER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define Z80_EXPECTED_EXT ".expected" // Expected state next to each test image
+
+// One conformance test: a program image and the state it should end in.
+// The expected file uses display_state()'s "Name: value" lines (hex) and
+// may add "Cycles: N" (decimal). Only the lines present are checked.
+struct Z80_TestCase
+{
+    std::string name;     // Image path relative to the test directory
+    std::string image;    // Full path of the .bin
+    std::string expected; // Full path of the expected state, empty if missing
+};
+
+struct Z80_TestResult
+{
+    std::string name;
+    bool passed;
+    bool skipped;                        // No expected state, or the image would not load
+    std::string message;                 // Why it was skipped
+    std::vector<std::string> mismatches; // "F is 10 instead of 40", one per difference
+    int cycles;                          // T-states until HALT or the budget ran out
+    double seconds;
+};
+
+// Every .bin under dir (recursively), sorted by path
+std::vector<Z80_TestCase> z80_find_tests(const std::string &dir);
+
+// Run the tests across a Z80Pool with tracing off, each for at most
+// `cycles` T-states. Results are in the order of `tests`.
+std::vector<Z80_TestResult> z80_run_tests(const std::vector<Z80_TestCase> &tests, unsigned threads, int cycles,
+                                          bool jit);
+
+// Reports for CI: a JSON summary and a JUnit XML testsuite
+void z80_write_json(std::ostream &out, const std::vector<Z80_TestResult> &results);
+void z80_write_junit(std::ostream &out, const std::vector<Z80_TestResult> &results);
+
+#endif // Z80_RUNNER_H
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include "z80_sched.h"
+#include "z80_trace.h"
+
+Z80Scheduler::Z80Scheduler(Z80Machine &machine) : m(machine)
+{
+}
+
+void Z80Scheduler::push(Entry entry)
+{
+    heap.push_back(std::move(entry));
+    std::push_heap(heap.begin(), heap.end(), Later());
+}
+
+uint64_t Z80Scheduler::at(uint64_t when, Event event)
+{
+    uint64_t id = next_id++;
+    push({when, id, 0, std::move(event)});
+    return id;
+}
+
+uint64_t Z80Scheduler::every(uint64_t period, Event event)
+{
+    uint64_t id = next_id++;
+    if (period == 0)
+        period = 1;
+    push({clock + period, id, period, std::move(event)});
+    return id;
+}
+
+void Z80Scheduler::cancel(uint64_t id)
+{
+    if (id == firing)
+    {
+        cancelled.insert(id); // A periodic event stopping itself
+        return;
+    }
+    for (const Entry &entry : heap)
+    {
+        if (entry.id == id)
+        {
+            cancelled.insert(id); // Dropped when it reaches the top
+            return;
+        }
+    }
+}
+
+// Fire every event whose deadline has been reached, earliest first
+void Z80Scheduler::fire_due()
+{
+    while (!heap.empty() && heap.front().when <= clock)
+    {
+        std::pop_heap(heap.begin(), heap.end(), Later());
+        Entry entry = std::move(heap.back());
+        heap.pop_back();
+        if (cancelled.erase(entry.id) != 0)
+            continue;
+
+        firing = entry.id;
+        entry.event(*this); // May schedule or cancel events
+        firing = 0;
+        bool stopped = cancelled.erase(entry.id) != 0;
+        if (entry.period != 0 && !stopped)
+        {
+            entry.when += entry.period;
+            push(std::move(entry));
+        }
+    }
+}
+
+uint64_t Z80Scheduler::run(uint64_t cycles)
+{
+    uint64_t start = clock;
+    uint64_t end = clock + cycles;
+
+    fire_due(); // Anything already due goes before the first instruction
+    while (clock < end)
+    {
+        uint64_t deadline = heap.empty() ? end : std::min(end, heap.front().when);
+        if (deadline > clock)
+        {
+            uint64_t burst = std::min<uint64_t>(deadline - clock, Z80_SCHED_MAX_BURST);
+            uint64_t ran = static_cast<uint64_t>(m.execute(static_cast<int>(burst)));
+            clock += ran;
+            if (m.stop_info().reason != Z80_STOP_NONE)
+                break; // At a breakpoint or watch: the caller looks before going on
+            if (ran < burst && m.cpu.halted)
+                clock += m.idle(static_cast<int>(burst - ran)); // Nothing runs until an event wakes the CPU
+        }
+        fire_due();
+    }
+
+    Z80_LOG_SUMMARY("Scheduler ran %llu cycles, %zu events pending\n",
+                    static_cast<unsigned long long>(clock - start), pending());
+    return clock - start;
+}
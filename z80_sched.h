@@ -0,0 +1,100 @@
+#ifndef Z80_SCHED_H
+#define Z80_SCHED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+#include "z80.h"
+
+// Longest single execute() call made by run(), in T-states
+#define Z80_SCHED_MAX_BURST 0x40000000
+
+// Timed events for one machine: timer ticks, interrupt requests, device
+// callbacks. Events sit in a min-heap ordered by deadline, and run() lets
+// the CPU execute in straight-line bursts up to the next deadline instead
+// of polling devices after every instruction. Events fire at the end of
+// the instruction that reaches their deadline; ties fire in the order they
+// were scheduled.
+class Z80Scheduler
+{
+public:
+    typedef std::function<void(Z80Scheduler &sched)> Event;
+
+    explicit Z80Scheduler(Z80Machine &machine);
+
+    Z80Scheduler(const Z80Scheduler &) = delete;
+    Z80Scheduler &operator=(const Z80Scheduler &) = delete;
+
+    Z80Machine &machine()
+    {
+        return m;
+    }
+
+    // T-states run since the scheduler was created
+    uint64_t now() const
+    {
+        return clock;
+    }
+
+    // Call event once at time `when` (or as soon as possible if that has
+    // passed). Returns an id for cancel().
+    uint64_t at(uint64_t when, Event event);
+
+    // Call event once, `delay` T-states from now
+    uint64_t after(uint64_t delay, Event event)
+    {
+        return at(clock + delay, std::move(event));
+    }
+
+    // Call event every `period` T-states, the first time one period from
+    // now. Later deadlines are counted from the previous one, so a late
+    // tick does not make the timer drift.
+    uint64_t every(uint64_t period, Event event);
+
+    // Forget a pending event. Unknown or already fired ids are ignored.
+    void cancel(uint64_t id);
+
+    // Events not yet fired or cancelled
+    size_t pending() const
+    {
+        return heap.size() - cancelled.size();
+    }
+
+    // Run the machine for `cycles` T-states, firing events on the way. A
+    // halted CPU with nothing to wake it skips ahead to the next deadline.
+    // Returns the T-states that passed (at least `cycles`, as the last
+    // instruction may overrun), or fewer if a breakpoint or watch stopped
+    // the machine (Z80Machine::stop_info).
+    uint64_t run(uint64_t cycles);
+
+private:
+    struct Entry
+    {
+        uint64_t when;
+        uint64_t id;     // Also the order of scheduling, for ties
+        uint64_t period; // 0 for one-shot events
+        Event event;
+    };
+
+    struct Later
+    {
+        bool operator()(const Entry &x, const Entry &y) const
+        {
+            return x.when != y.when ? x.when > y.when : x.id > y.id;
+        }
+    };
+
+    void push(Entry entry);
+    void fire_due();
+
+    Z80Machine &m;
+    uint64_t clock = 0;
+    uint64_t next_id = 1;
+    uint64_t firing = 0;                    // Id of the event being called
+    std::vector<Entry> heap;                // Min-heap on (when, id)
+    std::unordered_set<uint64_t> cancelled; // Ids still in the heap but dead
+};
+
+#endif // Z80_SCHED_H
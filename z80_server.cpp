@@ -0,0 +1,226 @@
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "z80_capi.h"
+
+// Job server on top of libz80. Jobs arrive on stdin (replies on stdout) or
+// on a Unix socket, one connection per client, and each connection keeps
+// one warm machine for all of its jobs. Little-endian framing:
+//
+//   request  "Z80J", u32 flags, u64 T-states, u32 image bytes (at most
+//            65536), u16 dump address, u16 reserved, u32 dump bytes (at
+//            most 65536), then the image, loaded at 0000h
+//   flags    bit 0  run with the JIT
+//            bit 1  reply in JSON instead of binary
+//   reply    "Z80R", u32 status, u64 T-states run, the z80_regs fields in
+//            order (12 words, 6 bytes, 2 zero bytes), u32 dump bytes, then
+//            the dump
+//   JSON     one line: {"status": 0, "cycles": N, "pc": N, ..., "memory": "hex"}
+//   status   0 ran; 1 the request was out of range, nothing ran
+//
+// A request that does not start with "Z80J" closes the connection.
+
+#define SERVER_REQUEST_MAGIC "Z80J"
+#define SERVER_REPLY_MAGIC "Z80R"
+#define SERVER_REQUEST_BYTES 28
+#define SERVER_FLAG_JIT 0x01
+#define SERVER_FLAG_JSON 0x02
+
+static bool read_full(int fd, void *data, size_t size)
+{
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (size != 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void *data, size_t size)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (size != 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0] | p[1] << 8 | p[2] << 16) | static_cast<uint32_t>(p[3]) << 24;
+}
+
+static void put(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+    for (int n = 0; n < bytes; n++)
+        out.push_back(static_cast<uint8_t>(value >> (8 * n)));
+}
+
+static void binary_reply(std::vector<uint8_t> &out, uint32_t status, uint64_t cycles, const z80_regs &regs,
+                         const std::vector<uint8_t> &dump)
+{
+    out.insert(out.end(), SERVER_REPLY_MAGIC, SERVER_REPLY_MAGIC + 4);
+    put(out, status, 4);
+    put(out, cycles, 8);
+    const uint16_t words[] = {regs.pc, regs.sp, regs.af, regs.bc, regs.de, regs.hl, regs.ix, regs.iy,
+                              regs.af_prime, regs.bc_prime, regs.de_prime, regs.hl_prime};
+    for (uint16_t word : words)
+        put(out, word, 2);
+    const uint8_t bytes[] = {regs.i, regs.r, regs.iff1, regs.iff2, regs.im, regs.halted, 0, 0};
+    out.insert(out.end(), bytes, bytes + sizeof(bytes));
+    put(out, dump.size(), 4);
+    out.insert(out.end(), dump.begin(), dump.end());
+}
+
+static void json_reply(std::vector<uint8_t> &out, uint32_t status, uint64_t cycles, const z80_regs &regs,
+                       const std::vector<uint8_t> &dump)
+{
+    char line[512];
+    int n = std::snprintf(line, sizeof(line),
+                          "{\"status\": %u, \"cycles\": %llu, \"pc\": %u, \"sp\": %u, \"af\": %u, \"bc\": %u, "
+                          "\"de\": %u, \"hl\": %u, \"ix\": %u, \"iy\": %u, \"af_prime\": %u, \"bc_prime\": %u, "
+                          "\"de_prime\": %u, \"hl_prime\": %u, \"i\": %u, \"r\": %u, \"iff1\": %u, \"iff2\": %u, "
+                          "\"im\": %u, \"halted\": %u, \"memory\": \"",
+                          status, static_cast<unsigned long long>(cycles), regs.pc, regs.sp, regs.af, regs.bc,
+                          regs.de, regs.hl, regs.ix, regs.iy, regs.af_prime, regs.bc_prime, regs.de_prime,
+                          regs.hl_prime, regs.i, regs.r, regs.iff1, regs.iff2, regs.im, regs.halted);
+    out.insert(out.end(), line, line + n);
+    static const char hex[] = "0123456789abcdef";
+    for (uint8_t byte : dump)
+    {
+        out.push_back(static_cast<uint8_t>(hex[byte >> 4]));
+        out.push_back(static_cast<uint8_t>(hex[byte & 15]));
+    }
+    const char *end = "\"}\n";
+    out.insert(out.end(), end, end + 3);
+}
+
+// Answer jobs from `in` on `out` until the client goes away
+static void serve(int in, int out)
+{
+    z80_machine *m = z80_create();
+    if (m == nullptr)
+        return;
+    std::vector<uint8_t> image, dump, reply;
+    int jit = -1; // JIT setting of the warm machine, -1 before the first job
+    for (;;)
+    {
+        uint8_t head[SERVER_REQUEST_BYTES];
+        if (!read_full(in, head, sizeof(head)) || std::memcmp(head, SERVER_REQUEST_MAGIC, 4) != 0)
+            break;
+        uint32_t flags = get32(head + 4);
+        uint64_t cycles = get32(head + 8) | static_cast<uint64_t>(get32(head + 12)) << 32;
+        uint32_t image_size = get32(head + 16);
+        uint16_t dump_addr = static_cast<uint16_t>(head[20] | head[21] << 8);
+        uint32_t dump_size = get32(head + 24);
+        bool valid = image_size <= 65536 && dump_size <= 65536;
+
+        image.resize(valid ? image_size : 0);
+        if (!valid || !read_full(in, image.data(), image.size()))
+            valid = false;
+
+        z80_regs regs;
+        uint64_t ran = 0;
+        dump.clear();
+        if (valid)
+        {
+            int want = (flags & SERVER_FLAG_JIT) != 0;
+            if (want != jit)
+                jit = z80_set_jit(m, want) != 0 ? want : 0; // Only on a change: it drops cached code
+            z80_load(m, image.data(), image.size());
+            ran = z80_run(m, cycles);
+            dump.resize(dump_size);
+            z80_read_memory(m, dump_addr, dump.data(), dump.size());
+        }
+        z80_read_regs(m, &regs);
+
+        reply.clear();
+        if (flags & SERVER_FLAG_JSON)
+            json_reply(reply, valid ? 0 : 1, ran, regs, dump);
+        else
+            binary_reply(reply, valid ? 0 : 1, ran, regs, dump);
+        if (!write_full(out, reply.data(), reply.size()) || image.size() != image_size)
+            break; // An oversized image was not read, so the stream is out of step
+    }
+    z80_destroy(m);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string socket_path;
+    std::signal(SIGPIPE, SIG_IGN); // A client hanging up ends its connection, not the server
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strncmp(argv[i], "--socket=", 9) == 0)
+        {
+            socket_path = argv[i] + 9;
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--socket=path]" << std::endl;
+            return -1;
+        }
+    }
+
+    if (socket_path.empty())
+    {
+        serve(STDIN_FILENO, STDOUT_FILENO);
+        return 0;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Error: socket path too long" << std::endl;
+        return 1;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listener, 64) != 0)
+    {
+        std::cerr << "Error: cannot listen on " << socket_path << std::endl;
+        return 1;
+    }
+
+    for (;;)
+    {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        std::thread([client]() {
+            serve(client, client);
+            close(client);
+        }).detach();
+    }
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cstring>
+#include "z80_sched.h"
+#include "z80_snap.h"
+#include "z80_trace.h"
+
+Z80Snapshots::Z80Snapshots(Z80Machine &machine, uint64_t interval, size_t arena_pages)
+    : m(machine), interval(std::max<uint64_t>(interval, 1))
+{
+    arena_pages = std::max<size_t>(arena_pages, Z80_SNAP_MIN_PAGES);
+    arena.reset(new uint8_t[arena_pages * Z80_PAGE_SIZE]);
+    free_list.reserve(arena_pages);
+    for (size_t page = arena_pages; page-- > 0;)
+        free_list.push_back(static_cast<int32_t>(page)); // Lowest pages handed out first
+    ring.resize(arena_pages);
+
+    m.track_dirty(true);
+    checkpoint(); // The oldest checkpoint always holds every slot
+}
+
+Z80Snapshots::~Z80Snapshots()
+{
+    m.track_dirty(false);
+}
+
+void Z80Snapshots::free_pages(const Checkpoint &cp)
+{
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        if (cp.page[slot] >= 0)
+            free_list.push_back(cp.page[slot]);
+}
+
+// Fold the oldest checkpoint into the next one: slots the next one did not
+// store move over, so it becomes the new full checkpoint
+void Z80Snapshots::drop_oldest()
+{
+    Checkpoint &oldest = at(0);
+    Checkpoint &after = at(1);
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+    {
+        if (after.page[slot] < 0)
+            after.page[slot] = oldest.page[slot];
+        else
+            free_list.push_back(oldest.page[slot]);
+    }
+    head = (head + 1) % ring.size();
+    used--;
+}
+
+void Z80Snapshots::checkpoint()
+{
+    bool full = used == 0;
+    size_t needed = 0;
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        needed += full || m.page_dirty(slot);
+
+    // The last checkpoint left holds at most Z80_PAGES pages, so the arena
+    // (and the ring, one slot per page) always has room once enough old ones
+    // are folded away
+    while (used > 1 && (used == ring.size() || free_list.size() < needed))
+        drop_oldest();
+
+    Checkpoint &cp = at(used);
+    cp.clock = clock;
+    cp.cpu = m.cpu;
+    cp.int_lines = m.int_lines & ~Z80_LINE_STOP;
+    cp.int_data = m.int_data;
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+    {
+        cp.page[slot] = -1;
+        if (full || m.page_dirty(slot))
+        {
+            cp.page[slot] = free_list.back();
+            free_list.pop_back();
+            std::memcpy(arena_page(cp.page[slot]), m.memory_map.read_page[slot], Z80_PAGE_SIZE);
+        }
+    }
+    used++;
+    next = clock + interval;
+    m.clear_dirty();
+}
+
+uint64_t Z80Snapshots::run(uint64_t cycles)
+{
+    uint64_t start = clock;
+    uint64_t end = clock + cycles;
+
+    while (clock < end)
+    {
+        uint64_t deadline = std::min(end, next);
+        uint64_t burst = std::min<uint64_t>(deadline - clock, Z80_SCHED_MAX_BURST);
+        uint64_t ran = static_cast<uint64_t>(m.execute(static_cast<int>(burst)));
+        clock += ran;
+        if (m.stop_info().reason != Z80_STOP_NONE)
+            break;
+        if (ran < burst && m.cpu.halted)
+            clock += m.idle(static_cast<int>(burst - ran));
+        if (clock >= next)
+            checkpoint();
+    }
+    return clock - start;
+}
+
+bool Z80Snapshots::rewind(uint64_t when)
+{
+    if (when < oldest() || when > clock)
+        return false;
+
+    size_t k = used - 1;
+    while (at(k).clock > when)
+        k--;
+
+    // Slots changed since checkpoint k: dirty now, or stored by a later one
+    bool changed[Z80_PAGES];
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        changed[slot] = m.page_dirty(slot);
+    for (size_t i = k + 1; i < used; i++)
+    {
+        for (int slot = 0; slot < Z80_PAGES; slot++)
+            changed[slot] |= at(i).page[slot] >= 0;
+        free_pages(at(i));
+    }
+    used = k + 1;
+
+    int restored = 0;
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+    {
+        if (!changed[slot])
+            continue;
+        size_t j = k;
+        while (at(j).page[slot] < 0)
+            j--; // Stops at the oldest, which holds every slot
+        std::memcpy(m.memory_map.write_page[slot], arena_page(at(j).page[slot]), Z80_PAGE_SIZE);
+        if (m.block_count != 0)
+            m.invalidate_code(static_cast<uint16_t>(slot << Z80_PAGE_BITS), Z80_PAGE_SIZE);
+        restored++;
+    }
+    m.retired.clear();
+
+    const Checkpoint &cp = at(k);
+    m.cpu = cp.cpu;
+    m.int_lines = cp.int_lines;
+    m.int_data = cp.int_data;
+    clock = cp.clock;
+    next = clock + interval;
+    m.clear_dirty();
+
+    Z80_LOG_SUMMARY("Rewound to checkpoint at %llu, %d slots restored\n",
+                    static_cast<unsigned long long>(clock), restored);
+    run(when - clock);
+    return true;
+}
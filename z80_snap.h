@@ -0,0 +1,105 @@
+#ifndef Z80_SNAP_H
+#define Z80_SNAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "z80.h"
+
+// Smallest arena accepted, in pages: room for a full checkpoint plus a full
+// set of changes on top of it
+#define Z80_SNAP_MIN_PAGES (2 * Z80_PAGES)
+
+// Periodic checkpoints of one machine, for rewinding it. run() executes in
+// bursts and takes a checkpoint every `interval` T-states. A checkpoint
+// holds the CPU, the pending interrupt lines and only the memory slots
+// written through mem_write since the one before (Z80Machine::track_dirty);
+// the oldest one holds every slot. Pages come from one arena allocated up
+// front and checkpoints sit in a ring; when either runs out, the oldest
+// checkpoint is folded into the next.
+//
+// rewind() copies back just the slots changed since the nearest checkpoint
+// at or before the target, then runs forward to it. That lands on the same
+// instruction boundary a straight run would have stopped at, so long as the
+// machine is deterministic from the checkpoint on: devices, scheduler
+// events and the bank map are not captured, and memory changed behind
+// mem_write's back (load(), ram[], map_page()) is not seen.
+class Z80Snapshots
+{
+public:
+    // Checkpoint m every `interval` T-states into an arena of `arena_pages`
+    // pages (Z80_PAGE_SIZE bytes each, at least Z80_SNAP_MIN_PAGES). Takes
+    // the first checkpoint straight away, at time 0.
+    Z80Snapshots(Z80Machine &machine, uint64_t interval, size_t arena_pages);
+    ~Z80Snapshots();
+    Z80Snapshots(const Z80Snapshots &) = delete;
+    Z80Snapshots &operator=(const Z80Snapshots &) = delete;
+
+    // Run the machine for `cycles` T-states, taking checkpoints on the way.
+    // Returns the T-states that passed, fewer if a breakpoint or watch
+    // stopped the machine.
+    uint64_t run(uint64_t cycles);
+
+    // Take a checkpoint now, off the regular schedule
+    void checkpoint();
+
+    // Put the machine back to time `when` (the first instruction boundary
+    // at or after it). Checkpoints after it are dropped. The run forward
+    // stops early at a breakpoint or watch, as run() does. Returns false if
+    // `when` is before the oldest checkpoint or after now.
+    bool rewind(uint64_t when);
+
+    // T-states run since the first checkpoint
+    uint64_t now() const
+    {
+        return clock;
+    }
+
+    size_t count() const
+    {
+        return used;
+    }
+
+    // Earliest time rewind() can reach
+    uint64_t oldest() const
+    {
+        return ring[head].clock;
+    }
+
+private:
+    struct Checkpoint
+    {
+        uint64_t clock;
+        Z80_CPU cpu;
+        uint8_t int_lines;
+        uint8_t int_data;
+        int32_t page[Z80_PAGES]; // Arena page holding the slot, -1 if unchanged
+    };
+
+    // i-th checkpoint, oldest first
+    Checkpoint &at(size_t i)
+    {
+        return ring[(head + i) % ring.size()];
+    }
+
+    uint8_t *arena_page(int32_t page)
+    {
+        return arena.get() + static_cast<size_t>(page) * Z80_PAGE_SIZE;
+    }
+
+    void drop_oldest();
+    void free_pages(const Checkpoint &cp);
+
+    Z80Machine &m;
+    uint64_t interval;
+    uint64_t clock = 0;
+    uint64_t next = 0; // Time of the next scheduled checkpoint
+    std::unique_ptr<uint8_t[]> arena;
+    std::vector<int32_t> free_list; // Unused arena pages
+    std::vector<Checkpoint> ring;   // One slot per arena page, at most
+    size_t head = 0;                // Oldest checkpoint
+    size_t used = 0;
+};
+
+#endif // Z80_SNAP_H
@@ -0,0 +1,225 @@
+#include <cstdio>
+#include <cstring>
+#include "z80_flags.h"
+#include "z80_state.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define Z80_STATE_MMAP 1
+#else
+#define Z80_STATE_MMAP 0
+#endif
+
+#define Z80_STATE_CPU 16     // Offset of the CPU fields in the header
+#define Z80_STATE_DEVICE 12  // Bytes per device table entry
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    put16(p, static_cast<uint16_t>(value));
+    put16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | static_cast<uint32_t>(get16(p + 2)) << 16;
+}
+
+bool z80_save_state(const std::string &filename, const Z80Machine &m, const std::vector<Z80_StateDevice> &devices)
+{
+    size_t blobs = Z80_STATE_HEADER + devices.size() * Z80_STATE_DEVICE;
+    size_t table = Z80_STATE_HEADER;
+    size_t end = blobs;
+    for (const Z80_StateDevice &device : devices)
+        end += device.data.size();
+    size_t memory = (end + Z80_STATE_ALIGN - 1) / Z80_STATE_ALIGN * Z80_STATE_ALIGN;
+
+    std::vector<uint8_t> head(memory, 0);
+    std::memcpy(head.data(), Z80_STATE_MAGIC, 4);
+    put16(&head[4], Z80_STATE_VERSION);
+    put16(&head[6], Z80_STATE_HEADER);
+    put32(&head[8], static_cast<uint32_t>(memory));
+    put32(&head[12], static_cast<uint32_t>(devices.size()));
+
+    Z80_CPU cpu = m.cpu;
+    const uint16_t words[] = {
+        cpu.pc, cpu.sp, static_cast<uint16_t>(cpu.a << 8 | flags_get(cpu)), cpu.bc, cpu.de, cpu.hl,
+        cpu.ix, cpu.iy, cpu.af_prime, cpu.bc_prime, cpu.de_prime, cpu.hl_prime};
+    uint8_t *p = &head[Z80_STATE_CPU];
+    for (uint16_t word : words)
+    {
+        put16(p, word);
+        p += 2;
+    }
+    const uint8_t bytes[] = {
+        cpu.i, cpu.r, cpu.interrupt_enable, cpu.iff2, cpu.im, cpu.halted, cpu.ei_delay,
+        static_cast<uint8_t>(m.int_lines & ~Z80_LINE_STOP), m.int_data};
+    std::memcpy(p, bytes, sizeof(bytes));
+
+    for (const Z80_StateDevice &device : devices)
+    {
+        put32(&head[table], device.tag);
+        put32(&head[table + 4], static_cast<uint32_t>(blobs));
+        put32(&head[table + 8], static_cast<uint32_t>(device.data.size()));
+        if (!device.data.empty())
+            std::memcpy(&head[blobs], device.data.data(), device.data.size());
+        table += Z80_STATE_DEVICE;
+        blobs += device.data.size();
+    }
+
+    std::vector<uint8_t> image(65536);
+    for (int slot = 0; slot < Z80_PAGES; slot++)
+        std::memcpy(&image[slot * Z80_PAGE_SIZE], m.memory_map.read_page[slot], Z80_PAGE_SIZE);
+
+    FILE *file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fwrite(head.data(), 1, head.size(), file) == head.size() &&
+              std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+Z80SavedState::~Z80SavedState()
+{
+    close();
+}
+
+void Z80SavedState::close()
+{
+#if Z80_STATE_MMAP
+    if (mapped)
+        munmap(file_data, file_size);
+    else
+        delete[] file_data;
+#else
+    delete[] file_data;
+#endif
+    file_data = nullptr;
+    file_size = 0;
+    mapped = false;
+    memory = nullptr;
+}
+
+bool Z80SavedState::open(const std::string &filename)
+{
+    close();
+#if Z80_STATE_MMAP
+    // One private writable mapping of the whole file: the header is read
+    // from it and the machine runs on its memory image, copying a page only
+    // when the program first writes it
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *region = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED)
+        {
+            file_data = static_cast<uint8_t *>(region);
+            file_size = static_cast<size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (!mapped)
+        return false;
+#else
+    FILE *file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size > 0)
+    {
+        file_data = new uint8_t[size];
+        file_size = static_cast<size_t>(size);
+        if (std::fread(file_data, 1, file_size, file) != file_size)
+            file_size = 0;
+    }
+    std::fclose(file);
+#endif
+
+    if (file_size < Z80_STATE_HEADER || std::memcmp(file_data, Z80_STATE_MAGIC, 4) != 0 ||
+        get16(file_data + 4) != Z80_STATE_VERSION || get16(file_data + 6) != Z80_STATE_HEADER)
+    {
+        close();
+        return false;
+    }
+    size_t offset = get32(file_data + 8);
+    size_t devices = get32(file_data + 12);
+    bool fits = offset % Z80_STATE_ALIGN == 0 && offset + 65536 <= file_size &&
+                Z80_STATE_HEADER + devices * Z80_STATE_DEVICE <= offset;
+    for (size_t n = 0; fits && n < devices; n++)
+    {
+        const uint8_t *entry = file_data + Z80_STATE_HEADER + n * Z80_STATE_DEVICE;
+        fits = static_cast<size_t>(get32(entry + 4)) + get32(entry + 8) <= offset;
+    }
+    if (!fits)
+    {
+        close();
+        return false;
+    }
+    memory = file_data + offset;
+    return true;
+}
+
+void Z80SavedState::restore(Z80Machine &m)
+{
+    const uint8_t *p = file_data + Z80_STATE_CPU;
+    std::memset(&m.cpu, 0, sizeof(Z80_CPU));
+    m.cpu.pc = get16(p);
+    m.cpu.sp = get16(p + 2);
+    m.cpu.af = get16(p + 4); // flag_op is FLAGS_NONE: F is current
+    m.cpu.bc = get16(p + 6);
+    m.cpu.de = get16(p + 8);
+    m.cpu.hl = get16(p + 10);
+    m.cpu.ix = get16(p + 12);
+    m.cpu.iy = get16(p + 14);
+    m.cpu.af_prime = get16(p + 16);
+    m.cpu.bc_prime = get16(p + 18);
+    m.cpu.de_prime = get16(p + 20);
+    m.cpu.hl_prime = get16(p + 22);
+    p += 24;
+    m.cpu.i = p[0];
+    m.cpu.r = p[1];
+    m.cpu.interrupt_enable = p[2];
+    m.cpu.iff2 = p[3];
+    m.cpu.im = p[4];
+    m.cpu.halted = p[5];
+    m.cpu.ei_delay = p[6];
+    m.int_lines = p[7] & ~Z80_LINE_STOP;
+    m.int_data = p[8];
+    m.attach_memory(memory);
+}
+
+const uint8_t *Z80SavedState::device(uint32_t tag, size_t &size) const
+{
+    if (file_data == nullptr)
+        return nullptr;
+    size_t devices = get32(file_data + 12);
+    for (size_t n = 0; n < devices; n++)
+    {
+        const uint8_t *entry = file_data + Z80_STATE_HEADER + n * Z80_STATE_DEVICE;
+        if (get32(entry) == tag)
+        {
+            size = get32(entry + 8);
+            return file_data + get32(entry + 4);
+        }
+    }
+    return nullptr;
+}
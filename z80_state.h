@@ -0,0 +1,79 @@
+#ifndef Z80_STATE_H
+#define Z80_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "z80.h"
+
+// Save-state file. Little-endian, laid out so the memory image can be
+// mapped straight from the file:
+//
+//   0       header  "Z80S", u16 version, u16 header bytes (Z80_STATE_HEADER),
+//                   u32 memory offset, u32 device count, then the CPU:
+//                   u16 PC SP AF BC DE HL IX IY AF' BC' DE' HL',
+//                   u8 I R IFF1 IFF2 IM halted ei_delay, interrupt lines,
+//                   INT bus byte, zeros up to Z80_STATE_HEADER
+//   64      device table, one {u32 tag, u32 offset, u32 size} per device,
+//           then the device blobs
+//   memory offset (a multiple of Z80_STATE_ALIGN)
+//           the 64KB address space as the CPU saw it
+//
+// Restoring maps the memory image copy-on-write and runs the machine on it
+// (Z80Machine::attach_memory), so only the pages the program then writes
+// are ever copied. Device state is opaque to the format: each device saves
+// a blob under a tag of its choosing and reads it back by that tag.
+
+#define Z80_STATE_MAGIC "Z80S"
+#define Z80_STATE_VERSION 1
+#define Z80_STATE_HEADER 64
+#define Z80_STATE_ALIGN 65536 // Memory offset alignment, a multiple of any host page size
+
+struct Z80_StateDevice
+{
+    uint32_t tag;
+    std::vector<uint8_t> data;
+};
+
+// Write m's registers, interrupt lines and memory, plus the device blobs,
+// to a state file. Banked slots are saved as the bytes they show, so the
+// state restores as flat memory. Returns false if the file could not be
+// written.
+bool z80_save_state(const std::string &filename, const Z80Machine &m,
+                    const std::vector<Z80_StateDevice> &devices = std::vector<Z80_StateDevice>());
+
+// An open state file. The memory image stays mapped for as long as the
+// object lives, and a machine restored from it runs on that mapping, so it
+// must outlive the machine's use of it (or the machine's next
+// attach_memory()).
+class Z80SavedState
+{
+public:
+    Z80SavedState() = default;
+    ~Z80SavedState();
+    Z80SavedState(const Z80SavedState &) = delete;
+    Z80SavedState &operator=(const Z80SavedState &) = delete;
+
+    // Open and check a state file. Returns false if it cannot be read, is
+    // not a state file or has another version.
+    bool open(const std::string &filename);
+
+    // Put the saved registers and interrupt lines into m and point its
+    // memory at the saved image. Breakpoints, watches and ports are kept,
+    // as by init().
+    void restore(Z80Machine &m);
+
+    // Blob a device saved under tag, or nullptr if there is none
+    const uint8_t *device(uint32_t tag, size_t &size) const;
+
+private:
+    void close();
+
+    uint8_t *file_data = nullptr;  // Whole file, mapped or read
+    size_t file_size = 0;
+    bool mapped = false;
+    uint8_t *memory = nullptr;     // 64KB image, copy-on-write when mapped
+};
+
+#endif // Z80_STATE_H
@@ -0,0 +1,1059 @@
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "z80.h"
+#include "z80_batch.h"
+#include "z80_btrace.h"
+#include "z80_bus.h"
+#include "z80_capi.h"
+#include "z80_flags.h"
+#include "z80_io.h"
+#include "z80_profile.h"
+#include "z80_sched.h"
+#include "z80_snap.h"
+#include "z80_state.h"
+#include "z80_trace.h"
+
+// Regression tests, one per ctest entry: z80_test <name> runs a test and
+// exits non-zero if it fails, z80_test with no name runs them all.
+
+#define TEST_BATCH_LANES 64
+#define TEST_BATCH_BUDGET 1000
+#define TEST_JIT_BUDGET 100000
+#define TEST_RUN_OVERRUN 32 // More than the T-states of any one instruction
+#define TEST_BLOCK_BUDGET 4000000 // T-states each block instruction test may take
+#define TEST_DEBUG_RUNS 100 // execute() calls a breakpoint or watch test may take
+#define TEST_SNAP_CYCLES 1000000 // Checkpointed run before the first rewind
+#define TEST_SNAP_AGAIN 5000 // Run on after each rewind
+#define TEST_STATE_CYCLES 50000 // Run before a save and again after the restore
+#define TEST_BUS_CYCLES 10000 // M-cycles the bus test may take to reach each HALT
+
+static Z80Machine machine;
+
+// Registers for lane n: varied values and every F pattern the branch
+// conditions look at, so conditional ops go both ways across the lanes
+static Z80_CPU test_lane_state(int n)
+{
+    machine.init();
+    Z80_CPU cpu = machine.cpu;
+    cpu.a = static_cast<uint8_t>(n * 37 + 1);
+    cpu.f = static_cast<uint8_t>(n * 11);
+    cpu.b = static_cast<uint8_t>(n * 5 + 0x7F);
+    cpu.c = static_cast<uint8_t>(n * 3 + 0xFF);
+    cpu.d = static_cast<uint8_t>(n * 7);
+    cpu.e = static_cast<uint8_t>(n + 0x0F);
+    cpu.h = static_cast<uint8_t>(n * 13 + 0x80);
+    cpu.l = static_cast<uint8_t>(n * 17);
+    return cpu;
+}
+
+// Every opcode Z80Batch::execute() runs as a kernel must take the T-states
+// the interpreter takes and leave the same registers. Each program is the
+// opcode followed by a HALT (branches land on the HALT whichever way they
+// go), run on a batch and lane by lane on Z80Machine.
+static bool test_batch_timing()
+{
+    static const std::vector<std::vector<uint8_t>> programs = {
+        {0x00, 0x76},                                                         // NOP
+        {0x06, 0x5A, 0x76}, {0x0E, 0x5A, 0x76}, {0x16, 0x5A, 0x76}, {0x1E, 0x5A, 0x76}, // LD r, n
+        {0x26, 0x5A, 0x76}, {0x2E, 0x5A, 0x76}, {0x3E, 0x5A, 0x76},
+        {0x01, 0x34, 0x12, 0x76}, {0x11, 0x34, 0x12, 0x76}, {0x21, 0x34, 0x12, 0x76}, // LD rr, nn
+        {0x04, 0x76}, {0x0C, 0x76}, {0x14, 0x76}, {0x1C, 0x76}, {0x24, 0x76}, {0x2C, 0x76}, {0x3C, 0x76}, // INC r
+        {0x05, 0x76}, {0x0D, 0x76}, {0x15, 0x76}, {0x1D, 0x76}, {0x25, 0x76}, {0x2D, 0x76}, {0x3D, 0x76}, // DEC r
+        {0x80, 0x76}, {0x90, 0x76},                                           // ADD A, B / SUB B
+        {0x18, 0x00, 0x76}, {0xC3, 0x03, 0x00, 0x76},                         // JR e / JP nn
+        {0x20, 0x00, 0x76}, {0x28, 0x00, 0x76}, {0x30, 0x00, 0x76}, {0x38, 0x00, 0x76}, // JR cc, e
+        {0xC2, 0x03, 0x00, 0x76}, {0xCA, 0x03, 0x00, 0x76}, {0xD2, 0x03, 0x00, 0x76}, // JP cc, nn
+        {0xDA, 0x03, 0x00, 0x76}, {0xE2, 0x03, 0x00, 0x76}, {0xEA, 0x03, 0x00, 0x76},
+        {0xF2, 0x03, 0x00, 0x76}, {0xFA, 0x03, 0x00, 0x76},
+        {0x76},                                                               // HALT
+        {0xCB, 0x07, 0x76}, {0xCB, 0x08, 0x76}, {0xCB, 0x0F, 0x76}, {0xCB, 0x17, 0x76}, // CB shifts and BIT
+        {0xCB, 0x1F, 0x76}, {0xCB, 0x27, 0x76}, {0xCB, 0x28, 0x76}, {0xCB, 0x31, 0x76},
+        {0xCB, 0x3A, 0x76}, {0xCB, 0x6F, 0x76},
+    };
+
+    bool ok = true;
+    for (const std::vector<uint8_t> &program : programs)
+    {
+        Z80Batch batch(TEST_BATCH_LANES);
+        batch.load_image(program.data(), program.size());
+        for (int n = 0; n < TEST_BATCH_LANES; n++)
+            batch.set_lane(n, test_lane_state(n));
+        batch.execute(TEST_BATCH_BUDGET);
+
+        for (int n = 0; n < TEST_BATCH_LANES; n++)
+        {
+            Z80_CPU state = test_lane_state(n);
+            for (size_t i = 0; i < program.size(); i++)
+                machine.mem_write(static_cast<uint16_t>(i), program[i]);
+            machine.cpu = state;
+            int cycles = machine.execute(TEST_BATCH_BUDGET);
+
+            Z80_CPU want = machine.cpu, got = batch.get_lane(n);
+            if (batch.lane_cycles(n) != cycles || got.pc != want.pc || got.a != want.a ||
+                got.f != flags_get(want) || got.bc != want.bc || got.de != want.de || got.hl != want.hl)
+            {
+                std::printf("batch_timing: opcode %02X %02X lane %d: batch %d T-states PC %04X AF %02X%02X, "
+                            "interpreter %d T-states PC %04X AF %02X%02X\n",
+                            program[0], program[1], n, batch.lane_cycles(n), got.pc, got.a, got.f, cycles, want.pc,
+                            want.a, flags_get(want));
+                ok = false;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+// Budgets of 2^31 T-states and more must come back: z80_run splits them
+// into bursts, and execute() does not wrap on one near INT_MAX. JR $ spins
+// until the budget is spent.
+static bool test_run_long_budget()
+{
+    static const uint8_t program[] = {0x18, 0xFE}; // JR $
+    static const uint64_t budgets[] = {INT_MAX, 1ull << 31, 5000000000ull};
+
+    bool ok = true;
+    z80_machine *m = z80_create();
+    for (uint64_t budget : budgets)
+    {
+        z80_load(m, program, sizeof(program));
+        uint64_t ran = z80_run(m, budget);
+        z80_regs regs;
+        z80_read_regs(m, &regs);
+        if (ran < budget || ran > budget + TEST_RUN_OVERRUN || regs.pc != 0)
+        {
+            std::printf("run_long_budget: z80_run(%llu) ran %llu T-states, PC %04X\n",
+                        static_cast<unsigned long long>(budget), static_cast<unsigned long long>(ran), regs.pc);
+            ok = false;
+        }
+    }
+    z80_destroy(m);
+
+    machine.init();
+    machine.mem_write(0, program[0]);
+    machine.mem_write(1, program[1]);
+    int ran = machine.execute(INT_MAX);
+    if (ran < Z80_EXECUTE_MAX || ran > Z80_EXECUTE_MAX + TEST_RUN_OVERRUN || machine.cpu.pc != 0)
+    {
+        std::printf("run_long_budget: execute(INT_MAX) ran %d T-states, PC %04X\n", ran, machine.cpu.pc);
+        ok = false;
+    }
+    return ok;
+}
+
+// A machine loaded again and again with a file over 64KB (a ROM bank) must
+// only keep the last one: init() frees the banks of the load before.
+static bool test_reload_rom_bank()
+{
+    const char *path = "z80_test_rom.bin";
+    std::vector<uint8_t> rom(65536 + Z80_PAGE_SIZE, 0x76);
+    rom[0] = 0x3C; // INC A
+    FILE *file = std::fopen(path, "wb");
+    bool ok = file != nullptr && std::fwrite(rom.data(), 1, rom.size(), file) == rom.size();
+    if (file != nullptr)
+        std::fclose(file);
+
+    for (int n = 0; ok && n < 3; n++)
+    {
+        machine.init();
+        if (!machine.load(path) || machine.bank_pages(0) != rom.size() / Z80_PAGE_SIZE ||
+            machine.bank_pages(1) != 0 || machine.peek(0) != 0x3C)
+        {
+            std::printf("reload_rom_bank: load %d: bank 0 has %zu pages, bank 1 %zu, byte 0 is %02X\n", n,
+                        machine.bank_pages(0), machine.bank_pages(1), machine.peek(0));
+            ok = false;
+        }
+    }
+    std::remove(path);
+    machine.init();
+    return ok && machine.bank_pages(0) == 0;
+}
+
+// A new machine runs on shared zeros and only copies the pages it writes;
+// its own 64KB comes with the first init()
+static bool test_new_machine_memory()
+{
+    static const uint8_t program[] = {0x01, 0x00, 0x90, 0x3E, 0x5A, 0x02, 0x76}; // LD BC,9000h; LD A,5Ah; LD (BC),A; HALT
+    std::unique_ptr<Z80Machine> m(new Z80Machine());
+    for (size_t i = 0; i < sizeof(program); i++)
+        m->mem_write(static_cast<uint16_t>(i), program[i]);
+    m->execute(TEST_BATCH_BUDGET);
+
+    bool ok = m->ram == nullptr && m->private_pages() == (Z80_PAGES > 1 ? 2 : 1) && m->peek(0x9000) == 0x5A &&
+              m->peek(0x8FFF) == 0 && m->cpu.halted;
+    m->init();
+    ok = ok && m->ram != nullptr && m->private_pages() == 0 && m->peek(0x9000) == 0 && m->peek(0) == 0;
+    if (!ok)
+        std::printf("new_machine_memory: wrong memory before or after init()\n");
+    return ok;
+}
+
+// The program with the routine the JIT tests call put at 0040h: INC B; RET
+static std::vector<uint8_t> test_with_routine(std::vector<uint8_t> program)
+{
+    program.resize(0x40);
+    program.push_back(0x04);
+    program.push_back(0xC9);
+    return program;
+}
+
+// Run program from address 0 until HALT on a machine with the JIT and on
+// one without, and compare registers, T-states and all 64KB. Leaves the
+// interpreter's registers in `want`, for the test to check that the code
+// did what it should and the two did not just go wrong the same way.
+static bool test_jit_against_interpreter(const char *name, const std::vector<uint8_t> &program, Z80_CPU &want)
+{
+    std::unique_ptr<Z80Machine> jit(new Z80Machine()), interp(new Z80Machine());
+    int cycles[2];
+    Z80Machine *machines[2] = {jit.get(), interp.get()};
+    for (int n = 0; n < 2; n++)
+    {
+        machines[n]->init();
+        machines[n]->enable_jit(n == 0);
+        for (size_t i = 0; i < program.size(); i++)
+            machines[n]->mem_write(static_cast<uint16_t>(i), program[i]);
+        cycles[n] = machines[n]->execute(TEST_JIT_BUDGET);
+    }
+
+    Z80_CPU got = jit->cpu;
+    want = interp->cpu;
+    bool ok = cycles[0] == cycles[1] && got.halted && want.halted && got.pc == want.pc && got.sp == want.sp &&
+              got.a == want.a && flags_get(got) == flags_get(want) && got.bc == want.bc && got.de == want.de &&
+              got.hl == want.hl && got.ix == want.ix && got.iy == want.iy && got.r == want.r &&
+              std::memcmp(jit->ram, interp->ram, 65536) == 0;
+    if (!ok)
+        std::printf("%s: JIT %d T-states PC %04X BC %04X DE %04X, interpreter %d T-states PC %04X BC %04X DE %04X\n",
+                    name, cycles[0], got.pc, got.bc, got.de, cycles[1], want.pc, want.bc, want.de);
+    return ok;
+}
+
+// A routine run hot enough to be translated (INC B; RET at 0040h) is
+// patched to DEC B by a store that runs once, on the interpreter: the
+// native code has to go, so the second 100 calls count B back down to 0
+static bool test_jit_smc()
+{
+    std::vector<uint8_t> program = {
+        0x16, 0x64,             // 0000 LD D,100
+        0xDD, 0x21, 0x40, 0x00, // 0002 LD IX,0040h
+        0xCD, 0x40, 0x00,       // 0006 CALL 0040h
+        0x15,                   // 0009 DEC D
+        0x20, 0xFA,             // 000A JR NZ,0006
+        0x3E, 0x05,             // 000C LD A,05h (DEC B)
+        0xDD, 0x77, 0x00,       // 000E LD (IX+0),A
+        0x16, 0x64,             // 0011 LD D,100
+        0xCD, 0x40, 0x00,       // 0013 CALL 0040h
+        0x15,                   // 0016 DEC D
+        0x20, 0xFA,             // 0017 JR NZ,0013
+        0x76,                   // 0019 HALT
+    };
+    program.resize(0x40);
+    program.push_back(0x04); // 0040 INC B
+    program.push_back(0xC9); // 0041 RET
+
+    Z80_CPU want;
+    bool ok = test_jit_against_interpreter("jit_smc", program, want);
+    if (ok && want.b != 0)
+        std::printf("jit_smc: B is %02X, not 00\n", want.b);
+    return ok && want.b == 0;
+}
+
+// A translated loop stores down through memory until, on pass 130, it hits
+// the offset of its own JR. Z80Jit::mem_write reports the hit and the
+// native block has to stop there: the rest of it runs on the interpreter,
+// which sees the new offset (76h) and jumps to the HALTs the loop stored.
+static bool test_jit_write_trap()
+{
+    static const std::vector<uint8_t> program = {
+        0x16, 0xC8,       // 0000 LD D,200
+        0x01, 0x90, 0x00, // 0002 LD BC,0090h
+        0x3E, 0x76,       // 0005 LD A,76h (HALT)
+        0x1E, 0x00,       // 0007 LD E,0
+        0x02,             // 0009 LD (BC),A
+        0x0D,             // 000A DEC C
+        0x1C,             // 000B INC E
+        0x15,             // 000C DEC D
+        0x20, 0xFA,       // 000D JR NZ,0009
+        0x76,             // 000F HALT
+    };
+
+    Z80_CPU want;
+    bool ok = test_jit_against_interpreter("jit_write_trap", program, want);
+    if (ok && (want.de != 0x4583 || want.pc != 0x0085))
+        std::printf("jit_write_trap: DE %04X PC %04X, not 4583 0085\n", want.de, want.pc);
+    return ok && want.de == 0x4583 && want.pc == 0x0085;
+}
+
+// With no host draining it, the console keeps the first ring's worth of
+// output, drops the rest without blocking the writer and counts what it
+// dropped; the status port stops reporting room once the ring is full.
+static bool test_console_overflow()
+{
+    const uint8_t port = 0x01;
+    const size_t written = Z80_CONSOLE_RING + 10;
+    Z80PortBus bus;
+    Z80Console console;
+    if (!console.attach(bus, port))
+        return false;
+    for (size_t i = 0; i < written; i++)
+        bus.write(port, static_cast<uint8_t>(i));
+    bool ok = (bus.read(port + 1) & 0x02) == 0;
+
+    std::vector<uint8_t> received(written);
+    size_t n = console.receive(received.data(), received.size());
+    for (size_t i = 0; i < n; i++)
+        ok &= received[i] == static_cast<uint8_t>(i);
+    if (n + console.dropped() != written || n == 0)
+    {
+        std::printf("console_overflow: %zu received + %llu dropped, %zu written\n", n,
+                    static_cast<unsigned long long>(console.dropped()), written);
+        return false;
+    }
+    return ok && (bus.read(port + 1) & 0x02) != 0;
+}
+
+// Block instructions (LDIR, CPIR, OTIR...) run many iterations per dispatch
+// under execute() and one per step(). A program run both ways, execute()
+// in slices of `slice` T-states and step() until each slice is used up, has
+// to take the same T-states per slice and leave the same registers (R
+// included), memory and port writes. Leaves step()'s registers in `want`.
+struct Test_Block_Run
+{
+    const char *name;
+    std::vector<uint8_t> program;
+    void (*setup)(Z80Machine &m); // Memory and banks beyond the program, or nullptr
+};
+
+static void test_port_log(void *ctx, uint16_t port, uint8_t value)
+{
+    static_cast<std::vector<uint32_t> *>(ctx)->push_back(static_cast<uint32_t>(port) << 8 | value);
+}
+
+static bool test_block_against_steps(const Test_Block_Run &run, int slice, Z80_CPU &want)
+{
+    std::unique_ptr<Z80Machine> fast(new Z80Machine()), slow(new Z80Machine());
+    std::vector<uint32_t> out[2];
+    Z80Machine *machines[2] = {fast.get(), slow.get()};
+    for (int n = 0; n < 2; n++)
+    {
+        machines[n]->init();
+        machines[n]->ports.map(0x00, 0xFF, {nullptr, test_port_log, &out[n], false});
+        for (size_t i = 0; i < run.program.size(); i++)
+            machines[n]->mem_write(static_cast<uint16_t>(i), run.program[i]);
+        if (run.setup != nullptr)
+            run.setup(*machines[n]);
+    }
+
+    int64_t total = 0;
+    while (!fast->cpu.halted && total < TEST_BLOCK_BUDGET)
+    {
+        int ran = fast->execute(slice), stepped = 0;
+        while (stepped < slice && !slow->cpu.halted)
+            stepped += slow->step();
+        Z80_CPU got = fast->cpu;
+        want = slow->cpu;
+        if (ran != stepped || got.halted != want.halted || got.pc != want.pc || got.sp != want.sp ||
+            got.a != want.a || flags_get(got) != flags_get(want) || got.bc != want.bc || got.de != want.de ||
+            got.hl != want.hl || got.r != want.r)
+        {
+            std::printf("%s: slice %d at T-state %lld: execute() %d T-states PC %04X F %02X BC %04X DE %04X HL "
+                        "%04X R %02X, step() %d T-states PC %04X F %02X BC %04X DE %04X HL %04X R %02X\n",
+                        run.name, slice, static_cast<long long>(total), ran, got.pc, flags_get(got), got.bc, got.de,
+                        got.hl, got.r, stepped, want.pc, flags_get(want), want.bc, want.de, want.hl, want.r);
+            return false;
+        }
+        total += ran;
+    }
+    for (int addr = 0; addr < 65536; addr++)
+    {
+        if (fast->peek(static_cast<uint16_t>(addr)) != slow->peek(static_cast<uint16_t>(addr)))
+        {
+            std::printf("%s: slice %d: byte %04X is %02X, %02X after step()\n", run.name, slice, addr,
+                        fast->peek(static_cast<uint16_t>(addr)), slow->peek(static_cast<uint16_t>(addr)));
+            return false;
+        }
+    }
+    if (out[0] != out[1] || !fast->cpu.halted)
+    {
+        std::printf("%s: slice %d: %zu port writes, %zu after step()%s\n", run.name, slice, out[0].size(),
+                    out[1].size(), fast->cpu.halted ? "" : ", never halted");
+        return false;
+    }
+    return true;
+}
+
+// Every slice length: all at once, slices that cut runs short, and slices
+// shorter than one iteration
+static bool test_block_slices(const Test_Block_Run &run, Z80_CPU &want)
+{
+    static const int slices[] = {TEST_BLOCK_BUDGET, 1000, 97, 21, 7};
+    bool ok = true;
+    for (int slice : slices)
+        ok &= test_block_against_steps(run, slice, want);
+    return ok;
+}
+
+// Bytes 8000h-BFFFh numbered so every copy and search has something to find
+static void test_block_pattern(Z80Machine &m)
+{
+    for (int addr = 0x8000; addr < 0xC000; addr++)
+        m.mem_write(static_cast<uint16_t>(addr), static_cast<uint8_t>(addr * 7 + (addr >> 8)));
+}
+
+// LDIR and LDDR onto their own source: the fill idiom (DE one past HL) and
+// a 3-byte pattern, each way, across a slot boundary
+static bool test_block_overlap()
+{
+    Z80_CPU want;
+    return test_block_slices({"block_overlap",
+                              {
+                                  0x21, 0xF0, 0x8F,       // LD HL,8FF0h
+                                  0x11, 0xF3, 0x8F,       // LD DE,8FF3h
+                                  0x01, 0x40, 0x01,       // LD BC,0140h
+                                  0xED, 0xB0,             // LDIR
+                                  0x21, 0x00, 0xA0,       // LD HL,A000h
+                                  0x11, 0x01, 0xA0,       // LD DE,A001h
+                                  0x01, 0x00, 0x02,       // LD BC,0200h
+                                  0xED, 0xB0,             // LDIR
+                                  0x21, 0x10, 0xB0,       // LD HL,B010h
+                                  0x11, 0x0D, 0xB0,       // LD DE,B00Dh
+                                  0x01, 0x80, 0x00,       // LD BC,0080h
+                                  0xED, 0xB8,             // LDDR
+                                  0x21, 0x00, 0x91,       // LD HL,9100h
+                                  0x11, 0xFF, 0x90,       // LD DE,90FFh
+                                  0x01, 0x00, 0x03,       // LD BC,0300h
+                                  0xED, 0xB8,             // LDDR
+                                  0x76,                   // HALT
+                              },
+                              test_block_pattern},
+                             want);
+}
+
+// BC (or B) counting from 0 runs 65536 (256) iterations: LDIR copying all
+// of memory onto itself through the code, CPIR searching all of it for a
+// byte that is not there, OTIR sending 256 bytes; LDI with BC 0 wraps it
+// to FFFFh
+static bool test_block_wrap()
+{
+    Z80_CPU want;
+    return test_block_slices({"block_wrap",
+                              {
+                                  0x21, 0x00, 0x80, // LD HL,8000h
+                                  0x11, 0x00, 0x80, // LD DE,8000h
+                                  0x01, 0x00, 0x00, // LD BC,0
+                                  0xED, 0xB0,       // LDIR
+                                  0x3E, 0x77,       // LD A,77h
+                                  0xED, 0xB1,       // CPIR
+                                  0x21, 0x00, 0xA0, // LD HL,A000h
+                                  0x01, 0x10, 0x00, // LD BC,0010h: B 0, port 10h
+                                  0xED, 0xB3,       // OTIR
+                                  0x01, 0x00, 0x00, // LD BC,0
+                                  0xED, 0xA0,       // LDI
+                                  0x3E, 0x10,       // LD A,10h
+                                  0x01, 0x00, 0x02, // LD BC,0200h
+                                  0xED, 0xB1,       // CPIR
+                                  0x21, 0xFF, 0xBF, // LD HL,BFFFh
+                                  0x01, 0x00, 0x20, // LD BC,2000h
+                                  0xED, 0xB9,       // CPDR
+                                  0x76,             // HALT
+                              },
+                              [](Z80Machine &m)
+                              {
+                                  for (int addr = 0x8000; addr < 0xC000; addr++)
+                                      m.mem_write(static_cast<uint16_t>(addr), static_cast<uint8_t>(addr & 0x3F));
+                              }},
+                             want);
+}
+
+#define TEST_BLOCK_ROM "z80_test_block_rom.bin"
+
+// A ROM bank mapped at 8000h, one slot long
+static void test_block_rom(Z80Machine &m)
+{
+    int bank = m.add_rom_bank(TEST_BLOCK_ROM);
+    if (bank < 0 || !m.map_page(0x8000 >> Z80_PAGE_BITS, bank, 0))
+        std::printf("block_slots: cannot map " TEST_BLOCK_ROM "\n");
+}
+
+// Copies across slot boundaries, out of ROM into RAM and from RAM into ROM
+// (where the writes are lost)
+static bool test_block_slots()
+{
+    std::vector<uint8_t> rom(Z80_PAGE_SIZE);
+    for (size_t i = 0; i < rom.size(); i++)
+        rom[i] = static_cast<uint8_t>(i * 5 + 1);
+    FILE *file = std::fopen(TEST_BLOCK_ROM, "wb");
+    bool ok = file != nullptr && std::fwrite(rom.data(), 1, rom.size(), file) == rom.size();
+    if (file != nullptr)
+        std::fclose(file);
+
+    const uint16_t rom_end = 0x8000 + Z80_PAGE_SIZE;
+    Z80_CPU want;
+    ok = ok && test_block_slices({"block_slots",
+                                  {
+                                      0x21, 0xC0, 0x7F,       // LD HL,7FC0h
+                                      0x11, 0xE0, 0x6F,       // LD DE,6FE0h
+                                      0x01, 0x80, 0x00,       // LD BC,0080h: across a slot and into ROM
+                                      0xED, 0xB0,             // LDIR
+                                      0x21, 0x00, 0x10,       // LD HL,1000h
+                                      0x11, 0xF0, 0x7F,       // LD DE,7FF0h
+                                      0x01, 0x40, 0x00,       // LD BC,0040h: into ROM
+                                      0xED, 0xB0,             // LDIR
+                                      0x21, static_cast<uint8_t>(rom_end + 0x1F), // LD HL,ROM end + 1Fh
+                                      static_cast<uint8_t>((rom_end + 0x1F) >> 8),
+                                      0x11, 0x1F, 0x30,       // LD DE,301Fh
+                                      0x01, 0x40, 0x00,       // LD BC,0040h: out of ROM, down
+                                      0xED, 0xB8,             // LDDR
+                                      0x76,                   // HALT
+                                  },
+                                  [](Z80Machine &m)
+                                  {
+                                      for (int addr = 0x1000; addr < 0x1040; addr++)
+                                          m.mem_write(static_cast<uint16_t>(addr), static_cast<uint8_t>(~addr));
+                                      test_block_rom(m);
+                                  }},
+                                 want);
+    std::remove(TEST_BLOCK_ROM);
+    return ok;
+}
+
+// LDIR over code already decoded: first a routine that has been called
+// (INC B; RET at 0040h becomes DEC B; RET), then its own opcode, so the
+// repeat lands on the NOPs copied there: the run ends with BC 5, after
+// NOP; OR B; HALT
+static bool test_block_smc()
+{
+    std::vector<uint8_t> program = test_with_routine({
+        0xCD, 0x40, 0x00, // 0000 CALL 0040h
+        0x21, 0x00, 0x01, // 0003 LD HL,0100h
+        0x11, 0x30, 0x00, // 0006 LD DE,0030h
+        0x01, 0x12, 0x00, // 0009 LD BC,0012h
+        0xED, 0xB0,       // 000C LDIR
+        0xCD, 0x40, 0x00, // 000E CALL 0040h
+        0xCD, 0x40, 0x00, // 0011 CALL 0040h
+        0x21, 0x00, 0x01, // 0014 LD HL,0100h
+        0x11, 0x1B, 0x00, // 0017 LD DE,001Bh
+        0x01, 0x08, 0x00, // 001A LD BC,0008h
+        0xED, 0xB0,       // 001D LDIR
+        0x76,             // 001F HALT
+    });
+    Z80_CPU want;
+    bool ok = test_block_slices({"block_smc", program,
+                                 [](Z80Machine &m)
+                                 {
+                                     m.mem_write(0x0110, 0x05); // 0100: NOPs, then DEC B; RET
+                                     m.mem_write(0x0111, 0xC9);
+                                 }},
+                                want);
+    if (ok && (want.bc != 0x0005 || want.de != 0x001E || want.pc != 0x001F))
+        std::printf("block_smc: BC %04X DE %04X PC %04X, not 0005 001E 001F\n", want.bc, want.de, want.pc);
+    return ok && want.bc == 0x0005 && want.de == 0x001E && want.pc == 0x001F;
+}
+
+// Run program to HALT on a machine with breakpoints or watches (set by arm)
+// and on one without, both profiled and recorded, calling execute() again
+// after every stop. The stops have to be the expected ones, each leaving PC
+// at `pcs`, and the runs have to agree on T-states, registers (R included),
+// memory, profile and trace records: an instruction stopped at a breakpoint
+// counts when it runs after the resume, not before.
+static bool test_debug_against_plain(const char *name, const std::vector<uint8_t> &program,
+                                     void (*arm)(Z80Machine &m), const std::vector<Z80_Stop> &stops,
+                                     const std::vector<uint16_t> &pcs)
+{
+    std::unique_ptr<Z80Machine> plain(new Z80Machine()), debug(new Z80Machine());
+    Z80TraceWriter writers[2];
+    const char *paths[2] = {"z80_test_plain.trace", "z80_test_debug.trace"};
+    Z80Machine *machines[2] = {plain.get(), debug.get()};
+    bool ok = true;
+    for (int n = 0; n < 2; n++)
+    {
+        machines[n]->init();
+        for (size_t i = 0; i < program.size(); i++)
+            machines[n]->mem_write(static_cast<uint16_t>(i), program[i]);
+        ok &= machines[n]->enable_profile(true) && writers[n].open(paths[n], *machines[n]) &&
+              machines[n]->set_recorder(&writers[n]);
+    }
+    if (!ok)
+    {
+        std::printf("%s: cannot profile or record\n", name);
+        return false;
+    }
+    arm(*debug);
+
+    int cycles[2] = {plain->execute(TEST_JIT_BUDGET), 0};
+    size_t stopped = 0;
+    for (int run = 0; run < TEST_DEBUG_RUNS && !debug->cpu.halted; run++)
+    {
+        cycles[1] += debug->execute(TEST_JIT_BUDGET);
+        const Z80_Stop &stop = debug->stop_info();
+        if (stop.reason == Z80_STOP_NONE)
+            continue;
+        if (stopped == stops.size() || stop.reason != stops[stopped].reason || stop.addr != stops[stopped].addr ||
+            stop.value != stops[stopped].value || debug->cpu.pc != pcs[stopped])
+        {
+            std::printf("%s: stop %zu: reason %d at %04X (%02X), PC %04X\n", name, stopped, stop.reason, stop.addr,
+                        stop.value, debug->cpu.pc);
+            ok = false;
+        }
+        stopped++;
+    }
+    for (int n = 0; n < 2; n++)
+    {
+        machines[n]->set_recorder(nullptr);
+        ok &= writers[n].close();
+        std::remove(paths[n]);
+    }
+
+    Z80_CPU got = debug->cpu, want = plain->cpu;
+    if (stopped != stops.size() || cycles[0] != cycles[1] || !got.halted || got.pc != want.pc ||
+        got.a != want.a || flags_get(got) != flags_get(want) || got.bc != want.bc || got.de != want.de ||
+        got.r != want.r || writers[0].records() != writers[1].records() ||
+        std::memcmp(plain->ram, debug->ram, 65536) != 0 ||
+        std::memcmp(plain->profile_data(), debug->profile_data(), sizeof(Z80_Profile)) != 0)
+    {
+        std::printf("%s: %zu stops of %zu; stopped %d T-states PC %04X R %02X, %llu records; plain %d T-states PC "
+                    "%04X R %02X, %llu records\n",
+                    name, stopped, stops.size(), cycles[1], got.pc, got.r,
+                    static_cast<unsigned long long>(writers[1].records()), cycles[0], want.pc, want.r,
+                    static_cast<unsigned long long>(writers[0].records()));
+        ok = false;
+    }
+    return ok;
+}
+
+// A breakpoint inside a loop stops before each of its 3 passes, without
+// counting the instruction, and execute() resumes by running it
+static bool test_debug_break()
+{
+    return test_debug_against_plain("debug_break",
+                                    {
+                                        0x06, 0x03, // 0000 LD B,3
+                                        0x3E, 0x00, // 0002 LD A,0
+                                        0x3C,       // 0004 INC A
+                                        0x05,       // 0005 DEC B
+                                        0x20, 0xFC, // 0006 JR NZ,0004
+                                        0x76,       // 0008 HALT
+                                    },
+                                    [](Z80Machine &m) { m.set_breakpoint(0x0004, true); },
+                                    {{Z80_STOP_BREAK, 0x0004, 0}, {Z80_STOP_BREAK, 0x0004, 0},
+                                     {Z80_STOP_BREAK, 0x0004, 0}},
+                                    {0x0004, 0x0004, 0x0004});
+}
+
+// Watches stop after the instruction that wrote or read the byte, which is
+// counted once, and execute() goes on from the next one
+static bool test_debug_watch()
+{
+    static const std::vector<uint8_t> program = {
+        0x01, 0x90, 0x00, // 0000 LD BC,0090h
+        0x21, 0x90, 0x00, // 0003 LD HL,0090h
+        0x16, 0x02,       // 0006 LD D,2
+        0x3E, 0x05,       // 0008 LD A,5
+        0x02,             // 000A LD (BC),A
+        0xCB, 0x2F,       // 000B BIT 5,(HL)
+        0x3C,             // 000D INC A
+        0x15,             // 000E DEC D
+        0x20, 0xF9,       // 000F JR NZ,000A
+        0x76,             // 0011 HALT
+    };
+    bool ok = test_debug_against_plain("debug_watch", program,
+                                       [](Z80Machine &m) { m.set_watch(0x0090, 1, Z80_WATCH_WRITE, true); },
+                                       {{Z80_STOP_WRITE, 0x0090, 0x05}, {Z80_STOP_WRITE, 0x0090, 0x06}},
+                                       {0x000B, 0x000B});
+#if Z80_WATCH_READS
+    ok &= test_debug_against_plain("debug_watch", program,
+                                   [](Z80Machine &m) { m.set_watch(0x0090, 1, Z80_WATCH_READ | Z80_WATCH_WRITE, true); },
+                                   {{Z80_STOP_WRITE, 0x0090, 0x05},
+                                    {Z80_STOP_READ, 0x0090, 0x05},
+                                    {Z80_STOP_WRITE, 0x0090, 0x06},
+                                    {Z80_STOP_READ, 0x0090, 0x06}},
+                                   {0x000B, 0x000D, 0x000B, 0x000D});
+#endif
+    return ok;
+}
+
+// A status port read by a polling loop: counts the reads and never gets
+// ready
+static uint8_t test_status_read(void *ctx, uint16_t)
+{
+    ++*static_cast<int *>(ctx);
+    return 0x00;
+}
+
+// IN A,(10h); SUB B; JR Z,$-3 waits for the status port to read other than
+// B (0). On a stable port execute() skips every pass after the first one
+// that changes nothing, so the handler is read at most 3 times whatever the
+// budget; otherwise it is read every pass. Both runs take the same T-states
+// and end with the same registers and R.
+static bool test_spin_stable_port()
+{
+    static const uint8_t program[] = {0xDB, 0x10, 0x90, 0x28, 0xFB, 0x76};
+    std::unique_ptr<Z80Machine> machines[2] = {std::unique_ptr<Z80Machine>(new Z80Machine()),
+                                               std::unique_ptr<Z80Machine>(new Z80Machine())};
+    int reads[2] = {0, 0}, cycles[2];
+    for (int n = 0; n < 2; n++)
+    {
+        machines[n]->init();
+        machines[n]->ports.map(0x10, 0x10, {test_status_read, nullptr, &reads[n], n == 0});
+        for (size_t i = 0; i < sizeof(program); i++)
+            machines[n]->mem_write(static_cast<uint16_t>(i), program[i]);
+        cycles[n] = machines[n]->execute(TEST_JIT_BUDGET);
+    }
+
+    Z80_CPU got = machines[0]->cpu, want = machines[1]->cpu;
+    bool ok = reads[0] <= 3 && reads[1] >= cycles[1] / 27 && cycles[0] == cycles[1] && got.pc == want.pc &&
+              got.a == want.a && flags_get(got) == flags_get(want) && got.r == want.r;
+    if (!ok)
+        std::printf("spin_stable_port: stable %d reads %d T-states R %02X, polled %d reads %d T-states R %02X\n",
+                    reads[0], cycles[0], got.r, reads[1], cycles[1], want.r);
+    return ok;
+}
+
+// Fill memory from 1000h up, a byte per pass, so a run writes across slots:
+// LD BC,1000h; loop: LD (BC),A; INC A; INC C; JR NZ,loop; INC B; JR loop
+static const uint8_t test_snap_program[] = {0x01, 0x00, 0x10, 0x02, 0x3C, 0x0C, 0x20, 0xFB, 0x04, 0x18, 0xF8};
+
+static void test_snap_load(Z80Machine &m)
+{
+    m.init();
+    for (size_t i = 0; i < sizeof(test_snap_program); i++)
+        m.mem_write(static_cast<uint16_t>(i), test_snap_program[i]);
+}
+
+// Memory, registers and clock of a rewound machine against a fresh run to
+// the same time
+static bool test_snap_same(const char *what, Z80Machine &m, const Z80Snapshots &snaps, Z80Machine &ref,
+                           const Z80Scheduler &sched)
+{
+    bool memory = std::memcmp(m.ram, ref.ram, 65536) == 0;
+    if (snaps.now() == sched.now() && m.cpu.pc == ref.cpu.pc && m.cpu.a == ref.cpu.a && m.cpu.bc == ref.cpu.bc &&
+        flags_get(m.cpu) == flags_get(ref.cpu) && m.cpu.r == ref.cpu.r && memory)
+        return true;
+    std::printf("snap_rewind: %s: clock %llu PC %04X BC %04X R %02X, fresh run %llu PC %04X BC %04X R %02X%s\n",
+                what, static_cast<unsigned long long>(snaps.now()), m.cpu.pc, m.cpu.bc, m.cpu.r,
+                static_cast<unsigned long long>(sched.now()), ref.cpu.pc, ref.cpu.bc, ref.cpu.r,
+                memory ? "" : ", memory differs");
+    return false;
+}
+
+// Checkpoint a run that writes across several slots, then rewind it to
+// times between checkpoints, latest first, and run on from there. With the
+// smallest arena the oldest checkpoints have been folded into the next
+// (drop_oldest) and the ring has wrapped before the first rewind; with a
+// large one every checkpoint back to time 0 is still there.
+static bool test_snap_rewind()
+{
+    static const struct
+    {
+        uint64_t interval;
+        size_t pages;
+    } runs[] = {{1000, Z80_SNAP_MIN_PAGES}, {37000, 8 * Z80_SNAP_MIN_PAGES}};
+    std::unique_ptr<Z80Machine> m(new Z80Machine()), ref(new Z80Machine());
+    bool ok = true;
+    for (const auto &run : runs)
+    {
+        uint64_t interval = run.interval;
+        test_snap_load(*m);
+        Z80Snapshots snaps(*m, interval, run.pages);
+        snaps.run(TEST_SNAP_CYCLES);
+        bool wrapped = snaps.oldest() > 0;
+        if (wrapped != (run.pages == Z80_SNAP_MIN_PAGES) || (wrapped && snaps.rewind(snaps.oldest() - 1)))
+        {
+            std::printf("snap_rewind: interval %llu: oldest checkpoint at %llu of %zu\n",
+                        static_cast<unsigned long long>(interval), static_cast<unsigned long long>(snaps.oldest()),
+                        snaps.count());
+            ok = false;
+        }
+
+        for (int k = 3; k > 0; k--)
+        {
+            uint64_t when = snaps.oldest() + (snaps.now() - snaps.oldest()) * k / 4 + interval / 2;
+            test_snap_load(*ref);
+            Z80Scheduler sched(*ref);
+            sched.run(when);
+            ok &= snaps.rewind(when) && test_snap_same("rewind", *m, snaps, *ref, sched);
+            snaps.run(TEST_SNAP_AGAIN);
+            sched.run(snaps.now() - sched.now());
+            ok &= test_snap_same("run on", *m, snaps, *ref, sched);
+        }
+    }
+    return ok;
+}
+
+#define TEST_STATE_FILE "z80_test.z80s"
+#define TEST_STATE_TAG 0x434F4E53 // "CONS"
+
+static bool test_write_file(const char *path, const std::vector<uint8_t> &bytes)
+{
+    FILE *file = std::fopen(path, "wb");
+    bool ok = file != nullptr && std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    if (file != nullptr)
+        ok &= std::fclose(file) == 0;
+    return ok;
+}
+
+static std::string test_cpu_text(Z80Machine &m)
+{
+    std::ostringstream text;
+    m.display_state(text);
+    return text.str();
+}
+
+// Save a machine partway through a run that writes across memory, restore
+// it into a fresh one, and check registers, memory and device blobs come
+// back and both machines go on to the same state
+static bool test_state_round_trip()
+{
+    std::unique_ptr<Z80Machine> saved(new Z80Machine()), restored(new Z80Machine());
+    test_snap_load(*saved);
+    saved->execute(TEST_STATE_CYCLES);
+    saved->cpu.ix = 0x1234;
+    saved->cpu.iy = 0xFEDC;
+    saved->cpu.i = 0x3F;
+    saved->cpu.im = 2;
+    const std::vector<Z80_StateDevice> devices = {{TEST_STATE_TAG, {1, 2, 3}}, {7, {}}};
+    bool ok = z80_save_state(TEST_STATE_FILE, *saved, devices);
+
+    Z80SavedState state;
+    restored->init();
+    ok = ok && state.open(TEST_STATE_FILE);
+    if (ok)
+    {
+        state.restore(*restored);
+        size_t size = 0, empty = 1, none = 0;
+        const uint8_t *blob = state.device(TEST_STATE_TAG, size);
+        ok = blob != nullptr && size == 3 && blob[0] == 1 && blob[2] == 3 && state.device(7, empty) != nullptr &&
+             empty == 0 && state.device(8, none) == nullptr;
+        ok &= test_cpu_text(*saved) == test_cpu_text(*restored) && saved->cpu.r == restored->cpu.r &&
+              std::memcmp(saved->ram, restored->ram, 65536) == 0;
+        saved->execute(TEST_STATE_CYCLES);
+        restored->execute(TEST_STATE_CYCLES);
+        ok &= test_cpu_text(*saved) == test_cpu_text(*restored) && std::memcmp(saved->ram, restored->ram, 65536) == 0;
+        restored->attach_memory(nullptr); // Off the state's mapping before it closes
+    }
+    std::remove(TEST_STATE_FILE);
+    if (!ok)
+        std::printf("state_round_trip: restored machine differs from the saved one\n");
+    return ok;
+}
+
+// A state file with one thing wrong at a time has to be refused by open():
+// magic, version, header size, memory offset, truncation, and device entries
+// reaching past the start of memory
+static bool test_state_reject()
+{
+    std::unique_ptr<Z80Machine> m(new Z80Machine());
+    test_snap_load(*m);
+    std::vector<uint8_t> good;
+    bool ok = z80_save_state(TEST_STATE_FILE, *m, {{TEST_STATE_TAG, {1, 2, 3}}});
+    FILE *file = std::fopen(TEST_STATE_FILE, "rb");
+    if (ok && file != nullptr)
+    {
+        good.resize(Z80_STATE_ALIGN + 65536);
+        good.resize(std::fread(good.data(), 1, good.size(), file));
+    }
+    if (file != nullptr)
+        std::fclose(file);
+    if (!ok || good.size() != Z80_STATE_ALIGN + 65536)
+    {
+        std::printf("state_reject: cannot save a state file\n");
+        return false;
+    }
+
+    static const struct
+    {
+        const char *what;
+        size_t at;     // Byte to change
+        uint8_t value; // New value
+        size_t size;   // Bytes of the file kept
+    } bad[] = {
+        {"good file", 0, 'Z', Z80_STATE_ALIGN + 65536},
+        {"bad magic", 3, 'X', Z80_STATE_ALIGN + 65536},
+        {"bad version", 4, Z80_STATE_VERSION + 1, Z80_STATE_ALIGN + 65536},
+        {"bad header size", 6, Z80_STATE_HEADER + 4, Z80_STATE_ALIGN + 65536},
+        {"unaligned memory", 8, 0x40, Z80_STATE_ALIGN + 65536},
+        {"memory past the end", 10, 0x02, Z80_STATE_ALIGN + 65536},
+        {"truncated memory", 0, 'Z', Z80_STATE_ALIGN + 65535},
+        {"truncated header", 0, 'Z', Z80_STATE_HEADER - 1},
+        {"device count", 14, 0x01, Z80_STATE_ALIGN + 65536},
+        {"device offset", Z80_STATE_HEADER + 6, 0x01, Z80_STATE_ALIGN + 65536},
+        {"device size", Z80_STATE_HEADER + 11, 0xFF, Z80_STATE_ALIGN + 65536},
+    };
+    for (const auto &change : bad)
+    {
+        std::vector<uint8_t> bytes(good.begin(), good.begin() + change.size);
+        bytes[change.at] = change.value;
+        Z80SavedState state;
+        bool opened = test_write_file(TEST_STATE_FILE, bytes) && state.open(TEST_STATE_FILE);
+        if (opened != (&change == bad))
+        {
+            std::printf("state_reject: %s %s\n", change.what, opened ? "opened" : "refused");
+            ok = false;
+        }
+    }
+    std::remove(TEST_STATE_FILE);
+    return ok;
+}
+
+#if Z80_BUS_CYCLES
+// Memory, ports, stack, a block copy, then HALT until an INT (IM 1, handler
+// at 0038h), and after it HALT with interrupts off until an NMI (handler at
+// 0066h returns to a last HALT)
+static std::vector<uint8_t> test_bus_program()
+{
+    std::vector<uint8_t> program = {
+        0xED, 0x56,             // 0000 IM 1
+        0x01, 0x00, 0x90,       // 0002 LD BC,9000h
+        0x3E, 0x42,             // 0005 LD A,42h
+        0x02,                   // 0007 LD (BC),A
+        0xF5,                   // 0008 PUSH AF
+        0xDD, 0x21, 0x10, 0x90, // 0009 LD IX,9010h
+        0xDD, 0x77, 0x05,       // 000D LD (IX+5),A
+        0xD3, 0x20,             // 0010 OUT (20h),A
+        0xDB, 0x21,             // 0012 IN A,(21h)
+        0xCD, 0x40, 0x00,       // 0014 CALL 0040h
+        0xF1,                   // 0017 POP AF
+        0x21, 0x00, 0x90,       // 0018 LD HL,9000h
+        0x11, 0x00, 0xA0,       // 001B LD DE,A000h
+        0x01, 0x08, 0x00,       // 001E LD BC,0008h
+        0xED, 0xB0,             // 0021 LDIR
+        0xFB,                   // 0023 EI
+        0x76,                   // 0024 HALT
+        0x04,                   // 0025 INC B
+        0xF3,                   // 0026 DI
+        0x76,                   // 0027 HALT
+        0x76,                   // 0028 HALT
+    };
+    program.resize(0x70);
+    const uint8_t routines[][4] = {
+        {0x38, 0x0C, 0xFB, 0xC9}, // 0038 INC C; EI; RET
+        {0x40, 0xE3, 0xE3, 0xC9}, // 0040 EX (SP),HL; EX (SP),HL; RET
+        {0x66, 0x14, 0xED, 0x45}, // 0066 INC D; RETN
+    };
+    for (const auto &routine : routines)
+        std::memcpy(&program[routine[0]], routine + 1, 3);
+    return program;
+}
+
+// Cycles from the coroutine up to the one the CPU halts on, their T-states
+// summed and their kinds counted
+static uint64_t test_bus_until_halt(Z80BusCycles &cycles, const Z80Machine &m, int kinds[])
+{
+    uint64_t tstates = 0;
+    for (int n = 0; n < TEST_BUS_CYCLES && cycles.next(); n++)
+    {
+        tstates += cycles.cycle().tstates;
+        kinds[cycles.cycle().kind]++;
+        if (m.cpu.halted)
+            return tstates;
+    }
+    return 0;
+}
+
+// The M-cycles z80_bus_cycles() yields have to add up to the T-states
+// execute() counts for the same run, stretch by stretch between the HALTs
+// (the interrupt acknowledges included), and leave the same machine
+static bool test_bus_cycles()
+{
+    std::unique_ptr<Z80Machine> stepped(new Z80Machine()), run(new Z80Machine());
+    std::vector<uint8_t> program = test_bus_program();
+    for (Z80Machine *m : {stepped.get(), run.get()})
+    {
+        m->init();
+        for (size_t i = 0; i < program.size(); i++)
+            m->mem_write(static_cast<uint16_t>(i), program[i]);
+        m->cpu.sp = 0x8000;
+    }
+
+    Z80BusCycles cycles = z80_bus_cycles(*stepped);
+    int kinds[Z80_BUS_INTERNAL + 1] = {};
+    bool ok = true;
+    for (int stretch = 0; stretch < 3; stretch++)
+    {
+        if (stretch == 1)
+        {
+            stepped->set_int(true);
+            run->set_int(true);
+        }
+        else if (stretch == 2)
+        {
+            stepped->nmi();
+            run->nmi();
+        }
+        uint64_t yielded = test_bus_until_halt(cycles, *stepped, kinds);
+        int counted = run->execute(TEST_JIT_BUDGET);
+        if (yielded != static_cast<uint64_t>(counted) || !run->cpu.halted || stepped->cpu.pc != run->cpu.pc)
+        {
+            std::printf("bus_cycles: stretch %d: cycles add up to %llu T-states, execute() counted %d; PC %04X, %04X\n",
+                        stretch, static_cast<unsigned long long>(yielded), counted, stepped->cpu.pc, run->cpu.pc);
+            ok = false;
+        }
+    }
+
+    Z80_CPU got = stepped->cpu, want = run->cpu;
+    ok &= got.pc == 0x0028 && got.bc == want.bc && got.de == want.de && got.hl == want.hl && got.ix == want.ix &&
+          got.sp == want.sp && got.a == want.a && flags_get(got) == flags_get(want) &&
+          std::memcmp(stepped->ram, run->ram, 65536) == 0;
+    for (int kind = 0; kind <= Z80_BUS_INTERNAL; kind++)
+        ok &= kinds[kind] != 0 && (kind != Z80_BUS_INT_ACK || kinds[kind] == 1);
+    if (!ok)
+        std::printf("bus_cycles: PC %04X BC %04X DE %04X, execute() PC %04X BC %04X DE %04X; %d INT acknowledges\n",
+                    got.pc, got.bc, got.de, want.pc, want.bc, want.de, kinds[Z80_BUS_INT_ACK]);
+    return ok;
+}
+#endif
+
+struct Test
+{
+    const char *name;
+    bool (*run)();
+};
+
+static const Test tests[] = {
+    {"batch_timing", test_batch_timing},
+    {"run_long_budget", test_run_long_budget},
+    {"reload_rom_bank", test_reload_rom_bank},
+    {"new_machine_memory", test_new_machine_memory},
+    {"jit_smc", test_jit_smc},
+    {"jit_write_trap", test_jit_write_trap},
+    {"console_overflow", test_console_overflow},
+    {"block_overlap", test_block_overlap},
+    {"block_wrap", test_block_wrap},
+    {"block_slots", test_block_slots},
+    {"block_smc", test_block_smc},
+    {"debug_break", test_debug_break},
+    {"debug_watch", test_debug_watch},
+    {"spin_stable_port", test_spin_stable_port},
+    {"snap_rewind", test_snap_rewind},
+    {"state_round_trip", test_state_round_trip},
+    {"state_reject", test_state_reject},
+#if Z80_BUS_CYCLES
+    {"bus_cycles", test_bus_cycles},
+#endif
+};
+
+int main(int argc, char *argv[])
+{
+    z80_trace_level = Z80_TRACE_OFF;
+    int failed = 0, ran = 0;
+    for (const Test &test : tests)
+    {
+        if (argc > 1 && std::strcmp(argv[1], test.name) != 0)
+            continue;
+        ran++;
+        bool ok = test.run();
+        std::cout << test.name << ": " << (ok ? "ok" : "FAILED") << std::endl;
+        failed += !ok;
+    }
+    if (ran == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [test]" << std::endl;
+        return -1;
+    }
+    return failed != 0;
+}
@@ -0,0 +1,107 @@
+#ifndef Z80_TRACE_H
+#define Z80_TRACE_H
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Trace levels
+#define Z80_TRACE_OFF 0     // Final CPU state only
+#define Z80_TRACE_SUMMARY 1 // Init, load and cycle count messages
+#define Z80_TRACE_INSN 2    // One line per executed instruction
+
+// Highest level compiled into the emulator. Build with -DZ80_TRACE_LEVEL=0
+// and every trace call in the execute loop disappears.
+#ifndef Z80_TRACE_LEVEL
+#define Z80_TRACE_LEVEL Z80_TRACE_INSN
+#endif
+
+#define Z80_TRACE_RING_SIZE (64 * 1024) // Bytes buffered before a write
+#define Z80_TRACE_LINE_MAX 256          // Longest single trace line
+
+// Trace ring buffer. With a sink it is drained in one write whenever it
+// fills up; without one it wraps and keeps only the newest output. Each
+// thread has its own ring, so machines on different threads never contend.
+struct Z80_TraceRing
+{
+    char buf[Z80_TRACE_RING_SIZE];
+    size_t head; // Next byte to write
+    size_t used; // Bytes currently held
+    FILE *sink;  // Where flushed output goes (nullptr keeps the tail only)
+};
+
+inline int z80_trace_level = Z80_TRACE_SUMMARY; // Runtime level, capped by Z80_TRACE_LEVEL
+inline thread_local Z80_TraceRing z80_trace_ring = {{0}, 0, 0, stdout};
+
+// Write out everything held in the ring, oldest byte first
+inline void z80_trace_flush()
+{
+    Z80_TraceRing &ring = z80_trace_ring;
+    if (ring.used == 0 || ring.sink == nullptr)
+        return;
+
+    size_t start = (ring.head + Z80_TRACE_RING_SIZE - ring.used) % Z80_TRACE_RING_SIZE;
+    size_t first = ring.used < Z80_TRACE_RING_SIZE - start ? ring.used : Z80_TRACE_RING_SIZE - start;
+    std::fwrite(ring.buf + start, 1, first, ring.sink);
+    std::fwrite(ring.buf, 1, ring.used - first, ring.sink);
+    std::fflush(ring.sink);
+    ring.head = 0;
+    ring.used = 0;
+}
+
+// Format one trace line into the ring
+inline void z80_trace_printf(const char *fmt, ...)
+{
+    char line[Z80_TRACE_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = std::vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len <= 0)
+        return;
+    if (len >= static_cast<int>(sizeof(line)))
+        len = sizeof(line) - 1; // Truncated
+
+    Z80_TraceRing &ring = z80_trace_ring;
+    if (ring.sink != nullptr && ring.used + len > Z80_TRACE_RING_SIZE)
+        z80_trace_flush();
+
+    size_t first = static_cast<size_t>(len) < Z80_TRACE_RING_SIZE - ring.head ? len : Z80_TRACE_RING_SIZE - ring.head;
+    std::memcpy(ring.buf + ring.head, line, first);
+    std::memcpy(ring.buf, line + first, len - first);
+    ring.head = (ring.head + len) % Z80_TRACE_RING_SIZE;
+    ring.used = ring.used + len > Z80_TRACE_RING_SIZE ? Z80_TRACE_RING_SIZE : ring.used + len;
+}
+
+// Trace macros. Levels above Z80_TRACE_LEVEL compile to nothing, so their
+// arguments are never evaluated.
+#if Z80_TRACE_LEVEL >= Z80_TRACE_SUMMARY
+#define Z80_LOG_SUMMARY(...)                          \
+    do                                                \
+    {                                                 \
+        if (z80_trace_level >= Z80_TRACE_SUMMARY)     \
+            z80_trace_printf(__VA_ARGS__);            \
+    } while (0)
+#else
+#define Z80_LOG_SUMMARY(...) \
+    do                       \
+    {                        \
+    } while (0)
+#endif
+
+#if Z80_TRACE_LEVEL >= Z80_TRACE_INSN
+#define Z80_LOG_INSN(...)                             \
+    do                                                \
+    {                                                 \
+        if (z80_trace_level >= Z80_TRACE_INSN)        \
+            z80_trace_printf(__VA_ARGS__);            \
+    } while (0)
+#else
+#define Z80_LOG_INSN(...) \
+    do                    \
+    {                     \
+    } while (0)
+#endif
+
+#endif // Z80_TRACE_H